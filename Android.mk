@@ -141,6 +141,10 @@ LOCAL_SRC_FILES:= \
 	rsDevice.cpp \
 	rsElement.cpp \
 	rsFBOCache.cpp \
+	rsFence.cpp \
+	rsCommandQueue.cpp \
+	rsCommandScheduler.cpp \
+	rsFusionRecorder.cpp \
 	rsFifoSocket.cpp \
 	rsFileA3D.cpp \
 	rsFont.cpp \
@@ -165,8 +169,10 @@ LOCAL_SRC_FILES:= \
 	rsScriptGroup.cpp \
 	rsScriptIntrinsic.cpp \
 	rsSignal.cpp \
+	rsStats.cpp \
 	rsStream.cpp \
 	rsThreadIO.cpp \
+	rsTrace.cpp \
 	rsType.cpp
 
 LOCAL_SHARED_LIBRARIES += liblog libcutils libutils libEGL libGLESv1_CM libGLESv2 libc++
@@ -240,6 +246,10 @@ LOCAL_SRC_FILES:= \
 	rsDevice.cpp \
 	rsElement.cpp \
 	rsFBOCache.cpp \
+	rsFence.cpp \
+	rsCommandQueue.cpp \
+	rsCommandScheduler.cpp \
+	rsFusionRecorder.cpp \
 	rsFifoSocket.cpp \
 	rsFileA3D.cpp \
 	rsFont.cpp \
@@ -263,8 +273,10 @@ LOCAL_SRC_FILES:= \
 	rsScriptGroup.cpp \
 	rsScriptIntrinsic.cpp \
 	rsSignal.cpp \
+	rsStats.cpp \
 	rsStream.cpp \
 	rsThreadIO.cpp \
+	rsTrace.cpp \
 	rsType.cpp
 
 LOCAL_STATIC_LIBRARIES := libcutils libutils liblog
@@ -286,6 +298,8 @@ rsloader_SRC_FILES := \
   cpu_ref/linkloader/lib/ELFSectionHeader.cpp \
   cpu_ref/linkloader/lib/ELFTypes.cpp \
   cpu_ref/linkloader/lib/GOT.cpp \
+  cpu_ref/linkloader/lib/ImageCache.cpp \
+  cpu_ref/linkloader/lib/MemArena.cpp \
   cpu_ref/linkloader/lib/MemChunk.cpp \
   cpu_ref/linkloader/lib/StubLayout.cpp \
   cpu_ref/linkloader/utils/helper.cpp \
@@ -26,6 +26,12 @@
  * This program takes an optional -v parameter, the RS version to target the
  * test files for.  The header file will always contain all the functions.
  *
+ * With the -b parameter, it instead generates {spec}_bench.cpp, a native harness
+ * that looks up each scalar float function in the CPU runtime math table
+ * (cpu_ref/rsCpuRuntimeMath.cpp) and, for every vector width found in the spec,
+ * reports the maximum ULP error against the double precision libm and the time
+ * per element.
+ *
  * This program contains five main classes:
  * - SpecFile: Represents on spec file.
  * - Function: Each instance represents a function, like clamp.  Even though the
@@ -78,6 +84,147 @@ const char* LEGAL_NOTICE =
             " * limitations under the License.\n"
             " */\n\n";
 
+/* Support code placed before the generated tables of the benchmark harness.  Vector widths are
+ * evaluated lane by lane through the scalar entry point, which is what the CPU runtime does for
+ * them.
+ */
+const char* BENCH_PROLOGUE =
+            "#include <math.h>\n"
+            "#include <stdio.h>\n"
+            "#include <stdlib.h>\n"
+            "#include <time.h>\n\n"
+            "#include \"rsCpuCore.h\"\n"
+            "#include \"rsCpuScript.h\"\n\n"
+            "using namespace android;\n"
+            "using namespace android::renderscript;\n\n"
+            "namespace {\n\n"
+            "typedef float (*Fn1)(float);\n"
+            "typedef float (*Fn2)(float, float);\n"
+            "typedef float (*Fn3)(float, float, float);\n\n"
+            "struct BenchEntry {\n"
+            "    const char* name;       // e.g. pow(float4, float4)\n"
+            "    const char* symbol;     // Mangled scalar name in the CPU runtime math table\n"
+            "    int vectorSize;\n"
+            "    int inputCount;\n"
+            "    int isVector[3];        // 0 if the argument is a scalar broadcast to all lanes\n"
+            "    float minValue[3];\n"
+            "    float maxValue[3];\n"
+            "    double (*reference)(const double* args);\n"
+            "};\n\n";
+
+const char* BENCH_EPILOGUE =
+            "const int NUM_ENTRIES = sizeof(ENTRIES) / sizeof(ENTRIES[0]);\n\n"
+            "double ulpError(float actual, double expected) {\n"
+            "    if (isnan(expected)) {\n"
+            "        return isnan(actual) ? 0.0 : INFINITY;\n"
+            "    }\n"
+            "    if (isinf(expected) || fabs(expected) > 0x1.fffffep127) {\n"
+            "        return (isinf(actual) && (actual > 0) == (expected > 0)) ? 0.0 : INFINITY;\n"
+            "    }\n"
+            "    int exponent;\n"
+            "    frexp(expected, &exponent);\n"
+            "    double ulp = ldexp(1.0, exponent - 24 < -149 ? -149 : exponent - 24);\n"
+            "    return fabs((double)actual - expected) / ulp;\n"
+            "}\n\n"
+            "double nowNs() {\n"
+            "    struct timespec t;\n"
+            "    clock_gettime(CLOCK_MONOTONIC, &t);\n"
+            "    return t.tv_sec * 1e9 + t.tv_nsec;\n"
+            "}\n\n"
+            "// Runs the entry over count vectors; returns the time per element in ns.\n"
+            "double runEntry(const BenchEntry& e, void* fn, const float* in[3], float* out,\n"
+            "                int count, int iterations) {\n"
+            "    const int lanes = e.vectorSize;\n"
+            "    double start = nowNs();\n"
+            "    for (int it = 0; it < iterations; it++) {\n"
+            "        for (int v = 0; v < count; v++) {\n"
+            "            for (int l = 0; l < lanes; l++) {\n"
+            "                int o = v * lanes + l;\n"
+            "                float a = in[0][e.isVector[0] ? o : v];\n"
+            "                switch (e.inputCount) {\n"
+            "                case 1:\n"
+            "                    out[o] = ((Fn1)fn)(a);\n"
+            "                    break;\n"
+            "                case 2:\n"
+            "                    out[o] = ((Fn2)fn)(a, in[1][e.isVector[1] ? o : v]);\n"
+            "                    break;\n"
+            "                default:\n"
+            "                    out[o] = ((Fn3)fn)(a, in[1][e.isVector[1] ? o : v],\n"
+            "                                       in[2][e.isVector[2] ? o : v]);\n"
+            "                    break;\n"
+            "                }\n"
+            "            }\n"
+            "        }\n"
+            "    }\n"
+            "    return (nowNs() - start) / ((double)iterations * count * lanes);\n"
+            "}\n\n"
+            "}  // namespace\n\n"
+            "int main(int argc, char* argv[]) {\n"
+            "    int iterations = argc > 1 ? atoi(argv[1]) : 10;\n"
+            "    int count = argc > 2 ? atoi(argv[2]) : 4096;\n"
+            "    if (iterations <= 0 || count <= 0) {\n"
+            "        printf(\"Usage: %s [iterations] [vectors]\\n\", argv[0]);\n"
+            "        return 1;\n"
+            "    }\n\n"
+            "    float* in[3];\n"
+            "    for (int i = 0; i < 3; i++) {\n"
+            "        in[i] = new float[count * 4];\n"
+            "    }\n"
+            "    float* out = new float[count * 4];\n\n"
+            "    printf(\"%-40s %12s %12s\\n\", \"function\", \"max ulp\", \"ns/element\");\n"
+            "    int missing = 0;\n"
+            "    for (int i = 0; i < NUM_ENTRIES; i++) {\n"
+            "        const BenchEntry& e = ENTRIES[i];\n"
+            "        const RsdCpuReference::CpuSymbol* sym =\n"
+            "                RsdCpuScriptImpl::lookupSymbolMath(e.symbol);\n"
+            "        if (!sym) {\n"
+            "            printf(\"%-40s %12s\\n\", e.name, \"(not in runtime)\");\n"
+            "            missing++;\n"
+            "            continue;\n"
+            "        }\n\n"
+            "        srand(i);\n"
+            "        for (int a = 0; a < e.inputCount; a++) {\n"
+            "            for (int j = 0; j < count * 4; j++) {\n"
+            "                float r = (float)rand() / RAND_MAX;\n"
+            "                in[a][j] = e.minValue[a] + r * (e.maxValue[a] - e.minValue[a]);\n"
+            "            }\n"
+            "        }\n"
+            "        const float* inputs[3] = {in[0], in[1], in[2]};\n"
+            "        double ns = runEntry(e, sym->fnPtr, inputs, out, count, iterations);\n\n"
+            "        double maxUlp = 0.0;\n"
+            "        for (int v = 0; v < count; v++) {\n"
+            "            for (int l = 0; l < e.vectorSize; l++) {\n"
+            "                int o = v * e.vectorSize + l;\n"
+            "                double args[3];\n"
+            "                for (int a = 0; a < e.inputCount; a++) {\n"
+            "                    args[a] = in[a][e.isVector[a] ? o : v];\n"
+            "                }\n"
+            "                double u = ulpError(out[o], e.reference(args));\n"
+            "                if (u > maxUlp) {\n"
+            "                    maxUlp = u;\n"
+            "                }\n"
+            "            }\n"
+            "        }\n"
+            "        printf(\"%-40s %12.2f %12.3f\\n\", e.name, maxUlp, ns);\n"
+            "    }\n"
+            "    printf(\"%d functions, %d not found in the CPU runtime.\\n\", NUM_ENTRIES, missing);\n\n"
+            "    for (int i = 0; i < 3; i++) {\n"
+            "        delete[] in[i];\n"
+            "    }\n"
+            "    delete[] out;\n"
+            "    return 0;\n"
+            "}\n";
+
+// The spec functions that have a double precision libm counterpart of the same name, which the
+// benchmark harness uses as the reference.
+const char* LIBM_FUNCTIONS[] = {
+            "acos",  "acosh", "asin",   "asinh",     "atan",      "atan2", "atanh",  "cbrt",
+            "ceil",  "copysign", "cos", "cosh",      "erf",       "erfc",  "exp",    "exp2",
+            "expm1", "fdim",  "floor",  "fma",       "fmax",      "fmin",  "fmod",   "hypot",
+            "lgamma", "log",  "log10",  "log1p",     "logb",      "nextafter", "pow", "remainder",
+            "rint",  "round", "sin",    "sinh",      "sqrt",      "tan",   "tanh",   "tgamma",
+            "trunc"};
+
 class Function;
 class Specification;
 class Permutation;
@@ -134,7 +281,7 @@ struct ParameterDefinition {
 class SpecFile {
 public:
     explicit SpecFile(const string& specFileName) : mSpecFileName(specFileName) {}
-    bool process(int versionOfTestFiles);
+    bool process(int versionOfTestFiles, bool generateBench);
 
 private:
     const string mSpecFileName;
@@ -148,6 +295,8 @@ private:
     Function* getFunction(const string& name);
     bool generateFiles(int versionOfTestFiles);
     bool writeAllFunctions(ofstream& headerFile, int versionOfTestFiles);
+    // Write {spec}_bench.cpp, the native benchmark and accuracy harness.
+    bool generateBenchFile();
 };
 
 /* Represents a function, like "clamp".  Even though the spec file contains many entries for clamp,
@@ -168,6 +317,8 @@ private:
      */
     set<string> mRsAllocationsGenerated;
     set<string> mJavaGeneratedArgumentClasses;
+    // The reference functions already written for the benchmark harness, by input count.
+    set<int> mBenchReferencesGenerated;
 
     string mJavaCallAllCheckMethods;  // Lines of Java code to invoke the check methods.
 
@@ -192,6 +343,11 @@ public:
     void writeJavaArgumentClassDefinition(const string& className, const string& definition);
     // Add a call to mJavaCallAllCheckMethods to be used at the end of the file generation.
     void addJavaCheckCall(const string& call);
+    // Write the benchmark table entries of all the specifications of this function.
+    void writeBenchEntries(ostream& references, ostream& entries);
+    // Write the libm reference used by the benchmark, once per input count.
+    void writeBenchReference(ostream& references, int inputCount);
+    const string& getName() const { return mName; }
 };
 
 /* Defines one of the many variations of the function.  There's a one to one correspondance between
@@ -271,6 +427,7 @@ public:
 
     void writeFiles(ofstream& headerFile, ofstream& rsFile, ofstream& javaFile, Function* function,
                     int versionOfTestFiles);
+    void writeBenchEntries(ostream& references, ostream& entries, Function* function);
     bool writeRelaxedRsFile() const;
     // Return true if this specification should be generated for this version.
     bool relevantForVersion(int versionOfTestFiles) const;
@@ -364,6 +521,8 @@ public:
     Permutation(Function* function, Specification* specification, int i1, int i2, int i3, int i4);
     void writeFiles(ofstream& headerFile, ofstream& rsFile, ofstream& javaFile,
                     int versionOfTestFiles);
+    // Write the benchmark table entry, if this permutation only takes and returns floats.
+    void writeBenchEntry(ostream& references, ostream& entries) const;
 };
 
 // Table of type equivalences
@@ -533,11 +692,13 @@ void writeJavaArrayInitialization(ofstream& file, const ParameterDefinition& p)
     file << tab(2) << p.javaAllocName << ".copyTo(" << p.javaArrayName << ");\n";
 }
 
-bool parseCommandLine(int argc, char* argv[], int* versionOfTestFiles,
+bool parseCommandLine(int argc, char* argv[], int* versionOfTestFiles, bool* generateBench,
                       vector<string>* specFileNames) {
     for (int i = 1; i < argc; i++) {
         if (argv[i][0] == '-') {
-            if (argv[i][1] == 'v') {
+            if (argv[i][1] == 'b') {
+                *generateBench = true;
+            } else if (argv[i][1] == 'v') {
                 i++;
                 if (i < argc) {
                     char* end;
@@ -679,14 +840,18 @@ void ParameterDefinition::parseParameterDefinition(string s, bool isReturn, int*
     }
 }
 
-bool SpecFile::process(int versionOfTestFiles) {
+bool SpecFile::process(int versionOfTestFiles, bool generateBench) {
     if (!readSpecFile()) {
         return false;
     }
     if (versionOfTestFiles == 0) {
         versionOfTestFiles = mLargestVersionNumber;
     }
-    if (!generateFiles(versionOfTestFiles)) {
+    if (generateBench) {
+        if (!generateBenchFile()) {
+            return false;
+        }
+    } else if (!generateFiles(versionOfTestFiles)) {
         return false;
     }
     printf("%s: %ld functions processed.\n", mSpecFileName.c_str(), mFunctionsMap.size());
@@ -757,6 +922,40 @@ bool SpecFile::generateFiles(int versionOfTestFiles) {
     return success;
 }
 
+bool SpecFile::generateBenchFile() {
+    string benchFileName = mSpecFileName;
+    const char SPEC[] = ".spec";
+    const int SPEC_SIZE = sizeof(SPEC) - 1;
+    const int start = benchFileName.length() - SPEC_SIZE;
+    if (start >= 0 && benchFileName.compare(start, SPEC_SIZE, SPEC) == 0) {
+        benchFileName.erase(start);
+    }
+    benchFileName += "_bench.cpp";
+    printf("%s: Generating %s\n", mSpecFileName.c_str(), benchFileName.c_str());
+
+    ofstream benchFile;
+    benchFile.open(benchFileName.c_str(), ios::out | ios::trunc);
+    if (!benchFile.is_open()) {
+        printf("Error opening output file: %s\n", benchFileName.c_str());
+        return false;
+    }
+
+    ostringstream references;
+    ostringstream entries;
+    for (FunctionsIterator iter = mFunctionsMap.begin(); iter != mFunctionsMap.end(); iter++) {
+        iter->second->writeBenchEntries(references, entries);
+    }
+
+    benchFile << LEGAL_NOTICE;
+    benchFile << AUTO_GENERATED_WARNING;
+    benchFile << BENCH_PROLOGUE;
+    benchFile << references.str() << "\n";
+    benchFile << "const BenchEntry ENTRIES[] = {\n" << entries.str() << "};\n\n";
+    benchFile << BENCH_EPILOGUE;
+    benchFile.close();
+    return true;
+}
+
 // Return the named function from the map.  Creates it if it's not there.
 Function* SpecFile::getFunction(const string& name) {
     FunctionsIterator iter = mFunctionsMap.find(name);
@@ -881,6 +1080,28 @@ void Function::addJavaCheckCall(const string& call) {
     mJavaCallAllCheckMethods += tab(2) + call + "\n";
 }
 
+void Function::writeBenchEntries(ostream& references, ostream& entries) {
+    for (SpecificationIterator i = mSpecifications.begin(); i < mSpecifications.end(); i++) {
+        (*i)->writeBenchEntries(references, entries, this);
+    }
+}
+
+void Function::writeBenchReference(ostream& references, int inputCount) {
+    if (mBenchReferencesGenerated.find(inputCount) != mBenchReferencesGenerated.end()) {
+        return;
+    }
+    mBenchReferencesGenerated.insert(inputCount);
+    references << "double ref_" << mName << "_" << inputCount << "(const double* a) {\n";
+    references << tab(1) << "return " << mName << "(";
+    for (int i = 0; i < inputCount; i++) {
+        if (i > 0) {
+            references << ", ";
+        }
+        references << "a[" << i << "]";
+    }
+    references << ");\n}\n\n";
+}
+
 void Function::finishJavaFile() {
     mJavaFile << tab(1) << "public void test" << mCapitalizedName << "() {\n";
     mJavaFile << mJavaCallAllCheckMethods;
@@ -1076,6 +1297,30 @@ void Specification::writeFiles(ofstream& headerFile, ofstream& rsFile, ofstream&
     }
 }
 
+void Specification::writeBenchEntries(ostream& references, ostream& entries, Function* function) {
+    int start[4];
+    int end[4];
+    for (int i = 0; i < 4; i++) {
+        if (i < (int)mReplaceables.size()) {
+            start[i] = 0;
+            end[i] = mReplaceables[i].size();
+        } else {
+            start[i] = -1;
+            end[i] = 0;
+        }
+    }
+    for (int i4 = start[3]; i4 < end[3]; i4++) {
+        for (int i3 = start[2]; i3 < end[2]; i3++) {
+            for (int i2 = start[1]; i2 < end[1]; i2++) {
+                for (int i1 = start[0]; i1 < end[0]; i1++) {
+                    Permutation p(function, this, i1, i2, i3, i4);
+                    p.writeBenchEntry(references, entries);
+                }
+            }
+        }
+    }
+}
+
 bool Specification::relevantForVersion(int versionOfTestFiles) const {
     if (mMinVersion != 0 && mMinVersion > versionOfTestFiles) {
         return false;
@@ -1174,6 +1419,66 @@ void Permutation::writeFiles(ofstream& headerFile, ofstream& rsFile, ofstream& j
     }
 }
 
+void Permutation::writeBenchEntry(ostream& references, ostream& entries) const {
+    if (mReturnIndex < 0 || mTest == "none" || mName != mCleanName || mInputCount < 1 ||
+        mInputCount > 3) {
+        return;
+    }
+    bool inLibm = false;
+    for (size_t i = 0; i < sizeof(LIBM_FUNCTIONS) / sizeof(LIBM_FUNCTIONS[0]); i++) {
+        if (mName == LIBM_FUNCTIONS[i]) {
+            inLibm = true;
+        }
+    }
+    if (!inLibm) {
+        return;
+    }
+    for (size_t i = 0; i < mParams.size(); i++) {
+        const ParameterDefinition& p = *mParams[i];
+        if (p.rsBaseType != "float" || (p.isOutParameter && (int)i != mReturnIndex)) {
+            return;
+        }
+    }
+
+    mFunction->writeBenchReference(references, mInputCount);
+
+    // The runtime only exports the scalar version, e.g. _Z3powff.
+    string symbol = "_Z" + toString(mName.size()) + mName + string(mInputCount, 'f');
+    string name = mName + "(";
+    string isVector;
+    string minValues;
+    string maxValues;
+    int n = 0;
+    for (size_t i = 0; i < mParams.size(); i++) {
+        const ParameterDefinition& p = *mParams[i];
+        if ((int)i == mReturnIndex) {
+            continue;
+        }
+        if (n > 0) {
+            name += ", ";
+            isVector += ", ";
+            minValues += ", ";
+            maxValues += ", ";
+        }
+        name += p.rsType;
+        isVector += p.mVectorSize != "1" ? "1" : "0";
+        minValues += p.minValue.empty() ? "-100" : p.minValue;
+        maxValues += p.maxValue.empty() ? "100" : p.maxValue;
+        n++;
+    }
+    name += ")";
+    for (; n < 3; n++) {
+        isVector += ", 0";
+        minValues += ", 0";
+        maxValues += ", 0";
+    }
+
+    entries << tab(1) << "{\"" << name << "\", \"" << symbol << "\", "
+            << mParams[mReturnIndex]->mVectorSize << ", " << mInputCount << ", {" << isVector
+            << "}, {" << minValues << "}, {" << maxValues << "}, &ref_" << mName << "_"
+            << mInputCount << "},\n";
+}
+
 void Permutation::writeHeaderSection(ofstream& file) const {
     int minVersion = mSpecification->getMinVersion();
     int maxVersion = mSpecification->getMaxVersion();
@@ -1947,15 +2252,16 @@ void Permutation::writeJavaCallToRs(ofstream& file, bool relaxed, bool generateC
 
 int main(int argc, char* argv[]) {
     int versionOfTestFiles = 0;
+    bool generateBench = false;
     vector<string> specFileNames;
-    if (!parseCommandLine(argc, argv, &versionOfTestFiles, &specFileNames)) {
-        printf("Usage: gen_runtime spec_file [spec_file...] [-v version_of_test_files]\n");
+    if (!parseCommandLine(argc, argv, &versionOfTestFiles, &generateBench, &specFileNames)) {
+        printf("Usage: gen_runtime spec_file [spec_file...] [-v version_of_test_files] [-b]\n");
         return -1;
     }
     int result = 0;
     for (size_t i = 0; i < specFileNames.size(); i++) {
         SpecFile specFile(specFileNames[i]);
-        if (!specFile.process(versionOfTestFiles)) {
+        if (!specFile.process(versionOfTestFiles, generateBench)) {
             result = -1;
         }
     }
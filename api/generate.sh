@@ -21,4 +21,6 @@ g++ gen_runtime.cpp -Wall -o gen_runtime
 mv Test*.java ../../../cts/tests/tests/renderscript/src/android/renderscript/cts/
 mv Test*.rs ../../../cts/tests/tests/renderscript/src/android/renderscript/cts/
 mv rs_core_math.rsh ../scriptc/
+./gen_runtime -b rs_core_math.spec
+mv rs_core_math_bench.cpp ../tests/cpumathbench/
 rm ./gen_runtime
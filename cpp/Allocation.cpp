@@ -149,6 +149,27 @@ void Allocation::syncAll(RsAllocationUsageType srcLocation) {
     tryDispatch(mRS, RS::dispatch->AllocationSyncAll(mRS->getContext(), getIDSafe(), srcLocation));
 }
 
+void Allocation::generateMipmaps() {
+    tryDispatch(mRS, RS::dispatch->AllocationGenerateMipmaps(mRS->getContext(), getID()));
+}
+
+void Allocation::generateMipmaps(RsMipmapFilter filter) {
+    tryDispatch(mRS, RS::dispatch->AllocationGenerateMipmapsFiltered(mRS->getContext(),
+                                                                    getID(), filter));
+}
+
+sp<Allocation> Allocation::clone() {
+    void *id = 0;
+    if (mRS->getError() == RS_SUCCESS) {
+        id = RS::dispatch->AllocationClone(mRS->getContext(), getID());
+    }
+    if (id == 0) {
+        mRS->throwError(RS_ERROR_RUNTIME_ERROR, "Allocation clone failed");
+        return NULL;
+    }
+    return new Allocation(id, mRS, mType, mUsage);
+}
+
 void Allocation::ioSendOutput() {
 #ifndef RS_COMPATIBILITY_LIB
     if ((mUsage & RS_ALLOCATION_USAGE_IO_OUTPUT) == 0) {
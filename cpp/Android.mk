@@ -7,7 +7,9 @@ rs_cpp_SRC_FILES := \
 	Script.cpp \
 	ScriptC.cpp \
 	ScriptIntrinsics.cpp \
-	Sampler.cpp
+	Sampler.cpp \
+	Fence.cpp \
+	CommandQueue.cpp
 
 LOCAL_PATH:= $(call my-dir)
 include $(CLEAR_VARS)
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RenderScript.h"
+#include "rsCppInternal.h"
+
+using namespace android;
+using namespace RSC;
+
+CommandQueue::CommandQueue(sp<RS> rs, void *id) :
+    BaseObj(id, rs)
+{
+}
+
+CommandQueue::~CommandQueue() {
+    // Drain the queue so pending work is not dropped when the native object
+    // goes away, then make sure the destroy is not routed through itself.
+    void *prev = RS::dispatch->ContextBindQueue(mRS->getContext(), getID());
+    RS::dispatch->ContextFinish(mRS->getContext());
+    if (prev == getID()) {
+        prev = NULL;
+    }
+    RS::dispatch->ContextBindQueue(mRS->getContext(), prev);
+}
+
+sp<CommandQueue> CommandQueue::create(sp<RS> rs) {
+    void *id = RS::dispatch->ContextCreateQueue(rs->getContext());
+    if (id == NULL) {
+        rs->throwError(RS_ERROR_RUNTIME_ERROR, "Command queue creation failed");
+        return NULL;
+    }
+    return new CommandQueue(rs, id);
+}
+
+void CommandQueue::bind() {
+    RS::dispatch->ContextBindQueue(mRS->getContext(), getID());
+}
+
+void CommandQueue::unbind(sp<RS> rs) {
+    RS::dispatch->ContextBindQueue(rs->getContext(), NULL);
+}
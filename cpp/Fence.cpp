@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RenderScript.h"
+#include "rsCppInternal.h"
+
+using namespace android;
+using namespace RSC;
+
+Fence::Fence(sp<RS> rs, void *id) :
+    BaseObj(id, rs)
+{
+    mHasCallback = false;
+}
+
+sp<Fence> Fence::insert(sp<RS> rs) {
+    void *id = RS::dispatch->FenceCreate(rs->getContext());
+    if (id == NULL) {
+        rs->throwError(RS_ERROR_RUNTIME_ERROR, "Fence creation failed");
+        return NULL;
+    }
+    tryDispatch(rs, RS::dispatch->ContextInsertFence(rs->getContext(), id));
+    return new Fence(rs, id);
+}
+
+bool Fence::isSignaled() {
+    return RS::dispatch->FenceWait(mRS->getContext(), getID(), 0);
+}
+
+bool Fence::wait(int64_t timeoutNs) {
+    return RS::dispatch->FenceWait(mRS->getContext(), getID(), timeoutNs);
+}
+
+void Fence::setCallback(FenceCallbackFunc_t func, void *usr) {
+    if (mHasCallback) {
+        mRS->throwError(RS_ERROR_INVALID_PARAMETER, "Fence callback already set");
+        return;
+    }
+    mHasCallback = true;
+    // The context owns the callback, so the Fence itself may be released
+    // before it signals.
+    uintptr_t cookie = mRS->addFenceCallback(func, usr);
+    RS::dispatch->FenceSetNotify(mRS->getContext(), getID(), cookie);
+}
@@ -48,7 +48,10 @@ RS::RS() {
     mMessageFunc = NULL;
     mMessageRun = false;
     mInit = false;
+    mAsyncScripts = false;
     mCurrentError = RS_SUCCESS;
+    mNextFenceCookie = 1;
+    pthread_mutex_init(&mFenceLock, NULL);
 
     memset(&mElements, 0, sizeof(mElements));
     memset(&mSamplers, 0, sizeof(mSamplers));
@@ -72,6 +75,7 @@ RS::~RS() {
             mDev = NULL;
         }
     }
+    pthread_mutex_destroy(&mFenceLock);
 }
 
 bool RS::init(std::string name, uint32_t flags) {
@@ -140,6 +144,16 @@ static bool loadSymbols(void* handle) {
         ALOGV("Couldn't initialize RS::dispatch->ContextPeekMessage");
         return false;
     }
+    RS::dispatch->ContextAcquireMessages = (ContextAcquireMessagesFnPtr)dlsym(handle, "rsContextAcquireMessages");
+    if (RS::dispatch->ContextAcquireMessages == NULL) {
+        ALOGV("Couldn't initialize RS::dispatch->ContextAcquireMessages");
+        return false;
+    }
+    RS::dispatch->ContextReleaseMessages = (ContextReleaseMessagesFnPtr)dlsym(handle, "rsContextReleaseMessages");
+    if (RS::dispatch->ContextReleaseMessages == NULL) {
+        ALOGV("Couldn't initialize RS::dispatch->ContextReleaseMessages");
+        return false;
+    }
     RS::dispatch->ContextSendMessage = (ContextSendMessageFnPtr)dlsym(handle, "rsContextSendMessage");
     if (RS::dispatch->ContextSendMessage == NULL) {
         ALOGV("Couldn't initialize RS::dispatch->ContextSendMessage");
@@ -150,6 +164,36 @@ static bool loadSymbols(void* handle) {
         ALOGV("Couldn't initialize RS::dispatch->ContextInitToClient");
         return false;
     }
+    RS::dispatch->FenceCreate = (FenceCreateFnPtr)dlsym(handle, "rsFenceCreate");
+    if (RS::dispatch->FenceCreate == NULL) {
+        ALOGV("Couldn't initialize RS::dispatch->FenceCreate");
+        return false;
+    }
+    RS::dispatch->ContextInsertFence = (ContextInsertFenceFnPtr)dlsym(handle, "rsContextInsertFence");
+    if (RS::dispatch->ContextInsertFence == NULL) {
+        ALOGV("Couldn't initialize RS::dispatch->ContextInsertFence");
+        return false;
+    }
+    RS::dispatch->FenceWait = (FenceWaitFnPtr)dlsym(handle, "rsFenceWait");
+    if (RS::dispatch->FenceWait == NULL) {
+        ALOGV("Couldn't initialize RS::dispatch->FenceWait");
+        return false;
+    }
+    RS::dispatch->FenceSetNotify = (FenceSetNotifyFnPtr)dlsym(handle, "rsFenceSetNotify");
+    if (RS::dispatch->FenceSetNotify == NULL) {
+        ALOGV("Couldn't initialize RS::dispatch->FenceSetNotify");
+        return false;
+    }
+    RS::dispatch->ContextCreateQueue = (ContextCreateQueueFnPtr)dlsym(handle, "rsContextCreateQueue");
+    if (RS::dispatch->ContextCreateQueue == NULL) {
+        ALOGV("Couldn't initialize RS::dispatch->ContextCreateQueue");
+        return false;
+    }
+    RS::dispatch->ContextBindQueue = (ContextBindQueueFnPtr)dlsym(handle, "rsContextBindQueue");
+    if (RS::dispatch->ContextBindQueue == NULL) {
+        ALOGV("Couldn't initialize RS::dispatch->ContextBindQueue");
+        return false;
+    }
     RS::dispatch->ContextDeinitToClient = (ContextDeinitToClientFnPtr)dlsym(handle, "rsContextDeinitToClient");
     if (RS::dispatch->ContextDeinitToClient == NULL) {
         ALOGV("Couldn't initialize RS::dispatch->ContextDeinitToClient");
@@ -195,6 +239,31 @@ static bool loadSymbols(void* handle) {
         ALOGV("Couldn't initialize RS::dispatch->ContextDump");
         return false;
     }
+    RS::dispatch->ContextSetAutoFusion = (ContextSetAutoFusionFnPtr)dlsym(handle, "rsContextSetAutoFusion");
+    if (RS::dispatch->ContextSetAutoFusion == NULL) {
+        ALOGV("Couldn't initialize RS::dispatch->ContextSetAutoFusion");
+        return false;
+    }
+    RS::dispatch->ContextSetSliceSize = (ContextSetSliceSizeFnPtr)dlsym(handle, "rsContextSetSliceSize");
+    if (RS::dispatch->ContextSetSliceSize == NULL) {
+        ALOGV("Couldn't initialize RS::dispatch->ContextSetSliceSize");
+        return false;
+    }
+    RS::dispatch->ContextSetTracing = (ContextSetTracingFnPtr)dlsym(handle, "rsContextSetTracing");
+    if (RS::dispatch->ContextSetTracing == NULL) {
+        ALOGV("Couldn't initialize RS::dispatch->ContextSetTracing");
+        return false;
+    }
+    RS::dispatch->ContextDumpTrace = (ContextDumpTraceFnPtr)dlsym(handle, "rsContextDumpTrace");
+    if (RS::dispatch->ContextDumpTrace == NULL) {
+        ALOGV("Couldn't initialize RS::dispatch->ContextDumpTrace");
+        return false;
+    }
+    RS::dispatch->ContextGetStats = (ContextGetStatsFnPtr)dlsym(handle, "rsContextGetStats");
+    if (RS::dispatch->ContextGetStats == NULL) {
+        ALOGV("Couldn't initialize RS::dispatch->ContextGetStats");
+        return false;
+    }
     RS::dispatch->ContextSetPriority = (ContextSetPriorityFnPtr)dlsym(handle, "rsContextSetPriority");
     if (RS::dispatch->ContextSetPriority == NULL) {
         ALOGV("Couldn't initialize RS::dispatch->ContextSetPriority");
@@ -250,6 +319,16 @@ static bool loadSymbols(void* handle) {
         ALOGV("Couldn't initialize RS::dispatch->AllocationGenerateMipmaps");
         return false;
     }
+    RS::dispatch->AllocationGenerateMipmapsFiltered = (AllocationGenerateMipmapsFilteredFnPtr)dlsym(handle, "rsAllocationGenerateMipmapsFiltered");
+    if (RS::dispatch->AllocationGenerateMipmapsFiltered == NULL) {
+        ALOGV("Couldn't initialize RS::dispatch->AllocationGenerateMipmapsFiltered");
+        return false;
+    }
+    RS::dispatch->AllocationClone = (AllocationCloneFnPtr)dlsym(handle, "rsAllocationClone");
+    if (RS::dispatch->AllocationClone == NULL) {
+        ALOGV("Couldn't initialize RS::dispatch->AllocationClone");
+        return false;
+    }
     RS::dispatch->AllocationRead = (AllocationReadFnPtr)dlsym(handle, "rsAllocationRead");
     if (RS::dispatch->AllocationRead == NULL) {
         ALOGV("Couldn't initialize RS::dispatch->AllocationRead");
@@ -360,6 +439,21 @@ static bool loadSymbols(void* handle) {
         ALOGV("Couldn't initialize RS::dispatch->ScriptCCreate");
         return false;
     }
+    RS::dispatch->ScriptCCreateAsync = (ScriptCCreateAsyncFnPtr)dlsym(handle, "rsScriptCCreateAsync");
+    if (RS::dispatch->ScriptCCreateAsync == NULL) {
+        ALOGV("Couldn't initialize RS::dispatch->ScriptCCreateAsync");
+        return false;
+    }
+    RS::dispatch->ScriptCWait = (ScriptCWaitFnPtr)dlsym(handle, "rsScriptCWait");
+    if (RS::dispatch->ScriptCWait == NULL) {
+        ALOGV("Couldn't initialize RS::dispatch->ScriptCWait");
+        return false;
+    }
+    RS::dispatch->ScriptCClone = (ScriptCCloneFnPtr)dlsym(handle, "rsScriptCClone");
+    if (RS::dispatch->ScriptCClone == NULL) {
+        ALOGV("Couldn't initialize RS::dispatch->ScriptCClone");
+        return false;
+    }
     RS::dispatch->ScriptIntrinsicCreate = (ScriptIntrinsicCreateFnPtr)dlsym(handle, "rsScriptIntrinsicCreate");
     if (RS::dispatch->ScriptIntrinsicCreate == NULL) {
         ALOGV("Couldn't initialize RS::dispatch->ScriptIntrinsicCreate");
@@ -493,8 +587,12 @@ bool RS::init(std::string &name, int targetApi, uint32_t flags) {
         return false;
     }
 
+    // Handled entirely on this side.
+    mAsyncScripts = (flags & RS_INIT_ASYNC_SCRIPTS) != 0;
+    flags &= ~RS_INIT_ASYNC_SCRIPTS;
+
     if (flags & ~(RS_CONTEXT_SYNCHRONOUS | RS_CONTEXT_LOW_LATENCY |
-                  RS_CONTEXT_LOW_POWER)) {
+                  RS_CONTEXT_LOW_POWER | RS_CONTEXT_OUT_OF_ORDER)) {
         ALOGE("Invalid flags passed");
         return false;
     }
@@ -538,68 +636,86 @@ RSError RS::getError() {
 
 void * RS::threadProc(void *vrsc) {
     RS *rs = static_cast<RS *>(vrsc);
-    size_t rbuf_size = 256;
-    void * rbuf = malloc(rbuf_size);
+
+    // Messages are handed over in batches straight out of the context's
+    // message ring; payload pointers are only valid until the release.
+    RsMessageToClient msgs[32];
 
     RS::dispatch->ContextInitToClient(rs->mContext);
     rs->mMessageRun = true;
 
     while (rs->mMessageRun) {
-        size_t receiveLen = 0;
-        uint32_t usrID = 0;
-        uint32_t subID = 0;
-        RsMessageToClientType r = RS::dispatch->ContextPeekMessage(rs->mContext,
-                                                                   &receiveLen, sizeof(receiveLen),
-                                                                   &usrID, sizeof(usrID));
-
-        if (receiveLen >= rbuf_size) {
-            rbuf_size = receiveLen + 32;
-            rbuf = realloc(rbuf, rbuf_size);
-        }
-        if (!rbuf) {
-            ALOGE("RS::message handler realloc error %zu", rbuf_size);
-            // No clean way to recover now?
-        }
-        RS::dispatch->ContextGetMessage(rs->mContext, rbuf, rbuf_size, &receiveLen, sizeof(receiveLen),
-                            &subID, sizeof(subID));
-
-        switch(r) {
-        case RS_MESSAGE_TO_CLIENT_ERROR:
-            ALOGE("RS Error %s", (const char *)rbuf);
-            rs->throwError(RS_ERROR_RUNTIME_ERROR, "Error returned from runtime");
-            if(rs->mMessageFunc != NULL) {
-                rs->mErrorFunc(usrID, (const char *)rbuf);
+        size_t count = 0;
+        RS::dispatch->ContextAcquireMessages(rs->mContext, msgs, sizeof(msgs),
+                                             &count, sizeof(count));
+
+        for (size_t ct = 0; ct < count; ct++) {
+            const RsMessageToClient &m = msgs[ct];
+            switch(m.type) {
+            case RS_MESSAGE_TO_CLIENT_ERROR:
+                ALOGE("RS Error %s", (const char *)m.data);
+                rs->throwError(RS_ERROR_RUNTIME_ERROR, "Error returned from runtime");
+                if(rs->mErrorFunc != NULL) {
+                    rs->mErrorFunc(m.usrID, (const char *)m.data);
+                }
+                break;
+            case RS_MESSAGE_TO_CLIENT_NONE:
+            case RS_MESSAGE_TO_CLIENT_EXCEPTION:
+            case RS_MESSAGE_TO_CLIENT_RESIZE:
+                break;
+            case RS_MESSAGE_TO_CLIENT_USER:
+                if(rs->mMessageFunc != NULL) {
+                    rs->mMessageFunc(m.usrID, m.data, m.dataLen);
+                } else {
+                    ALOGE("Received a message from the script with no message handler installed.");
+                }
+                break;
+            case RS_MESSAGE_TO_CLIENT_FENCE:
+                rs->runFenceCallback(*(const uintptr_t *)m.data);
+                break;
+
+            default:
+                ALOGE("RS unknown message type %i", m.type);
             }
-            break;
-        case RS_MESSAGE_TO_CLIENT_NONE:
-        case RS_MESSAGE_TO_CLIENT_EXCEPTION:
-        case RS_MESSAGE_TO_CLIENT_RESIZE:
-            // teardown. But we want to avoid starving other threads during
-            // teardown by yielding until the next line in the destructor can
-            // execute to set mRun = false. Note that the FIFO sends an
-            // empty NONE message when it reaches its destructor.
-            usleep(1000);
-            break;
-        case RS_MESSAGE_TO_CLIENT_USER:
-            if(rs->mMessageFunc != NULL) {
-                rs->mMessageFunc(usrID, rbuf, receiveLen);
-            } else {
-                ALOGE("Received a message from the script with no message handler installed.");
-            }
-            break;
-
-        default:
-            ALOGE("RS unknown message type %i", r);
         }
-    }
 
-    if (rbuf) {
-        free(rbuf);
+        // Also reached with count == 0 once the context shuts the ring down.
+        RS::dispatch->ContextReleaseMessages(rs->mContext);
     }
+
     ALOGV("RS Message thread exiting.");
     return NULL;
 }
 
+uintptr_t RS::addFenceCallback(FenceCallbackFunc_t func, void *usr) {
+    FenceCallback cb;
+    cb.func = func;
+    cb.usr = usr;
+    pthread_mutex_lock(&mFenceLock);
+    cb.cookie = mNextFenceCookie++;
+    mFenceCallbacks.push_back(cb);
+    pthread_mutex_unlock(&mFenceLock);
+    return cb.cookie;
+}
+
+void RS::runFenceCallback(uintptr_t cookie) {
+    FenceCallback cb;
+    cb.func = NULL;
+    pthread_mutex_lock(&mFenceLock);
+    for (size_t ct = 0; ct < mFenceCallbacks.size(); ct++) {
+        if (mFenceCallbacks[ct].cookie == cookie) {
+            cb = mFenceCallbacks[ct];
+            mFenceCallbacks.erase(mFenceCallbacks.begin() + ct);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mFenceLock);
+
+    if (cb.func != NULL) {
+        cb.func(cb.usr);
+    }
+}
+
 void RS::setErrorHandler(ErrorHandlerFunc_t func) {
     mErrorFunc = func;
 }
@@ -611,3 +727,25 @@ void RS::setMessageHandler(MessageHandlerFunc_t func) {
 void RS::finish() {
     RS::dispatch->ContextFinish(mContext);
 }
+
+void RS::setAutoFusion(bool enable) {
+    RS::dispatch->ContextSetAutoFusion(mContext, enable);
+}
+
+void RS::setSliceSize(uint32_t sliceSize) {
+    RS::dispatch->ContextSetSliceSize(mContext, sliceSize);
+}
+
+void RS::setTracing(bool enable) {
+    RS::dispatch->ContextSetTracing(mContext, enable);
+}
+
+bool RS::dumpTrace(const char *path) {
+    return RS::dispatch->ContextDumpTrace(mContext, path, strlen(path));
+}
+
+RsContextStats RS::getStats() {
+    RsContextStats stats;
+    RS::dispatch->ContextGetStats(mContext, &stats, sizeof(stats));
+    return stats;
+}
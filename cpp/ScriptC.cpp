@@ -24,7 +24,30 @@ ScriptC::ScriptC(sp<RS> rs,
                  const char *cachedName, size_t cachedNameLength,
                  const char *cacheDir, size_t cacheDirLength)
 : Script(NULL, rs) {
+    if (rs->mAsyncScripts) {
+        mID = RS::dispatch->ScriptCCreateAsync(rs->getContext(), cachedName, cachedNameLength,
+                                               rs->mCacheDir.c_str(), rs->mCacheDir.length(),
+                                               (const char *)codeTxt, codeLength);
+        return;
+    }
     mID = RS::dispatch->ScriptCCreate(rs->getContext(), cachedName, cachedNameLength,
                                       rs->mCacheDir.c_str(), rs->mCacheDir.length(), (const char *)codeTxt, codeLength);
 }
 
+bool ScriptC::waitForCompile() {
+    if (mID == NULL) {
+        return false;
+    }
+    return RS::dispatch->ScriptCWait(mRS->getContext(), getID());
+}
+
+ScriptC::ScriptC(sp<const ScriptC> src)
+: Script(NULL, src->mRS) {
+    if (mRS->getError() == RS_SUCCESS) {
+        mID = RS::dispatch->ScriptCClone(mRS->getContext(), src->getID());
+    }
+    if (mID == NULL) {
+        mRS->throwError(RS_ERROR_RUNTIME_ERROR, "Script clone failed");
+    }
+}
+
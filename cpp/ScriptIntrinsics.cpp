@@ -569,6 +569,161 @@ ScriptIntrinsicLUT::~ScriptIntrinsicLUT() {
 
 }
 
+sp<ScriptIntrinsicMedian> ScriptIntrinsicMedian::create(sp<RS> rs, sp<const Element> e) {
+    if ((e->isCompatible(Element::U8_4(rs)) == false) &&
+        (e->isCompatible(Element::U8(rs)) == false)) {
+        rs->throwError(RS_ERROR_INVALID_ELEMENT, "Invalid element in median");
+        return NULL;
+    }
+    return new ScriptIntrinsicMedian(rs, e);
+}
+
+ScriptIntrinsicMedian::ScriptIntrinsicMedian(sp<RS> rs, sp<const Element> e)
+    : ScriptIntrinsic(rs, RS_SCRIPT_INTRINSIC_ID_MEDIAN, e) {
+
+}
+
+void ScriptIntrinsicMedian::setInput(sp<Allocation> in) {
+    if (in->getType()->getElement()->isCompatible(mElement) == false) {
+        mRS->throwError(RS_ERROR_INVALID_ELEMENT, "Invalid element in median input");
+        return;
+    }
+    Script::setVar(1, in);
+}
+
+void ScriptIntrinsicMedian::setRadius(int32_t radius) {
+    if (radius >= 0 && radius <= 100) {
+        Script::setVar(0, radius);
+    } else {
+        mRS->throwError(RS_ERROR_INVALID_PARAMETER, "Median radius out of 0-100 bound");
+    }
+}
+
+void ScriptIntrinsicMedian::forEach(sp<Allocation> out) {
+    if (out->getType()->getElement()->isCompatible(mElement) == false) {
+        mRS->throwError(RS_ERROR_INVALID_ELEMENT, "Invalid element in median output");
+        return;
+    }
+    Script::forEach(0, NULL, out, NULL, 0);
+}
+
+sp<ScriptIntrinsicMorphology> ScriptIntrinsicMorphology::create(sp<RS> rs, sp<const Element> e) {
+    if ((e->isCompatible(Element::U8_4(rs)) == false) &&
+        (e->isCompatible(Element::U8(rs)) == false)) {
+        rs->throwError(RS_ERROR_INVALID_ELEMENT, "Invalid element in morphology");
+        return NULL;
+    }
+    return new ScriptIntrinsicMorphology(rs, e);
+}
+
+ScriptIntrinsicMorphology::ScriptIntrinsicMorphology(sp<RS> rs, sp<const Element> e)
+    : ScriptIntrinsic(rs, RS_SCRIPT_INTRINSIC_ID_MORPHOLOGY, e) {
+
+}
+
+void ScriptIntrinsicMorphology::setInput(sp<Allocation> in) {
+    if (in->getType()->getElement()->isCompatible(mElement) == false) {
+        mRS->throwError(RS_ERROR_INVALID_ELEMENT, "Invalid element in morphology input");
+        return;
+    }
+    Script::setVar(1, in);
+}
+
+void ScriptIntrinsicMorphology::setRadius(int32_t radiusX, int32_t radiusY) {
+    if (radiusX < 0 || radiusY < 0) {
+        mRS->throwError(RS_ERROR_INVALID_PARAMETER, "Morphology radius must not be negative");
+        return;
+    }
+    int32_t r[2] = {radiusX, radiusY};
+    Script::setVar(0, r, sizeof(r));
+}
+
+void ScriptIntrinsicMorphology::forEachErode(sp<Allocation> out) {
+    if (out->getType()->getElement()->isCompatible(mElement) == false) {
+        mRS->throwError(RS_ERROR_INVALID_ELEMENT, "Invalid element in morphology output");
+        return;
+    }
+    Script::forEach(0, NULL, out, NULL, 0);
+}
+
+void ScriptIntrinsicMorphology::forEachDilate(sp<Allocation> out) {
+    if (out->getType()->getElement()->isCompatible(mElement) == false) {
+        mRS->throwError(RS_ERROR_INVALID_ELEMENT, "Invalid element in morphology output");
+        return;
+    }
+    Script::forEach(1, NULL, out, NULL, 0);
+}
+
+sp<ScriptIntrinsicResize> ScriptIntrinsicResize::create(sp<RS> rs, sp<const Element> e) {
+    if (!(e->isCompatible(Element::U8(rs))) &&
+        !(e->isCompatible(Element::U8_2(rs))) &&
+        !(e->isCompatible(Element::U8_3(rs))) &&
+        !(e->isCompatible(Element::U8_4(rs)))) {
+        rs->throwError(RS_ERROR_INVALID_ELEMENT, "Invalid element for Resize");
+        return NULL;
+    }
+    return new ScriptIntrinsicResize(rs, e);
+}
+
+ScriptIntrinsicResize::ScriptIntrinsicResize(sp<RS> rs, sp<const Element> e)
+    : ScriptIntrinsic(rs, RS_SCRIPT_INTRINSIC_ID_RESIZE, e) {
+
+}
+
+void ScriptIntrinsicResize::setInput(sp<Allocation> in) {
+    if (!(in->getType()->getElement()->isCompatible(mElement))) {
+        mRS->throwError(RS_ERROR_INVALID_ELEMENT, "Invalid element for input in Resize");
+        return;
+    }
+    Script::setVar(0, in);
+}
+
+void ScriptIntrinsicResize::setMode(RsResizeMode mode) {
+    if ((mode < RS_RESIZE_MODE_BICUBIC) || (mode > RS_RESIZE_MODE_AREA)) {
+        mRS->throwError(RS_ERROR_INVALID_PARAMETER, "Invalid mode for Resize");
+        return;
+    }
+    Script::setVar(1, (int32_t)mode);
+}
+
+void ScriptIntrinsicResize::forEach(sp<Allocation> out) {
+    if (!(out->getType()->getElement()->isCompatible(mElement))) {
+        mRS->throwError(RS_ERROR_INVALID_ELEMENT, "Invalid element for output in Resize");
+        return;
+    }
+    Script::forEach(0, NULL, out, NULL, 0);
+}
+
+sp<ScriptIntrinsicRGBToYuv> ScriptIntrinsicRGBToYuv::create(sp<RS> rs, sp<const Element> e) {
+    if (!(e->isCompatible(Element::U8_4(rs)))) {
+        rs->throwError(RS_ERROR_INVALID_ELEMENT, "Invalid element for RGBToYuv");
+        return NULL;
+    }
+    return new ScriptIntrinsicRGBToYuv(rs, e);
+}
+
+ScriptIntrinsicRGBToYuv::ScriptIntrinsicRGBToYuv(sp<RS> rs, sp<const Element> e)
+    : ScriptIntrinsic(rs, RS_SCRIPT_INTRINSIC_ID_RGB_TO_YUV, e) {
+
+}
+
+void ScriptIntrinsicRGBToYuv::setInput(sp<Allocation> in) {
+    if (!(in->getType()->getElement()->isCompatible(mElement))) {
+        mRS->throwError(RS_ERROR_INVALID_ELEMENT, "Invalid element for input in RGBToYuv");
+        return;
+    }
+    Script::setVar(0, in);
+}
+
+void ScriptIntrinsicRGBToYuv::forEach(sp<Allocation> out) {
+    if (!(out->getType()->getElement()->isCompatible(Element::YUV(mRS)))) {
+        mRS->throwError(RS_ERROR_INVALID_ELEMENT, "Invalid element for output in RGBToYuv");
+        return;
+    }
+
+    Script::forEach(0, NULL, out, NULL, 0);
+}
+
 sp<ScriptIntrinsicYuvToRGB> ScriptIntrinsicYuvToRGB::create(sp<RS> rs, sp<const Element> e) {
     if (!(e->isCompatible(Element::U8_4(rs)))) {
         rs->throwError(RS_ERROR_INVALID_ELEMENT, "Invalid element for YuvToRGB");
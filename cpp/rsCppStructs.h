@@ -36,6 +36,7 @@ namespace RSC {
 
 typedef void (*ErrorHandlerFunc_t)(uint32_t errorNum, const char *errorText);
 typedef void (*MessageHandlerFunc_t)(uint32_t msgNum, const void *msgData, size_t msgLen);
+typedef void (*FenceCallbackFunc_t)(void *usr);
 
 class RS;
 class BaseObj;
@@ -45,6 +46,8 @@ class Allocation;
 class Script;
 class ScriptC;
 class Sampler;
+class Fence;
+class CommandQueue;
 
 /**
  * Possible error codes used by RenderScript. Once a status other than RS_SUCCESS
@@ -77,7 +80,9 @@ class Sampler;
  enum RSInitFlags {
      RS_INIT_SYNCHRONOUS = 1, ///< All RenderScript calls will be synchronous. May reduce latency.
      RS_INIT_LOW_LATENCY = 2, ///< Prefer low latency devices over potentially higher throughput devices.
-     RS_INIT_MAX = 4
+     RS_INIT_OUT_OF_ORDER = 8, ///< Independent kernel launches and copies may execute concurrently.
+     RS_INIT_ASYNC_SCRIPTS = 16, ///< Scripts are compiled in the background; see ScriptC::waitForCompile().
+     RS_INIT_MAX = 32
  };
 
  /**
@@ -116,6 +121,8 @@ class Sampler;
     /**
      * Sets the message handler function for this context. This message handler
      * is called whenever a message is sent from a RenderScript kernel.
+     * msgData points directly into the context's message ring and is only
+     * valid for the duration of the call; copy it to keep it longer.
      *
      *  @param[in] func Message handler function
      */
@@ -141,6 +148,56 @@ class Sampler;
      */
     void finish();
 
+    /**
+     * Enables or disables automatic kernel fusion. While enabled, a sequence
+     * of forEach launches where each consumes the previous one's output is
+     * recognized when it is issued again and then runs as a fused group.
+     * Intermediate Allocations keep their contents. Only launches without
+     * user data or launch options, on scripts without object globals, are
+     * considered. Has no effect on synchronous contexts.
+     * @param[in] enable whether to fuse recurring launch chains
+     */
+    void setAutoFusion(bool enable);
+
+    /**
+     * Overrides how kernel launches are split between threads. By default
+     * each launch is timed over its first runs with a few slice sizes and
+     * thread counts, including running short launches on a single thread,
+     * and the fastest is kept for that kernel and size. A non-zero size
+     * instead splits every launch into slices of that many rows (elements
+     * for 1D launches) across all threads.
+     * @param[in] sliceSize rows per slice, or 0 to tune automatically
+     */
+    void setSliceSize(uint32_t sliceSize);
+
+    /**
+     * Enables or disables execution tracing for the whole process. Command
+     * dispatch, FIFO waits, kernel launches, the slices each worker runs and
+     * Allocation copies are recorded; each thread keeps its most recent
+     * events. Tracing can also be enabled with the debug.rs.trace property.
+     * @param[in] enable whether to record events
+     */
+    void setTracing(bool enable);
+
+    /**
+     * Writes the recorded events as Chrome trace JSON, which can be loaded
+     * in chrome://tracing or Perfetto. Commands issued before this call
+     * complete first.
+     * @param[in] path file to write
+     * @return true on success
+     */
+    bool dumpTrace(const char *path);
+
+    /**
+     * Returns the counters this context has accumulated since it was
+     * created: commands played, forEach launches, bytes copied in and out
+     * of Allocations, live Allocations and their storage, FIFO wait time
+     * and worker busy and idle time. Safe to call from any thread; work
+     * that is still queued is not waited for.
+     * @return the current totals
+     */
+    RsContextStats getStats();
+
     RsContext getContext() { return mContext; }
     void throwError(RSError error, const char *errMsg);
 
@@ -153,6 +210,20 @@ class Sampler;
     bool init(std::string &name, int targetApi, uint32_t flags);
     static void * threadProc(void *);
 
+    // Fence callbacks waiting for their notification, keyed by the cookie
+    // sent to the runtime.  Pending entries are dropped with the context.
+    struct FenceCallback {
+        uintptr_t cookie;
+        FenceCallbackFunc_t func;
+        void *usr;
+    };
+    uintptr_t addFenceCallback(FenceCallbackFunc_t func, void *usr);
+    void runFenceCallback(uintptr_t cookie);
+
+    pthread_mutex_t mFenceLock;
+    std::vector<FenceCallback> mFenceCallbacks;
+    uintptr_t mNextFenceCookie;
+
     static bool gInitialized;
     static pthread_mutex_t gInitMutex;
 
@@ -167,6 +238,7 @@ class Sampler;
     ErrorHandlerFunc_t mErrorFunc;
     MessageHandlerFunc_t mMessageFunc;
     bool mInit;
+    bool mAsyncScripts;
 
     std::string mCacheDir;
 
@@ -252,6 +324,7 @@ class Sampler;
     friend class Sampler;
     friend class Element;
     friend class ScriptC;
+    friend class Fence;
 };
 
  /**
@@ -357,6 +430,23 @@ public:
      */
     void generateMipmaps();
 
+    /**
+     * Generate a mipmap chain with the given filter. RS_MIPMAP_FILTER_BOX
+     * matches generateMipmaps(); RS_MIPMAP_FILTER_LANCZOS uses a wider,
+     * sharper Lanczos-3 kernel at a higher cost.
+     * @param[in] filter filter used to produce each level from the previous one
+     */
+    void generateMipmaps(RsMipmapFilter filter);
+
+    /**
+     * Creates a new Allocation with the same Type, usage and contents as this
+     * one. Large script memory is shared copy-on-write, so the cost of a
+     * clone and of later writes to either Allocation is proportional to the
+     * pages written rather than to the whole Allocation.
+     * @return the new Allocation
+     */
+    sp<Allocation> clone();
+
     /**
      * Copy an array into part of this Allocation.
      * @param[in] off offset of first Element to be overwritten
@@ -1391,6 +1481,27 @@ protected:
             const char *cachedName, size_t cachedNameLength,
             const char *cacheDir, size_t cacheDirLength);
 
+    /**
+     * Creates a new instance of the script src is an instance of. The new
+     * instance shares the compiled code of src but has its own copy of the
+     * globals, which start out with the values src currently holds, and is
+     * bound to the same Allocations. The script's init() is not run again.
+     * Instances can then be launched concurrently with different globals.
+     * Not every driver supports this; on failure an error is raised.
+     * @param[in] src script to clone
+     */
+    ScriptC(sp<const ScriptC> src);
+
+public:
+    /**
+     * Waits for this script to be ready. On a context initialized with
+     * RS_INIT_ASYNC_SCRIPTS, scripts are compiled or loaded from the cache on
+     * background threads, so several can be created at once, and any use of
+     * the script waits for it. This lets the caller choose when to block.
+     * @return true if the script was created successfully
+     */
+    bool waitForCompile();
+
 };
 
 /**
@@ -1830,6 +1941,153 @@ class ScriptIntrinsicLUT : public ScriptIntrinsic {
     virtual ~ScriptIntrinsicLUT();
 };
 
+/**
+ * Intrinsic for median filtering. Each output element is the per-channel
+ * median of the square window of the given radius around it; edges are
+ * replicated. The cost per element does not depend on the radius.
+ */
+class ScriptIntrinsicMedian : public ScriptIntrinsic {
+ private:
+    ScriptIntrinsicMedian(sp<RS> rs, sp<const Element> e);
+ public:
+    /**
+     * Supported Element types are U8 and U8_4. The default radius is 1.
+     * @param[in] rs RenderScript context
+     * @param[in] e Element
+     * @return new ScriptIntrinsicMedian
+     */
+    static sp<ScriptIntrinsicMedian> create(sp<RS> rs, sp<const Element> e);
+    /**
+     * Sets the input of the filter.
+     * @param[in] in input Allocation
+     */
+    void setInput(sp<Allocation> in);
+    /**
+     * Sets the radius of the window. The supported range is 0 <= radius <= 100.
+     * @param[in] radius window radius in elements
+     */
+    void setRadius(int32_t radius);
+    /**
+     * Runs the intrinsic.
+     * @param[in] out output Allocation
+     */
+    void forEach(sp<Allocation> out);
+};
+
+/**
+ * Intrinsic for grayscale morphology. Erode replaces every element by the
+ * per-channel minimum of a rectangular window around it, dilate by the
+ * maximum. The cost per element does not depend on the radius.
+ */
+class ScriptIntrinsicMorphology : public ScriptIntrinsic {
+ private:
+    ScriptIntrinsicMorphology(sp<RS> rs, sp<const Element> e);
+ public:
+    /**
+     * Supported Element types are U8 and U8_4. The default radius is 1.
+     * @param[in] rs RenderScript context
+     * @param[in] e Element
+     * @return new ScriptIntrinsicMorphology
+     */
+    static sp<ScriptIntrinsicMorphology> create(sp<RS> rs, sp<const Element> e);
+    /**
+     * Sets the input of the filter.
+     * @param[in] in input Allocation
+     */
+    void setInput(sp<Allocation> in);
+    /**
+     * Sets the window to (2 * radiusX + 1) x (2 * radiusY + 1) elements.
+     * @param[in] radiusX horizontal radius, >= 0
+     * @param[in] radiusY vertical radius, >= 0
+     */
+    void setRadius(int32_t radiusX, int32_t radiusY);
+    /**
+     * Runs an erode.
+     * @param[in] out output Allocation
+     */
+    void forEachErode(sp<Allocation> out);
+    /**
+     * Runs a dilate.
+     * @param[in] out output Allocation
+     */
+    void forEachDilate(sp<Allocation> out);
+};
+
+/**
+ * Intrinsic for resizing a 2D Allocation. The input is bound with
+ * setInput() and resampled to the dimensions of the output passed to
+ * forEach().
+ */
+class ScriptIntrinsicResize : public ScriptIntrinsic {
+ private:
+    ScriptIntrinsicResize(sp<RS> rs, sp<const Element> e);
+ public:
+    /**
+     * Supported Element types are U8, U8_2, U8_3 and U8_4.
+     * @param[in] rs RenderScript context
+     * @param[in] e Element
+     * @return new ScriptIntrinsicResize
+     */
+    static sp<ScriptIntrinsicResize> create(sp<RS> rs, sp<const Element> e);
+    /**
+     * Sets the input of the resize.
+     * @param[in] in input Allocation
+     */
+    void setInput(sp<Allocation> in);
+    /**
+     * Sets the resampling filter. The default is RS_RESIZE_MODE_BICUBIC.
+     * RS_RESIZE_MODE_AREA averages every covered source element and should
+     * be used for large downscaling ratios.
+     * @param[in] mode resampling filter
+     */
+    void setMode(RsResizeMode mode);
+    /**
+     * Resizes the input into the output.
+     * @param[in] out output Allocation
+     */
+    void forEach(sp<Allocation> out);
+};
+
+/**
+ * Intrinsic for converting RGB to an Android YUV buffer, the inverse of
+ * ScriptIntrinsicYuvToRGB.
+ *
+ * The output is written in whatever 4:2:0 layout the output Allocation was
+ * created with (NV21 or YV12). Chroma is the average of each 2x2 block.
+ * The alpha channel of the input is ignored.
+ */
+class ScriptIntrinsicRGBToYuv : public ScriptIntrinsic {
+ private:
+    ScriptIntrinsicRGBToYuv(sp<RS> rs, sp<const Element> e);
+ public:
+    /**
+     * Create an intrinsic for converting RGB to YUV.
+     *
+     * Supported elements types are U8_4.
+     *
+     * @param[in] rs The RenderScript context
+     * @param[in] e Element type for input
+     *
+     * @return ScriptIntrinsicRGBToYuv
+     */
+    static sp<ScriptIntrinsicRGBToYuv> create(sp<RS> rs, sp<const Element> e);
+    /**
+     * Set the input RGBA allocation.
+     *
+     * @param[in] in The input allocation.
+     */
+    void setInput(sp<Allocation> in);
+
+    /**
+     * Convert the image to YUV.
+     *
+     * @param[in] out Output allocation. Must be a YUV element Allocation
+     *                with the same dimensions as the input.
+     */
+    void forEach(sp<Allocation> out);
+
+};
+
 /**
  * Intrinsic for converting an Android YUV buffer to RGB.
  *
@@ -2006,6 +2264,90 @@ class ScriptIntrinsicYuvToRGB : public ScriptIntrinsic {
 
 };
 
+/**
+ * A Fence marks a point in a context's command stream. It signals once every
+ * command issued before it, including kernel launches, ScriptGroup executions
+ * and Allocation copies, has completed. Unlike RS::finish(), waiting on a
+ * fence does not require the work issued after it to drain, so the host can
+ * keep queuing work while it waits for one particular result.
+ */
+class Fence : public BaseObj {
+private:
+    Fence(sp<RS> rs, void *id);
+
+    bool mHasCallback;
+
+public:
+    /**
+     * Creates a fence and inserts it into the command stream after all
+     * previously issued work.
+     * @param[in] rs RenderScript context
+     * @return new Fence
+     */
+    static sp<Fence> insert(sp<RS> rs);
+
+    /**
+     * @return true if all work issued before the fence has completed
+     */
+    bool isSignaled();
+
+    /**
+     * Blocks until the fence signals or the timeout expires.
+     * @param[in] timeoutNs timeout in nanoseconds; negative waits forever
+     * @return true if the fence signaled
+     */
+    bool wait(int64_t timeoutNs = -1);
+
+    /**
+     * Sets a function to be called from the context's message thread once
+     * the fence signals. It is called right away if the fence already has.
+     * Only one callback may be set per fence. The callback must not wait on
+     * other fences or call RS::finish(). A callback still pending when the
+     * context is destroyed is not called.
+     * @param[in] func callback
+     * @param[in] usr user data passed to func
+     */
+    void setCallback(FenceCallbackFunc_t func, void *usr);
+};
+
+/**
+ * An additional command stream on a compute context. Work issued to different
+ * queues may execute concurrently; work within one queue stays in order.
+ * Each thread routes its RenderScript calls through the queue it has bound,
+ * or through the context's default queue if none is bound. Objects used from
+ * several queues must be synchronized by the caller, for example with Fence.
+ */
+class CommandQueue : public BaseObj {
+private:
+    CommandQueue(sp<RS> rs, void *id);
+
+public:
+    virtual ~CommandQueue();
+
+    /**
+     * Creates a new command queue. Not supported on synchronous contexts.
+     * Kernels launched through an additional queue run on that queue's own
+     * thread only; the worker threads that split launches across cores
+     * serve the default queue.
+     * @param[in] rs RenderScript context
+     * @return new CommandQueue, or NULL on failure
+     */
+    static sp<CommandQueue> create(sp<RS> rs);
+
+    /**
+     * Routes subsequent RenderScript calls made by the calling thread through
+     * this queue. RS::finish() then only waits for this queue.
+     */
+    void bind();
+
+    /**
+     * Routes the calling thread's RenderScript calls back through the
+     * default queue.
+     * @param[in] rs RenderScript context
+     */
+    static void unbind(sp<RS> rs);
+};
+
 class Byte2 {
  public:
   int8_t x, y;
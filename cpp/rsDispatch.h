@@ -32,8 +32,16 @@ typedef void (*GetNameFnPtr)(RsContext, void * obj, const char **name);
 typedef void (*ContextDestroyFnPtr) (RsContext);
 typedef RsMessageToClientType (*ContextGetMessageFnPtr) (RsContext, void*, size_t, size_t*, size_t, uint32_t*, size_t);
 typedef RsMessageToClientType (*ContextPeekMessageFnPtr) (RsContext, size_t*, size_t, uint32_t*, size_t);
+typedef void (*ContextAcquireMessagesFnPtr) (RsContext, RsMessageToClient*, size_t, size_t*, size_t);
+typedef void (*ContextReleaseMessagesFnPtr) (RsContext);
 typedef void (*ContextSendMessageFnPtr) (RsContext, uint32_t, const uint8_t*, size_t);
 typedef void (*ContextInitToClientFnPtr) (RsContext);
+typedef RsFence (*FenceCreateFnPtr) (RsContext);
+typedef void (*ContextInsertFenceFnPtr) (RsContext, RsFence);
+typedef bool (*FenceWaitFnPtr) (RsContext, RsFence, int64_t);
+typedef void (*FenceSetNotifyFnPtr) (RsContext, RsFence, uintptr_t);
+typedef RsCommandQueue (*ContextCreateQueueFnPtr) (RsContext);
+typedef RsCommandQueue (*ContextBindQueueFnPtr) (RsContext, RsCommandQueue);
 typedef void (*ContextDeinitToClientFnPtr) (RsContext);
 typedef RsType (*TypeCreateFnPtr) (RsContext, RsElement, uint32_t, uint32_t, uint32_t, bool, bool, uint32_t);
 typedef RsAllocation (*AllocationCreateTypedFnPtr) (RsContext, RsType, RsAllocationMipmapControl, uint32_t, uintptr_t);
@@ -43,6 +51,11 @@ typedef RsNativeWindow (*AllocationGetSurfaceFnPtr) (RsContext, RsAllocation);
 typedef void (*AllocationSetSurfaceFnPtr) (RsContext, RsAllocation, RsNativeWindow);
 typedef void (*ContextFinishFnPtr) (RsContext);
 typedef void (*ContextDumpFnPtr) (RsContext, int32_t);
+typedef void (*ContextSetAutoFusionFnPtr) (RsContext, uint32_t);
+typedef void (*ContextSetSliceSizeFnPtr) (RsContext, uint32_t);
+typedef void (*ContextSetTracingFnPtr) (RsContext, uint32_t);
+typedef bool (*ContextDumpTraceFnPtr) (RsContext, const char*, size_t);
+typedef void (*ContextGetStatsFnPtr) (RsContext, RsContextStats*, size_t);
 typedef void (*ContextSetPriorityFnPtr) (RsContext, int32_t);
 typedef void (*AssignNameFnPtr) (RsContext, RsObjectBase, const char*, size_t);
 typedef void (*ObjDestroyFnPtr) (RsContext, RsAsyncVoidPtr);
@@ -54,6 +67,8 @@ typedef void (*Allocation1DElementDataFnPtr) (RsContext, RsAllocation, uint32_t,
 typedef void (*Allocation2DDataFnPtr) (RsContext, RsAllocation, uint32_t, uint32_t, uint32_t, RsAllocationCubemapFace, uint32_t, uint32_t, const void*, size_t, size_t);
 typedef void (*Allocation3DDataFnPtr) (RsContext, RsAllocation, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, uint32_t, const void*, size_t, size_t);
 typedef void (*AllocationGenerateMipmapsFnPtr) (RsContext, RsAllocation);
+typedef RsAllocation (*AllocationCloneFnPtr) (RsContext, RsAllocation);
+typedef void (*AllocationGenerateMipmapsFilteredFnPtr) (RsContext, RsAllocation, RsMipmapFilter);
 typedef void (*AllocationReadFnPtr) (RsContext, RsAllocation, void*, size_t);
 typedef void (*Allocation1DReadFnPtr) (RsContext, RsAllocation, uint32_t, uint32_t, uint32_t, void*, size_t);
 typedef void (*Allocation2DReadFnPtr) (RsContext, RsAllocation, uint32_t, uint32_t, uint32_t, RsAllocationCubemapFace, uint32_t, uint32_t, void*, size_t, size_t);
@@ -76,6 +91,9 @@ typedef void (*ScriptSetVarVFnPtr) (RsContext, RsScript, uint32_t, const void*,
 typedef void (*ScriptGetVarVFnPtr) (RsContext, RsScript, uint32_t, void*, size_t);
 typedef void (*ScriptSetVarVEFnPtr) (RsContext, RsScript, uint32_t, const void*, size_t, RsElement, const uint32_t*, size_t);
 typedef RsScript (*ScriptCCreateFnPtr) (RsContext, const char*, size_t, const char*, size_t, const char*, size_t);
+typedef RsScript (*ScriptCCreateAsyncFnPtr) (RsContext, const char*, size_t, const char*, size_t, const char*, size_t);
+typedef bool (*ScriptCWaitFnPtr) (RsContext, RsScript);
+typedef RsScript (*ScriptCCloneFnPtr) (RsContext, RsScript);
 typedef RsScript (*ScriptIntrinsicCreateFnPtr) (RsContext, uint32_t id, RsElement);
 typedef RsScriptKernelID (*ScriptKernelIDCreateFnPtr) (RsContext, RsScript, int, int);
 typedef RsScriptFieldID (*ScriptFieldIDCreateFnPtr) (RsContext, RsScript, int);
@@ -104,8 +122,16 @@ typedef struct {
     ContextDestroyFnPtr ContextDestroy;
     ContextGetMessageFnPtr ContextGetMessage;
     ContextPeekMessageFnPtr ContextPeekMessage;
+    ContextAcquireMessagesFnPtr ContextAcquireMessages;
+    ContextReleaseMessagesFnPtr ContextReleaseMessages;
     ContextSendMessageFnPtr ContextSendMessage;
     ContextInitToClientFnPtr ContextInitToClient;
+    FenceCreateFnPtr FenceCreate;
+    ContextInsertFenceFnPtr ContextInsertFence;
+    FenceWaitFnPtr FenceWait;
+    FenceSetNotifyFnPtr FenceSetNotify;
+    ContextCreateQueueFnPtr ContextCreateQueue;
+    ContextBindQueueFnPtr ContextBindQueue;
     ContextDeinitToClientFnPtr ContextDeinitToClient;
     TypeCreateFnPtr TypeCreate;
     AllocationCreateTypedFnPtr AllocationCreateTyped;
@@ -115,6 +141,11 @@ typedef struct {
     AllocationSetSurfaceFnPtr AllocationSetSurface;
     ContextFinishFnPtr ContextFinish;
     ContextDumpFnPtr ContextDump;
+    ContextSetAutoFusionFnPtr ContextSetAutoFusion;
+    ContextSetSliceSizeFnPtr ContextSetSliceSize;
+    ContextSetTracingFnPtr ContextSetTracing;
+    ContextDumpTraceFnPtr ContextDumpTrace;
+    ContextGetStatsFnPtr ContextGetStats;
     ContextSetPriorityFnPtr ContextSetPriority;
     AssignNameFnPtr AssignName;
     ObjDestroyFnPtr ObjDestroy;
@@ -126,6 +157,8 @@ typedef struct {
     Allocation2DDataFnPtr Allocation2DData;
     Allocation3DDataFnPtr Allocation3DData;
     AllocationGenerateMipmapsFnPtr AllocationGenerateMipmaps;
+    AllocationGenerateMipmapsFilteredFnPtr AllocationGenerateMipmapsFiltered;
+    AllocationCloneFnPtr AllocationClone;
     AllocationReadFnPtr AllocationRead;
     Allocation1DReadFnPtr Allocation1DRead;
     Allocation2DReadFnPtr Allocation2DRead;
@@ -148,6 +181,9 @@ typedef struct {
     ScriptGetVarVFnPtr ScriptGetVarV;
     ScriptSetVarVEFnPtr ScriptSetVarVE;
     ScriptCCreateFnPtr ScriptCCreate;
+    ScriptCCreateAsyncFnPtr ScriptCCreateAsync;
+    ScriptCWaitFnPtr ScriptCWait;
+    ScriptCCloneFnPtr ScriptCClone;
     ScriptIntrinsicCreateFnPtr ScriptIntrinsicCreate;
     ScriptKernelIDCreateFnPtr ScriptKernelIDCreate;
     ScriptFieldIDCreateFnPtr ScriptFieldIDCreate;
@@ -24,6 +24,7 @@ endif
 
 LOCAL_SRC_FILES:= \
 	rsCpuCore.cpp \
+	rsCpuLaunchTuner.cpp \
 	rsCpuScript.cpp \
 	rsCpuRuntimeMath.cpp \
 	rsCpuRuntimeStubs.cpp \
@@ -36,8 +37,11 @@ LOCAL_SRC_FILES:= \
 	rsCpuIntrinsicConvolve3x3.cpp \
 	rsCpuIntrinsicConvolve5x5.cpp \
 	rsCpuIntrinsicHistogram.cpp \
+	rsCpuIntrinsicMedian.cpp \
+	rsCpuIntrinsicMorphology.cpp \
 	rsCpuIntrinsicResize.cpp \
 	rsCpuIntrinsicLUT.cpp \
+	rsCpuIntrinsicRGBToYuv.cpp \
 	rsCpuIntrinsicYuvToRGB.cpp
 
 LOCAL_CFLAGS_arm64 += -DARCH_ARM_USE_INTRINSICS -DARCH_ARM64_USE_INTRINSICS -DARCH_ARM64_HAVE_NEON
@@ -27,25 +27,38 @@
 
 #include <llvm/Support/ELF.h>
 
+#include <string.h>
+
 #if defined(__LP64__) || defined(__x86_64__)
-static inline RSExecRef wrap(ELFObject<64> *object) {
-  return reinterpret_cast<RSExecRef>(object);
-}
+typedef ELFObject<64> ELFObjectTy;
 #else
-static inline RSExecRef wrap(ELFObject<32> *object) {
-  return reinterpret_cast<RSExecRef>(object);
-}
+typedef ELFObject<32> ELFObjectTy;
 #endif
 
-#if defined(__LP64__) || defined(__x86_64__)
-static inline ELFObject<64> *unwrap(RSExecRef object) {
-  return reinterpret_cast<ELFObject<64> *>(object);
+// An executable is either an object linked by this process or an image
+// mapped from the image cache.
+struct RSExecOpaque {
+  ELFObjectTy *object;
+  ImageCache *image;
+};
+
+static inline RSExecRef wrap(ELFObjectTy *object) {
+  RSExecRef exec = new RSExecOpaque;
+  exec->object = object;
+  exec->image = NULL;
+  return exec;
 }
-#else
-static inline ELFObject<32> *unwrap(RSExecRef object) {
-  return reinterpret_cast<ELFObject<32> *>(object);
+
+static inline RSExecRef wrap(ImageCache *image) {
+  RSExecRef exec = new RSExecOpaque;
+  exec->object = NULL;
+  exec->image = image;
+  return exec;
+}
+
+static inline ELFObjectTy *unwrap(RSExecRef object) {
+  return object->object;
 }
-#endif
 
 extern "C" RSExecRef rsloaderCreateExec(unsigned char const *buf,
                                         size_t buf_size,
@@ -64,6 +77,61 @@ extern "C" RSExecRef rsloaderCreateExec(unsigned char const *buf,
   return object;
 }
 
+static ImageCacheKey getImageCacheKey(unsigned char const *buf,
+                                      size_t buf_size,
+                                      char const *abi_key) {
+  ImageCacheKey key;
+  memset(&key, 0, sizeof(key));
+  key.object_hash = ImageCache::hash(buf, buf_size);
+  key.object_size = buf_size;
+  key.abi_hash = ImageCache::hash(abi_key, strlen(abi_key));
+  key.machine = buf_size >= sizeof(llvm::ELF::Elf32_Ehdr) ?
+    reinterpret_cast<llvm::ELF::Elf32_Ehdr const *>(buf)->e_machine : 0;
+  key.bitwidth = sizeof(void *) * 8;
+  return key;
+}
+
+extern "C" RSExecRef rsloaderCreateExecCached(unsigned char const *buf,
+                                              size_t buf_size,
+                                              RSFindSymbolFn find_symbol,
+                                              void *find_symbol_context,
+                                              char const *cache_path,
+                                              char const *abi_key) {
+  if (!cache_path || !abi_key) {
+    return rsloaderCreateExec(buf, buf_size, find_symbol, find_symbol_context);
+  }
+
+  ImageCacheKey key = getImageCacheKey(buf, buf_size, abi_key);
+  ImageCache *image = ImageCache::load(cache_path, key, find_symbol,
+                                       find_symbol_context);
+  if (image) {
+    return wrap(image);
+  }
+
+  RSExecRef object = rsloaderCreateExec(buf, buf_size, find_symbol,
+                                        find_symbol_context);
+  if (!object) {
+    return NULL;
+  }
+
+  MemArena *arena = unwrap(object)->getArena();
+  ImageCacheWriter writer(arena ? arena->getBuffer() : NULL,
+                          arena ? arena->size() : 0);
+  unwrap(object)->describeImage(writer);
+  if (!writer.isCacheable() || !writer.write(cache_path, key)) {
+    ALOGV("Not caching the relocated image at %s", cache_path);
+  }
+  return object;
+}
+
+extern "C" int rsloaderIsExecCached(RSExecRef object) {
+  return object->image != NULL;
+}
+
+extern "C" void rsloaderSetHugePageThreshold(size_t size) {
+  MemArena::setHugePageThreshold(size);
+}
+
 extern "C" RSExecRef rsloaderLoadExecutable(unsigned char const *buf,
                                             size_t buf_size) {
   ArchiveReaderLE AR(buf, buf_size);
@@ -84,6 +152,10 @@ extern "C" RSExecRef rsloaderLoadExecutable(unsigned char const *buf,
 extern "C" int rsloaderRelocateExecutable(RSExecRef object_,
                                           RSFindSymbolFn find_symbol,
                                           void *find_symbol_context) {
+  if (object_->image) {
+    // Already linked when it was cached.
+    return 1;
+  }
 #if defined(__LP64__) || defined(__x86_64__)
   ELFObject<64>* object = unwrap(object_);
 #else
@@ -95,6 +167,7 @@ extern "C" int rsloaderRelocateExecutable(RSExecRef object_,
 
 extern "C" void rsloaderUpdateSectionHeaders(RSExecRef object_,
                                              unsigned char *buf) {
+  ImageCache *image = object_->image;
 #if defined(__LP64__) || defined(__x86_64__)
   ELFObject<64> *object = unwrap(object_);
 #else
@@ -118,6 +191,11 @@ extern "C" void rsloaderUpdateSectionHeaders(RSExecRef object_,
 
   for (int i = 0; i < header->e_shnum; i++) {
     if (shtab[i].sh_flags & SHF_ALLOC) {
+      if (image) {
+        shtab[i].sh_addr = reinterpret_cast<uintptr_t>(
+            image->getSectionAddress(i));
+        continue;
+      }
 #if defined(__LP64__) || defined(__x86_64__)
       ELFSectionBits<64>* bits =
           static_cast<ELFSectionBits<64>*>(object->getSectionByIndex(i));
@@ -138,11 +216,17 @@ extern "C" void rsloaderUpdateSectionHeaders(RSExecRef object_,
 }
 
 extern "C" void rsloaderDisposeExec(RSExecRef object) {
+  delete object->image;
   delete unwrap(object);
+  delete object;
 }
 
 extern "C" void *rsloaderGetSymbolAddress(RSExecRef object_,
                                           char const *name) {
+  if (object_->image) {
+    return object_->image->getSymbolAddress(name);
+  }
+
 #if defined(__LP64__) || defined(__x86_64__)
   ELFObject<64> *object = unwrap(object_);
 
@@ -176,6 +260,10 @@ extern "C" void *rsloaderGetSymbolAddress(RSExecRef object_,
 }
 
 extern "C" size_t rsloaderGetSymbolSize(RSExecRef object_, char const *name) {
+  if (object_->image) {
+    return object_->image->getSymbolSize(name);
+  }
+
 #if defined(__LP64__) || defined(__x86_64__)
   ELFObject<64> *object = unwrap(object_);
 
@@ -206,6 +294,10 @@ extern "C" size_t rsloaderGetSymbolSize(RSExecRef object_, char const *name) {
 }
 
 extern "C" size_t rsloaderGetFuncCount(RSExecRef object) {
+  if (object->image) {
+    return object->image->getFuncCount();
+  }
+
 #if defined(__LP64__) || defined(__x86_64__)
   ELFSectionSymTab<64> *symtab = static_cast<ELFSectionSymTab<64> *>(
 #else
@@ -223,6 +315,11 @@ extern "C" size_t rsloaderGetFuncCount(RSExecRef object) {
 extern "C" void rsloaderGetFuncNameList(RSExecRef object,
                                         size_t size,
                                         char const **list) {
+  if (object->image) {
+    object->image->getFuncNameList(size, list);
+    return;
+  }
+
 #if defined(__LP64__) || defined(__x86_64__)
   ELFSectionSymTab<64> *symtab = static_cast<ELFSectionSymTab<64> *>(
 #else
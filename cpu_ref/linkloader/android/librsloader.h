@@ -32,6 +32,23 @@ RSExecRef rsloaderCreateExec(unsigned char const *buf,
                              RSFindSymbolFn find_symbol,
                              void *find_symbol_context);
 
+/* Like rsloaderCreateExec, but first tries to map a previously relocated
+ * image from cache_path.  abi_key identifies the runtime the externals come
+ * from; a cached image is only reused when both the object and abi_key match.
+ * On a miss the object is linked normally and the result is written back. */
+RSExecRef rsloaderCreateExecCached(unsigned char const *buf,
+                                   size_t buf_size,
+                                   RSFindSymbolFn find_symbol,
+                                   void *find_symbol_context,
+                                   char const *cache_path,
+                                   char const *abi_key);
+
+int rsloaderIsExecCached(RSExecRef object);
+
+/* Back the code of objects with at least size bytes of text with
+ * transparent huge pages, where available.  0 (the default) disables it. */
+void rsloaderSetHugePageThreshold(size_t size);
+
 RSExecRef rsloaderLoadExecutable(unsigned char const *buf,
                                  size_t buf_size);
 
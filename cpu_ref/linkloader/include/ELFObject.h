@@ -18,6 +18,8 @@
 #define ELF_OBJECT_H
 
 #include "ELFTypes.h"
+#include "ImageCache.h"
+#include "MemArena.h"
 #include "MemChunk.h"
 
 #include "utils/rsl_assert.h"
@@ -26,6 +28,12 @@
 #include <string>
 #include <vector>
 
+#ifndef USE_MINGW
+#include <sys/mman.h>
+#else
+#include "mmanWindows.h"
+#endif
+
 template <unsigned Bitwidth>
 class ELFObject {
 public:
@@ -36,16 +44,26 @@ private:
   std::unique_ptr<ELFSectionHeaderTableTy> shtab;
   std::vector<ELFSectionTy *> stab;
 
+  // Backs every section and the common data, so it must outlive them.
+  std::unique_ptr<MemArena> arena;
+
   MemChunk SHNCommonData;
   unsigned char *SHNCommonDataPtr;
   size_t SHNCommonDataFreeSize;
 
   bool missingSymbols;
 
+  // Sizes and allocates the common data once the symbols are read.
+  bool initSHNCommonData();
+
+  // Order in which sections are laid out in the arena.
+  static int getLayoutRank(ELFSectionHeaderTy const *sh);
+
   // TODO: Need refactor!
   bool initSHNCommonDataSize(size_t SHNCommonDataSize) {
     rsl_assert(!SHNCommonDataPtr && "Can't init twice.");
-    if (!SHNCommonData.allocate(SHNCommonDataSize)) {
+    if (!SHNCommonData.allocate(SHNCommonDataSize, arena.get(), 16,
+                                PROT_READ | PROT_WRITE)) {
       return false;
     }
 
@@ -75,6 +93,15 @@ public:
   ELFSectionTy const *getSectionByName(std::string const &str) const;
   ELFSectionTy *getSectionByName(std::string const &str);
 
+  // NULL if the sections were allocated individually.
+  MemArena *getArena() {
+    return arena.get();
+  }
+
+  MemArena const *getArena() const {
+    return arena.get();
+  }
+
   inline bool getMissingSymbols() const {
     return missingSymbols;
   }
@@ -109,6 +136,10 @@ public:
 
   void print() const;
 
+  // Describe the relocated image for ImageCache.  The writer is marked
+  // uncacheable if any part of the image can't be moved or re-linked.
+  void describeImage(ImageCacheWriter &writer);
+
   ~ELFObject() {
     for (size_t i = 0; i < stab.size(); ++i) {
       // Delete will check the pointer is nullptr or not by himself.
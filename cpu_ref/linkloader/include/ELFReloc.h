@@ -52,6 +52,12 @@ public:
     return r_addend;
   }
 
+  // REL entries carry their addend in the relocated field.  Relocation may
+  // record it here once the field has been overwritten.
+  void setAddend(addend_t addend) {
+    r_addend = addend;
+  }
+
   bool isValid() const {
     // FIXME: Should check the correctness of the relocation entite.
     return true;
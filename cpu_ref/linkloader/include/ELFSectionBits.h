@@ -35,6 +35,9 @@ public:
 
   bool protect();
 
+  // The protection a section with header sh is finally mapped with.
+  static int getProtection(ELFSectionHeader<Bitwidth> const *sh);
+
   unsigned char const *getBuffer() const {
     return chunk.getBuffer();
   }
@@ -29,7 +29,9 @@ public:
 
 public:
   template <typename Archiver>
-  static ELFSectionNoBits *read(Archiver &AR, ELFSectionHeaderTy const *sh);
+  static ELFSectionNoBits *read(Archiver &AR,
+                               ELFObjectTy *owner,
+                               ELFSectionHeaderTy const *sh);
 };
 
 #include "impl/ELFSectionNoBits.hxx"
@@ -0,0 +1,182 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef IMAGE_CACHE_H
+#define IMAGE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+// On-disk cache of a fully relocated object image.
+//
+// The image is saved as laid out in its MemArena, together with the list of
+// relocated words that depend on where the image or one of its external
+// symbols ended up (fixups).  A warm load maps the saved image (at its old
+// address when that range is free), resolves the external symbols again and
+// patches only the fixups whose target moved.  Relocations that can't be
+// patched that way pin the image base or the external symbol instead, and a
+// warm load that can't honour a pin is treated as a miss.
+
+struct ImageCacheKey {
+  uint64_t object_hash;
+  uint64_t object_size;
+  uint64_t abi_hash;
+  uint32_t machine;
+  uint32_t bitwidth;
+};
+
+enum ImageCacheFixupKind {
+  IMAGE_FIXUP_ABS32,        // 32-bit absolute address.
+  IMAGE_FIXUP_ABS32S,       // Sign-extended 32-bit absolute address.
+  IMAGE_FIXUP_ABS64,        // 64-bit absolute address.
+  IMAGE_FIXUP_REL32,        // 32-bit PC-relative displacement.
+  IMAGE_FIXUP_REL64,        // 64-bit PC-relative displacement.
+  IMAGE_FIXUP_MOVW_ARM,     // ARM movw, low half of the address.
+  IMAGE_FIXUP_MOVT_ARM,     // ARM movt, high half of the address plus addend.
+  IMAGE_FIXUP_MOVW_THUMB,   // Thumb-2 movw.
+  IMAGE_FIXUP_MOVT_THUMB,   // Thumb-2 movt.
+};
+
+struct ImageCacheFixup {
+  uint32_t offset;          // Site, from the start of the image.
+  uint16_t kind;            // ImageCacheFixupKind.
+  int16_t addend;           // Added to the target by movw and movt.
+  int32_t target;           // External symbol index, or -1 for the image.
+  uint32_t symbol;          // Target offset when target is -1.
+};
+
+class ImageCacheWriter {
+private:
+  struct External {
+    std::string name;
+    void const *addr;
+    bool pinned;
+  };
+
+  struct Symbol {
+    std::string name;
+    uint64_t offset;
+    uint64_t size;
+    bool is_func;
+  };
+
+  struct Protect {
+    uint32_t offset;
+    uint32_t size;
+    uint32_t prot;
+  };
+
+  unsigned char const *image;
+  size_t image_size;
+  bool cacheable;
+  bool pinned_base;
+
+  std::vector<uint32_t> sections;
+  std::vector<Protect> protects;
+  std::vector<External> externals;
+  std::vector<Symbol> symbols;
+  std::vector<ImageCacheFixup> fixups;
+
+  int findExternal(void const *addr) const;
+
+  bool inImage(void const *addr) const {
+    return (unsigned char const *)addr >= image &&
+           (unsigned char const *)addr <= image + image_size;
+  }
+
+public:
+  ImageCacheWriter(unsigned char const *image, size_t image_size);
+
+  void setSection(size_t index, void const *addr, size_t size, int prot);
+
+  void addExternal(char const *name, void const *addr);
+
+  void addSymbol(char const *name, void const *addr, size_t size,
+                 bool is_func);
+
+  // sym is the address the relocation resolved its symbol to.
+  void addFixup(void const *site, ImageCacheFixupKind kind, void const *sym,
+                int32_t addend = 0);
+
+  // The relocation at sym can't be patched; require it not to move.
+  void pin(void const *sym);
+
+  void markUncacheable() {
+    cacheable = false;
+  }
+
+  bool isCacheable() const {
+    return cacheable;
+  }
+
+  bool contains(void const *addr) const {
+    return inImage(addr);
+  }
+
+  // Written to a temporary file first and renamed, so concurrent loaders
+  // never see a partial entry.
+  bool write(char const *path, ImageCacheKey const &key) const;
+};
+
+class ImageCache {
+private:
+  struct Symbol {
+    uint32_t name;
+    uint32_t flags;
+    uint64_t offset;
+    uint64_t size;
+  };
+
+  unsigned char *image;
+  size_t image_size;
+
+  std::vector<uint32_t> sections;
+  std::vector<Symbol> symbols;
+  std::string strings;
+  std::map<std::string, size_t> symbol_index;
+
+  ImageCache();
+
+  Symbol const *lookup(char const *name) const;
+
+public:
+  // Returns NULL on a miss: no entry, a different key, an external symbol
+  // that can't be resolved, or a pin that can't be honoured.
+  static ImageCache *load(char const *path, ImageCacheKey const &key,
+                          void *(*find_sym)(void *context, char const *name),
+                          void *context);
+
+  ~ImageCache();
+
+  static uint64_t hash(void const *data, size_t size);
+
+  void *getSymbolAddress(char const *name) const;
+
+  size_t getSymbolSize(char const *name) const;
+
+  size_t getFuncCount() const;
+
+  void getFuncNameList(size_t size, char const **list) const;
+
+  // NULL if section index isn't part of the image.
+  unsigned char *getSectionAddress(size_t index) const;
+};
+
+#endif // IMAGE_CACHE_H
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MEM_ARENA_H
+#define MEM_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+// A single address range that all the sections of one object are carved
+// from, so that the loaded image is contiguous and can be saved and mapped
+// again as a whole (see ImageCache).
+//
+// Allocations are packed at their own alignment and grouped by protection:
+// a new page is started only when the protection changes, so an object that
+// is read in text, rodata, data order ends up in at most three mappings.
+class MemArena {
+private:
+  struct Group {
+    size_t offset;
+    size_t size;
+    int prot;
+  };
+
+  unsigned char *base;
+  size_t reserved;
+  size_t used;
+  size_t committed;
+
+  std::vector<Group> groups;
+
+  static size_t huge_page_threshold;
+
+  bool commit(size_t end);
+
+public:
+  MemArena();
+
+  ~MemArena();
+
+  // Reserve address space only; pages are committed by allocate().
+  // exec_size is the expected size of the executable group; when it is at
+  // least the huge page threshold the range starts on a huge page boundary
+  // and is advised for transparent huge pages.
+  bool reserve(size_t size, size_t exec_size = 0);
+
+  // Returns zeroed, read-write memory aligned to align (a power of two), or
+  // NULL once the reservation is exhausted.  The memory gets prot when
+  // protect() is called.
+  unsigned char *allocate(size_t size, size_t align, int prot);
+
+  // Apply the final protection of every group.
+  bool protect();
+
+  // Give back the reserved space that was never allocated.
+  void trim();
+
+  unsigned char const *getBuffer() const {
+    return base;
+  }
+
+  unsigned char *getBuffer() {
+    return base;
+  }
+
+  // The image extent, in whole pages.
+  size_t size() const {
+    size_t page = getPageSize();
+    return (used + page - 1) / page * page;
+  }
+
+  size_t getGroupCount() const {
+    return groups.size();
+  }
+
+  bool contains(void const *addr) const {
+    return (unsigned char const *)addr >= base &&
+           (unsigned char const *)addr < base + used;
+  }
+
+  static size_t getPageSize();
+
+  static size_t getHugePageSize();
+
+  // 0 (the default) disables huge pages.
+  static void setHugePageThreshold(size_t size) {
+    huge_page_threshold = size;
+  }
+};
+
+#endif // MEM_ARENA_H
@@ -21,6 +21,8 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+class MemArena;
+
 typedef void *(*AllocFunc) (size_t, uint32_t);
 typedef void (*FreeFunc) (void *);
 
@@ -29,6 +31,7 @@ private:
   unsigned char *buf;
   size_t buf_size;
   bool bVendorBuf;
+  bool bArenaBuf;
 
   static AllocFunc VendorAlloc;
   static FreeFunc VendorFree;
@@ -42,6 +45,11 @@ public:
 
   bool allocate(size_t size);
 
+  // Allocate from arena when possible, falling back to a separate mapping.
+  // prot is the final protection, which the arena applies to the whole
+  // group the chunk is packed into.
+  bool allocate(size_t size, MemArena *arena, size_t align, int prot);
+
   void print() const;
 
   bool protect(int prot);
@@ -34,6 +34,11 @@ public:
   void initStubTable(unsigned char *table, size_t count);
   void *allocateStub(void *addr = 0);
 
+  // Target address to stub, for every stub allocated so far.
+  std::map<void *, void *> const &getStubIndex() const {
+    return stub_index;
+  }
+
   size_t calcStubTableSize(size_t count) const;
   virtual size_t getUnitStubSize() const = 0;
 
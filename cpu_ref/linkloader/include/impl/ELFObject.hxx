@@ -29,6 +29,15 @@
 
 #include <llvm/ADT/SmallVector.h>
 
+#include <algorithm>
+#include <string.h>
+
+#ifndef USE_MINGW
+#include <sys/mman.h>
+#else
+#include "mmanWindows.h"
+#endif
+
 #include "utils/rsl_assert.h"
 
 
@@ -50,10 +59,40 @@ ELFObject<Bitwidth>::read(Archiver &AR) {
     return 0;
   }
 
-  // Read each section
+  // Reserve one range for the whole image.  Common data is only sized
+  // once the symbols are read, so leave generous room for it; the
+  // reservation is address space only and the unused part is released after
+  // relocation.  Objects that still outgrow it fall back to per-section
+  // mappings.
+  size_t page_size = MemArena::getPageSize();
+  size_t arena_size = 0;
+  size_t exec_size = 0;
+  for (size_t i = 0; i < object->header->getSectionHeaderNum(); ++i) {
+    ELFSectionHeaderTy const *sh = (*object->shtab)[i];
+    if (sh->getFlags() & SHF_ALLOC) {
+      arena_size += (sh->getSize() + page_size - 1) / page_size * page_size;
+      if (sh->getFlags() & SHF_EXECINSTR) {
+        exec_size += sh->getSize();
+      }
+    } else if ((sh->getType() == SHT_REL || sh->getType() == SHT_RELA) &&
+               sh->getEntrySize() != 0) {
+      // Upper bound of the stub table (16 bytes is the largest stub).
+      arena_size += sh->getSize() / sh->getEntrySize() * 16 + page_size;
+    }
+  }
+  arena_size += std::max(arena_size * 4, (size_t)(16 << 20));
+  object->arena.reset(new MemArena());
+  if (!object->arena->reserve(arena_size, exec_size)) {
+    object->arena.reset();
+  }
+
+  // Read each section.  The ones with contents in memory are read last, in
+  // text, rodata, data, bss order, so that the arena packs each protection
+  // into one group.
   llvm::SmallVector<size_t, 4> progbits_ndx;
   for (size_t i = 0; i < object->header->getSectionHeaderNum(); ++i) {
-    if ((*object->shtab)[i]->getType() == SHT_PROGBITS) {
+    if ((*object->shtab)[i]->getType() == SHT_PROGBITS ||
+        (*object->shtab)[i]->getType() == SHT_NOBITS) {
       object->stab.push_back(NULL);
       progbits_ndx.push_back(i);
     } else {
@@ -69,6 +108,12 @@ ELFObject<Bitwidth>::read(Archiver &AR) {
   rsl_assert(symtab && "Symtab is required.");
   symtab->buildNameMap();
 
+  ELFSectionHeaderTableTy const &shtab = *object->shtab;
+  std::stable_sort(progbits_ndx.begin(), progbits_ndx.end(),
+                   [&shtab](size_t a, size_t b) {
+    return getLayoutRank(shtab[a]) < getLayoutRank(shtab[b]);
+  });
+
   for (size_t i = 0; i < progbits_ndx.size(); ++i) {
     size_t index = progbits_ndx[i];
 
@@ -77,9 +122,73 @@ ELFObject<Bitwidth>::read(Archiver &AR) {
     object->stab[index] = sec.release();
   }
 
+  // Common data goes right after .bss.
+  if (!object->initSHNCommonData()) {
+    __android_log_print(ANDROID_LOG_ERROR, "rs",
+                        "Allocate memory for common variable fail!\n");
+    return 0;
+  }
+
   return object.release();
 }
 
+template <unsigned Bitwidth>
+inline int
+ELFObject<Bitwidth>::getLayoutRank(ELFSectionHeaderTy const *sh) {
+  if (sh->getFlags() & SHF_EXECINSTR) {
+    return 0;
+  }
+  if (!(sh->getFlags() & SHF_WRITE)) {
+    return 1;
+  }
+  return sh->getType() == SHT_NOBITS ? 3 : 2;
+}
+
+template <unsigned Bitwidth>
+inline bool ELFObject<Bitwidth>::initSHNCommonData() {
+  size_t SHNCommonDataSize = 0;
+
+  ELFSectionSymTabTy *symtab =
+    static_cast<ELFSectionSymTabTy *>(getSectionByName(".symtab"));
+  rsl_assert(symtab && "Symtab is required.");
+
+  for (size_t i = 0; i < symtab->size(); ++i) {
+    ELFSymbolTy *sym = (*symtab)[i];
+
+    if (sym->getType() != STT_OBJECT) {
+      continue;
+    }
+
+    size_t idx = (size_t)sym->getSectionIndex();
+    switch (idx) {
+    default:
+      if ((*shtab)[idx]->getType() == SHT_NOBITS) {
+        // FIXME(logan): This is a workaround for .lcomm directives
+        // bug of LLVM ARM MC code generator.  Remove this when the
+        // LLVM bug is fixed.
+
+        size_t align = 16;
+        SHNCommonDataSize += (size_t)sym->getSize() + align;
+      }
+      break;
+
+    case SHN_COMMON:
+      {
+        size_t align = (size_t)sym->getValue();
+        SHNCommonDataSize += (size_t)sym->getSize() + align;
+      }
+      break;
+
+    case SHN_ABS:
+    case SHN_UNDEF:
+    case SHN_XINDEX:
+      break;
+    }
+  }
+
+  return initSHNCommonDataSize(SHNCommonDataSize);
+}
+
 template <unsigned Bitwidth>
 inline char const *ELFObject<Bitwidth>::getSectionName(size_t i) const {
   ELFSectionTy const *sec = stab[header->getStringSectionIndex()];
@@ -307,16 +416,21 @@ relocateARM(void *(*find_sym)(void *context, char const *name),
           S = (Inst_t)(uintptr_t)ext_sym;
           sym->setAddress(ext_sym);
         }
-        if (reltype == R_ARM_MOVT_ABS
-            || reltype == R_ARM_THM_MOVT_ABS) {
-          S >>= 16;
-        }
+        // The addend is the signed 16-bit literal of either instruction,
+        // and movt takes the high half of the whole S + A so a carry out of
+        // the low half is kept.  The addend is recorded for the image cache,
+        // which has to redo this at another address.
+        bool is_movt = (reltype == R_ARM_MOVT_ABS ||
+                        reltype == R_ARM_THM_MOVT_ABS);
 
         if (reltype == R_ARM_MOVT_ABS
             || reltype == R_ARM_MOVW_ABS_NC) {
-          // No need sign extend.
-          A = ((*inst & 0xF0000) >> 4) | (*inst & 0xFFF);
-          uint32_t result = (S + A);
+          A = (int16_t)(((*inst & 0xF0000) >> 4) | (*inst & 0xFFF));
+          rel->setAddend(A);
+          uint32_t result = (uint32_t)(S + A);
+          if (is_movt) {
+            result >>= 16;
+          }
           *inst = (((result) & 0xF000) << 4) |
             ((result) & 0xFFF) |
             (*inst & 0xFFF0F000);
@@ -324,13 +438,14 @@ relocateARM(void *(*find_sym)(void *context, char const *name),
           // Hack for two 16bit.
           *inst = ((*inst >> 16) & 0xFFFF) | (*inst << 16);
           // imm16: [19-16][26][14-12][7-0]
-          A = (((*inst >>  4) & 0xF000u) |
-               ((*inst >> 15) & 0x0800u) |
-               ((*inst >>  4) & 0x0700u) |
-               ( *inst        & 0x00FFu));
+          A = (int16_t)(((*inst >>  4) & 0xF000u) |
+                        ((*inst >> 15) & 0x0800u) |
+                        ((*inst >>  4) & 0x0700u) |
+                        ( *inst        & 0x00FFu));
+          rel->setAddend(A);
           uint32_t result;
-          if (reltype == R_ARM_THM_MOVT_ABS) {
-            result = (S + A);
+          if (is_movt) {
+            result = (uint32_t)(S + A) >> 16;
           } else {
             result = (S + A) | T;
           }
@@ -1027,57 +1142,6 @@ relocateMIPS(void *(*find_sym)(void *context, char const *name),
 template <unsigned Bitwidth>
 inline void ELFObject<Bitwidth>::
 relocate(void *(*find_sym)(void *context, char const *name), void *context) {
-  // Init SHNCommonDataSize.
-  // Need refactoring
-  size_t SHNCommonDataSize = 0;
-
-  ELFSectionSymTabTy *symtab =
-    static_cast<ELFSectionSymTabTy *>(getSectionByName(".symtab"));
-  rsl_assert(symtab && "Symtab is required.");
-
-  for (size_t i = 0; i < symtab->size(); ++i) {
-    ELFSymbolTy *sym = (*symtab)[i];
-
-    if (sym->getType() != STT_OBJECT) {
-      continue;
-    }
-
-    size_t idx = (size_t)sym->getSectionIndex();
-    switch (idx) {
-    default:
-      if ((*shtab)[idx]->getType() == SHT_NOBITS) {
-        // FIXME(logan): This is a workaround for .lcomm directives
-        // bug of LLVM ARM MC code generator.  Remove this when the
-        // LLVM bug is fixed.
-
-        size_t align = 16;
-        SHNCommonDataSize += (size_t)sym->getSize() + align;
-      }
-      break;
-
-    case SHN_COMMON:
-      {
-        size_t align = (size_t)sym->getValue();
-        SHNCommonDataSize += (size_t)sym->getSize() + align;
-      }
-      break;
-
-    case SHN_ABS:
-    case SHN_UNDEF:
-    case SHN_XINDEX:
-      break;
-    }
-  }
-  if (!initSHNCommonDataSize(SHNCommonDataSize)) {
-    rsl_assert("Allocate memory for common variable fail!");
-    // TODO: Refactor object loading to use proper status/error returns.
-    // We mark the object as having missing symbols and return early in this
-    // case to signal a loading error (usually due to running out of
-    // available memory to allocate).
-    missingSymbols = true;
-    return;
-  }
-
   for (size_t i = 0; i < stab.size(); ++i) {
     ELFSectionHeaderTy *sh = (*shtab)[i];
     if (sh->getType() != SHT_REL && sh->getType() != SHT_RELA) {
@@ -1138,6 +1202,13 @@ relocate(void *(*find_sym)(void *context, char const *name), void *context) {
       }
     }
   }
+
+  if (arena) {
+    if (!arena->protect()) {
+      llvm::errs() << "Error: Can't mprotect.\n";
+    }
+    arena->trim();
+  }
 }
 
 template <unsigned Bitwidth>
@@ -1153,4 +1224,278 @@ inline void ELFObject<Bitwidth>::print() const {
   }
 }
 
+template <unsigned Bitwidth>
+inline void ELFObject<Bitwidth>::describeImage(ImageCacheWriter &writer) {
+  int machine = getHeader()->getMachine();
+
+  // MIPS code goes through the shared GOT, which isn't part of the image.
+  if (!arena || machine == EM_MIPS || missingSymbols) {
+    writer.markUncacheable();
+    return;
+  }
+
+  for (size_t i = 0; i < stab.size(); ++i) {
+    ELFSectionHeaderTy *sh = (*shtab)[i];
+    if ((sh->getType() != SHT_PROGBITS && sh->getType() != SHT_NOBITS) ||
+        !stab[i]) {
+      continue;
+    }
+    ELFSectionBitsTy *bits = static_cast<ELFSectionBitsTy *>(stab[i]);
+    if (bits->size() == 0) {
+      continue;
+    }
+    writer.setSection(i, bits->getBuffer(), bits->size(),
+                      ELFSectionBitsTy::getProtection(sh));
+  }
+
+  ELFSectionSymTabTy *symtab =
+    static_cast<ELFSectionSymTabTy *>(getSectionByName(".symtab"));
+  rsl_assert(symtab && "Symtab is required.");
+
+  for (size_t i = 0; i < symtab->size(); ++i) {
+    ELFSymbolTy *sym = (*symtab)[i];
+    if (!sym) {
+      continue;
+    }
+    size_t idx = (size_t)sym->getSectionIndex();
+    if (idx == SHN_UNDEF) {
+      // Externals are only resolved once referenced.
+      void *addr = sym->getAddress(machine, false);
+      if (addr) {
+        writer.addExternal(sym->getName(), addr);
+      }
+      continue;
+    }
+    switch (sym->getType()) {
+    case STT_OBJECT:
+    case STT_FUNC:
+    case STT_SECTION:
+    case STT_NOTYPE:
+      if (idx != SHN_ABS && idx != SHN_XINDEX) {
+        void *addr = sym->getAddress(machine, false);
+        if (addr) {
+          writer.addSymbol(sym->getName(), addr, (size_t)sym->getSize(),
+                           sym->isConcreteFunc());
+        }
+      }
+      break;
+    }
+  }
+
+  for (size_t i = 0; i < stab.size(); ++i) {
+    ELFSectionHeaderTy *sh = (*shtab)[i];
+    if (sh->getType() != SHT_REL && sh->getType() != SHT_RELA) {
+      continue;
+    }
+    ELFSectionRelTableTy *reltab =
+      static_cast<ELFSectionRelTableTy *>(stab[i]);
+
+    // Same section pairing as relocate().
+    const char *need_rel_name = sh->getName() +
+                                (sh->getType() == SHT_REL ? 4 : 5);
+    if (!strcmp(".ARM.exidx", need_rel_name)) {
+      continue;
+    }
+    ELFSectionProgBitsTy *text =
+      static_cast<ELFSectionProgBitsTy *>(getSectionByName(need_rel_name));
+
+    for (size_t j = 0; j < reltab->size(); ++j) {
+      ELFRelocTy *rel = (*reltab)[j];
+      ELFSymbolTy *sym = (*symtab)[rel->getSymTabIndex()];
+      unsigned char *P = &(*text)[rel->getOffset()];
+      void *S = sym->getAddress(machine, false);
+      bool external = !writer.contains(S);
+
+      switch (machine) {
+      case EM_ARM:
+        switch (rel->getType()) {
+        default:
+          writer.markUncacheable();
+          break;
+        case R_ARM_ABS32:
+          writer.addFixup(P, IMAGE_FIXUP_ABS32, S);
+          break;
+        case R_ARM_CALL:
+        case R_ARM_THM_CALL:
+        case R_ARM_JUMP24:
+        case R_ARM_THM_JUMP24:
+          // Always through a stub, which is recorded below.
+          break;
+        case R_ARM_MOVW_ABS_NC:
+          writer.addFixup(P, IMAGE_FIXUP_MOVW_ARM, S, rel->getAddend());
+          break;
+        case R_ARM_MOVT_ABS:
+          writer.addFixup(P, IMAGE_FIXUP_MOVT_ARM, S, rel->getAddend());
+          break;
+        case R_ARM_THM_MOVW_ABS_NC:
+          writer.addFixup(P, IMAGE_FIXUP_MOVW_THUMB, S, rel->getAddend());
+          break;
+        case R_ARM_THM_MOVT_ABS:
+          writer.addFixup(P, IMAGE_FIXUP_MOVT_THUMB, S, rel->getAddend());
+          break;
+        }
+        break;
+
+      case EM_AARCH64:
+        switch (rel->getType()) {
+        default:
+          writer.markUncacheable();
+          break;
+        case R_AARCH64_ABS64:
+          writer.addFixup(P, IMAGE_FIXUP_ABS64, S);
+          break;
+        case R_AARCH64_ABS32:
+          writer.addFixup(P, IMAGE_FIXUP_ABS32, S);
+          break;
+        case R_AARCH64_PREL64:
+          if (external) {
+            writer.addFixup(P, IMAGE_FIXUP_REL64, S);
+          }
+          break;
+        case R_AARCH64_PREL32:
+          if (external) {
+            writer.addFixup(P, IMAGE_FIXUP_REL32, S);
+          }
+          break;
+        case R_AARCH64_ADR_PREL_PG_HI21:
+        case R_AARCH64_ADR_PREL_LO21:
+        case R_AARCH64_ADD_ABS_LO12_NC:
+        case R_AARCH64_LDST8_ABS_LO12_NC:
+        case R_AARCH64_LDST16_ABS_LO12_NC:
+        case R_AARCH64_LDST32_ABS_LO12_NC:
+        case R_AARCH64_LDST64_ABS_LO12_NC:
+        case R_AARCH64_LDST128_ABS_LO12_NC:
+          // Page-relative, so the image can move by whole pages.
+          if (external) {
+            writer.pin(S);
+          }
+          break;
+        case R_AARCH64_CALL26:
+        case R_AARCH64_JUMP26:
+          {
+            // Calls that were out of range went through a stub.
+            uint32_t inst;
+            memcpy(&inst, P, sizeof(inst));
+            int32_t imm = (int32_t)(inst << 6) >> 6;
+            if (external && !writer.contains(P + (intptr_t)imm * 4)) {
+              writer.pin(S);
+            }
+          }
+          break;
+        case R_AARCH64_ABS16:
+        case R_AARCH64_PREL16:
+        case R_AARCH64_MOVW_UABS_G0:
+        case R_AARCH64_MOVW_UABS_G0_NC:
+        case R_AARCH64_MOVW_UABS_G1:
+        case R_AARCH64_MOVW_UABS_G1_NC:
+        case R_AARCH64_MOVW_UABS_G2:
+        case R_AARCH64_MOVW_UABS_G2_NC:
+        case R_AARCH64_MOVW_UABS_G3:
+        case R_AARCH64_MOVW_SABS_G0:
+        case R_AARCH64_MOVW_SABS_G1:
+        case R_AARCH64_MOVW_SABS_G2:
+          writer.pin(S);
+          break;
+        }
+        break;
+
+      case EM_X86_64:
+        switch (rel->getType()) {
+        default:
+          writer.markUncacheable();
+          break;
+        case R_X86_64_64:
+          writer.addFixup(P, IMAGE_FIXUP_ABS64, S);
+          break;
+        case R_X86_64_32:
+          writer.addFixup(P, IMAGE_FIXUP_ABS32, S);
+          break;
+        case R_X86_64_32S:
+          writer.addFixup(P, IMAGE_FIXUP_ABS32S, S);
+          break;
+        case R_X86_64_PC32:
+          {
+            // Out of range targets went through a stub.
+            int32_t disp;
+            memcpy(&disp, P, sizeof(disp));
+            unsigned char *target = P + disp - (intptr_t)rel->getAddend();
+            if (external && !writer.contains(target)) {
+              writer.addFixup(P, IMAGE_FIXUP_REL32, S);
+            }
+          }
+          break;
+        case R_X86_64_PC64:
+          if (external) {
+            writer.addFixup(P, IMAGE_FIXUP_REL64, S);
+          }
+          break;
+        case R_X86_64_16:
+        case R_X86_64_PC16:
+        case R_X86_64_8:
+        case R_X86_64_PC8:
+          writer.pin(S);
+          break;
+        }
+        break;
+
+      case EM_386:
+        switch (rel->getType()) {
+        default:
+          writer.markUncacheable();
+          break;
+        case R_386_32:
+          writer.addFixup(P, IMAGE_FIXUP_ABS32, S);
+          break;
+        case R_386_PC32:
+          if (external) {
+            writer.addFixup(P, IMAGE_FIXUP_REL32, S);
+          }
+          break;
+        }
+        break;
+
+      default:
+        writer.markUncacheable();
+        break;
+      }
+    }
+  }
+
+  // Stubs hold the absolute address of their target.
+  size_t stub_addr_offset = 0;
+  ImageCacheFixupKind stub_kind = IMAGE_FIXUP_ABS32;
+  switch (machine) {
+  case EM_ARM:
+    stub_addr_offset = 4;
+    break;
+  case EM_AARCH64:
+    stub_addr_offset = 8;
+    stub_kind = IMAGE_FIXUP_ABS64;
+    break;
+  case EM_386:
+    stub_addr_offset = 1;
+    break;
+  case EM_X86_64:
+    stub_addr_offset = 6;
+    stub_kind = IMAGE_FIXUP_ABS64;
+    break;
+  }
+  for (size_t i = 0; i < stab.size(); ++i) {
+    if ((*shtab)[i]->getType() != SHT_PROGBITS || !stab[i]) {
+      continue;
+    }
+    StubLayout *stubs =
+      static_cast<ELFSectionProgBitsTy *>(stab[i])->getStubLayout();
+    if (!stubs) {
+      continue;
+    }
+    std::map<void *, void *> const &index = stubs->getStubIndex();
+    for (std::map<void *, void *>::const_iterator it = index.begin();
+         it != index.end(); ++it) {
+      writer.addFixup((unsigned char *)it->second + stub_addr_offset,
+                      stub_kind, it->first);
+    }
+  }
+}
+
 #endif // ELF_OBJECT_HXX
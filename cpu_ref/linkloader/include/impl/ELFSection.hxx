@@ -52,7 +52,7 @@ ELFSection<Bitwidth>::read(Archiver &AR,
       return ELFSectionProgBitsTy::read(AR, owner, sh);
 
     case SHT_NOBITS:
-      return ELFSectionNoBitsTy::read(AR, sh);
+      return ELFSectionNoBitsTy::read(AR, owner, sh);
 
     case SHT_REL:
     case SHT_RELA:
@@ -51,7 +51,8 @@ inline void ELFSectionBits<Bitwidth>::print() const {
 }
 
 template <unsigned Bitwidth>
-inline bool ELFSectionBits<Bitwidth>::protect() {
+inline int
+ELFSectionBits<Bitwidth>::getProtection(ELFSectionHeader<Bitwidth> const *sh) {
   int prot = PROT_READ;
 
   if (sh->getFlags() & SHF_WRITE) {
@@ -62,7 +63,12 @@ inline bool ELFSectionBits<Bitwidth>::protect() {
     prot |= PROT_EXEC;
   }
 
-  return chunk.protect(prot);
+  return prot;
+}
+
+template <unsigned Bitwidth>
+inline bool ELFSectionBits<Bitwidth>::protect() {
+  return chunk.protect(getProtection(sh));
 }
 
 #endif // ELF_SECTION_BITS_HXX
@@ -27,10 +27,13 @@
 template <unsigned Bitwidth>
 template <typename Archiver>
 inline ELFSectionNoBits<Bitwidth> *
-ELFSectionNoBits<Bitwidth>::read(Archiver &AR, ELFSectionHeaderTy const *sh) {
+ELFSectionNoBits<Bitwidth>::read(Archiver &AR,
+                                 ELFObjectTy *owner,
+                                 ELFSectionHeaderTy const *sh) {
   std::unique_ptr<ELFSectionNoBits> result(new ELFSectionNoBits());
 
-  if (!result->chunk.allocate(sh->getSize())) {
+  if (!result->chunk.allocate(sh->getSize(), owner->getArena(),
+                              sh->getAddressAlign(), ELFSectionBits<Bitwidth>::getProtection(sh))) {
     return NULL;
   }
 
@@ -25,6 +25,7 @@
 
 #include "utils/raw_ostream.h"
 
+#include <algorithm>
 #include <string.h>
 
 template <unsigned Bitwidth>
@@ -66,7 +67,9 @@ ELFSectionProgBits<Bitwidth>::read(Archiver &AR,
   }
 
   // Allocate text section
-  if (!result->chunk.allocate(alloc_size)) {
+  if (!result->chunk.allocate(alloc_size, owner->getArena(),
+                              std::max<size_t>(sh->getAddressAlign(), 4),
+                              ELFSectionBits<Bitwidth>::getProtection(sh))) {
     return NULL;
   }
 
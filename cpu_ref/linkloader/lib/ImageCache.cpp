@@ -0,0 +1,647 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ImageCache.h"
+#include "MemArena.h"
+
+#include "utils/flush_cpu_cache.h"
+
+#ifndef USE_MINGW       /* TODO create a proper HAVE_MMAN_H */
+#include <sys/mman.h>
+#else
+#include "mmanWindows.h"
+#endif
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef MAP_32BIT
+#define MAP_32BIT 0
+#endif
+
+#ifndef O_CLOEXEC
+#define O_CLOEXEC 0
+#endif
+
+namespace {
+
+char const kImageCacheMagic[8] = { 'R', 'S', 'L', 'I', 'M', 'G', '\0', '\0' };
+uint32_t const kImageCacheVersion = 2;
+
+uint32_t const kNoSection = 0xFFFFFFFFu;
+uint32_t const kExternalPinned = 0x1;
+uint32_t const kSymbolFunc = 0x1;
+uint32_t const kImagePinnedBase = 0x1;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t page_size;
+  uint32_t machine;
+  uint32_t bitwidth;
+  uint64_t object_hash;
+  uint64_t object_size;
+  uint64_t abi_hash;
+  uint64_t image_base;
+  uint64_t image_size;
+  uint64_t image_offset;
+  uint32_t flags;
+  uint32_t section_count;
+  uint32_t protect_count;
+  uint32_t external_count;
+  uint32_t symbol_count;
+  uint32_t fixup_count;
+  uint32_t strings_size;
+  uint32_t reserved;
+};
+
+struct FileProtect {
+  uint32_t offset;
+  uint32_t size;
+  uint32_t prot;
+};
+
+struct FileExternal {
+  uint32_t name;
+  uint32_t flags;
+  uint64_t address;
+};
+
+struct FileSymbol {
+  uint32_t name;
+  uint32_t flags;
+  uint64_t offset;
+  uint64_t size;
+};
+
+bool writeFully(int fd, void const *data, size_t size) {
+  unsigned char const *p = (unsigned char const *)data;
+  while (size > 0) {
+    ssize_t n = write(fd, p, size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    p += n;
+    size -= n;
+  }
+  return true;
+}
+
+bool readFully(int fd, void *data, size_t size, off_t offset) {
+  unsigned char *p = (unsigned char *)data;
+  while (size > 0) {
+    ssize_t n = pread(fd, p, size, offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    p += n;
+    size -= n;
+    offset += n;
+  }
+  return true;
+}
+
+inline uint32_t swapHalves(uint32_t inst) {
+  return ((inst >> 16) & 0xFFFF) | (inst << 16);
+}
+
+bool fitsInt32(int64_t v) {
+  return v >= INT32_MIN && v <= INT32_MAX;
+}
+
+// Moves one relocated site from old_s to new_s.  delta is how far the image
+// itself moved, which PC-relative sites cancel out.  A movt is recomputed
+// from new_s + addend since a carry out of the low half can change.
+bool applyFixup(unsigned char *site, uint16_t kind, int32_t addend,
+                uintptr_t old_s, uintptr_t new_s, intptr_t delta) {
+  bool const wide = sizeof(void *) == 8;
+  intptr_t diff = (intptr_t)(new_s - old_s);
+
+  switch (kind) {
+  case IMAGE_FIXUP_ABS32:
+    {
+      uint32_t v;
+      memcpy(&v, site, sizeof(v));
+      int64_t nv = (int64_t)v + diff;
+      if (wide && (nv < 0 || nv > (int64_t)UINT32_MAX)) {
+        return false;
+      }
+      v = (uint32_t)nv;
+      memcpy(site, &v, sizeof(v));
+    }
+    return true;
+
+  case IMAGE_FIXUP_ABS32S:
+    {
+      int32_t v;
+      memcpy(&v, site, sizeof(v));
+      int64_t nv = (int64_t)v + diff;
+      if (wide && !fitsInt32(nv)) {
+        return false;
+      }
+      v = (int32_t)nv;
+      memcpy(site, &v, sizeof(v));
+    }
+    return true;
+
+  case IMAGE_FIXUP_ABS64:
+    {
+      uint64_t v;
+      memcpy(&v, site, sizeof(v));
+      v += (int64_t)diff;
+      memcpy(site, &v, sizeof(v));
+    }
+    return true;
+
+  case IMAGE_FIXUP_REL32:
+    {
+      int32_t v;
+      memcpy(&v, site, sizeof(v));
+      int64_t nv = (int64_t)v + diff - delta;
+      if (wide && !fitsInt32(nv)) {
+        return false;
+      }
+      v = (int32_t)nv;
+      memcpy(site, &v, sizeof(v));
+    }
+    return true;
+
+  case IMAGE_FIXUP_REL64:
+    {
+      uint64_t v;
+      memcpy(&v, site, sizeof(v));
+      v += (int64_t)diff - (int64_t)delta;
+      memcpy(site, &v, sizeof(v));
+    }
+    return true;
+
+  case IMAGE_FIXUP_MOVW_ARM:
+  case IMAGE_FIXUP_MOVT_ARM:
+    {
+      uint32_t inst;
+      memcpy(&inst, site, sizeof(inst));
+      uint32_t imm = ((inst & 0xF0000) >> 4) | (inst & 0xFFF);
+      if (kind == IMAGE_FIXUP_MOVW_ARM) {
+        imm += (uint32_t)diff;
+      } else {
+        imm = (uint32_t)(new_s + addend) >> 16;
+      }
+      inst = ((imm & 0xF000) << 4) | (imm & 0xFFF) | (inst & 0xFFF0F000);
+      memcpy(site, &inst, sizeof(inst));
+    }
+    return true;
+
+  case IMAGE_FIXUP_MOVW_THUMB:
+  case IMAGE_FIXUP_MOVT_THUMB:
+    {
+      uint32_t inst;
+      memcpy(&inst, site, sizeof(inst));
+      inst = swapHalves(inst);
+      // imm16: [19-16][26][14-12][7-0]
+      uint32_t imm = (((inst >>  4) & 0xF000u) |
+                      ((inst >> 15) & 0x0800u) |
+                      ((inst >>  4) & 0x0700u) |
+                      ( inst        & 0x00FFu));
+      if (kind == IMAGE_FIXUP_MOVW_THUMB) {
+        imm += (uint32_t)diff;
+      } else {
+        imm = (uint32_t)(new_s + addend) >> 16;
+      }
+      inst &= 0xFBF08F00u;
+      inst |= (imm & 0xF000u) << 4;
+      inst |= (imm & 0x0800u) << 15;
+      inst |= (imm & 0x0700u) << 4;
+      inst |= (imm & 0x00FFu);
+      inst = swapHalves(inst);
+      memcpy(site, &inst, sizeof(inst));
+    }
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+} // end anonymous namespace
+
+ImageCacheWriter::ImageCacheWriter(unsigned char const *image_,
+                                   size_t image_size_)
+  : image(image_), image_size(image_size_), cacheable(image_ != NULL),
+    pinned_base(false) {
+}
+
+void ImageCacheWriter::setSection(size_t index, void const *addr,
+                                  size_t size, int prot) {
+  if (!inImage(addr) || !inImage((unsigned char const *)addr + size)) {
+    cacheable = false;
+    return;
+  }
+  if (sections.size() <= index) {
+    sections.resize(index + 1, kNoSection);
+  }
+  uint32_t offset = (uint32_t)((unsigned char const *)addr - image);
+  sections[index] = offset;
+
+  // Sections are packed within the pages of their protection group, so the
+  // whole pages they touch share the same protection.
+  size_t page_size = MemArena::getPageSize();
+  size_t start = offset / page_size * page_size;
+  size_t end = (offset + size + page_size - 1) / page_size * page_size;
+  Protect p = { (uint32_t)start, (uint32_t)(std::min(end, image_size) - start),
+                (uint32_t)prot };
+  protects.push_back(p);
+}
+
+int ImageCacheWriter::findExternal(void const *addr) const {
+  for (size_t i = 0; i < externals.size(); ++i) {
+    if (externals[i].addr == addr) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+void ImageCacheWriter::addExternal(char const *name, void const *addr) {
+  External e = { name, addr, false };
+  externals.push_back(e);
+}
+
+void ImageCacheWriter::addSymbol(char const *name, void const *addr,
+                                 size_t size, bool is_func) {
+  if (!inImage(addr)) {
+    return;
+  }
+  Symbol s = { name, (uint64_t)((unsigned char const *)addr - image),
+               (uint64_t)size, is_func };
+  symbols.push_back(s);
+}
+
+void ImageCacheWriter::addFixup(void const *site, ImageCacheFixupKind kind,
+                                void const *sym, int32_t addend) {
+  if (!inImage(site) || addend != (int16_t)addend) {
+    cacheable = false;
+    return;
+  }
+
+  ImageCacheFixup f;
+  f.offset = (uint32_t)((unsigned char const *)site - image);
+  f.kind = (uint16_t)kind;
+  f.addend = (int16_t)addend;
+  if (inImage(sym)) {
+    f.target = -1;
+    f.symbol = (uint32_t)((unsigned char const *)sym - image);
+  } else {
+    f.target = findExternal(sym);
+    f.symbol = 0;
+    if (f.target < 0) {
+      cacheable = false;
+      return;
+    }
+  }
+  fixups.push_back(f);
+}
+
+void ImageCacheWriter::pin(void const *sym) {
+  if (inImage(sym)) {
+    pinned_base = true;
+    return;
+  }
+  int index = findExternal(sym);
+  if (index < 0) {
+    cacheable = false;
+    return;
+  }
+  externals[index].pinned = true;
+}
+
+bool ImageCacheWriter::write(char const *path,
+                             ImageCacheKey const &key) const {
+  if (!cacheable || image_size > UINT32_MAX) {
+    return false;
+  }
+
+  std::string strings;
+  std::vector<FileExternal> file_externals;
+  for (size_t i = 0; i < externals.size(); ++i) {
+    FileExternal e = { (uint32_t)strings.size(),
+                       externals[i].pinned ? kExternalPinned : 0,
+                       (uint64_t)(uintptr_t)externals[i].addr };
+    strings.append(externals[i].name);
+    strings.push_back('\0');
+    file_externals.push_back(e);
+  }
+  std::vector<FileSymbol> file_symbols;
+  for (size_t i = 0; i < symbols.size(); ++i) {
+    FileSymbol s = { (uint32_t)strings.size(),
+                     symbols[i].is_func ? kSymbolFunc : 0,
+                     symbols[i].offset, symbols[i].size };
+    strings.append(symbols[i].name);
+    strings.push_back('\0');
+    file_symbols.push_back(s);
+  }
+
+  size_t page_size = MemArena::getPageSize();
+  size_t meta_size = sizeof(FileHeader) +
+                     sections.size() * sizeof(uint32_t) +
+                     protects.size() * sizeof(FileProtect) +
+                     file_externals.size() * sizeof(FileExternal) +
+                     file_symbols.size() * sizeof(FileSymbol) +
+                     fixups.size() * sizeof(ImageCacheFixup) +
+                     strings.size();
+
+  FileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kImageCacheMagic, sizeof(header.magic));
+  header.version = kImageCacheVersion;
+  header.page_size = (uint32_t)page_size;
+  header.machine = key.machine;
+  header.bitwidth = key.bitwidth;
+  header.object_hash = key.object_hash;
+  header.object_size = key.object_size;
+  header.abi_hash = key.abi_hash;
+  header.image_base = (uint64_t)(uintptr_t)image;
+  header.image_size = image_size;
+  header.image_offset = (meta_size + page_size - 1) / page_size * page_size;
+  header.flags = pinned_base ? kImagePinnedBase : 0;
+  header.section_count = (uint32_t)sections.size();
+  header.protect_count = (uint32_t)protects.size();
+  header.external_count = (uint32_t)file_externals.size();
+  header.symbol_count = (uint32_t)file_symbols.size();
+  header.fixup_count = (uint32_t)fixups.size();
+  header.strings_size = (uint32_t)strings.size();
+
+  std::string tmp_path(path);
+  tmp_path.append(".XXXXXX");
+  std::vector<char> tmp_name(tmp_path.begin(), tmp_path.end());
+  tmp_name.push_back('\0');
+  int fd = mkstemp(&tmp_name[0]);
+  if (fd < 0) {
+    return false;
+  }
+
+  std::vector<unsigned char> padding(header.image_offset - meta_size, 0);
+  bool ok = writeFully(fd, &header, sizeof(header)) &&
+    (sections.empty() ||
+     writeFully(fd, &sections[0], sections.size() * sizeof(uint32_t))) &&
+    (protects.empty() ||
+     writeFully(fd, &protects[0], protects.size() * sizeof(FileProtect))) &&
+    (file_externals.empty() ||
+     writeFully(fd, &file_externals[0],
+                file_externals.size() * sizeof(FileExternal))) &&
+    (file_symbols.empty() ||
+     writeFully(fd, &file_symbols[0],
+                file_symbols.size() * sizeof(FileSymbol))) &&
+    (fixups.empty() ||
+     writeFully(fd, &fixups[0], fixups.size() * sizeof(ImageCacheFixup))) &&
+    writeFully(fd, strings.data(), strings.size()) &&
+    (padding.empty() || writeFully(fd, &padding[0], padding.size())) &&
+    writeFully(fd, image, image_size);
+
+  if (close(fd) != 0) {
+    ok = false;
+  }
+  if (!ok || rename(&tmp_name[0], path) != 0) {
+    unlink(&tmp_name[0]);
+    return false;
+  }
+  return true;
+}
+
+ImageCache::ImageCache() : image(NULL), image_size(0) {
+}
+
+ImageCache::~ImageCache() {
+  if (image) {
+    munmap(image, image_size);
+  }
+}
+
+uint64_t ImageCache::hash(void const *data, size_t size) {
+  // FNV-1a.
+  unsigned char const *p = (unsigned char const *)data;
+  uint64_t h = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < size; ++i) {
+    h ^= p[i];
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+ImageCache *ImageCache::load(char const *path, ImageCacheKey const &key,
+                             void *(*find_sym)(void *, char const *),
+                             void *context) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  FileHeader header;
+  struct stat sb;
+  size_t page_size = MemArena::getPageSize();
+  if (!readFully(fd, &header, sizeof(header), 0) ||
+      memcmp(header.magic, kImageCacheMagic, sizeof(header.magic)) != 0 ||
+      header.version != kImageCacheVersion ||
+      header.page_size != page_size ||
+      header.machine != key.machine ||
+      header.bitwidth != key.bitwidth ||
+      header.object_hash != key.object_hash ||
+      header.object_size != key.object_size ||
+      header.abi_hash != key.abi_hash ||
+      header.image_size == 0 ||
+      header.image_offset % page_size != 0 ||
+      fstat(fd, &sb) != 0 ||
+      (uint64_t)sb.st_size < header.image_offset + header.image_size) {
+    close(fd);
+    return NULL;
+  }
+
+  uint64_t meta_size = (uint64_t)header.section_count * sizeof(uint32_t) +
+                       (uint64_t)header.protect_count * sizeof(FileProtect) +
+                       (uint64_t)header.external_count * sizeof(FileExternal) +
+                       (uint64_t)header.symbol_count * sizeof(FileSymbol) +
+                       (uint64_t)header.fixup_count * sizeof(ImageCacheFixup) +
+                       header.strings_size;
+  if (meta_size + sizeof(header) > header.image_offset) {
+    close(fd);
+    return NULL;
+  }
+
+  std::vector<unsigned char> meta(meta_size + 1);
+  if (!readFully(fd, &meta[0], meta_size, sizeof(header))) {
+    close(fd);
+    return NULL;
+  }
+
+  unsigned char const *cursor = &meta[0];
+  uint32_t const *sections = (uint32_t const *)cursor;
+  cursor += header.section_count * sizeof(uint32_t);
+  FileProtect const *protects = (FileProtect const *)cursor;
+  cursor += header.protect_count * sizeof(FileProtect);
+  FileExternal const *externals = (FileExternal const *)cursor;
+  cursor += header.external_count * sizeof(FileExternal);
+  FileSymbol const *symbols = (FileSymbol const *)cursor;
+  cursor += header.symbol_count * sizeof(FileSymbol);
+  ImageCacheFixup const *fixups = (ImageCacheFixup const *)cursor;
+  cursor += header.fixup_count * sizeof(ImageCacheFixup);
+  char const *strings = (char const *)cursor;
+  meta[meta_size] = '\0';
+
+  // Resolve the external symbols before touching the image.
+  std::vector<uintptr_t> new_externals(header.external_count);
+  for (size_t i = 0; i < header.external_count; ++i) {
+    if (externals[i].name >= header.strings_size) {
+      close(fd);
+      return NULL;
+    }
+    void *addr = find_sym(context, strings + externals[i].name);
+    if (!addr || ((externals[i].flags & kExternalPinned) &&
+                  (uint64_t)(uintptr_t)addr != externals[i].address)) {
+      close(fd);
+      return NULL;
+    }
+    new_externals[i] = (uintptr_t)addr;
+  }
+
+  void *addr = mmap((void *)(uintptr_t)header.image_base,
+                    (size_t)header.image_size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_32BIT, fd, (off_t)header.image_offset);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    return NULL;
+  }
+
+  ImageCache *result = new ImageCache();
+  result->image = (unsigned char *)addr;
+  result->image_size = (size_t)header.image_size;
+
+  uintptr_t old_base = (uintptr_t)header.image_base;
+  uintptr_t new_base = (uintptr_t)addr;
+  intptr_t delta = (intptr_t)(new_base - old_base);
+  if (delta != 0 && (header.flags & kImagePinnedBase)) {
+    delete result;
+    return NULL;
+  }
+
+  for (size_t i = 0; i < header.fixup_count; ++i) {
+    ImageCacheFixup const &f = fixups[i];
+    uintptr_t old_s, new_s;
+    if (f.target < 0) {
+      old_s = old_base + f.symbol;
+      new_s = new_base + f.symbol;
+    } else if ((uint32_t)f.target < header.external_count) {
+      old_s = (uintptr_t)externals[f.target].address;
+      new_s = new_externals[f.target];
+    } else {
+      delete result;
+      return NULL;
+    }
+    if (old_s == new_s && delta == 0) {
+      continue;
+    }
+    size_t width = (f.kind == IMAGE_FIXUP_ABS64 ||
+                    f.kind == IMAGE_FIXUP_REL64) ? 8 : 4;
+    if ((uint64_t)f.offset + width > header.image_size ||
+        !applyFixup(result->image + f.offset, f.kind, f.addend,
+                    old_s, new_s, delta)) {
+      delete result;
+      return NULL;
+    }
+  }
+
+  for (size_t i = 0; i < header.protect_count; ++i) {
+    FileProtect const &p = protects[i];
+    if ((uint64_t)p.offset + p.size > header.image_size ||
+        mprotect(result->image + p.offset, p.size, (int)p.prot) != 0) {
+      delete result;
+      return NULL;
+    }
+    if (p.prot & PROT_EXEC) {
+      FLUSH_CPU_CACHE(result->image + p.offset,
+                      result->image + p.offset + p.size);
+    }
+  }
+
+  result->sections.assign(sections, sections + header.section_count);
+  result->strings.assign(strings, header.strings_size);
+  for (size_t i = 0; i < header.symbol_count; ++i) {
+    Symbol s = { symbols[i].name, symbols[i].flags,
+                 symbols[i].offset, symbols[i].size };
+    if (s.name >= header.strings_size || s.offset > header.image_size) {
+      delete result;
+      return NULL;
+    }
+    result->symbols.push_back(s);
+    result->symbol_index.insert(
+      std::make_pair(std::string(result->strings.c_str() + s.name), i));
+  }
+
+  return result;
+}
+
+ImageCache::Symbol const *ImageCache::lookup(char const *name) const {
+  std::map<std::string, size_t>::const_iterator it = symbol_index.find(name);
+  if (it == symbol_index.end()) {
+    return NULL;
+  }
+  return &symbols[it->second];
+}
+
+void *ImageCache::getSymbolAddress(char const *name) const {
+  Symbol const *s = lookup(name);
+  return s ? image + s->offset : NULL;
+}
+
+size_t ImageCache::getSymbolSize(char const *name) const {
+  Symbol const *s = lookup(name);
+  return s ? (size_t)s->size : 0;
+}
+
+size_t ImageCache::getFuncCount() const {
+  size_t result = 0;
+  for (size_t i = 0; i < symbols.size(); ++i) {
+    if (symbols[i].flags & kSymbolFunc) {
+      result++;
+    }
+  }
+  return result;
+}
+
+void ImageCache::getFuncNameList(size_t size, char const **list) const {
+  for (size_t i = 0, j = 0; i < symbols.size() && j < size; ++i) {
+    if (symbols[i].flags & kSymbolFunc) {
+      list[j++] = strings.c_str() + symbols[i].name;
+    }
+  }
+}
+
+unsigned char *ImageCache::getSectionAddress(size_t index) const {
+  if (index >= sections.size() || sections[index] == kNoSection) {
+    return NULL;
+  }
+  return image + sections[index];
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright 2014, The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MemArena.h"
+
+#ifndef USE_MINGW       /* TODO create a proper HAVE_MMAN_H */
+#include <sys/mman.h>
+#else
+#include "mmanWindows.h"
+#endif
+
+#include "utils/flush_cpu_cache.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#ifndef MAP_32BIT
+#define MAP_32BIT 0
+// Note: If the <sys/mman.h> does not come with MAP_32BIT, then we
+// define it as zero, so that it won't manipulate the flags.
+#endif
+
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+size_t MemArena::huge_page_threshold = 0;
+
+static inline size_t roundUp(size_t value, size_t align) {
+  return (value + align - 1) & ~(align - 1);
+}
+
+MemArena::MemArena() : base(NULL), reserved(0), used(0), committed(0) {
+}
+
+MemArena::~MemArena() {
+  if (base) {
+    munmap(base, reserved);
+  }
+}
+
+size_t MemArena::getPageSize() {
+#ifndef USE_MINGW
+  static size_t const page_size = (size_t)sysconf(_SC_PAGESIZE);
+  return page_size;
+#else
+  return 4096;
+#endif
+}
+
+size_t MemArena::getHugePageSize() {
+  static size_t huge_page_size = 0;
+  if (huge_page_size == 0) {
+    size_t size = 2 << 20;
+#ifndef USE_MINGW
+    FILE *fp = fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size",
+                     "r");
+    if (fp) {
+      unsigned long value = 0;
+      if (fscanf(fp, "%lu", &value) == 1 && value != 0 &&
+          (value & (value - 1)) == 0) {
+        size = (size_t)value;
+      }
+      fclose(fp);
+    }
+#endif
+    huge_page_size = size;
+  }
+  return huge_page_size;
+}
+
+bool MemArena::reserve(size_t size, size_t exec_size) {
+#ifdef USE_MINGW
+  // No lazily committed reservations here; sections use MemChunk's own
+  // mappings instead.
+  return false;
+#endif
+  size = roundUp(size, getPageSize());
+  if (base || size == 0) {
+    return false;
+  }
+
+  size_t huge = 0;
+#ifdef MADV_HUGEPAGE
+  if (huge_page_threshold != 0 && exec_size >= huge_page_threshold &&
+      exec_size >= getHugePageSize()) {
+    huge = getHugePageSize();
+  }
+#endif
+
+  // Same placement as MemChunk, so that PC-relative references to the
+  // runtime behave identically.  Over-reserve by one huge page so the start
+  // can be aligned.
+  void *addr = mmap(0, size + huge, PROT_NONE,
+                    MAP_PRIVATE | MAP_ANON | MAP_32BIT | MAP_NORESERVE,
+                    -1, 0);
+  if (addr == MAP_FAILED) {
+    return false;
+  }
+
+  base = (unsigned char *)addr;
+  reserved = size;
+  used = 0;
+  committed = 0;
+  groups.clear();
+
+  if (huge) {
+    unsigned char *aligned = (unsigned char *)roundUp((uintptr_t)addr, huge);
+    if (aligned != base) {
+      munmap(base, aligned - base);
+    }
+    munmap(aligned + size, huge - (aligned - base));
+    base = aligned;
+
+#ifdef MADV_HUGEPAGE
+    // The text is laid out first, so its whole huge pages start at base.
+    // Commit them in one go: a huge page is only used when the fault hits
+    // a 2MB aligned range that is entirely accessible.
+    size_t huge_size = exec_size / huge * huge;
+    if (madvise(base, huge_size, MADV_HUGEPAGE) == 0) {
+      commit(huge_size);
+    }
+#endif
+  }
+
+  return true;
+}
+
+bool MemArena::commit(size_t end) {
+  end = roundUp(end, getPageSize());
+  if (end <= committed) {
+    return true;
+  }
+  if (mprotect(base + committed, end - committed,
+               PROT_READ | PROT_WRITE) != 0) {
+    return false;
+  }
+  committed = end;
+  return true;
+}
+
+unsigned char *MemArena::allocate(size_t size, size_t align, int prot) {
+  if (!base || size == 0) {
+    return NULL;
+  }
+  if (align == 0 || (align & (align - 1)) != 0) {
+    align = 1;
+  }
+
+  bool new_group = groups.empty() || groups.back().prot != prot;
+  size_t offset = used;
+  if (new_group) {
+    offset = roundUp(offset, getPageSize());
+  }
+  offset = roundUp(offset, align);
+  if (offset > reserved || size > reserved - offset) {
+    return NULL;
+  }
+
+  if (!commit(offset + size)) {
+    return NULL;
+  }
+
+  if (new_group) {
+    Group group = { offset, 0, prot };
+    groups.push_back(group);
+  }
+  groups.back().size = offset + size - groups.back().offset;
+  used = offset + size;
+  return base + offset;
+}
+
+bool MemArena::protect() {
+  size_t page = getPageSize();
+  for (size_t i = 0; i < groups.size(); ++i) {
+    Group const &group = groups[i];
+    size_t end = roundUp(group.offset + group.size, page);
+    if (mprotect(base + group.offset, end - group.offset, group.prot) != 0) {
+      return false;
+    }
+    if (group.prot & PROT_EXEC) {
+      FLUSH_CPU_CACHE(base + group.offset, base + group.offset + group.size);
+    }
+  }
+  return true;
+}
+
+void MemArena::trim() {
+  size_t keep = size();
+  if (base && keep < reserved) {
+    if (keep == 0) {
+      munmap(base, reserved);
+      base = NULL;
+    } else {
+      munmap(base + keep, reserved - keep);
+    }
+    reserved = keep;
+    if (committed > keep) {
+      committed = keep;
+    }
+  }
+}
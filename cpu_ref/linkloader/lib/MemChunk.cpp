@@ -15,6 +15,7 @@
  */
 
 #include "MemChunk.h"
+#include "MemArena.h"
 
 #include "utils/flush_cpu_cache.h"
 #include "utils/helper.h"
@@ -44,10 +45,15 @@ static uintptr_t StartAddr = 0x7e000000UL;
 AllocFunc MemChunk::VendorAlloc = NULL;
 FreeFunc MemChunk::VendorFree = NULL;
 
-MemChunk::MemChunk() : buf(NULL), buf_size(0), bVendorBuf(true) {
+MemChunk::MemChunk() : buf(NULL), buf_size(0), bVendorBuf(true),
+                       bArenaBuf(false) {
 }
 
 MemChunk::~MemChunk() {
+  if (bArenaBuf) {
+    // The arena owns the pages.
+    return;
+  }
   if (!invalidBuf() && bVendorBuf && VendorFree) {
     (*VendorFree)(buf);
     return;
@@ -61,6 +67,23 @@ bool MemChunk::invalidBuf() const {
   return (buf == 0 || buf == (unsigned char *)MAP_FAILED);
 }
 
+bool MemChunk::allocate(size_t size, MemArena *arena, size_t align,
+                        int prot) {
+  if (size == 0) {
+    return true;
+  }
+  if (arena && !VendorAlloc) {
+    buf = arena->allocate(size, align, prot);
+    if (buf) {
+      bArenaBuf = true;
+      bVendorBuf = false;
+      buf_size = size;
+      return true;
+    }
+  }
+  return allocate(size);
+}
+
 bool MemChunk::allocate(size_t size) {
   if (size == 0) {
     return true;
@@ -102,6 +125,11 @@ void MemChunk::print() const {
 }
 
 bool MemChunk::protect(int prot) {
+  if (bArenaBuf) {
+    // Chunks share pages within the arena; MemArena::protect() covers them.
+    return true;
+  }
+
   if (buf_size > 0) {
     int ret = mprotect((void *)buf, buf_size, prot);
     if (ret == -1) {
@@ -15,6 +15,7 @@
  */
 
 #include "ELFObject.h"
+#include "android/librsloader.h"
 
 #include "utils/serialize.h"
 #include "ELF.h"
@@ -27,6 +28,7 @@
 #include <map>
 #include <stdio.h>
 #include <stdarg.h>
+#include <time.h>
 
 using namespace std;
 
@@ -42,10 +44,30 @@ void close_mmap_file(int fd,
 void dump_and_run_file(unsigned char const *image, size_t size,
                        int argc, char **argv);
 
+void run_cached_file(char const *cache_path,
+                     unsigned char const *image, size_t size,
+                     int argc, char **argv);
+
 int main(int argc, char **argv) {
   // Check arguments
+  char const *cache_path = NULL;
+  char const *prog = argv[0];
+  while (argc >= 3 && argv[1][0] == '-') {
+    if (strcmp(argv[1], "-c") == 0) {
+      cache_path = argv[2];
+    } else if (strcmp(argv[1], "-H") == 0) {
+      rsloaderSetHugePageThreshold((size_t)strtoul(argv[2], NULL, 0));
+    } else {
+      break;
+    }
+    argc -= 2;
+    argv += 2;
+  }
+
   if (argc < 2) {
-    llvm::errs() << "USAGE: " << argv[0] << " [ELFObjectFile] [ARGS]\n";
+    llvm::errs() << "USAGE: " << prog
+                 << " [-c ImageCacheFile] [-H HugePageThreshold]"
+                 << " [ELFObjectFile] [ARGS]\n";
     exit(EXIT_FAILURE);
   }
 
@@ -62,7 +84,11 @@ int main(int argc, char **argv) {
   }
 
   // Dump and run the file
-  dump_and_run_file(image, image_size, argc - 1, argv + 1);
+  if (cache_path) {
+    run_cached_file(cache_path, image, image_size, argc - 1, argv + 1);
+  } else {
+    dump_and_run_file(image, image_size, argc - 1, argv + 1);
+  }
 
   // Close the file
   close_mmap_file(fd, image, image_size);
@@ -138,8 +164,26 @@ void *find_sym(void *context, char const *name) {
   return 0;
 }
 
+// Number of mappings in this process, to see what loading an object costs.
+static int count_mappings() {
+  FILE *fp = fopen("/proc/self/maps", "r");
+  if (!fp) {
+    return 0;
+  }
+  int count = 0;
+  int ch;
+  while ((ch = fgetc(fp)) != EOF) {
+    if (ch == '\n') {
+      ++count;
+    }
+  }
+  fclose(fp);
+  return count;
+}
+
 template <unsigned Bitwidth, typename Archiver>
 void dump_and_run_object(Archiver &AR, int argc, char **argv) {
+  int mappings = count_mappings();
   std::unique_ptr<ELFObject<Bitwidth> > object(ELFObject<Bitwidth>::read(AR));
 
   if (!object) {
@@ -154,7 +198,8 @@ void dump_and_run_object(Archiver &AR, int argc, char **argv) {
         object->getSectionByName(".symtab"));
 
   object->relocate(find_sym, 0);
-  out() << "relocate finished!\n";
+  out() << "relocate finished! (" << count_mappings() - mappings
+        << " new mappings)\n";
   out().flush();
 
   int machine = object->getHeader()->getMachine();
@@ -206,6 +251,42 @@ void dump_and_run_file(unsigned char const *image, size_t size,
   }
 }
 
+static double now_us() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Loads through the image cache so that cold (link and write back) and warm
+// (map and rebase) loads can be compared by running the same command twice.
+void run_cached_file(char const *cache_path,
+                     unsigned char const *image, size_t size,
+                     int argc, char **argv) {
+  int mappings = count_mappings();
+  double start = now_us();
+  RSExecRef exec = rsloaderCreateExecCached(image, size, find_sym, 0,
+                                            cache_path, "rsloader-main");
+  double end = now_us();
+
+  if (!exec) {
+    llvm::errs() << "ERROR: Unable to load object\n";
+    return;
+  }
+
+  out() << (rsloaderIsExecCached(exec) ? "warm" : "cold") << " load: "
+        << (unsigned long long)(end - start) << " us, "
+        << count_mappings() - mappings << " new mappings\n";
+  out().flush();
+
+  void *main_addr = rsloaderGetSymbolAddress(exec, "main");
+  if (main_addr) {
+    ((int (*)(int, char **))main_addr)(argc, argv);
+    fflush(stdout);
+  }
+
+  rsloaderDisposeExec(exec);
+}
+
 bool open_mmap_file(char const *filename,
                     int &fd,
                     unsigned char const *&image,
@@ -31,6 +31,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include <linux/futex.h>
 
 #if !defined(RS_SERVER) && !defined(RS_COMPATIBILITY_LIB)
 #include <cutils/properties.h>
@@ -47,6 +50,58 @@ static pid_t gettid() {
 using namespace android;
 using namespace android::renderscript;
 
+// Default time idle threads spin waiting for the next launch or for the
+// workers to finish before they sleep.  Waking a sleeping thread costs a
+// system call and a trip through the scheduler.
+static const uint64_t kWorkerSpinNs = 50 * 1000;
+
+static void futexWait(volatile int *addr, int value) {
+    syscall(__NR_futex, addr, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+static void futexWake(volatile int *addr, int count) {
+    syscall(__NR_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+static inline void cpuRelax() {
+#if defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__("pause" ::: "memory");
+#elif defined(__arm__) || defined(__aarch64__)
+    __asm__ __volatile__("yield" ::: "memory");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+static uint64_t spinClock() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_nsec + ((uint64_t)t.tv_sec * 1000 * 1000 * 1000);
+}
+
+// Spins for up to ns while *addr still holds value.  Returns true if it
+// changed.
+static bool spinWait(volatile int *addr, int value, uint64_t ns) {
+    if (*addr != value) {
+        return true;
+    }
+    if (!ns) {
+        return false;
+    }
+    const uint64_t end = spinClock() + ns;
+    for (uint32_t ct = 1; ; ct++) {
+        cpuRelax();
+        if (*addr != value) {
+            return true;
+        }
+        // Reading the clock costs more than a spin, so it is checked
+        // only now and then.
+        if (!(ct & 63) && (spinClock() >= end)) {
+            return false;
+        }
+    }
+}
+
 typedef void (*outer_foreach_t)(
     const android::renderscript::RsForEachStubParamStruct *,
     uint32_t x1, uint32_t x2,
@@ -57,6 +112,13 @@ static pthread_key_t gThreadTLSKey = 0;
 static uint32_t gThreadTLSKeyCount = 0;
 static pthread_mutex_t gInitMutex = PTHREAD_MUTEX_INITIALIZER;
 
+// Script creation only needs to be serialized between scripts sharing a
+// cache entry, so names hash onto a few locks rather than all taking
+// gInitMutex. That lets unrelated scripts compile concurrently.
+#define SCRIPT_CACHE_LOCK_COUNT 16
+static pthread_mutex_t gScriptCacheMutex[SCRIPT_CACHE_LOCK_COUNT];
+static pthread_once_t gScriptCacheOnce = PTHREAD_ONCE_INIT;
+
 bool android::renderscript::gArchUseSIMD = false;
 
 RsdCpuReference::~RsdCpuReference() {
@@ -131,7 +193,6 @@ void * RsdCpuReferenceImpl::helperThreadProc(void *vrsc) {
 
     //ALOGV("RS helperThread starting %p idx=%i", dc, idx);
 
-    dc->mWorkers.mLaunchSignals[idx].init();
     dc->mWorkers.mNativeThreadId[idx] = gettid();
 
     memset(&dc->mTlsStruct, 0, sizeof(dc->mTlsStruct));
@@ -150,14 +211,45 @@ void * RsdCpuReferenceImpl::helperThreadProc(void *vrsc) {
     ALOGE("SETAFFINITY ret = %i %s", ret, EGLUtils::strerror(ret));
 #endif
 
+    // The generation has to be read before reporting in; no launch can
+    // start until every worker has.
+    int generation = dc->mWorkers.mGeneration;
+    __sync_fetch_and_sub(&dc->mWorkers.mRunningCount, 1);
+
+    const Context *rsc = dc->mRSC;
+    uint64_t spinNs = dc->mWorkers.mSpinNs;
+    uint64_t idleStart = spinClock();
     while (!dc->mExit) {
-        dc->mWorkers.mLaunchSignals[idx].wait();
+        if (!spinWait(&dc->mWorkers.mGeneration, generation, spinNs)) {
+            __sync_fetch_and_add(&dc->mWorkers.mSleeping, 1);
+            while (dc->mWorkers.mGeneration == generation) {
+                futexWait(&dc->mWorkers.mGeneration, generation);
+            }
+            __sync_fetch_and_sub(&dc->mWorkers.mSleeping, 1);
+        }
+        generation = dc->mWorkers.mGeneration;
+
+        const uint64_t busyStart = spinClock();
+        rsc->mStats.add(ContextStats::WORKER_IDLE_NS, busyStart - idleStart);
+        // Spin for the whole window while launches come in quick
+        // succession, and less and less while they don't, so that an idle
+        // context stops burning CPU time.
+        if (busyStart - idleStart <= dc->mWorkers.mSpinNs) {
+            spinNs = dc->mWorkers.mSpinNs;
+        } else {
+            spinNs /= 2;
+        }
+
         if (dc->mWorkers.mLaunchCallback) {
            // idx +1 is used because the calling thread is always worker 0.
            dc->mWorkers.mLaunchCallback(dc->mWorkers.mLaunchData, idx+1);
         }
-        __sync_fetch_and_sub(&dc->mWorkers.mRunningCount, 1);
-        dc->mWorkers.mCompleteSignal.set();
+        idleStart = spinClock();
+        rsc->mStats.add(ContextStats::WORKER_BUSY_NS, idleStart - busyStart);
+        if ((__sync_sub_and_fetch(&dc->mWorkers.mRunningCount, 1) == 0) &&
+            dc->mWorkers.mCompleteWaiting) {
+            futexWake(&dc->mWorkers.mRunningCount, 1);
+        }
     }
 
     //ALOGV("RS helperThread exited %p idx=%i", dc, idx);
@@ -165,23 +257,99 @@ void * RsdCpuReferenceImpl::helperThreadProc(void *vrsc) {
 }
 
 void RsdCpuReferenceImpl::launchThreads(WorkerCallback_t cbk, void *data) {
-    mWorkers.mLaunchData = data;
-    mWorkers.mLaunchCallback = cbk;
-
     // fast path for very small launches
     MTLaunchStruct *mtls = (MTLaunchStruct *)data;
     if (mtls && mtls->fep.dimY <= 1 && mtls->xEnd <= mtls->xStart + mtls->mSliceSize) {
-        if (mWorkers.mLaunchCallback) {
-            mWorkers.mLaunchCallback(mWorkers.mLaunchData, 0);
+        if (cbk) {
+            cbk(data, 0);
         }
         return;
     }
 
+    wakeWorkers(cbk, data);
+}
+
+typedef struct {
+    WorkerCallback_t cbk;
+    void *data;
+    ScriptTLSStruct tls;
+} WorkerLaunchStruct;
+
+// Workers normally share one TLS struct that the launching thread fills in.
+// Callbacks started through launchWorkers may each run a different script,
+// so every thread gets a private copy for the duration of the callback.
+static void privateTLSWorker(void *usr, uint32_t idx) {
+    WorkerLaunchStruct *wl = (WorkerLaunchStruct *)usr;
+    ScriptTLSStruct tls = wl->tls;
+    void *old = pthread_getspecific(gThreadTLSKey);
+    pthread_setspecific(gThreadTLSKey, &tls);
+    wl->cbk(wl->data, idx);
+    pthread_setspecific(gThreadTLSKey, old);
+}
+
+void RsdCpuReferenceImpl::launchWorkers(WorkerCallback_t cbk, void *data) {
+    if (!canUseWorkers()) {
+        cbk(data, 0);
+        return;
+    }
+
+    WorkerLaunchStruct wl;
+    wl.cbk = cbk;
+    wl.data = data;
+    ScriptTLSStruct * tls = (ScriptTLSStruct *)pthread_getspecific(gThreadTLSKey);
+    if (tls) {
+        wl.tls = *tls;
+    } else {
+        memset(&wl.tls, 0, sizeof(wl.tls));
+        wl.tls.mContext = mRSC;
+    }
+
+    mInForEach = true;
+    wakeWorkers(privateTLSWorker, &wl);
+    mInForEach = false;
+}
+
+// The pool serves one launch at a time from the main RS thread.  Nested
+// launches and launches from extra command queue threads run inline.
+bool RsdCpuReferenceImpl::canUseWorkers() const {
+    if ((mWorkers.mCount < 1) || mInForEach) {
+        return false;
+    }
+    ScriptTLSStruct * tls = (ScriptTLSStruct *)pthread_getspecific(gThreadTLSKey);
+    return !(tls && tls->mQueueThread);
+}
+
+void RsdCpuReferenceImpl::attachQueueThread() {
+    ScriptTLSStruct *tls = (ScriptTLSStruct *)calloc(1, sizeof(ScriptTLSStruct));
+    tls->mContext = mRSC;
+    tls->mQueueThread = true;
+    int status = pthread_setspecific(gThreadTLSKey, tls);
+    if (status) {
+        ALOGE("pthread_setspecific %i", status);
+        free(tls);
+    }
+}
+
+void RsdCpuReferenceImpl::detachQueueThread() {
+    ScriptTLSStruct *tls = (ScriptTLSStruct *)pthread_getspecific(gThreadTLSKey);
+    if (tls && tls->mQueueThread) {
+        pthread_setspecific(gThreadTLSKey, NULL);
+        free(tls);
+    }
+}
+
+void RsdCpuReferenceImpl::wakeWorkers(WorkerCallback_t cbk, void *data) {
+    mWorkers.mLaunchData = data;
+    mWorkers.mLaunchCallback = cbk;
+
     mWorkers.mRunningCount = mWorkers.mCount;
-    __sync_synchronize();
 
-    for (uint32_t ct = 0; ct < mWorkers.mCount; ct++) {
-        mWorkers.mLaunchSignals[ct].set();
+    // The increment is a full barrier, so the launch is visible to any
+    // worker that sees the new generation.  Workers that are still spinning
+    // need no system call.
+    __sync_fetch_and_add(&mWorkers.mGeneration, 1);
+    if (mWorkers.mSleeping) {
+        futexWake(&mWorkers.mGeneration, INT_MAX);
     }
 
     // We use the calling thread as one of the workers so we can start without
@@ -190,9 +358,24 @@ void RsdCpuReferenceImpl::launchThreads(WorkerCallback_t cbk, void *data) {
         mWorkers.mLaunchCallback(mWorkers.mLaunchData, 0);
     }
 
-    while (__sync_fetch_and_or(&mWorkers.mRunningCount, 0) != 0) {
-        mWorkers.mCompleteSignal.wait();
+    waitForWorkers();
+}
+
+void RsdCpuReferenceImpl::waitForWorkers() {
+    int running;
+    while ((running = mWorkers.mRunningCount) != 0) {
+        if (spinWait(&mWorkers.mRunningCount, running, mWorkers.mSpinNs)) {
+            continue;
+        }
+        // The last worker to finish wakes us if it sees the flag.  If it
+        // finished before the flag was set, the futex value has changed
+        // and the wait returns at once.
+        mWorkers.mCompleteWaiting = 1;
+        __sync_synchronize();
+        futexWait(&mWorkers.mRunningCount, running);
+        mWorkers.mCompleteWaiting = 0;
     }
+    __sync_synchronize();
 }
 
 
@@ -204,6 +387,29 @@ void RsdCpuReferenceImpl::unlockMutex() {
     pthread_mutex_unlock(&gInitMutex);
 }
 
+static void initScriptCacheMutex() {
+    for (uint32_t ct = 0; ct < SCRIPT_CACHE_LOCK_COUNT; ct++) {
+        pthread_mutex_init(&gScriptCacheMutex[ct], NULL);
+    }
+}
+
+static pthread_mutex_t * getScriptCacheMutex(const char *resName) {
+    pthread_once(&gScriptCacheOnce, initScriptCacheMutex);
+    uint32_t hash = 5381;
+    for (const char *c = resName; c && *c; c++) {
+        hash = hash * 33 + (uint8_t)*c;
+    }
+    return &gScriptCacheMutex[hash % SCRIPT_CACHE_LOCK_COUNT];
+}
+
+void RsdCpuReferenceImpl::lockScriptCache(const char *resName) {
+    pthread_mutex_lock(getScriptCacheMutex(resName));
+}
+
+void RsdCpuReferenceImpl::unlockScriptCache(const char *resName) {
+    pthread_mutex_unlock(getScriptCacheMutex(resName));
+}
+
 static int
 read_file(const char*  pathname, char*  buffer, size_t  buffsize)
 {
@@ -282,13 +488,17 @@ bool RsdCpuReferenceImpl::init(uint32_t version_major, uint32_t version_minor,
 
     mWorkers.mThreadId = (pthread_t *) calloc(mWorkers.mCount, sizeof(pthread_t));
     mWorkers.mNativeThreadId = (pid_t *) calloc(mWorkers.mCount, sizeof(pid_t));
-    mWorkers.mLaunchSignals = new Signal[mWorkers.mCount];
     mWorkers.mLaunchCallback = NULL;
-
-    mWorkers.mCompleteSignal.init();
+    mWorkers.mSpinNs = kWorkerSpinNs;
+    if (mRSC->props.mDebugWorkerSpin) {
+        mWorkers.mSpinNs = (uint64_t)mRSC->props.mDebugWorkerSpin * 1000;
+    }
 
     mWorkers.mRunningCount = mWorkers.mCount;
     mWorkers.mLaunchCount = 0;
+    mWorkers.mGeneration = 0;
+    mWorkers.mSleeping = 0;
+    mWorkers.mCompleteWaiting = 0;
     __sync_synchronize();
 
     pthread_attr_t threadAttr;
@@ -326,10 +536,8 @@ RsdCpuReferenceImpl::~RsdCpuReferenceImpl() {
     mWorkers.mLaunchData = NULL;
     mWorkers.mLaunchCallback = NULL;
     mWorkers.mRunningCount = mWorkers.mCount;
-    __sync_synchronize();
-    for (uint32_t ct = 0; ct < mWorkers.mCount; ct++) {
-        mWorkers.mLaunchSignals[ct].set();
-    }
+    __sync_fetch_and_add(&mWorkers.mGeneration, 1);
+    futexWake(&mWorkers.mGeneration, INT_MAX);
     void *res;
     for (uint32_t ct = 0; ct < mWorkers.mCount; ct++) {
         pthread_join(mWorkers.mThreadId[ct], &res);
@@ -337,7 +545,6 @@ RsdCpuReferenceImpl::~RsdCpuReferenceImpl() {
     rsAssert(__sync_fetch_and_or(&mWorkers.mRunningCount, 0) == 0);
     free(mWorkers.mThreadId);
     free(mWorkers.mNativeThreadId);
-    delete[] mWorkers.mLaunchSignals;
 
     // Global structure cleanup.
     lockMutex();
@@ -353,6 +560,9 @@ typedef void (*rs_t)(const void *, void *, const void *, uint32_t, uint32_t, uin
 
 static void wc_xy(void *usr, uint32_t idx) {
     MTLaunchStruct *mtls = (MTLaunchStruct *)usr;
+    if (mtls->mThreadCount && (idx >= mtls->mThreadCount)) {
+        return;
+    }
     RsForEachStubParamStruct p;
     memcpy(&p, &mtls->fep, sizeof(p));
     p.lid = idx;
@@ -371,6 +581,7 @@ static void wc_xy(void *usr, uint32_t idx) {
         //ALOGE("usr idx %i, x %i,%i  y %i,%i", idx, mtls->xStart, mtls->xEnd, yStart, yEnd);
         //ALOGE("usr ptr in %p,  out %p", mtls->fep.ptrIn, mtls->fep.ptrOut);
 
+        TraceScope trace(Tracer::CAT_SLICE, "slice y", yStart, yEnd);
         for (p.y = yStart; p.y < yEnd; p.y++) {
             p.out = mtls->fep.ptrOut + (mtls->fep.yStrideOut * p.y) +
                     (mtls->fep.eStrideOut * mtls->xStart);
@@ -383,6 +594,9 @@ static void wc_xy(void *usr, uint32_t idx) {
 
 static void wc_x(void *usr, uint32_t idx) {
     MTLaunchStruct *mtls = (MTLaunchStruct *)usr;
+    if (mtls->mThreadCount && (idx >= mtls->mThreadCount)) {
+        return;
+    }
     RsForEachStubParamStruct p;
     memcpy(&p, &mtls->fep, sizeof(p));
     p.lid = idx;
@@ -401,58 +615,74 @@ static void wc_x(void *usr, uint32_t idx) {
         //ALOGE("usr slice %i idx %i, x %i,%i", slice, idx, xStart, xEnd);
         //ALOGE("usr ptr in %p,  out %p", mtls->fep.ptrIn, mtls->fep.ptrOut);
 
+        TraceScope trace(Tracer::CAT_SLICE, "slice x", xStart, xEnd);
         p.out = mtls->fep.ptrOut + (mtls->fep.eStrideOut * xStart);
         p.in = mtls->fep.ptrIn + (mtls->fep.eStrideIn * xStart);
         fn(&p, xStart, xEnd, mtls->fep.eStrideIn, mtls->fep.eStrideOut);
     }
 }
 
+// Splits a launch into slices for the worker pool. The slice size and the
+// number of threads come from the context's fixed slice size if one is set,
+// otherwise from the tuner.
+void RsdCpuReferenceImpl::launchSliced(MTLaunchStruct *mtls) {
+    const size_t targetByteChunk = 16 * 1024;
+    const uint32_t maxThreads = mWorkers.mCount + 1;
+    const bool is2D = mtls->fep.dimY > 1;
+    WorkerCallback_t cbk = is2D ? wc_xy : wc_x;
+
+    // The default rate limits atomic ops to one per 16k bytes of
+    // reads/writes, with at least four slices per thread.
+    uint32_t s1 = 0;
+    size_t stride = 0;
+    if (is2D) {
+        s1 = mtls->fep.dimY / (maxThreads * 4);
+        stride = mtls->fep.yStrideOut ? mtls->fep.yStrideOut : mtls->fep.yStrideIn;
+    } else {
+        s1 = mtls->fep.dimX / (maxThreads * 4);
+        stride = mtls->fep.eStrideOut ? mtls->fep.eStrideOut : mtls->fep.eStrideIn;
+    }
+    const uint32_t s2 = stride ? targetByteChunk / stride : s1;
+    const uint32_t defaultSlice = rsMax(rsMin(s1, s2), 1u);
+
+    const uint32_t fixedSlice = mRSC->getSliceSize();
+    if (fixedSlice) {
+        mtls->mSliceSize = fixedSlice;
+        mtls->mThreadCount = maxThreads;
+        launchThreads(cbk, mtls);
+        return;
+    }
+
+    LaunchTuner::Key key;
+    key.kernel = (const void *)mtls->kernel;
+    key.script = mtls->script;
+    key.extentX = mtls->xEnd - mtls->xStart;
+    key.extentY = mtls->yEnd - mtls->yStart;
+    key.stride = stride;
+    const uint32_t extent = is2D ? key.extentY : key.extentX;
+
+    uint32_t id;
+    LaunchTuner::Config config = mTuner.begin(key, defaultSlice, extent, maxThreads, &id);
+    mtls->mSliceSize = config.sliceSize;
+    mtls->mThreadCount = config.threads;
+
+    const uint64_t start = mRSC->getTime();
+    if (config.threads == 1) {
+        cbk(mtls, 0);
+    } else {
+        launchThreads(cbk, mtls);
+    }
+    mTuner.end(id, mRSC->getTime() - start);
+}
+
 void RsdCpuReferenceImpl::launchThreads(const Allocation * ain, Allocation * aout,
                                      const RsScriptCall *sc, MTLaunchStruct *mtls) {
 
     //android::StopWatch kernel_time("kernel time");
 
-    if ((mWorkers.mCount >= 1) && mtls->isThreadable && !mInForEach) {
-        const size_t targetByteChunk = 16 * 1024;
+    if (mtls->isThreadable && canUseWorkers()) {
         mInForEach = true;
-        if (mtls->fep.dimY > 1) {
-            uint32_t s1 = mtls->fep.dimY / ((mWorkers.mCount + 1) * 4);
-            uint32_t s2 = 0;
-
-            // This chooses our slice size to rate limit atomic ops to
-            // one per 16k bytes of reads/writes.
-            if (mtls->fep.yStrideOut) {
-                s2 = targetByteChunk / mtls->fep.yStrideOut;
-            } else {
-                s2 = targetByteChunk / mtls->fep.yStrideIn;
-            }
-            mtls->mSliceSize = rsMin(s1, s2);
-
-            if(mtls->mSliceSize < 1) {
-                mtls->mSliceSize = 1;
-            }
-
-         //   mtls->mSliceSize = 2;
-            launchThreads(wc_xy, mtls);
-        } else {
-            uint32_t s1 = mtls->fep.dimX / ((mWorkers.mCount + 1) * 4);
-            uint32_t s2 = 0;
-
-            // This chooses our slice size to rate limit atomic ops to
-            // one per 16k bytes of reads/writes.
-            if (mtls->fep.eStrideOut) {
-                s2 = targetByteChunk / mtls->fep.eStrideOut;
-            } else {
-                s2 = targetByteChunk / mtls->fep.eStrideIn;
-            }
-            mtls->mSliceSize = rsMin(s1, s2);
-
-            if(mtls->mSliceSize < 1) {
-                mtls->mSliceSize = 1;
-            }
-
-            launchThreads(wc_x, mtls);
-        }
+        launchSliced(mtls);
         mInForEach = false;
 
         //ALOGE("launch 1");
@@ -484,47 +714,9 @@ void RsdCpuReferenceImpl::launchThreads(const Allocation** ains, uint32_t inLen,
 
     //android::StopWatch kernel_time("kernel time");
 
-    if ((mWorkers.mCount >= 1) && mtls->isThreadable && !mInForEach) {
-        const size_t targetByteChunk = 16 * 1024;
+    if (mtls->isThreadable && canUseWorkers()) {
         mInForEach = true;
-        if (mtls->fep.dimY > 1) {
-            uint32_t s1 = mtls->fep.dimY / ((mWorkers.mCount + 1) * 4);
-            uint32_t s2 = 0;
-
-            // This chooses our slice size to rate limit atomic ops to
-            // one per 16k bytes of reads/writes.
-            if (mtls->fep.yStrideOut) {
-                s2 = targetByteChunk / mtls->fep.yStrideOut;
-            } else {
-                s2 = targetByteChunk / mtls->fep.yStrideIn;
-            }
-            mtls->mSliceSize = rsMin(s1, s2);
-
-            if(mtls->mSliceSize < 1) {
-                mtls->mSliceSize = 1;
-            }
-
-         //   mtls->mSliceSize = 2;
-            launchThreads(wc_xy, mtls);
-        } else {
-            uint32_t s1 = mtls->fep.dimX / ((mWorkers.mCount + 1) * 4);
-            uint32_t s2 = 0;
-
-            // This chooses our slice size to rate limit atomic ops to
-            // one per 16k bytes of reads/writes.
-            if (mtls->fep.eStrideOut) {
-                s2 = targetByteChunk / mtls->fep.eStrideOut;
-            } else {
-                s2 = targetByteChunk / mtls->fep.eStrideIn;
-            }
-            mtls->mSliceSize = rsMin(s1, s2);
-
-            if (mtls->mSliceSize < 1) {
-                mtls->mSliceSize = 1;
-            }
-
-            launchThreads(wc_x, mtls);
-        }
+        launchSliced(mtls);
         mInForEach = false;
 
         //ALOGE("launch 1");
@@ -619,6 +811,16 @@ RsdCpuReference::CpuScript * RsdCpuReferenceImpl::createScript(const ScriptC *s,
     return i;
 }
 
+RsdCpuReference::CpuScript * RsdCpuReferenceImpl::cloneScript(const ScriptC *s,
+                                                               const CpuScript *src) {
+    RsdCpuScriptImpl *i = new RsdCpuScriptImpl(this, s);
+    if (!i->initClone(static_cast<const RsdCpuScriptImpl *>(src))) {
+        delete i;
+        return NULL;
+    }
+    return i;
+}
+
 extern RsdCpuScriptImpl * rsdIntrinsic_3DLUT(RsdCpuReferenceImpl *ctx,
                                              const Script *s, const Element *e);
 extern RsdCpuScriptImpl * rsdIntrinsic_Convolve3x3(RsdCpuReferenceImpl *ctx,
@@ -639,6 +841,12 @@ extern RsdCpuScriptImpl * rsdIntrinsic_Histogram(RsdCpuReferenceImpl *ctx,
                                                  const Script *s, const Element *e);
 extern RsdCpuScriptImpl * rsdIntrinsic_Resize(RsdCpuReferenceImpl *ctx,
                                               const Script *s, const Element *e);
+extern RsdCpuScriptImpl * rsdIntrinsic_RGBToYuv(RsdCpuReferenceImpl *ctx,
+                                                const Script *s, const Element *e);
+extern RsdCpuScriptImpl * rsdIntrinsic_Morphology(RsdCpuReferenceImpl *ctx,
+                                                  const Script *s, const Element *e);
+extern RsdCpuScriptImpl * rsdIntrinsic_Median(RsdCpuReferenceImpl *ctx,
+                                              const Script *s, const Element *e);
 
 RsdCpuReference::CpuScript * RsdCpuReferenceImpl::createIntrinsic(const Script *s,
                                     RsScriptIntrinsicID iid, Element *e) {
@@ -675,6 +883,15 @@ RsdCpuReference::CpuScript * RsdCpuReferenceImpl::createIntrinsic(const Script *
     case RS_SCRIPT_INTRINSIC_ID_RESIZE:
         i = rsdIntrinsic_Resize(this, s, e);
         break;
+    case RS_SCRIPT_INTRINSIC_ID_RGB_TO_YUV:
+        i = rsdIntrinsic_RGBToYuv(this, s, e);
+        break;
+    case RS_SCRIPT_INTRINSIC_ID_MORPHOLOGY:
+        i = rsdIntrinsic_Morphology(this, s, e);
+        break;
+    case RS_SCRIPT_INTRINSIC_ID_MEDIAN:
+        i = rsdIntrinsic_Median(this, s, e);
+        break;
 
     default:
         rsAssert(0);
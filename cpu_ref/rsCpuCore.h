@@ -18,7 +18,7 @@
 #define RSD_CPU_CORE_H
 
 #include "rsd_cpu.h"
-#include "rsSignal.h"
+#include "rsCpuLaunchTuner.h"
 #include "rsContext.h"
 #include "rsElement.h"
 #include "rsScriptC.h"
@@ -86,6 +86,8 @@ typedef struct ScriptTLSStructRec {
     android::renderscript::Context * mContext;
     const android::renderscript::Script * mScript;
     RsdCpuScriptImpl *mImpl;
+    // Set on extra command queue threads, which never use the worker pool.
+    bool mQueueThread;
 } ScriptTLSStruct;
 
 typedef struct {
@@ -101,6 +103,8 @@ typedef struct {
 
     uint32_t mSliceSize;
     volatile int mSliceNum;
+    // Threads taking slices, the launching thread included. 0 means all.
+    uint32_t mThreadCount;
     bool isThreadable;
 
     uint32_t xStart;
@@ -127,14 +131,22 @@ public:
     void lockMutex();
     void unlockMutex();
 
+    // Held while a script named resName is compiled or loaded. Scripts with
+    // different names can usually be created concurrently.
+    void lockScriptCache(const char *resName);
+    void unlockScriptCache(const char *resName);
+
     bool init(uint32_t version_major, uint32_t version_minor, sym_lookup_t, script_lookup_t);
     virtual void setPriority(int32_t priority);
     virtual void launchThreads(WorkerCallback_t cbk, void *data);
+    virtual void launchWorkers(WorkerCallback_t cbk, void *data);
     static void * helperThreadProc(void *vrsc);
     RsdCpuScriptImpl * setTLS(RsdCpuScriptImpl *sc);
+    virtual void attachQueueThread();
+    virtual void detachQueueThread();
 
     Context * getContext() {return mRSC;}
-    uint32_t getThreadCount() const {
+    virtual uint32_t getThreadCount() const {
         return mWorkers.mCount + 1;
     }
 
@@ -150,6 +162,7 @@ public:
                                      uint32_t flags);
     virtual CpuScript * createIntrinsic(const Script *s,
                                         RsScriptIntrinsicID iid, Element *e);
+    virtual CpuScript * cloneScript(const ScriptC *s, const CpuScript *src);
     virtual CpuScriptGroup * createScriptGroup(const ScriptGroup *sg);
 
     const RsdCpuReference::CpuSymbol *symLookup(const char *);
@@ -192,6 +205,11 @@ public:
     virtual bool getInForEach() { return mInForEach; }
 
 protected:
+    void wakeWorkers(WorkerCallback_t cbk, void *data);
+    void waitForWorkers();
+    bool canUseWorkers() const;
+    void launchSliced(MTLaunchStruct *mtls);
+
     Context *mRSC;
     uint32_t version_major;
     uint32_t version_minor;
@@ -201,11 +219,17 @@ protected:
     struct Workers {
         volatile int mRunningCount;
         volatile int mLaunchCount;
+        // Incremented for every launch.  Idle workers spin on it for up to
+        // mSpinNs and then sleep on it as a futex.
+        volatile int mGeneration;
+        // Number of workers sleeping on mGeneration.
+        volatile int mSleeping;
+        // Set while the launching thread sleeps on mRunningCount.
+        volatile int mCompleteWaiting;
+        uint64_t mSpinNs;
         uint32_t mCount;
         pthread_t *mThreadId;
         pid_t *mNativeThreadId;
-        Signal mCompleteSignal;
-        Signal *mLaunchSignals;
         WorkerCallback_t mLaunchCallback;
         void *mLaunchData;
     };
@@ -215,6 +239,7 @@ protected:
     script_lookup_t mScriptLookupFn;
 
     ScriptTLSStruct mTlsStruct;
+    LaunchTuner mTuner;
 
 #ifndef RS_COMPATIBILITY_LIB
     bcc::RSLinkRuntimeCallback mLinkRuntimeCallback;
@@ -136,6 +136,34 @@ void RsdCpuScriptIntrinsic::invokeForEachMulti(uint32_t slot,
     postLaunch(slot, ains[0], aout, usr, usrLen, sc);
 }
 
+void RsdCpuScriptIntrinsic::launchRows(outer_foreach_t fn, uint32_t count) {
+    MTLaunchStruct mtls;
+    memset(&mtls, 0, sizeof(mtls));
+
+    mtls.rsc = mCtx;
+    mtls.script = this;
+    mtls.kernel = (void (*)())fn;
+    mtls.isThreadable = true;
+    mtls.fep.usr = this;
+    mtls.fep.dimX = 1;
+    mtls.fep.dimY = count;
+
+    // Rows carry no Allocation data; unit strides keep the slice size
+    // driven purely by the row count.
+    mtls.fep.eStrideOut = 1;
+    mtls.fep.yStrideOut = 1;
+
+    mtls.xEnd = 1;
+    mtls.yEnd = count;
+    mtls.zEnd = 1;
+    mtls.arrayEnd = 1;
+    mtls.mSliceSize = 1;
+
+    RsdCpuScriptImpl * oldTLS = mCtx->setTLS(this);
+    mCtx->launchThreads((const Allocation *)NULL, NULL, NULL, &mtls);
+    mCtx->setTLS(oldTLS);
+}
+
 void RsdCpuScriptIntrinsic::forEachKernelSetup(uint32_t slot, MTLaunchStruct *mtls) {
 
     mtls->script = this;
@@ -62,6 +62,11 @@ public:
     virtual void setGlobalBind(uint32_t slot, Allocation *data);
     virtual void setGlobalObj(uint32_t slot, ObjectBase *data);
 
+    // Runs fn on the worker pool for rows [0, count) of intrinsic specific
+    // work that is not tied to an Allocation, e.g. a filter pre-pass.
+    // fn receives the row in p->y and the worker index in p->lid.
+    void launchRows(outer_foreach_t fn, uint32_t count);
+
     virtual ~RsdCpuScriptIntrinsic();
     RsdCpuScriptIntrinsic(RsdCpuReferenceImpl *ctx, const Script *s, const Element *,
                           RsScriptIntrinsicID iid);
@@ -0,0 +1,371 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "rsCpuIntrinsic.h"
+#include "rsCpuIntrinsicInlines.h"
+
+using namespace android;
+using namespace android::renderscript;
+
+namespace android {
+namespace renderscript {
+
+
+/*
+ * Square window median filter using the constant time histogram method
+ * (Perreault and Hebert).  Every column keeps a histogram of the 2r + 1
+ * samples above and below the current row, updated with one add and one
+ * remove per row.  The window histogram is the sum of 2r + 1 column
+ * histograms and slides along the row with one add and one remove per
+ * pixel.  Histograms are split into 16 coarse and 256 fine bins; only the
+ * coarse level is kept up to date, a fine segment is brought up to the
+ * current column when the median search lands in it.
+ *
+ * The image is processed in horizontal bands, one band per launch row, so
+ * column histograms are built once per band rather than once per row.
+ * Only the columns within r of the launch's x range are tracked.  Edges are
+ * replicated.
+ */
+class RsdCpuScriptIntrinsicMedian : public RsdCpuScriptIntrinsic {
+public:
+    virtual void populateScript(Script *);
+    virtual void invokeFreeChildren();
+
+    virtual void setGlobalVar(uint32_t slot, const void *data, size_t dataLength);
+    virtual void setGlobalObj(uint32_t slot, ObjectBase *data);
+
+    virtual void invokeForEach(uint32_t slot,
+                       const Allocation * ain,
+                       Allocation * aout,
+                       const void * usr,
+                       uint32_t usrLen,
+                       const RsScriptCall *sc);
+
+    virtual ~RsdCpuScriptIntrinsicMedian();
+    RsdCpuScriptIntrinsicMedian(RsdCpuReferenceImpl *ctx, const Script *s, const Element *e);
+
+    virtual void preLaunch(uint32_t slot, const Allocation * ain,
+                           Allocation * aout, const void * usr,
+                           uint32_t usrLen, const RsScriptCall *sc);
+
+protected:
+    struct ColumnHist {
+        uint16_t coarse[16];
+        uint16_t fine[256];
+    };
+
+    ObjectBaseRef<Allocation> mAlloc;
+    int32_t mRadius;
+
+    uint32_t mWidth;
+    uint32_t mHeight;
+    uint32_t mChannels;
+    uint32_t mBandHeight;
+
+    // Launch range from the LaunchOptions, end exclusive.
+    uint32_t mXStart;
+    uint32_t mXEnd;
+    uint32_t mYStart;
+    uint32_t mYEnd;
+
+    uchar *mOutPtr;
+    size_t mOutStride;
+
+    ColumnHist **mScratch;
+    size_t *mScratchSize;
+
+    void processBand(uint32_t lid, uint32_t x0, uint32_t x1, uint32_t y0, uint32_t y1);
+
+    static void kernelBand(const RsForEachStubParamStruct *p,
+                           uint32_t xstart, uint32_t xend,
+                           uint32_t instep, uint32_t outstep);
+    static void kernel(const RsForEachStubParamStruct *p,
+                       uint32_t xstart, uint32_t xend,
+                       uint32_t instep, uint32_t outstep);
+};
+
+}
+}
+
+
+static inline void HistAdd(uint16_t *dst, const uint16_t *src, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        dst[i] += src[i];
+    }
+}
+
+static inline void HistSub(uint16_t *dst, const uint16_t *src, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        dst[i] -= src[i];
+    }
+}
+
+void RsdCpuScriptIntrinsicMedian::processBand(uint32_t lid, uint32_t x0, uint32_t x1,
+                                              uint32_t y0, uint32_t y1) {
+    const uchar *pin = (const uchar *)mAlloc->mHal.drvState.lod[0].mallocPtr;
+    const size_t stride = mAlloc->mHal.drvState.lod[0].stride;
+    const int32_t r = mRadius;
+    const int32_t w = mWidth;
+    const int32_t maxY = mHeight - 1;
+    const uint32_t cs = mChannels;
+    const uint32_t rank = ((2 * r + 1) * (2 * r + 1)) / 2;
+
+    // Columns the windows of x0 .. x1 - 1 read.
+    const int32_t cx0 = rsMax((int32_t)x0 - r, 0);
+    const int32_t cx1 = rsMin((int32_t)x1 - 1 + r, w - 1);
+
+    ColumnHist *cols = mScratch[lid];
+
+    for (uint32_t c = 0; c < cs; c++) {
+        // Column histograms for the window centred on y0.
+        memset(cols + cx0, 0, sizeof(ColumnHist) * (cx1 - cx0 + 1));
+        for (int32_t j = (int32_t)y0 - r; j <= (int32_t)y0 + r; j++) {
+            const uchar *in = pin + stride * rsMin(rsMax(j, 0), maxY) + c;
+            for (int32_t x = cx0; x <= cx1; x++) {
+                const uchar v = in[x * cs];
+                cols[x].coarse[v >> 4]++;
+                cols[x].fine[v]++;
+            }
+        }
+
+        for (uint32_t y = y0; y < y1; y++) {
+            if (y > y0) {
+                const uchar *rem = pin + stride * rsMax((int32_t)y - r - 1, 0) + c;
+                const uchar *add = pin + stride * rsMin((int32_t)y + r, maxY) + c;
+                for (int32_t x = cx0; x <= cx1; x++) {
+                    const uchar vr = rem[x * cs];
+                    const uchar va = add[x * cs];
+                    cols[x].coarse[vr >> 4]--;
+                    cols[x].fine[vr]--;
+                    cols[x].coarse[va >> 4]++;
+                    cols[x].fine[va]++;
+                }
+            }
+
+            uint16_t coarse[16];
+            uint16_t fine[16][16];
+            int32_t fineX[16];
+            memset(coarse, 0, sizeof(coarse));
+            for (int32_t i = 0; i < 16; i++) {
+                // Forces a rebuild of the segment on first use.
+                fineX[i] = (int32_t)x0 - 2 * r - 2;
+            }
+            for (int32_t j = (int32_t)x0 - r; j <= (int32_t)x0 + r; j++) {
+                HistAdd(coarse, cols[rsMin(rsMax(j, 0), w - 1)].coarse, 16);
+            }
+
+            uchar *out = mOutPtr + mOutStride * y + c;
+            for (int32_t x = x0; x < (int32_t)x1; x++) {
+                if (x > (int32_t)x0) {
+                    HistSub(coarse, cols[rsMax(x - r - 1, 0)].coarse, 16);
+                    HistAdd(coarse, cols[rsMin(x + r, w - 1)].coarse, 16);
+                }
+
+                uint32_t sum = 0;
+                uint32_t seg = 0;
+                while ((seg < 15) && ((sum + coarse[seg]) <= rank)) {
+                    sum += coarse[seg];
+                    seg++;
+                }
+
+                // Bring the fine segment up to column x, either by sliding
+                // or by rebuilding it when that is cheaper.
+                uint16_t *f = fine[seg];
+                const int32_t last = fineX[seg];
+                if ((x - last) > r) {
+                    memset(f, 0, sizeof(fine[0]));
+                    for (int32_t j = x - r; j <= x + r; j++) {
+                        HistAdd(f, cols[rsMin(rsMax(j, 0), w - 1)].fine + seg * 16, 16);
+                    }
+                } else {
+                    for (int32_t xx = last + 1; xx <= x; xx++) {
+                        HistSub(f, cols[rsMax(xx - r - 1, 0)].fine + seg * 16, 16);
+                        HistAdd(f, cols[rsMin(xx + r, w - 1)].fine + seg * 16, 16);
+                    }
+                }
+                fineX[seg] = x;
+
+                uint32_t bin = 0;
+                while ((bin < 15) && ((sum + f[bin]) <= rank)) {
+                    sum += f[bin];
+                    bin++;
+                }
+                out[x * cs] = (uchar)((seg << 4) | bin);
+            }
+        }
+    }
+}
+
+void RsdCpuScriptIntrinsicMedian::kernelBand(const RsForEachStubParamStruct *p,
+                                             uint32_t xstart, uint32_t xend,
+                                             uint32_t instep, uint32_t outstep) {
+    RsdCpuScriptIntrinsicMedian *cp = (RsdCpuScriptIntrinsicMedian *)p->usr;
+    const uint32_t y0 = cp->mYStart + p->y * cp->mBandHeight;
+    const uint32_t y1 = rsMin(y0 + cp->mBandHeight, cp->mYEnd);
+    cp->processBand(p->lid, cp->mXStart, cp->mXEnd, y0, y1);
+}
+
+// Row at a time entry point, used when the intrinsic is launched through a
+// ScriptGroup or a multi-input forEach.  Rows may arrive in any order, so
+// each one builds its column histograms from scratch: 2r + 1 input rows
+// are read per output row instead of 2.  Direct launches use the bands.
+void RsdCpuScriptIntrinsicMedian::kernel(const RsForEachStubParamStruct *p,
+                                         uint32_t xstart, uint32_t xend,
+                                         uint32_t instep, uint32_t outstep) {
+    RsdCpuScriptIntrinsicMedian *cp = (RsdCpuScriptIntrinsicMedian *)p->usr;
+    if (!cp->mAlloc.get() || !cp->mOutPtr || (p->y >= cp->mHeight)) {
+        ALOGE("Median executed without input, skipping");
+        return;
+    }
+    if (xstart >= xend) {
+        return;
+    }
+    cp->processBand(p->lid, xstart, xend, p->y, p->y + 1);
+}
+
+void RsdCpuScriptIntrinsicMedian::invokeForEach(uint32_t slot,
+                                                const Allocation * ain,
+                                                Allocation * aout,
+                                                const void * usr,
+                                                uint32_t usrLen,
+                                                const RsScriptCall *sc) {
+    preLaunch(slot, ain, aout, usr, usrLen, sc);
+    if (!mOutPtr) {
+        return;
+    }
+    launchRows(&kernelBand, (mYEnd - mYStart + mBandHeight - 1) / mBandHeight);
+    postLaunch(slot, ain, aout, usr, usrLen, sc);
+}
+
+void RsdCpuScriptIntrinsicMedian::setGlobalObj(uint32_t slot, ObjectBase *data) {
+    rsAssert(slot == 1);
+    mAlloc.set(static_cast<Allocation *>(data));
+}
+
+void RsdCpuScriptIntrinsicMedian::setGlobalVar(uint32_t slot, const void *data,
+                                               size_t dataLength) {
+    rsAssert(slot == 0);
+    int32_t r = ((const int32_t *)data)[0];
+    // Window counts must fit the 16 bit histogram bins.
+    if ((r < 0) || (r > 100)) {
+        mCtx->getContext()->setError(RS_ERROR_BAD_VALUE, "Invalid median radius");
+        return;
+    }
+    mRadius = r;
+}
+
+RsdCpuScriptIntrinsicMedian::RsdCpuScriptIntrinsicMedian(
+            RsdCpuReferenceImpl *ctx, const Script *s, const Element *e)
+            : RsdCpuScriptIntrinsic(ctx, s, e, RS_SCRIPT_INTRINSIC_ID_MEDIAN) {
+
+    mRootPtr = &kernel;
+    mRadius = 1;
+    mWidth = 0;
+    mHeight = 0;
+    mChannels = 0;
+    mBandHeight = 1;
+    mXStart = 0;
+    mXEnd = 0;
+    mYStart = 0;
+    mYEnd = 0;
+    mOutPtr = NULL;
+    mOutStride = 0;
+
+    mScratch = new ColumnHist *[mCtx->getThreadCount()];
+    mScratchSize = new size_t[mCtx->getThreadCount()];
+    memset(mScratch, 0, sizeof(ColumnHist *) * mCtx->getThreadCount());
+    memset(mScratchSize, 0, sizeof(size_t) * mCtx->getThreadCount());
+}
+
+RsdCpuScriptIntrinsicMedian::~RsdCpuScriptIntrinsicMedian() {
+    uint32_t threads = mCtx->getThreadCount();
+    for (size_t i = 0; i < threads; i++) {
+        free(mScratch[i]);
+    }
+    delete []mScratch;
+    delete []mScratchSize;
+}
+
+void RsdCpuScriptIntrinsicMedian::preLaunch(uint32_t slot, const Allocation * ain,
+                                            Allocation * aout, const void * usr,
+                                            uint32_t usrLen, const RsScriptCall *sc) {
+    mOutPtr = NULL;
+    if (!mAlloc.get()) {
+        ALOGE("Median executed without input, skipping");
+        return;
+    }
+    if (!aout || !mAlloc->hasSameDims(aout)) {
+        mCtx->getContext()->setError(RS_ERROR_BAD_VALUE,
+                                     "Median input and output dimensions do not match");
+        return;
+    }
+
+    mWidth = mAlloc->mHal.drvState.lod[0].dimX;
+    mHeight = rsMax(mAlloc->mHal.drvState.lod[0].dimY, 1u);
+    mChannels = mAlloc->getType()->getElementSizeBytes();
+
+    // Same rules as forEachMtlsSetup: an end of 0 selects the whole
+    // dimension.
+    mXStart = 0;
+    mXEnd = mWidth;
+    mYStart = 0;
+    mYEnd = mHeight;
+    if (sc && sc->xEnd) {
+        mXStart = rsMin(mWidth, sc->xStart);
+        mXEnd = rsMin(mWidth, sc->xEnd);
+    }
+    if (sc && sc->yEnd) {
+        mYStart = rsMin(mHeight, sc->yStart);
+        mYEnd = rsMin(mHeight, sc->yEnd);
+    }
+    if ((mXStart >= mXEnd) || (mYStart >= mYEnd)) {
+        mCtx->getContext()->setError(RS_ERROR_BAD_VALUE,
+                                     "Median launch range is empty");
+        return;
+    }
+
+    mOutPtr = (uchar *)aout->mHal.drvState.lod[0].mallocPtr;
+    mOutStride = aout->mHal.drvState.lod[0].stride;
+
+    // Aim for a few bands per thread, but no shorter than the window so the
+    // per-band histogram setup stays a fraction of the work.
+    const uint32_t rows = mYEnd - mYStart;
+    const uint32_t bands = mCtx->getThreadCount() * 4;
+    mBandHeight = rsMax((rows + bands - 1) / bands, (uint32_t)(2 * mRadius + 1));
+
+    const size_t need = sizeof(ColumnHist) * mWidth;
+    for (uint32_t i = 0; i < mCtx->getThreadCount(); i++) {
+        if (mScratchSize[i] < need) {
+            mScratch[i] = (ColumnHist *)realloc(mScratch[i], need);
+            mScratchSize[i] = need;
+        }
+    }
+}
+
+void RsdCpuScriptIntrinsicMedian::populateScript(Script *s) {
+    s->mHal.info.exportedVariableCount = 2;
+}
+
+void RsdCpuScriptIntrinsicMedian::invokeFreeChildren() {
+    mAlloc.clear();
+}
+
+
+RsdCpuScriptImpl * rsdIntrinsic_Median(RsdCpuReferenceImpl *ctx,
+                                       const Script *s, const Element *e) {
+    return new RsdCpuScriptIntrinsicMedian(ctx, s, e);
+}
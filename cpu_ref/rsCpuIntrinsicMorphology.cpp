@@ -0,0 +1,381 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "rsCpuIntrinsic.h"
+#include "rsCpuIntrinsicInlines.h"
+
+using namespace android;
+using namespace android::renderscript;
+
+namespace android {
+namespace renderscript {
+
+
+/*
+ * Erode (slot 0) and dilate (slot 1) over a rectangular window using the
+ * van Herk / Gil-Werman algorithm, which costs three min/max operations per
+ * sample per axis regardless of the radius.
+ *
+ * The domain is split into blocks of k = 2r + 1 samples.  Within each block
+ * a forward running extremum g and a backward running extremum h are kept;
+ * any window of k samples spans at most two blocks, so its extremum is
+ * op(h[start], g[end]).  Windows are clipped to the image, which is the
+ * same as padding with the identity of op.
+ *
+ * The horizontal pass and the per-block vertical scans run as row launches
+ * from preLaunch; the final vertical combine is the regular forEach kernel.
+ */
+class RsdCpuScriptIntrinsicMorphology : public RsdCpuScriptIntrinsic {
+public:
+    virtual void populateScript(Script *);
+    virtual void invokeFreeChildren();
+
+    virtual void setGlobalVar(uint32_t slot, const void *data, size_t dataLength);
+    virtual void setGlobalObj(uint32_t slot, ObjectBase *data);
+
+    virtual ~RsdCpuScriptIntrinsicMorphology();
+    RsdCpuScriptIntrinsicMorphology(RsdCpuReferenceImpl *ctx, const Script *s, const Element *e);
+
+    virtual void preLaunch(uint32_t slot, const Allocation * ain,
+                           Allocation * aout, const void * usr,
+                           uint32_t usrLen, const RsScriptCall *sc);
+
+protected:
+    ObjectBaseRef<Allocation> mAlloc;
+    int32_t mRadiusX;
+    int32_t mRadiusY;
+    // The radii of the current launch, clamped to the image.
+    int32_t mLaunchRadiusX;
+    int32_t mLaunchRadiusY;
+    bool mDilate;
+
+    uint32_t mWidth;
+    uint32_t mHeight;
+    uint32_t mChannels;
+    size_t mRowBytes;
+
+    // Horizontally filtered image, then the per-block forward (G) and
+    // backward (S) vertical scans of it.  Rows are mRowBytes apart.
+    uchar *mTmp;
+    uchar *mTmpG;
+    uchar *mTmpS;
+    size_t mTmpSize;
+
+    uchar **mScratch;
+    size_t *mScratchSize;
+
+    static void rowsH(const RsForEachStubParamStruct *p,
+                      uint32_t xstart, uint32_t xend,
+                      uint32_t instep, uint32_t outstep);
+    static void blocksV(const RsForEachStubParamStruct *p,
+                        uint32_t xstart, uint32_t xend,
+                        uint32_t instep, uint32_t outstep);
+    static void kernel(const RsForEachStubParamStruct *p,
+                       uint32_t xstart, uint32_t xend,
+                       uint32_t instep, uint32_t outstep);
+};
+
+}
+}
+
+
+template <bool Dilate>
+static inline uchar MorphOp(uchar a, uchar b) {
+    return Dilate ? rsMax(a, b) : rsMin(a, b);
+}
+
+// dst[i] = op(a[i], b[i]); written as a flat loop so it vectorizes to
+// packed byte min/max.
+template <bool Dilate>
+static void MorphRows(uchar *dst, const uchar *a, const uchar *b, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = MorphOp<Dilate>(a[i], b[i]);
+    }
+}
+
+// Combines the window [a, b] of a k-blocked axis from the running extrema.
+static inline int WindowCase(int32_t a, int32_t b, int32_t k) {
+    if ((a % k) == 0) {
+        return 0;   // g[b] alone
+    }
+    if ((a / k) == (b / k)) {
+        return 1;   // h[a] alone, b is clipped to the end of the axis
+    }
+    return 2;       // op(h[a], g[b])
+}
+
+template <bool Dilate>
+static void OneRowH(uchar *out, const uchar *in, uchar *g, uchar *h,
+                    uint32_t width, uint32_t cs, int32_t r) {
+    const int32_t k = 2 * r + 1;
+    const int32_t n = width;
+
+    for (int32_t x = 0; x < n; x++) {
+        const uchar *pi = in + x * cs;
+        uchar *pg = g + x * cs;
+        if ((x % k) == 0) {
+            memcpy(pg, pi, cs);
+        } else {
+            MorphRows<Dilate>(pg, pg - cs, pi, cs);
+        }
+    }
+    for (int32_t x = n - 1; x >= 0; x--) {
+        const uchar *pi = in + x * cs;
+        uchar *ph = h + x * cs;
+        if ((x == n - 1) || (((x + 1) % k) == 0)) {
+            memcpy(ph, pi, cs);
+        } else {
+            MorphRows<Dilate>(ph, ph + cs, pi, cs);
+        }
+    }
+    for (int32_t x = 0; x < n; x++) {
+        const int32_t a = rsMax(x - r, 0);
+        const int32_t b = rsMin(x + r, n - 1);
+        uchar *po = out + x * cs;
+        switch (WindowCase(a, b, k)) {
+        case 0:
+            memcpy(po, g + b * cs, cs);
+            break;
+        case 1:
+            memcpy(po, h + a * cs, cs);
+            break;
+        default:
+            MorphRows<Dilate>(po, h + a * cs, g + b * cs, cs);
+            break;
+        }
+    }
+}
+
+void RsdCpuScriptIntrinsicMorphology::rowsH(const RsForEachStubParamStruct *p,
+                                            uint32_t xstart, uint32_t xend,
+                                            uint32_t instep, uint32_t outstep) {
+    RsdCpuScriptIntrinsicMorphology *cp = (RsdCpuScriptIntrinsicMorphology *)p->usr;
+    const uchar *pin = (const uchar *)cp->mAlloc->mHal.drvState.lod[0].mallocPtr;
+    const size_t stride = cp->mAlloc->mHal.drvState.lod[0].stride;
+
+    const uchar *in = pin + stride * p->y;
+    uchar *out = cp->mTmp + cp->mRowBytes * p->y;
+
+    if (cp->mLaunchRadiusX == 0) {
+        memcpy(out, in, cp->mRowBytes);
+        return;
+    }
+
+    uchar *g = cp->mScratch[p->lid];
+    uchar *h = g + cp->mRowBytes;
+    if (cp->mDilate) {
+        OneRowH<true>(out, in, g, h, cp->mWidth, cp->mChannels, cp->mLaunchRadiusX);
+    } else {
+        OneRowH<false>(out, in, g, h, cp->mWidth, cp->mChannels, cp->mLaunchRadiusX);
+    }
+}
+
+template <bool Dilate>
+static void OneBlockV(uchar *G, uchar *S, const uchar *T, size_t rowBytes,
+                      uint32_t y0, uint32_t y1) {
+    memcpy(G + y0 * rowBytes, T + y0 * rowBytes, rowBytes);
+    for (uint32_t y = y0 + 1; y < y1; y++) {
+        MorphRows<Dilate>(G + y * rowBytes, G + (y - 1) * rowBytes, T + y * rowBytes, rowBytes);
+    }
+    memcpy(S + (y1 - 1) * rowBytes, T + (y1 - 1) * rowBytes, rowBytes);
+    for (uint32_t y = y1 - 1; y > y0; y--) {
+        MorphRows<Dilate>(S + (y - 1) * rowBytes, S + y * rowBytes, T + (y - 1) * rowBytes,
+                          rowBytes);
+    }
+}
+
+void RsdCpuScriptIntrinsicMorphology::blocksV(const RsForEachStubParamStruct *p,
+                                              uint32_t xstart, uint32_t xend,
+                                              uint32_t instep, uint32_t outstep) {
+    RsdCpuScriptIntrinsicMorphology *cp = (RsdCpuScriptIntrinsicMorphology *)p->usr;
+    const uint32_t k = 2 * cp->mLaunchRadiusY + 1;
+    const uint32_t y0 = p->y * k;
+    const uint32_t y1 = rsMin(y0 + k, cp->mHeight);
+
+    if (cp->mDilate) {
+        OneBlockV<true>(cp->mTmpG, cp->mTmpS, cp->mTmp, cp->mRowBytes, y0, y1);
+    } else {
+        OneBlockV<false>(cp->mTmpG, cp->mTmpS, cp->mTmp, cp->mRowBytes, y0, y1);
+    }
+}
+
+void RsdCpuScriptIntrinsicMorphology::kernel(const RsForEachStubParamStruct *p,
+                                             uint32_t xstart, uint32_t xend,
+                                             uint32_t instep, uint32_t outstep) {
+    RsdCpuScriptIntrinsicMorphology *cp = (RsdCpuScriptIntrinsicMorphology *)p->usr;
+    if (!cp->mAlloc.get() || !cp->mTmp) {
+        ALOGE("Morphology executed without input, skipping");
+        return;
+    }
+    if ((xend > cp->mWidth) || (p->y >= cp->mHeight)) {
+        return;
+    }
+
+    const uint32_t cs = cp->mChannels;
+    const size_t rowBytes = cp->mRowBytes;
+    const size_t offset = xstart * cs;
+    const size_t len = (xend - xstart) * cs;
+    uchar *out = (uchar *)p->out;
+
+    if (cp->mLaunchRadiusY == 0) {
+        memcpy(out, cp->mTmp + p->y * rowBytes + offset, len);
+        return;
+    }
+
+    const int32_t r = cp->mLaunchRadiusY;
+    const int32_t a = rsMax((int32_t)p->y - r, 0);
+    const int32_t b = rsMin((int32_t)p->y + r, (int32_t)cp->mHeight - 1);
+    const uchar *g = cp->mTmpG + b * rowBytes + offset;
+    const uchar *h = cp->mTmpS + a * rowBytes + offset;
+
+    switch (WindowCase(a, b, 2 * r + 1)) {
+    case 0:
+        memcpy(out, g, len);
+        break;
+    case 1:
+        memcpy(out, h, len);
+        break;
+    default:
+        if (cp->mDilate) {
+            MorphRows<true>(out, h, g, len);
+        } else {
+            MorphRows<false>(out, h, g, len);
+        }
+        break;
+    }
+}
+
+void RsdCpuScriptIntrinsicMorphology::setGlobalObj(uint32_t slot, ObjectBase *data) {
+    rsAssert(slot == 1);
+    mAlloc.set(static_cast<Allocation *>(data));
+}
+
+void RsdCpuScriptIntrinsicMorphology::setGlobalVar(uint32_t slot, const void *data,
+                                                   size_t dataLength) {
+    rsAssert(slot == 0);
+    const int32_t *r = (const int32_t *)data;
+    if ((dataLength < sizeof(int32_t)) || (r[0] < 0) ||
+        ((dataLength >= 2 * sizeof(int32_t)) && (r[1] < 0))) {
+        mCtx->getContext()->setError(RS_ERROR_BAD_VALUE, "Invalid morphology radius");
+        return;
+    }
+    mRadiusX = r[0];
+    mRadiusY = (dataLength >= 2 * sizeof(int32_t)) ? r[1] : r[0];
+}
+
+RsdCpuScriptIntrinsicMorphology::RsdCpuScriptIntrinsicMorphology(
+            RsdCpuReferenceImpl *ctx, const Script *s, const Element *e)
+            : RsdCpuScriptIntrinsic(ctx, s, e, RS_SCRIPT_INTRINSIC_ID_MORPHOLOGY) {
+
+    mRootPtr = &kernel;
+    mRadiusX = 1;
+    mRadiusY = 1;
+    mLaunchRadiusX = 0;
+    mLaunchRadiusY = 0;
+    mDilate = false;
+    mWidth = 0;
+    mHeight = 0;
+    mChannels = 0;
+    mRowBytes = 0;
+    mTmp = NULL;
+    mTmpG = NULL;
+    mTmpS = NULL;
+    mTmpSize = 0;
+
+    mScratch = new uchar *[mCtx->getThreadCount()];
+    mScratchSize = new size_t[mCtx->getThreadCount()];
+    memset(mScratch, 0, sizeof(uchar *) * mCtx->getThreadCount());
+    memset(mScratchSize, 0, sizeof(size_t) * mCtx->getThreadCount());
+}
+
+RsdCpuScriptIntrinsicMorphology::~RsdCpuScriptIntrinsicMorphology() {
+    uint32_t threads = mCtx->getThreadCount();
+    for (size_t i = 0; i < threads; i++) {
+        free(mScratch[i]);
+    }
+    delete []mScratch;
+    delete []mScratchSize;
+    free(mTmp);
+}
+
+void RsdCpuScriptIntrinsicMorphology::preLaunch(uint32_t slot, const Allocation * ain,
+                                                Allocation * aout, const void * usr,
+                                                uint32_t usrLen, const RsScriptCall *sc) {
+    if (!mAlloc.get()) {
+        ALOGE("Morphology executed without input, skipping");
+        return;
+    }
+
+    mDilate = (slot == 1);
+    mWidth = mAlloc->mHal.drvState.lod[0].dimX;
+    mHeight = rsMax(mAlloc->mHal.drvState.lod[0].dimY, 1u);
+    if (!aout || !mAlloc->hasSameDims(aout)) {
+        mCtx->getContext()->setError(RS_ERROR_BAD_VALUE,
+                                     "Morphology input and output dimensions do not match");
+        mWidth = 0;
+        mHeight = 0;
+        return;
+    }
+    mChannels = mAlloc->getType()->getElementSizeBytes();
+    mRowBytes = mWidth * mChannels;
+
+    // Radii beyond the image cover the whole axis; clamping keeps the
+    // block count meaningful.  The radii set by the user are kept for
+    // later launches on larger images.
+    mLaunchRadiusX = rsMin(mRadiusX, (int32_t)mWidth);
+    mLaunchRadiusY = rsMin(mRadiusY, (int32_t)mHeight);
+
+    const size_t imageBytes = mRowBytes * mHeight;
+    if (mTmpSize < imageBytes) {
+        free(mTmp);
+        mTmp = (uchar *)malloc(imageBytes * 3);
+        mTmpSize = mTmp ? imageBytes : 0;
+    }
+    if (!mTmp) {
+        mCtx->getContext()->setError(RS_ERROR_OUT_OF_MEMORY, "Morphology temporary allocation");
+        return;
+    }
+    mTmpG = mTmp + mTmpSize;
+    mTmpS = mTmpG + mTmpSize;
+
+    for (uint32_t i = 0; i < mCtx->getThreadCount(); i++) {
+        if (mScratchSize[i] < mRowBytes) {
+            mScratch[i] = (uchar *)realloc(mScratch[i], mRowBytes * 2);
+            mScratchSize[i] = mRowBytes;
+        }
+    }
+
+    launchRows(&rowsH, mHeight);
+    if (mLaunchRadiusY > 0) {
+        const uint32_t k = 2 * mLaunchRadiusY + 1;
+        launchRows(&blocksV, (mHeight + k - 1) / k);
+    }
+}
+
+void RsdCpuScriptIntrinsicMorphology::populateScript(Script *s) {
+    s->mHal.info.exportedVariableCount = 2;
+}
+
+void RsdCpuScriptIntrinsicMorphology::invokeFreeChildren() {
+    mAlloc.clear();
+}
+
+
+RsdCpuScriptImpl * rsdIntrinsic_Morphology(RsdCpuReferenceImpl *ctx,
+                                           const Script *s, const Element *e) {
+    return new RsdCpuScriptIntrinsicMorphology(ctx, s, e);
+}
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "rsCpuIntrinsic.h"
+#include "rsCpuIntrinsicInlines.h"
+
+using namespace android;
+using namespace android::renderscript;
+
+namespace android {
+namespace renderscript {
+
+
+/*
+ * Inverse of YuvToRGB: converts an RGBA input into a YUV 4:2:0 output in a
+ * single pass.  The output plane layout (NV21 or YV12) is whatever the driver
+ * derived for the output Allocation; Y goes to lod[0], U to lod[1], V to
+ * lod[2], with yuv.step between chroma samples.  Each even row also writes
+ * the chroma row for its 2x2 blocks, averaged over the row pair.
+ */
+class RsdCpuScriptIntrinsicRGBToYuv : public RsdCpuScriptIntrinsic {
+public:
+    virtual void populateScript(Script *);
+    virtual void invokeFreeChildren();
+
+    virtual void setGlobalObj(uint32_t slot, ObjectBase *data);
+
+    virtual ~RsdCpuScriptIntrinsicRGBToYuv();
+    RsdCpuScriptIntrinsicRGBToYuv(RsdCpuReferenceImpl *ctx, const Script *s, const Element *e);
+
+    virtual void preLaunch(uint32_t slot, const Allocation * ain,
+                           Allocation * aout, const void * usr,
+                           uint32_t usrLen, const RsScriptCall *sc);
+
+protected:
+    ObjectBaseRef<Allocation> alloc;
+    const Allocation *mOut;
+
+    static void kernel(const RsForEachStubParamStruct *p,
+                       uint32_t xstart, uint32_t xend,
+                       uint32_t instep, uint32_t outstep);
+};
+
+}
+}
+
+
+void RsdCpuScriptIntrinsicRGBToYuv::setGlobalObj(uint32_t slot, ObjectBase *data) {
+    rsAssert(slot == 0);
+    alloc.set(static_cast<Allocation *>(data));
+}
+
+
+typedef uchar uchar16 __attribute__((ext_vector_type(16)));
+
+// BT.601 limited range, the inverse of the integer YuvToRGB coefficients.
+static inline uchar rsRGBToY(int r, int g, int b) {
+    return (uchar)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+// r, g and b are sums over a 2x2 block.
+static inline uchar rsRGBToU4(int r, int g, int b) {
+    return (uchar)(((-38 * r - 74 * g + 112 * b + 512) >> 10) + 128);
+}
+
+static inline uchar rsRGBToV4(int r, int g, int b) {
+    return (uchar)(((112 * r - 94 * g - 18 * b + 512) >> 10) + 128);
+}
+
+static inline uchar16 loadPixels4(const uchar4 *in) {
+    uchar16 v;
+    memcpy(&v, in, sizeof(v));
+    return v;
+}
+
+// Converts four RGBA pixels at a time with the channels split into lanes.
+static void OneRowY(uchar *Y, const uchar4 *in, uint32_t x1, uint32_t x2) {
+    while ((x1 + 4) <= x2) {
+        uchar16 v = loadPixels4(in + x1);
+        int4 r = convert_int4((uchar4)__builtin_shufflevector(v, v, 0, 4, 8, 12));
+        int4 g = convert_int4((uchar4)__builtin_shufflevector(v, v, 1, 5, 9, 13));
+        int4 b = convert_int4((uchar4)__builtin_shufflevector(v, v, 2, 6, 10, 14));
+        int4 y = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+        uchar4 yo = convert_uchar4(y);
+        memcpy(Y + x1, &yo, sizeof(yo));
+        x1 += 4;
+    }
+    while (x1 < x2) {
+        uchar4 p = in[x1];
+        Y[x1] = rsRGBToY(p.x, p.y, p.z);
+        x1++;
+    }
+}
+
+// Writes chroma samples [c1, c2) from the row pair in0 / in1.
+static void OneRowUV(uchar *u, uchar *v, size_t cstep,
+                     const uchar4 *in0, const uchar4 *in1, uint32_t c1, uint32_t c2) {
+    while ((c1 + 2) <= c2) {
+        uchar16 a = loadPixels4(in0 + c1 * 2);
+        uchar16 b = loadPixels4(in1 + c1 * 2);
+        int4 r = convert_int4((uchar4)__builtin_shufflevector(a, a, 0, 4, 8, 12)) +
+                 convert_int4((uchar4)__builtin_shufflevector(b, b, 0, 4, 8, 12));
+        int4 g = convert_int4((uchar4)__builtin_shufflevector(a, a, 1, 5, 9, 13)) +
+                 convert_int4((uchar4)__builtin_shufflevector(b, b, 1, 5, 9, 13));
+        int4 bl = convert_int4((uchar4)__builtin_shufflevector(a, a, 2, 6, 10, 14)) +
+                  convert_int4((uchar4)__builtin_shufflevector(b, b, 2, 6, 10, 14));
+        int2 rs = r.even + r.odd;
+        int2 gs = g.even + g.odd;
+        int2 bs = bl.even + bl.odd;
+        int2 uo = ((-38 * rs - 74 * gs + 112 * bs + 512) >> 10) + 128;
+        int2 vo = ((112 * rs - 94 * gs - 18 * bs + 512) >> 10) + 128;
+        u[c1 * cstep] = (uchar)uo.x;
+        v[c1 * cstep] = (uchar)vo.x;
+        u[(c1 + 1) * cstep] = (uchar)uo.y;
+        v[(c1 + 1) * cstep] = (uchar)vo.y;
+        c1 += 2;
+    }
+    while (c1 < c2) {
+        uchar4 p0 = in0[c1 * 2];
+        uchar4 p1 = in0[c1 * 2 + 1];
+        uchar4 p2 = in1[c1 * 2];
+        uchar4 p3 = in1[c1 * 2 + 1];
+        int r = p0.x + p1.x + p2.x + p3.x;
+        int g = p0.y + p1.y + p2.y + p3.y;
+        int b = p0.z + p1.z + p2.z + p3.z;
+        u[c1 * cstep] = rsRGBToU4(r, g, b);
+        v[c1 * cstep] = rsRGBToV4(r, g, b);
+        c1++;
+    }
+}
+
+void RsdCpuScriptIntrinsicRGBToYuv::kernel(const RsForEachStubParamStruct *p,
+                                           uint32_t xstart, uint32_t xend,
+                                           uint32_t instep, uint32_t outstep) {
+    RsdCpuScriptIntrinsicRGBToYuv *cp = (RsdCpuScriptIntrinsicRGBToYuv *)p->usr;
+    if (!cp->alloc.get()) {
+        ALOGE("RGBToYuv executed without input, skipping");
+        return;
+    }
+    // preLaunch reports a missing or mismatched output.
+    const Allocation *out = cp->mOut;
+    if (!out) {
+        return;
+    }
+    uchar *pinU = (uchar *)out->mHal.drvState.lod[1].mallocPtr;
+    uchar *pinV = (uchar *)out->mHal.drvState.lod[2].mallocPtr;
+    if (!pinU || !pinV) {
+        ALOGE("RGBToYuv executed without chroma planes, skipping");
+        return;
+    }
+
+    const uchar *pin = (const uchar *)cp->alloc->mHal.drvState.lod[0].mallocPtr;
+    const size_t stride = cp->alloc->mHal.drvState.lod[0].stride;
+    const uint32_t maxY = rsMax(cp->alloc->mHal.drvState.lod[0].dimY, 1u) - 1;
+
+    const uchar4 *in0 = (const uchar4 *)(pin + stride * p->y);
+    OneRowY((uchar *)p->out - xstart, in0, xstart, xend);
+
+    // Chroma is produced once per row pair.
+    const uint32_t cy = p->y >> 1;
+    if ((p->y & 1) || (cy >= out->mHal.drvState.lod[1].dimY)) {
+        return;
+    }
+    const uchar4 *in1 = (const uchar4 *)(pin + stride * rsMin(p->y + 1, maxY));
+
+    const size_t cstep = out->mHal.drvState.yuv.step;
+    uchar *u = pinU + cy * out->mHal.drvState.lod[1].stride;
+    uchar *v = pinV + cy * out->mHal.drvState.lod[2].stride;
+
+    uint32_t c1 = (xstart + 1) >> 1;
+    uint32_t c2 = rsMin(xend >> 1, out->mHal.drvState.lod[1].dimX);
+    if (c2 > c1) {
+        OneRowUV(u, v, cstep, in0, in1, c1, c2);
+    }
+}
+
+RsdCpuScriptIntrinsicRGBToYuv::RsdCpuScriptIntrinsicRGBToYuv(
+            RsdCpuReferenceImpl *ctx, const Script *s, const Element *e)
+            : RsdCpuScriptIntrinsic(ctx, s, e, RS_SCRIPT_INTRINSIC_ID_RGB_TO_YUV) {
+
+    mRootPtr = &kernel;
+    mOut = NULL;
+}
+
+RsdCpuScriptIntrinsicRGBToYuv::~RsdCpuScriptIntrinsicRGBToYuv() {
+}
+
+void RsdCpuScriptIntrinsicRGBToYuv::preLaunch(uint32_t slot, const Allocation * ain,
+                                              Allocation * aout, const void * usr,
+                                              uint32_t usrLen, const RsScriptCall *sc) {
+    mOut = NULL;
+    if (!alloc.get()) {
+        return;
+    }
+    // The kernel reads the input row of every output row.
+    if (!aout ||
+        (aout->mHal.drvState.lod[0].dimX != alloc->mHal.drvState.lod[0].dimX) ||
+        (aout->mHal.drvState.lod[0].dimY != alloc->mHal.drvState.lod[0].dimY)) {
+        mCtx->getContext()->setError(RS_ERROR_BAD_VALUE,
+                                     "RGBToYuv input and output dimensions do not match");
+        return;
+    }
+    mOut = aout;
+}
+
+void RsdCpuScriptIntrinsicRGBToYuv::populateScript(Script *s) {
+    s->mHal.info.exportedVariableCount = 1;
+}
+
+void RsdCpuScriptIntrinsicRGBToYuv::invokeFreeChildren() {
+    alloc.clear();
+}
+
+
+RsdCpuScriptImpl * rsdIntrinsic_RGBToYuv(RsdCpuReferenceImpl *ctx,
+                                         const Script *s, const Element *e) {
+    return new RsdCpuScriptIntrinsicRGBToYuv(ctx, s, e);
+}
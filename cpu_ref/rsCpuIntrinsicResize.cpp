@@ -25,11 +25,31 @@ namespace android {
 namespace renderscript {
 
 
+/*
+ * Resize is done as two separable passes.  For every output row the
+ * vertical taps are accumulated across the needed source columns into a
+ * per-thread float row, then the horizontal taps are applied to that row.
+ * The source indices and weights for both axes are computed once per
+ * (source size, destination size, mode) and shared by all threads, so the
+ * inner loops only do loads and multiply-adds on vector types.
+ */
+struct ResizeTapTable {
+    uint32_t srcSize;
+    uint32_t dstSize;
+    uint32_t taps;
+    int32_t mode;
+
+    // dstSize * taps entries, clamped to [0, srcSize - 1].
+    int32_t *index;
+    float *weight;
+};
+
 class RsdCpuScriptIntrinsicResize : public RsdCpuScriptIntrinsic {
 public:
     virtual void populateScript(Script *);
     virtual void invokeFreeChildren();
 
+    virtual void setGlobalVar(uint32_t slot, const void *data, size_t dataLength);
     virtual void setGlobalObj(uint32_t slot, ObjectBase *data);
 
     virtual ~RsdCpuScriptIntrinsicResize();
@@ -39,13 +59,20 @@ public:
                            Allocation * aout, const void * usr,
                            uint32_t usrLen, const RsScriptCall *sc);
 
-    float scaleX;
-    float scaleY;
-
 protected:
     ObjectBaseRef<const Allocation> mAlloc;
     ObjectBaseRef<const Element> mElement;
 
+    int32_t mMode;
+    float mRound;
+    ResizeTapTable mTapsX;
+    ResizeTapTable mTapsY;
+
+    void **mScratch;
+    size_t *mScratchSize;
+
+    float * getRowBuffer(uint32_t lid) const;
+
     static void kernelU1(const RsForEachStubParamStruct *p,
                          uint32_t xstart, uint32_t xend,
                          uint32_t instep, uint32_t outstep);
@@ -66,113 +93,264 @@ void RsdCpuScriptIntrinsicResize::setGlobalObj(uint32_t slot, ObjectBase *data)
     mAlloc.set(static_cast<Allocation *>(data));
 }
 
-static float4 cubicInterpolate(float4 p0,float4 p1,float4 p2,float4 p3, float x) {
-    return p1 + 0.5f * x * (p2 - p0 + x * (2.f * p0 - 5.f * p1 + 4.f * p2 - p3
-            + x * (3.f * (p1 - p2) + p3 - p0)));
+void RsdCpuScriptIntrinsicResize::setGlobalVar(uint32_t slot, const void *data,
+                                               size_t dataLength) {
+    rsAssert(slot == 1);
+    rsAssert(dataLength == sizeof(int32_t));
+    int32_t mode = ((const int32_t *)data)[0];
+    if ((mode < RS_RESIZE_MODE_BICUBIC) || (mode > RS_RESIZE_MODE_AREA)) {
+        mCtx->getContext()->setError(RS_ERROR_BAD_VALUE, "Invalid resize mode");
+        return;
+    }
+    mMode = mode;
+}
+
+static void freeTaps(ResizeTapTable *t) {
+    delete[] t->index;
+    delete[] t->weight;
+    memset(t, 0, sizeof(*t));
+}
+
+static inline int32_t clampIndex(int32_t i, int32_t max) {
+    return rsMin(rsMax(i, 0), max);
+}
+
+// Catmull-Rom weights; identical to cubicInterpolate() expanded per sample.
+static void cubicWeights(float x, float *w) {
+    const float x2 = x * x;
+    const float x3 = x2 * x;
+    w[0] = 0.5f * (-x + 2.f * x2 - x3);
+    w[1] = 1.f + 0.5f * (-5.f * x2 + 3.f * x3);
+    w[2] = 0.5f * (x + 4.f * x2 - 3.f * x3);
+    w[3] = 0.5f * (x3 - x2);
 }
 
-static float2 cubicInterpolate(float2 p0,float2 p1,float2 p2,float2 p3, float x) {
-    return p1 + 0.5f * x * (p2 - p0 + x * (2.f * p0 - 5.f * p1 + 4.f * p2 - p3
-            + x * (3.f * (p1 - p2) + p3 - p0)));
+static void buildTaps(ResizeTapTable *t, uint32_t srcSize, uint32_t dstSize, int32_t mode) {
+    if (t->index && (t->srcSize == srcSize) && (t->dstSize == dstSize) && (t->mode == mode)) {
+        return;
+    }
+    freeTaps(t);
+
+    const float scale = (float)srcSize / dstSize;
+    const int32_t maxIndex = srcSize - 1;
+
+    // Area averaging only differs from bilinear when minifying.
+    if ((mode == RS_RESIZE_MODE_AREA) && (scale <= 1.f)) {
+        mode = RS_RESIZE_MODE_BILINEAR;
+    }
+
+    uint32_t taps;
+    switch (mode) {
+    case RS_RESIZE_MODE_BILINEAR:
+        taps = 2;
+        break;
+    case RS_RESIZE_MODE_AREA:
+        taps = (uint32_t)ceilf(scale) + 1;
+        break;
+    default:
+        taps = 4;
+        break;
+    }
+
+    t->srcSize = srcSize;
+    t->dstSize = dstSize;
+    t->taps = taps;
+    t->mode = mode;
+    t->index = new int32_t[dstSize * taps];
+    t->weight = new float[dstSize * taps];
+
+    for (uint32_t d = 0; d < dstSize; d++) {
+        int32_t *idx = t->index + d * taps;
+        float *w = t->weight + d * taps;
+
+        switch (mode) {
+        case RS_RESIZE_MODE_BILINEAR: {
+            float f = (d + 0.5f) * scale - 0.5f;
+            float fl = floorf(f);
+            float frac = f - fl;
+            idx[0] = clampIndex((int32_t)fl, maxIndex);
+            idx[1] = clampIndex((int32_t)fl + 1, maxIndex);
+            w[0] = 1.f - frac;
+            w[1] = frac;
+            break;
+        }
+        case RS_RESIZE_MODE_AREA: {
+            // Each output sample is the average of the source interval
+            // [lo, hi), weighted by how much of each source texel it covers.
+            float lo = d * scale;
+            float hi = lo + scale;
+            int32_t first = (int32_t)floorf(lo);
+            for (uint32_t i = 0; i < taps; i++) {
+                int32_t s = first + i;
+                float cover = rsMin(hi, (float)(s + 1)) - rsMax(lo, (float)s);
+                idx[i] = clampIndex(s, maxIndex);
+                w[i] = (cover > 0.f) ? (cover / scale) : 0.f;
+            }
+            break;
+        }
+        default: {
+            // Keep the sample positions of the original bicubic kernel.
+            float f = d * scale;
+            float fl = floorf(f);
+            int32_t start = (int32_t)fl - 2;
+            for (uint32_t i = 0; i < 4; i++) {
+                idx[i] = clampIndex(start + i, maxIndex);
+            }
+            cubicWeights(f - fl, w);
+            break;
+        }
+        }
+    }
 }
 
-static float cubicInterpolate(float p0,float p1,float p2,float p3 , float x) {
-    return p1 + 0.5f * x * (p2 - p0 + x * (2.f * p0 - 5.f * p1 + 4.f * p2 - p3
-            + x * (3.f * (p1 - p2) + p3 - p0)));
+static inline uchar4 loadU1x4(const uchar *p) {
+    uchar4 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
 }
 
-static uchar4 OneBiCubic(const uchar4 *yp0, const uchar4 *yp1, const uchar4 *yp2, const uchar4 *yp3,
-                         float xf, float yf, int width) {
-    int startx = (int) floor(xf - 2);
-    xf = xf - floor(xf);
-    int maxx = width - 1;
-    int xs0 = rsMax(0, startx + 0);
-    int xs1 = rsMax(0, startx + 1);
-    int xs2 = rsMin(maxx, startx + 2);
-    int xs3 = rsMin(maxx, startx + 3);
-
-    float4 p0  = cubicInterpolate(convert_float4(yp0[xs0]),
-                                  convert_float4(yp0[xs1]),
-                                  convert_float4(yp0[xs2]),
-                                  convert_float4(yp0[xs3]), xf);
-
-    float4 p1  = cubicInterpolate(convert_float4(yp1[xs0]),
-                                  convert_float4(yp1[xs1]),
-                                  convert_float4(yp1[xs2]),
-                                  convert_float4(yp1[xs3]), xf);
-
-    float4 p2  = cubicInterpolate(convert_float4(yp2[xs0]),
-                                  convert_float4(yp2[xs1]),
-                                  convert_float4(yp2[xs2]),
-                                  convert_float4(yp2[xs3]), xf);
-
-    float4 p3  = cubicInterpolate(convert_float4(yp3[xs0]),
-                                  convert_float4(yp3[xs1]),
-                                  convert_float4(yp3[xs2]),
-                                  convert_float4(yp3[xs3]), xf);
-
-    float4 p  = cubicInterpolate(p0, p1, p2, p3, yf);
-    p = clamp(p, 0.f, 255.f);
-    return convert_uchar4(p);
+// Vertical pass: row[c] = sum_t src[ys[t]][c] * wy[t] for c in [c1, c2).
+static void VertU4(float4 *row, const uchar *pin, size_t stride,
+                   const int32_t *ys, const float *wy, uint32_t taps,
+                   uint32_t c1, uint32_t c2) {
+    const uchar4 *in = (const uchar4 *)(pin + stride * ys[0]);
+    float w = wy[0];
+    for (uint32_t c = c1; c < c2; c++) {
+        row[c] = convert_float4(in[c]) * w;
+    }
+    for (uint32_t t = 1; t < taps; t++) {
+        in = (const uchar4 *)(pin + stride * ys[t]);
+        w = wy[t];
+        if (w == 0.f) {
+            continue;
+        }
+        for (uint32_t c = c1; c < c2; c++) {
+            row[c] += convert_float4(in[c]) * w;
+        }
+    }
 }
 
-static uchar2 OneBiCubic(const uchar2 *yp0, const uchar2 *yp1, const uchar2 *yp2, const uchar2 *yp3,
-                         float xf, float yf, int width) {
-    int startx = (int) floor(xf - 2);
-    xf = xf - floor(xf);
-    int maxx = width - 1;
-    int xs0 = rsMax(0, startx + 0);
-    int xs1 = rsMax(0, startx + 1);
-    int xs2 = rsMin(maxx, startx + 2);
-    int xs3 = rsMin(maxx, startx + 3);
-
-    float2 p0  = cubicInterpolate(convert_float2(yp0[xs0]),
-                                  convert_float2(yp0[xs1]),
-                                  convert_float2(yp0[xs2]),
-                                  convert_float2(yp0[xs3]), xf);
-
-    float2 p1  = cubicInterpolate(convert_float2(yp1[xs0]),
-                                  convert_float2(yp1[xs1]),
-                                  convert_float2(yp1[xs2]),
-                                  convert_float2(yp1[xs3]), xf);
-
-    float2 p2  = cubicInterpolate(convert_float2(yp2[xs0]),
-                                  convert_float2(yp2[xs1]),
-                                  convert_float2(yp2[xs2]),
-                                  convert_float2(yp2[xs3]), xf);
-
-    float2 p3  = cubicInterpolate(convert_float2(yp3[xs0]),
-                                  convert_float2(yp3[xs1]),
-                                  convert_float2(yp3[xs2]),
-                                  convert_float2(yp3[xs3]), xf);
-
-    float2 p  = cubicInterpolate(p0, p1, p2, p3, yf);
-    p = clamp(p, 0.f, 255.f);
-    return convert_uchar2(p);
+static void VertU2(float2 *row, const uchar *pin, size_t stride,
+                   const int32_t *ys, const float *wy, uint32_t taps,
+                   uint32_t c1, uint32_t c2) {
+    const uchar2 *in = (const uchar2 *)(pin + stride * ys[0]);
+    float w = wy[0];
+    for (uint32_t c = c1; c < c2; c++) {
+        row[c] = convert_float2(in[c]) * w;
+    }
+    for (uint32_t t = 1; t < taps; t++) {
+        in = (const uchar2 *)(pin + stride * ys[t]);
+        w = wy[t];
+        if (w == 0.f) {
+            continue;
+        }
+        for (uint32_t c = c1; c < c2; c++) {
+            row[c] += convert_float2(in[c]) * w;
+        }
+    }
 }
 
-static uchar OneBiCubic(const uchar *yp0, const uchar *yp1, const uchar *yp2, const uchar *yp3,
-                        float xf, float yf, int width) {
-    int startx = (int) floor(xf - 2);
-    xf = xf - floor(xf);
-    int maxx = width - 1;
-    int xs0 = rsMax(0, startx + 0);
-    int xs1 = rsMax(0, startx + 1);
-    int xs2 = rsMin(maxx, startx + 2);
-    int xs3 = rsMin(maxx, startx + 3);
-
-    float p0  = cubicInterpolate((float)yp0[xs0], (float)yp0[xs1],
-                                 (float)yp0[xs2], (float)yp0[xs3], xf);
-    float p1  = cubicInterpolate((float)yp1[xs0], (float)yp1[xs1],
-                                 (float)yp1[xs2], (float)yp1[xs3], xf);
-    float p2  = cubicInterpolate((float)yp2[xs0], (float)yp2[xs1],
-                                 (float)yp2[xs2], (float)yp2[xs3], xf);
-    float p3  = cubicInterpolate((float)yp3[xs0], (float)yp3[xs1],
-                                 (float)yp3[xs2], (float)yp3[xs3], xf);
-
-    float p  = cubicInterpolate(p0, p1, p2, p3, yf);
-    p = clamp(p, 0.f, 255.f);
-    return (uchar)p;
+// Single channel rows are processed four columns at a time.
+static void VertU1(float *row, const uchar *pin, size_t stride,
+                   const int32_t *ys, const float *wy, uint32_t taps,
+                   uint32_t c1, uint32_t c2) {
+    const uint32_t c4 = c1 + ((c2 - c1) & ~3);
+
+    for (uint32_t t = 0; t < taps; t++) {
+        const uchar *in = pin + stride * ys[t];
+        const float w = wy[t];
+        if ((t > 0) && (w == 0.f)) {
+            continue;
+        }
+        uint32_t c = c1;
+        for (; c < c4; c += 4) {
+            float4 v = convert_float4(loadU1x4(in + c)) * w;
+            float4 acc;
+            if (t > 0) {
+                memcpy(&acc, row + c, sizeof(acc));
+                v += acc;
+            }
+            memcpy(row + c, &v, sizeof(v));
+        }
+        for (; c < c2; c++) {
+            float v = in[c] * w;
+            row[c] = (t > 0) ? (row[c] + v) : v;
+        }
+    }
+}
+
+// Horizontal pass over the float row produced by the vertical pass.
+static void HorizU4(uchar4 *out, const float4 *row, const ResizeTapTable *tx,
+                    float round, uint32_t x1, uint32_t x2) {
+    const uint32_t taps = tx->taps;
+    const int32_t *xs = tx->index + x1 * taps;
+    const float *wx = tx->weight + x1 * taps;
+
+    if (taps == 4) {
+        for (uint32_t x = x1; x < x2; x++) {
+            float4 p = row[xs[0]] * wx[0] + row[xs[1]] * wx[1] +
+                       row[xs[2]] * wx[2] + row[xs[3]] * wx[3];
+            *out++ = convert_uchar4(clamp(p + round, 0.f, 255.f));
+            xs += 4;
+            wx += 4;
+        }
+        return;
+    }
+    for (uint32_t x = x1; x < x2; x++) {
+        float4 p = row[xs[0]] * wx[0];
+        for (uint32_t t = 1; t < taps; t++) {
+            p += row[xs[t]] * wx[t];
+        }
+        *out++ = convert_uchar4(clamp(p + round, 0.f, 255.f));
+        xs += taps;
+        wx += taps;
+    }
+}
+
+static void HorizU2(uchar2 *out, const float2 *row, const ResizeTapTable *tx,
+                    float round, uint32_t x1, uint32_t x2) {
+    const uint32_t taps = tx->taps;
+    const int32_t *xs = tx->index + x1 * taps;
+    const float *wx = tx->weight + x1 * taps;
+
+    for (uint32_t x = x1; x < x2; x++) {
+        float2 p = row[xs[0]] * wx[0];
+        for (uint32_t t = 1; t < taps; t++) {
+            p += row[xs[t]] * wx[t];
+        }
+        *out++ = convert_uchar2(clamp(p + round, 0.f, 255.f));
+        xs += taps;
+        wx += taps;
+    }
+}
+
+static void HorizU1(uchar *out, const float *row, const ResizeTapTable *tx,
+                    float round, uint32_t x1, uint32_t x2) {
+    const uint32_t taps = tx->taps;
+    const int32_t *xs = tx->index + x1 * taps;
+    const float *wx = tx->weight + x1 * taps;
+
+    for (uint32_t x = x1; x < x2; x++) {
+        float p = row[xs[0]] * wx[0];
+        for (uint32_t t = 1; t < taps; t++) {
+            p += row[xs[t]] * wx[t];
+        }
+        *out++ = (uchar)clamp(p + round, 0.f, 255.f);
+        xs += taps;
+        wx += taps;
+    }
+}
+
+float * RsdCpuScriptIntrinsicResize::getRowBuffer(uint32_t lid) const {
+    // realloc only aligns to 8 bytes so we manually align to 16.
+    return (float *)((((intptr_t)mScratch[lid]) + 15) & ~0xf);
+}
+
+// The source columns touched by outputs [x1, x2); tap indices are monotonic.
+static inline void columnRange(const ResizeTapTable *tx, uint32_t x1, uint32_t x2,
+                               uint32_t *c1, uint32_t *c2) {
+    *c1 = tx->index[x1 * tx->taps];
+    *c2 = tx->index[x2 * tx->taps - 1] + 1;
 }
 
 void RsdCpuScriptIntrinsicResize::kernelU4(const RsForEachStubParamStruct *p,
@@ -184,35 +362,21 @@ void RsdCpuScriptIntrinsicResize::kernelU4(const RsForEachStubParamStruct *p,
         ALOGE("Resize executed without input, skipping");
         return;
     }
+    if (xstart >= xend) {
+        return;
+    }
     const uchar *pin = (const uchar *)cp->mAlloc->mHal.drvState.lod[0].mallocPtr;
-    const int srcHeight = cp->mAlloc->mHal.drvState.lod[0].dimY;
-    const int srcWidth = cp->mAlloc->mHal.drvState.lod[0].dimX;
     const size_t stride = cp->mAlloc->mHal.drvState.lod[0].stride;
+    const ResizeTapTable *ty = &cp->mTapsY;
+    const uint32_t y = rsMin(p->y, ty->dstSize - 1);
 
-    float yf = p->y * cp->scaleY;
-    int starty = (int) floor(yf - 2);
-    yf = yf - floor(yf);
-    int maxy = srcHeight - 1;
-    int ys0 = rsMax(0, starty + 0);
-    int ys1 = rsMax(0, starty + 1);
-    int ys2 = rsMin(maxy, starty + 2);
-    int ys3 = rsMin(maxy, starty + 3);
-
-    const uchar4 *yp0 = (const uchar4 *)(pin + stride * ys0);
-    const uchar4 *yp1 = (const uchar4 *)(pin + stride * ys1);
-    const uchar4 *yp2 = (const uchar4 *)(pin + stride * ys2);
-    const uchar4 *yp3 = (const uchar4 *)(pin + stride * ys3);
-
-    uchar4 *out = ((uchar4 *)p->out) + xstart;
-    uint32_t x1 = xstart;
-    uint32_t x2 = xend;
-
-    while(x1 < x2) {
-        float xf = x1 * cp->scaleX;
-        *out = OneBiCubic(yp0, yp1, yp2, yp3, xf, yf, srcWidth);
-        out++;
-        x1++;
-    }
+    uint32_t c1, c2;
+    columnRange(&cp->mTapsX, xstart, xend, &c1, &c2);
+
+    float4 *row = (float4 *)cp->getRowBuffer(p->lid);
+    VertU4(row, pin, stride, ty->index + y * ty->taps, ty->weight + y * ty->taps,
+           ty->taps, c1, c2);
+    HorizU4(((uchar4 *)p->out), row, &cp->mTapsX, cp->mRound, xstart, xend);
 }
 
 void RsdCpuScriptIntrinsicResize::kernelU2(const RsForEachStubParamStruct *p,
@@ -224,35 +388,21 @@ void RsdCpuScriptIntrinsicResize::kernelU2(const RsForEachStubParamStruct *p,
         ALOGE("Resize executed without input, skipping");
         return;
     }
+    if (xstart >= xend) {
+        return;
+    }
     const uchar *pin = (const uchar *)cp->mAlloc->mHal.drvState.lod[0].mallocPtr;
-    const int srcHeight = cp->mAlloc->mHal.drvState.lod[0].dimY;
-    const int srcWidth = cp->mAlloc->mHal.drvState.lod[0].dimX;
     const size_t stride = cp->mAlloc->mHal.drvState.lod[0].stride;
+    const ResizeTapTable *ty = &cp->mTapsY;
+    const uint32_t y = rsMin(p->y, ty->dstSize - 1);
 
-    float yf = p->y * cp->scaleY;
-    int starty = (int) floor(yf - 2);
-    yf = yf - floor(yf);
-    int maxy = srcHeight - 1;
-    int ys0 = rsMax(0, starty + 0);
-    int ys1 = rsMax(0, starty + 1);
-    int ys2 = rsMin(maxy, starty + 2);
-    int ys3 = rsMin(maxy, starty + 3);
-
-    const uchar2 *yp0 = (const uchar2 *)(pin + stride * ys0);
-    const uchar2 *yp1 = (const uchar2 *)(pin + stride * ys1);
-    const uchar2 *yp2 = (const uchar2 *)(pin + stride * ys2);
-    const uchar2 *yp3 = (const uchar2 *)(pin + stride * ys3);
-
-    uchar2 *out = ((uchar2 *)p->out) + xstart;
-    uint32_t x1 = xstart;
-    uint32_t x2 = xend;
-
-    while(x1 < x2) {
-        float xf = x1 * cp->scaleX;
-        *out = OneBiCubic(yp0, yp1, yp2, yp3, xf, yf, srcWidth);
-        out++;
-        x1++;
-    }
+    uint32_t c1, c2;
+    columnRange(&cp->mTapsX, xstart, xend, &c1, &c2);
+
+    float2 *row = (float2 *)cp->getRowBuffer(p->lid);
+    VertU2(row, pin, stride, ty->index + y * ty->taps, ty->weight + y * ty->taps,
+           ty->taps, c1, c2);
+    HorizU2(((uchar2 *)p->out), row, &cp->mTapsX, cp->mRound, xstart, xend);
 }
 
 void RsdCpuScriptIntrinsicResize::kernelU1(const RsForEachStubParamStruct *p,
@@ -264,44 +414,50 @@ void RsdCpuScriptIntrinsicResize::kernelU1(const RsForEachStubParamStruct *p,
         ALOGE("Resize executed without input, skipping");
         return;
     }
+    if (xstart >= xend) {
+        return;
+    }
     const uchar *pin = (const uchar *)cp->mAlloc->mHal.drvState.lod[0].mallocPtr;
-    const int srcHeight = cp->mAlloc->mHal.drvState.lod[0].dimY;
-    const int srcWidth = cp->mAlloc->mHal.drvState.lod[0].dimX;
     const size_t stride = cp->mAlloc->mHal.drvState.lod[0].stride;
+    const ResizeTapTable *ty = &cp->mTapsY;
+    const uint32_t y = rsMin(p->y, ty->dstSize - 1);
 
-    float yf = p->y * cp->scaleY;
-    int starty = (int) floor(yf - 2);
-    yf = yf - floor(yf);
-    int maxy = srcHeight - 1;
-    int ys0 = rsMax(0, starty + 0);
-    int ys1 = rsMax(0, starty + 1);
-    int ys2 = rsMin(maxy, starty + 2);
-    int ys3 = rsMin(maxy, starty + 3);
-
-    const uchar *yp0 = pin + stride * ys0;
-    const uchar *yp1 = pin + stride * ys1;
-    const uchar *yp2 = pin + stride * ys2;
-    const uchar *yp3 = pin + stride * ys3;
-
-    uchar *out = ((uchar *)p->out) + xstart;
-    uint32_t x1 = xstart;
-    uint32_t x2 = xend;
-
-    while(x1 < x2) {
-        float xf = x1 * cp->scaleX;
-        *out = OneBiCubic(yp0, yp1, yp2, yp3, xf, yf, srcWidth);
-        out++;
-        x1++;
-    }
+    uint32_t c1, c2;
+    columnRange(&cp->mTapsX, xstart, xend, &c1, &c2);
+
+    float *row = cp->getRowBuffer(p->lid);
+    VertU1(row, pin, stride, ty->index + y * ty->taps, ty->weight + y * ty->taps,
+           ty->taps, c1, c2);
+    HorizU1(((uchar *)p->out), row, &cp->mTapsX, cp->mRound, xstart, xend);
 }
 
 RsdCpuScriptIntrinsicResize::RsdCpuScriptIntrinsicResize (
             RsdCpuReferenceImpl *ctx, const Script *s, const Element *e)
             : RsdCpuScriptIntrinsic(ctx, s, e, RS_SCRIPT_INTRINSIC_ID_RESIZE) {
 
+    mMode = RS_RESIZE_MODE_BICUBIC;
+    mRound = 0.f;
+    memset(&mTapsX, 0, sizeof(mTapsX));
+    memset(&mTapsY, 0, sizeof(mTapsY));
+
+    mScratch = new void *[mCtx->getThreadCount()];
+    mScratchSize = new size_t[mCtx->getThreadCount()];
+    memset(mScratch, 0, sizeof(void *) * mCtx->getThreadCount());
+    memset(mScratchSize, 0, sizeof(size_t) * mCtx->getThreadCount());
 }
 
 RsdCpuScriptIntrinsicResize::~RsdCpuScriptIntrinsicResize() {
+    uint32_t threads = mCtx->getThreadCount();
+    for (size_t i = 0; i < threads; i++) {
+        if (mScratch[i]) {
+            free(mScratch[i]);
+        }
+    }
+    delete []mScratch;
+    delete []mScratchSize;
+
+    freeTaps(&mTapsX);
+    freeTaps(&mTapsY);
 }
 
 void RsdCpuScriptIntrinsicResize::preLaunch(uint32_t slot, const Allocation * ain,
@@ -312,9 +468,10 @@ void RsdCpuScriptIntrinsicResize::preLaunch(uint32_t slot, const Allocation * ai
         ALOGE("Resize executed without input, skipping");
         return;
     }
-    const uint32_t srcHeight = mAlloc->mHal.drvState.lod[0].dimY;
+    const uint32_t srcHeight = rsMax(mAlloc->mHal.drvState.lod[0].dimY, 1u);
     const uint32_t srcWidth = mAlloc->mHal.drvState.lod[0].dimX;
-    const size_t stride = mAlloc->mHal.drvState.lod[0].stride;
+    const uint32_t dstHeight = rsMax(aout->mHal.drvState.lod[0].dimY, 1u);
+    const uint32_t dstWidth = aout->mHal.drvState.lod[0].dimX;
 
     switch(mAlloc->getType()->getElement()->getVectorSize()) {
     case 1:
@@ -329,13 +486,25 @@ void RsdCpuScriptIntrinsicResize::preLaunch(uint32_t slot, const Allocation * ai
         break;
     }
 
-    scaleX = (float)srcWidth / aout->mHal.drvState.lod[0].dimX;
-    scaleY = (float)srcHeight / aout->mHal.drvState.lod[0].dimY;
+    buildTaps(&mTapsX, srcWidth, dstWidth, mMode);
+    buildTaps(&mTapsY, srcHeight, dstHeight, mMode);
 
+    // The bicubic path keeps the truncating conversion it always had.
+    mRound = (mMode == RS_RESIZE_MODE_BICUBIC) ? 0.f : 0.5f;
+
+    // One float row of the source per thread for the vertical pass.
+    const size_t rowBytes = srcWidth * sizeof(float4);
+    for (uint32_t i = 0; i < mCtx->getThreadCount(); i++) {
+        if (!mScratch[i] || (mScratchSize[i] < rowBytes)) {
+            // Pad by 16 bytes to allow alignment in getRowBuffer.
+            mScratch[i] = realloc(mScratch[i], rowBytes + 16);
+            mScratchSize[i] = rowBytes;
+        }
+    }
 }
 
 void RsdCpuScriptIntrinsicResize::populateScript(Script *s) {
-    s->mHal.info.exportedVariableCount = 1;
+    s->mHal.info.exportedVariableCount = 2;
 }
 
 void RsdCpuScriptIntrinsicResize::invokeFreeChildren() {
@@ -347,5 +516,3 @@ RsdCpuScriptImpl * rsdIntrinsic_Resize(RsdCpuReferenceImpl *ctx, const Script *s
 
     return new RsdCpuScriptIntrinsicResize(ctx, s, e);
 }
-
-
@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rsCpuLaunchTuner.h"
+
+#include <string.h>
+
+using namespace android;
+using namespace android::renderscript;
+
+static const uint64_t kNoTime = ~(uint64_t)0;
+
+static bool sameKey(const LaunchTuner::Key &a, const LaunchTuner::Key &b) {
+    return (a.kernel == b.kernel) && (a.script == b.script) &&
+           (a.extentX == b.extentX) && (a.extentY == b.extentY) &&
+           (a.stride == b.stride);
+}
+
+LaunchTuner::LaunchTuner() {
+    memset(mEntries, 0, sizeof(mEntries));
+    mEntryCount = 0;
+    mUseCount = 0;
+}
+
+void LaunchTuner::addCandidate(Entry *e, uint32_t sliceSize, uint32_t threads) {
+    // Larger slices than this would leave some of the threads without one.
+    uint32_t maxSlice = e->extent / threads;
+    if (sliceSize > maxSlice) {
+        sliceSize = maxSlice;
+    }
+    if (sliceSize < 1) {
+        sliceSize = 1;
+    }
+
+    for (uint32_t ct = 0; ct < e->candidateCount; ct++) {
+        if ((e->candidates[ct].sliceSize == sliceSize) &&
+            (e->candidates[ct].threads == threads)) {
+            return;
+        }
+    }
+    if (e->candidateCount < kMaxCandidates) {
+        Config &c = e->candidates[e->candidateCount];
+        c.sliceSize = sliceSize;
+        c.threads = threads;
+        e->times[e->candidateCount] = kNoTime;
+        e->candidateCount++;
+    }
+}
+
+void LaunchTuner::startTuning(Entry *e) {
+    const uint32_t defaultSlice = e->defaultSlice;
+    e->phase = PHASE_SLICE;
+    e->candidateCount = 0;
+    e->current = 0;
+    e->samples = 0;
+
+    // The default goes first so a launch that is only run a few times
+    // still mostly uses it.
+    addCandidate(e, defaultSlice, e->maxThreads);
+    addCandidate(e, defaultSlice / 2, e->maxThreads);
+    addCandidate(e, defaultSlice * 2, e->maxThreads);
+    addCandidate(e, defaultSlice / 4, e->maxThreads);
+    addCandidate(e, defaultSlice * 4, e->maxThreads);
+
+    e->chosen = e->candidates[0];
+    e->chosenTime = kNoTime;
+    e->recentTime = kNoTime;
+}
+
+LaunchTuner::Entry * LaunchTuner::find(const Key &key, uint32_t defaultSlice,
+                                       uint32_t extent, uint32_t maxThreads) {
+    for (uint32_t ct = 0; ct < mEntryCount; ct++) {
+        Entry *e = &mEntries[ct];
+        if (sameKey(e->key, key) && (e->maxThreads == maxThreads)) {
+            return e;
+        }
+    }
+
+    Entry *e = &mEntries[0];
+    if (mEntryCount < kMaxEntries) {
+        e = &mEntries[mEntryCount++];
+    } else {
+        for (uint32_t ct = 1; ct < kMaxEntries; ct++) {
+            if (mEntries[ct].lastUse < e->lastUse) {
+                e = &mEntries[ct];
+            }
+        }
+    }
+
+    memset(e, 0, sizeof(*e));
+    e->key = key;
+    e->extent = extent;
+    e->maxThreads = maxThreads;
+    e->defaultSlice = defaultSlice;
+    startTuning(e);
+    return e;
+}
+
+LaunchTuner::Config LaunchTuner::begin(const Key &key, uint32_t defaultSlice,
+                                       uint32_t extent, uint32_t maxThreads,
+                                       uint32_t *id) {
+    Entry *e = find(key, defaultSlice, extent, maxThreads);
+    e->lastUse = ++mUseCount;
+    *id = e - mEntries;
+    if (e->phase == PHASE_SETTLED) {
+        return e->chosen;
+    }
+    return e->candidates[e->current];
+}
+
+void LaunchTuner::finishPhase(Entry *e) {
+    uint32_t best = 0;
+    for (uint32_t ct = 1; ct < e->candidateCount; ct++) {
+        if (e->times[ct] < e->times[best]) {
+            best = ct;
+        }
+    }
+    if (e->times[best] < e->chosenTime) {
+        e->chosen = e->candidates[best];
+        e->chosenTime = e->times[best];
+    }
+
+    e->candidateCount = 0;
+    e->current = 0;
+    e->samples = 0;
+    if (e->phase == PHASE_SLICE) {
+        e->phase = PHASE_THREADS;
+        if (e->maxThreads >= 4) {
+            addCandidate(e, e->chosen.sliceSize, e->maxThreads / 2);
+        }
+        if ((e->maxThreads > 1) && (e->chosenTime < kSerialProbeNs)) {
+            addCandidate(e, e->extent, 1);
+        }
+        if (e->candidateCount) {
+            return;
+        }
+    }
+
+    e->phase = PHASE_SETTLED;
+    e->recentTime = e->chosenTime;
+}
+
+void LaunchTuner::end(uint32_t id, uint64_t ns) {
+    Entry *e = &mEntries[id];
+
+    if (e->phase == PHASE_SETTLED) {
+        e->recentTime = (e->recentTime * 7 + ns) / 8;
+        if (e->recentTime > e->chosenTime * 2) {
+            // The cost of the kernel has changed, for instance because of
+            // different data or load on the device.
+            startTuning(e);
+        }
+        return;
+    }
+
+    // The fastest sample is the least disturbed by other work.
+    if (ns < e->times[e->current]) {
+        e->times[e->current] = ns;
+    }
+    if (++e->samples < kSamples) {
+        return;
+    }
+    e->samples = 0;
+    if (++e->current < e->candidateCount) {
+        return;
+    }
+    finishPhase(e);
+}
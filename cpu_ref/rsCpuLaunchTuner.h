@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RSD_CPU_LAUNCH_TUNER_H
+#define RSD_CPU_LAUNCH_TUNER_H
+
+#include <stdint.h>
+
+namespace android {
+namespace renderscript {
+
+/*
+ * Chooses the slice size and thread count of threaded forEach launches.
+ *
+ * Launches are told apart by kernel, script, extent and row size. The
+ * first launches of each try slice sizes around the default, then half the
+ * threads and, if the launch is short, a serial run on the calling thread.
+ * Every candidate is timed over kSamples launches and the fastest one is
+ * used from then on. If its time later doubles the launch is tuned again.
+ *
+ * Choices are kept for the lifetime of the context, for the kMaxEntries
+ * most recently used launches. Only the thread that owns the worker pool
+ * uses the tuner, so it takes no locks.
+ */
+class LaunchTuner {
+public:
+    struct Config {
+        uint32_t sliceSize;
+        // Threads taking slices, the calling thread included. 1 means the
+        // launch runs serially without waking the workers.
+        uint32_t threads;
+    };
+
+    struct Key {
+        const void *kernel;
+        const void *script;
+        uint32_t extentX;
+        uint32_t extentY;
+        uint32_t stride;
+    };
+
+    LaunchTuner();
+
+    // Returns the configuration for the next launch with the given key.
+    // extent is the number of rows (or elements for 1D launches) to split.
+    // The returned id is passed to end() with the time the launch took.
+    Config begin(const Key &key, uint32_t defaultSlice, uint32_t extent,
+                 uint32_t maxThreads, uint32_t *id);
+    void end(uint32_t id, uint64_t ns);
+
+    static const uint32_t kSamples = 3;
+    static const uint32_t kMaxEntries = 32;
+    static const uint32_t kMaxCandidates = 6;
+    // Launches faster than this in parallel also try running serially.
+    static const uint64_t kSerialProbeNs = 200 * 1000;
+
+protected:
+    enum Phase {
+        PHASE_SLICE,
+        PHASE_THREADS,
+        PHASE_SETTLED
+    };
+
+    struct Entry {
+        Key key;
+        uint32_t lastUse;
+        uint32_t extent;
+        uint32_t maxThreads;
+        uint32_t defaultSlice;
+
+        Phase phase;
+        Config candidates[kMaxCandidates];
+        uint64_t times[kMaxCandidates];
+        uint32_t candidateCount;
+        uint32_t current;
+        uint32_t samples;
+
+        Config chosen;
+        uint64_t chosenTime;
+        // Moving average of the chosen configuration once settled.
+        uint64_t recentTime;
+    };
+
+    Entry * find(const Key &key, uint32_t defaultSlice, uint32_t extent,
+                 uint32_t maxThreads);
+    void startTuning(Entry *e);
+    void addCandidate(Entry *e, uint32_t sliceSize, uint32_t threads);
+    void finishPhase(Entry *e);
+
+    Entry mEntries[kMaxEntries];
+    uint32_t mEntryCount;
+    uint32_t mUseCount;
+};
+
+}
+}
+
+#endif
@@ -21,11 +21,20 @@
     #include <set>
     #include <string>
     #include <dlfcn.h>
+    #include <elf.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <link.h>
     #include <stdio.h>
     #include <stdlib.h>
     #include <string.h>
+    #include <sys/mman.h>
     #include <sys/stat.h>
     #include <unistd.h>
+    #include <utility>
+    #include <vector>
+
+    #include "rsCpuScriptIndex.h"
 #else
     #include <bcc/BCCContext.h>
     #include <bcc/Config/Config.h>
@@ -43,6 +52,526 @@
     #include <vector>
 #endif
 
+#ifdef RS_COMPATIBILITY_LIB
+
+#if defined(__arm__)
+    #define RS_R_RELATIVE   R_ARM_RELATIVE
+    #define RS_R_GLOB_DAT   R_ARM_GLOB_DAT
+    #define RS_R_JUMP_SLOT  R_ARM_JUMP_SLOT
+    #define RS_R_ABS        R_ARM_ABS32
+#elif defined(__aarch64__)
+    #define RS_R_RELATIVE   R_AARCH64_RELATIVE
+    #define RS_R_GLOB_DAT   R_AARCH64_GLOB_DAT
+    #define RS_R_JUMP_SLOT  R_AARCH64_JUMP_SLOT
+    #define RS_R_ABS        R_AARCH64_ABS64
+#elif defined(__i386__)
+    #define RS_R_RELATIVE   R_386_RELATIVE
+    #define RS_R_GLOB_DAT   R_386_GLOB_DAT
+    #define RS_R_JUMP_SLOT  R_386_JMP_SLOT
+    #define RS_R_ABS        R_386_32
+#elif defined(__x86_64__)
+    #define RS_R_RELATIVE   R_X86_64_RELATIVE
+    #define RS_R_GLOB_DAT   R_X86_64_GLOB_DAT
+    #define RS_R_JUMP_SLOT  R_X86_64_JUMP_SLOT
+    #define RS_R_ABS        R_X86_64_64
+#endif
+
+#ifdef __LP64__
+    #define RS_ELF_R_TYPE(i) ELF64_R_TYPE(i)
+    #define RS_ELF_R_SYM(i)  ELF64_R_SYM(i)
+    #define RS_ELF_ST_BIND(i) ELF64_ST_BIND(i)
+    #define RS_ELFCLASS      ELFCLASS64
+#else
+    #define RS_ELF_R_TYPE(i) ELF32_R_TYPE(i)
+    #define RS_ELF_R_SYM(i)  ELF32_R_SYM(i)
+    #define RS_ELF_ST_BIND(i) ELF32_ST_BIND(i)
+    #define RS_ELFCLASS      ELFCLASS32
+#endif
+
+// Android packed relocations, which we leave to the system loader.
+#define RS_DT_ANDROID_REL    0x6000000f
+#define RS_DT_ANDROID_RELA   0x60000011
+#define RS_DT_RELR           36
+
+namespace android {
+namespace renderscript {
+
+// A private instance of a script library that is already loaded.
+//
+// Script globals live in the data segment of the library, so every Script
+// instance needs its own copy of it. Rather than loading the file again
+// under a different name, the segments are mapped a second time from the
+// same file. Code and read-only data remain shared through the page cache;
+// only the pages of the writable segments that get written become private.
+// Relocations are applied against the new load address, with imported
+// symbols taken from the original load, which the instance keeps open.
+class ScriptSOImage {
+public:
+    // Returns NULL if the library uses anything we can't relocate here, in
+    // which case the caller falls back to loading it under a new name.
+    static ScriptSOImage * create(void *handle, const char *path);
+    ~ScriptSOImage();
+
+    // Translates an address from the original load into this image.
+    void * translate(void *addr) const {
+        uintptr_t a = (uintptr_t) addr;
+        if (a >= mOldStart && a < mOldEnd) {
+            return (void *) (a - mOldBias + mNewBias);
+        }
+        return addr;
+    }
+
+    // The inverse of translate().
+    void * original(void *addr) const {
+        uintptr_t a = (uintptr_t) addr;
+        if (a >= mOldStart - mOldBias + mNewBias && a < mOldEnd - mOldBias + mNewBias) {
+            return (void *) (a - mNewBias + mOldBias);
+        }
+        return addr;
+    }
+
+    // Replaces the writable data of this image with that of another instance
+    // of the same library (src, or the original load if src is NULL), so the
+    // globals start out with that instance's current values. Relocated
+    // pointers into src are moved to the same place in this image.
+    void copyData(const ScriptSOImage *src);
+
+private:
+    ScriptSOImage() : mBase(NULL), mSize(0), mOldStart(0), mOldEnd(0),
+                      mOldBias(0), mNewBias(0), mHandle(NULL),
+                      mSymTab(NULL), mStrTab(NULL),
+                      mRel(NULL), mRelSize(0), mRela(NULL), mRelaSize(0),
+                      mJmpRel(NULL), mJmpRelSize(0), mJmpRelIsRela(false) {}
+
+    bool mapSegments(int fd, const ElfW(Phdr) *phdr, size_t phnum);
+    void findData(const ElfW(Phdr) *phdr, size_t phnum);
+    bool relocate(const ElfW(Dyn) *dyn);
+    bool applyRelocation(uint32_t type, uint32_t sym, ElfW(Addr) offset,
+                         ElfW(Addr) addend, bool hasAddend);
+    void rebaseSite(ElfW(Addr) offset, uintptr_t srcBias);
+
+    uint8_t *mBase;
+    size_t mSize;
+    uintptr_t mOldStart;
+    uintptr_t mOldEnd;
+    uintptr_t mOldBias;
+    uintptr_t mNewBias;
+
+    void *mHandle;
+    const ElfW(Sym) *mSymTab;
+    const char *mStrTab;
+
+    const uint8_t *mRel;
+    size_t mRelSize;
+    const uint8_t *mRela;
+    size_t mRelaSize;
+    const uint8_t *mJmpRel;
+    size_t mJmpRelSize;
+    bool mJmpRelIsRela;
+
+    // Writable, non-RELRO ranges, as unbiased [start, end) addresses.
+    std::vector<std::pair<uintptr_t, uintptr_t> > mData;
+};
+
+static inline uintptr_t pageStart(uintptr_t a) {
+    return a & ~((uintptr_t) getpagesize() - 1);
+}
+
+static inline uintptr_t pageEnd(uintptr_t a) {
+    return pageStart(a + getpagesize() - 1);
+}
+
+#ifdef RS_R_RELATIVE
+static bool preadFully(int fd, void *buf, size_t len, off_t offset) {
+    uint8_t *p = (uint8_t *) buf;
+    while (len > 0) {
+        ssize_t r = pread(fd, p, len, offset);
+        if (r <= 0) {
+            if (r < 0 && errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += r;
+        len -= r;
+        offset += r;
+    }
+    return true;
+}
+#endif
+
+ScriptSOImage * ScriptSOImage::create(void *handle, const char *path) {
+#ifndef RS_R_RELATIVE
+    return NULL;
+#else
+    // Every compatibility script exports .rs.info, which locates the
+    // original load for us.
+    void *anchor = dlsym(handle, ".rs.info");
+    Dl_info info;
+    if (anchor == NULL || dladdr(anchor, &info) == 0 || info.dli_fbase == NULL) {
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    ScriptSOImage *image = NULL;
+    ElfW(Phdr) *phdr = NULL;
+    ElfW(Ehdr) ehdr;
+    if (!preadFully(fd, &ehdr, sizeof(ehdr), 0) ||
+        memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0 ||
+        ehdr.e_ident[EI_CLASS] != RS_ELFCLASS ||
+        ehdr.e_type != ET_DYN ||
+        ehdr.e_phentsize != sizeof(ElfW(Phdr)) ||
+        ehdr.e_phnum == 0) {
+        goto fail;
+    }
+
+    phdr = new ElfW(Phdr)[ehdr.e_phnum];
+    if (!preadFully(fd, phdr, ehdr.e_phnum * sizeof(ElfW(Phdr)), ehdr.e_phoff)) {
+        goto fail;
+    }
+
+    image = new ScriptSOImage();
+    image->mHandle = handle;
+    if (!image->mapSegments(fd, phdr, ehdr.e_phnum)) {
+        goto fail;
+    }
+    image->mOldBias = (uintptr_t) info.dli_fbase - image->mOldStart;
+    image->mOldEnd += image->mOldBias;
+    image->mOldStart += image->mOldBias;
+
+    for (size_t i = 0; i < ehdr.e_phnum; i++) {
+        if (phdr[i].p_type == PT_DYNAMIC) {
+            if (!image->relocate((const ElfW(Dyn) *)
+                                 (image->mNewBias + phdr[i].p_vaddr))) {
+                goto fail;
+            }
+        }
+    }
+
+    image->findData(phdr, ehdr.e_phnum);
+
+    // The loader hands out RELRO read-only, so keep this copy the same.
+    for (size_t i = 0; i < ehdr.e_phnum; i++) {
+        if (phdr[i].p_type == PT_GNU_RELRO) {
+            uintptr_t start = pageStart(image->mNewBias + phdr[i].p_vaddr);
+            uintptr_t end = pageStart(image->mNewBias + phdr[i].p_vaddr +
+                                       phdr[i].p_memsz);
+            if (end > start) {
+                mprotect((void *) start, end - start, PROT_READ);
+            }
+        }
+    }
+
+    delete[] phdr;
+    close(fd);
+    return image;
+
+fail:
+    delete image;
+    delete[] phdr;
+    close(fd);
+    return NULL;
+#endif
+}
+
+ScriptSOImage::~ScriptSOImage() {
+    if (mBase) {
+        munmap(mBase, mSize);
+    }
+}
+
+bool ScriptSOImage::mapSegments(int fd, const ElfW(Phdr) *phdr, size_t phnum) {
+    uintptr_t minAddr = UINTPTR_MAX;
+    uintptr_t maxAddr = 0;
+    for (size_t i = 0; i < phnum; i++) {
+        if (phdr[i].p_type == PT_TLS) {
+            return false;
+        }
+        if (phdr[i].p_type != PT_LOAD) {
+            continue;
+        }
+        minAddr = rsMin(minAddr, (uintptr_t) pageStart(phdr[i].p_vaddr));
+        maxAddr = rsMax(maxAddr, (uintptr_t) pageEnd(phdr[i].p_vaddr +
+                                                     phdr[i].p_memsz));
+    }
+    if (maxAddr <= minAddr) {
+        return false;
+    }
+
+    // Reserve the whole span first so the segments keep their layout.
+    mSize = maxAddr - minAddr;
+    void *base = mmap(NULL, mSize, PROT_NONE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) {
+        mSize = 0;
+        return false;
+    }
+    mBase = (uint8_t *) base;
+    mNewBias = (uintptr_t) mBase - minAddr;
+    mOldStart = minAddr;
+    mOldEnd = maxAddr;
+
+    for (size_t i = 0; i < phnum; i++) {
+        const ElfW(Phdr) &p = phdr[i];
+        if (p.p_type != PT_LOAD) {
+            continue;
+        }
+        int prot = ((p.p_flags & PF_R) ? PROT_READ : 0) |
+                   ((p.p_flags & PF_W) ? PROT_WRITE : 0) |
+                   ((p.p_flags & PF_X) ? PROT_EXEC : 0);
+
+        uintptr_t segStart = mNewBias + p.p_vaddr;
+        uintptr_t fileEnd = segStart + p.p_filesz;
+        uintptr_t segEnd = segStart + p.p_memsz;
+        uintptr_t mapStart = pageStart(segStart);
+        uintptr_t mapEnd = pageEnd(fileEnd);
+
+        if (p.p_filesz > 0) {
+            // MAP_PRIVATE of the same file: untouched pages stay shared with
+            // the original load.
+            void *seg = mmap((void *) mapStart, mapEnd - mapStart, prot,
+                             MAP_PRIVATE | MAP_FIXED, fd, pageStart(p.p_offset));
+            if (seg == MAP_FAILED) {
+                return false;
+            }
+        }
+
+        // Clear the rest of the last file page, then back the remaining bss
+        // with anonymous memory.
+        if ((p.p_flags & PF_W) && p.p_filesz > 0 && pageEnd(fileEnd) > fileEnd) {
+            memset((void *) fileEnd, 0, pageEnd(fileEnd) - fileEnd);
+        }
+        uintptr_t bssStart = p.p_filesz > 0 ? mapEnd : mapStart;
+        if (pageEnd(segEnd) > bssStart) {
+            void *bss = mmap((void *) bssStart, pageEnd(segEnd) - bssStart, prot,
+                             MAP_PRIVATE | MAP_FIXED | MAP_ANONYMOUS, -1, 0);
+            if (bss == MAP_FAILED) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void ScriptSOImage::findData(const ElfW(Phdr) *phdr, size_t phnum) {
+    uintptr_t relroStart = 0, relroEnd = 0;
+    for (size_t i = 0; i < phnum; i++) {
+        if (phdr[i].p_type == PT_GNU_RELRO) {
+            relroStart = phdr[i].p_vaddr;
+            relroEnd = pageStart(phdr[i].p_vaddr + phdr[i].p_memsz);
+        }
+    }
+    for (size_t i = 0; i < phnum; i++) {
+        if (phdr[i].p_type != PT_LOAD || !(phdr[i].p_flags & PF_W)) {
+            continue;
+        }
+        uintptr_t start = phdr[i].p_vaddr;
+        uintptr_t end = phdr[i].p_vaddr + phdr[i].p_memsz;
+        // RELRO holds nothing but relocated constants, which are already
+        // right for this image.
+        if (relroEnd > relroStart && relroStart <= start && relroEnd > start) {
+            start = rsMin(relroEnd, end);
+        } else if (relroEnd > relroStart && relroStart < end && relroEnd >= end) {
+            end = rsMax(relroStart, start);
+        }
+        if (end > start) {
+            mData.push_back(std::make_pair(start, end));
+        }
+    }
+}
+
+void ScriptSOImage::copyData(const ScriptSOImage *src) {
+    uintptr_t srcBias = src ? src->mNewBias : mOldBias;
+    for (size_t i = 0; i < mData.size(); i++) {
+        memcpy((void *) (mNewBias + mData[i].first),
+               (const void *) (srcBias + mData[i].first),
+               mData[i].second - mData[i].first);
+    }
+
+    for (size_t off = 0; mRel && off + sizeof(ElfW(Rel)) <= mRelSize;
+         off += sizeof(ElfW(Rel))) {
+        rebaseSite(((const ElfW(Rel) *) (mRel + off))->r_offset, srcBias);
+    }
+    for (size_t off = 0; mRela && off + sizeof(ElfW(Rela)) <= mRelaSize;
+         off += sizeof(ElfW(Rela))) {
+        rebaseSite(((const ElfW(Rela) *) (mRela + off))->r_offset, srcBias);
+    }
+    size_t jmpEntry = mJmpRelIsRela ? sizeof(ElfW(Rela)) : sizeof(ElfW(Rel));
+    for (size_t off = 0; mJmpRel && off + jmpEntry <= mJmpRelSize; off += jmpEntry) {
+        rebaseSite(((const ElfW(Rel) *) (mJmpRel + off))->r_offset, srcBias);
+    }
+}
+
+void ScriptSOImage::rebaseSite(ElfW(Addr) offset, uintptr_t srcBias) {
+    for (size_t i = 0; i < mData.size(); i++) {
+        if (offset >= mData[i].first && offset < mData[i].second) {
+            ElfW(Addr) *where = (ElfW(Addr) *) (mNewBias + offset);
+            uintptr_t start = mOldStart - mOldBias;
+            uintptr_t end = mOldEnd - mOldBias;
+            if (*where >= start + srcBias && *where < end + srcBias) {
+                *where = *where - srcBias + mNewBias;
+            }
+            return;
+        }
+    }
+}
+
+bool ScriptSOImage::relocate(const ElfW(Dyn) *dyn) {
+    const uint8_t *rel = NULL, *rela = NULL, *jmprel = NULL;
+    size_t relSize = 0, relaSize = 0, jmprelSize = 0;
+    bool jmprelIsRela = false;
+
+    for (; dyn->d_tag != DT_NULL; dyn++) {
+        switch (dyn->d_tag) {
+        case DT_SYMTAB:
+            mSymTab = (const ElfW(Sym) *) (mNewBias + dyn->d_un.d_ptr);
+            break;
+        case DT_STRTAB:
+            mStrTab = (const char *) (mNewBias + dyn->d_un.d_ptr);
+            break;
+        case DT_REL:
+            rel = (const uint8_t *) (mNewBias + dyn->d_un.d_ptr);
+            break;
+        case DT_RELSZ:
+            relSize = dyn->d_un.d_val;
+            break;
+        case DT_RELA:
+            rela = (const uint8_t *) (mNewBias + dyn->d_un.d_ptr);
+            break;
+        case DT_RELASZ:
+            relaSize = dyn->d_un.d_val;
+            break;
+        case DT_JMPREL:
+            jmprel = (const uint8_t *) (mNewBias + dyn->d_un.d_ptr);
+            break;
+        case DT_PLTRELSZ:
+            jmprelSize = dyn->d_un.d_val;
+            break;
+        case DT_PLTREL:
+            jmprelIsRela = (dyn->d_un.d_val == DT_RELA);
+            break;
+        case DT_FLAGS:
+            if (dyn->d_un.d_val & DF_TEXTREL) {
+                return false;
+            }
+            break;
+        case DT_INIT_ARRAYSZ:
+        case DT_PREINIT_ARRAYSZ:
+            if (dyn->d_un.d_val != 0) {
+                return false;
+            }
+            break;
+        // Constructors would have to run again for this copy, and the
+        // remaining tags need the system loader.
+        case DT_INIT:
+        case DT_TEXTREL:
+        case RS_DT_ANDROID_REL:
+        case RS_DT_ANDROID_RELA:
+        case RS_DT_RELR:
+            return false;
+        default:
+            break;
+        }
+    }
+    if (mSymTab == NULL || mStrTab == NULL) {
+        return false;
+    }
+    mRel = rel;
+    mRelSize = relSize;
+    mRela = rela;
+    mRelaSize = relaSize;
+    mJmpRel = jmprel;
+    mJmpRelSize = jmprelSize;
+    mJmpRelIsRela = jmprelIsRela;
+
+    for (size_t off = 0; rel && off + sizeof(ElfW(Rel)) <= relSize;
+         off += sizeof(ElfW(Rel))) {
+        const ElfW(Rel) *r = (const ElfW(Rel) *) (rel + off);
+        if (!applyRelocation(RS_ELF_R_TYPE(r->r_info), RS_ELF_R_SYM(r->r_info),
+                             r->r_offset, 0, false)) {
+            return false;
+        }
+    }
+    for (size_t off = 0; rela && off + sizeof(ElfW(Rela)) <= relaSize;
+         off += sizeof(ElfW(Rela))) {
+        const ElfW(Rela) *r = (const ElfW(Rela) *) (rela + off);
+        if (!applyRelocation(RS_ELF_R_TYPE(r->r_info), RS_ELF_R_SYM(r->r_info),
+                             r->r_offset, r->r_addend, true)) {
+            return false;
+        }
+    }
+    size_t jmpEntry = jmprelIsRela ? sizeof(ElfW(Rela)) : sizeof(ElfW(Rel));
+    for (size_t off = 0; jmprel && off + jmpEntry <= jmprelSize; off += jmpEntry) {
+        const ElfW(Rel) *r = (const ElfW(Rel) *) (jmprel + off);
+        ElfW(Addr) addend = jmprelIsRela ? ((const ElfW(Rela) *) r)->r_addend : 0;
+        if (!applyRelocation(RS_ELF_R_TYPE(r->r_info), RS_ELF_R_SYM(r->r_info),
+                             r->r_offset, addend, jmprelIsRela)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ScriptSOImage::applyRelocation(uint32_t type, uint32_t sym, ElfW(Addr) offset,
+                                    ElfW(Addr) addend, bool hasAddend) {
+#ifdef RS_R_RELATIVE
+    ElfW(Addr) *where = (ElfW(Addr) *) (mNewBias + offset);
+    // REL entries keep the addend in place, and the target page still holds
+    // the file contents.
+    ElfW(Addr) a = hasAddend ? addend : *where;
+
+    switch (type) {
+    case RS_R_RELATIVE:
+        *where = mNewBias + a;
+        return true;
+
+    case RS_R_GLOB_DAT:
+    case RS_R_JUMP_SLOT: {
+        // The loader has already bound the original GOT, and scripts never
+        // write to it.
+        ElfW(Addr) bound = *(const ElfW(Addr) *) (mOldBias + offset);
+        *where = (ElfW(Addr)) translate((void *) bound);
+        return true;
+    }
+
+    case RS_R_ABS: {
+        // Pointers in script data may have been changed by the original
+        // instance, so resolve these from the symbol table rather than
+        // copying them.
+        if (sym == 0) {
+            *where = a;
+            return true;
+        }
+        const ElfW(Sym) *s = &mSymTab[sym];
+        if (s->st_shndx != SHN_UNDEF) {
+            *where = mNewBias + s->st_value + a;
+            return true;
+        }
+        void *import = dlsym(mHandle, mStrTab + s->st_name);
+        if (import == NULL && RS_ELF_ST_BIND(s->st_info) != STB_WEAK) {
+            return false;
+        }
+        *where = (ElfW(Addr)) import + a;
+        return true;
+    }
+
+    default:
+        return false;
+    }
+#else
+    return false;
+#endif
+}
+
+}
+}
+
+#endif
+
 namespace {
 #ifdef RS_COMPATIBILITY_LIB
 
@@ -79,20 +608,37 @@ static bool ensureCacheDirExists(const char *path) {
     return false;
 }
 
-// Attempt to load the shared library from origName, but then fall back to
-// creating the symlinked shared library if necessary (to ensure instancing).
+// Keep track of which .so libraries have been loaded. Once a library is
+// in the set (per-process granularity), later instances must not use the
+// original load directly. If we don't do this, we end up aliasing global
+// data between the various Script instances (which are supposed to be
+// completely independent). Scripts of the same name are created one at a
+// time, but the set itself is shared by all of them.
+static std::set<std::string> LoadedLibraries;
+static pthread_mutex_t gLoadedLibrariesMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static bool isLibraryLoaded(const char *name) {
+    pthread_mutex_lock(&gLoadedLibrariesMutex);
+    bool loaded = LoadedLibraries.find(name) != LoadedLibraries.end();
+    pthread_mutex_unlock(&gLoadedLibrariesMutex);
+    return loaded;
+}
+
+static void setLibraryLoaded(const char *name) {
+    pthread_mutex_lock(&gLoadedLibrariesMutex);
+    LoadedLibraries.insert(name);
+    pthread_mutex_unlock(&gLoadedLibrariesMutex);
+}
+
+// Attempt to load the shared library from origName. Repeat loads get a
+// private ScriptSOImage of the library in *image (to ensure instancing),
+// falling back to loading a symlink to it if the image can't be built.
 // This function returns the dlopen()-ed handle if successful.
 static void *loadSOHelper(const char *origName, const char *cacheDir,
-                          const char *resName) {
-    // Keep track of which .so libraries have been loaded. Once a library is
-    // in the set (per-process granularity), we must instead make a symlink to
-    // the original shared object (randomly named .so file) and load that one
-    // instead. If we don't do this, we end up aliasing global data between
-    // the various Script instances (which are supposed to be completely
-    // independent).
-    static std::set<std::string> LoadedLibraries;
-
+                          const char *resName,
+                          android::renderscript::ScriptSOImage **image) {
     void *loaded = NULL;
+    *image = NULL;
 
     // Skip everything if we don't even have the original library available.
     if (access(origName, F_OK) != 0) {
@@ -100,14 +646,26 @@ static void *loadSOHelper(const char *origName, const char *cacheDir,
     }
 
     // Common path is that we have not loaded this Script/library before.
-    if (LoadedLibraries.find(origName) == LoadedLibraries.end()) {
+    if (!isLibraryLoaded(origName)) {
         loaded = dlopen(origName, RTLD_NOW | RTLD_LOCAL);
         if (loaded) {
-            LoadedLibraries.insert(origName);
+            setLibraryLoaded(origName);
         }
         return loaded;
     }
 
+    // Reopening by the same name only takes another reference on the
+    // original load, which the private image relocates against.
+    loaded = dlopen(origName, RTLD_NOW | RTLD_LOCAL);
+    if (loaded) {
+        *image = android::renderscript::ScriptSOImage::create(loaded, origName);
+        if (*image) {
+            return loaded;
+        }
+        dlclose(loaded);
+        loaded = NULL;
+    }
+
     std::string newName(cacheDir);
     newName.append("/com.android.renderscript.cache/");
 
@@ -134,18 +692,20 @@ static void *loadSOHelper(const char *origName, const char *cacheDir,
         ALOGE("Could not unlink symlink %s", newName.c_str());
     }
     if (loaded) {
-        LoadedLibraries.insert(newName.c_str());
+        setLibraryLoaded(newName.c_str());
     }
 
     return loaded;
 }
 
 // Load the shared library referred to by cacheDir and resName. If we have
-// already loaded this library, we instead create a new symlink (in the
-// cache dir) and then load that. We then immediately destroy the symlink.
-// This is required behavior to implement script instancing for the support
-// library, since shared objects are loaded and de-duped by name only.
-static void *loadSharedLibrary(const char *cacheDir, const char *resName) {
+// already loaded this library, we instead map a private image of it (see
+// ScriptSOImage), or failing that create a new symlink (in the cache dir)
+// and load that. We then immediately destroy the symlink. This is required
+// behavior to implement script instancing for the support library, since
+// shared objects are loaded and de-duped by name only.
+static void *loadSharedLibrary(const char *cacheDir, const char *resName,
+                               android::renderscript::ScriptSOImage **image) {
     void *loaded = NULL;
     //arc4random_stir();
 #ifndef RS_SERVER
@@ -165,7 +725,7 @@ static void *loadSharedLibrary(const char *cacheDir, const char *resName) {
 
     // We should check if we can load the library from the standard app
     // location for shared libraries first.
-    loaded = loadSOHelper(scriptSOName.c_str(), cacheDir, resName);
+    loaded = loadSOHelper(scriptSOName.c_str(), cacheDir, resName, image);
 
     if (loaded == NULL) {
         ALOGE("Unable to open shared library (%s): %s",
@@ -180,7 +740,7 @@ static void *loadSharedLibrary(const char *cacheDir, const char *resName) {
         scriptSONameSystem.append(resName);
         scriptSONameSystem.append(".so");
         loaded = loadSOHelper(scriptSONameSystem.c_str(), cacheDir,
-                              resName);
+                              resName, image);
         if (loaded == NULL) {
             ALOGE("Unable to open system shared library (%s): %s",
                   scriptSONameSystem.c_str(), dlerror());
@@ -347,11 +907,15 @@ RsdCpuScriptImpl::RsdCpuScriptImpl(RsdCpuReferenceImpl *ctx, const Script *s) {
 
 #ifdef RS_COMPATIBILITY_LIB
     mScriptSO = NULL;
+    mScriptImage = NULL;
     mInvokeFunctions = NULL;
     mForEachFunctions = NULL;
     mFieldAddress = NULL;
     mFieldIsObject = NULL;
     mForEachSignatures = NULL;
+    mExportedVariableCount = 0;
+    mExportedFunctionCount = 0;
+    mExportedForEachCount = 0;
 #else
     mCompilerContext = NULL;
     mCompilerDriver = NULL;
@@ -377,7 +941,7 @@ bool RsdCpuScriptImpl::init(char const *resName, char const *cacheDir,
     //ALOGE("rsdScriptCreate %p %p %p %p %i %i %p", rsc, resName, cacheDir, bitcode, bitcodeSize, flags, lookupFunc);
     //ALOGE("rsdScriptInit %p %p", rsc, script);
 
-    mCtx->lockMutex();
+    mCtx->lockScriptCache(resName);
 #ifndef RS_COMPATIBILITY_LIB
     bool useRSDebugContext = false;
 
@@ -388,14 +952,14 @@ bool RsdCpuScriptImpl::init(char const *resName, char const *cacheDir,
     mCompilerContext = new bcc::BCCContext();
     if (mCompilerContext == NULL) {
         ALOGE("bcc: FAILS to create compiler context (out of memory)");
-        mCtx->unlockMutex();
+        mCtx->unlockScriptCache(resName);
         return false;
     }
 
     mCompilerDriver = new bcc::RSCompilerDriver();
     if (mCompilerDriver == NULL) {
         ALOGE("bcc: FAILS to create compiler driver (out of memory)");
-        mCtx->unlockMutex();
+        mCtx->unlockScriptCache(resName);
         return false;
     }
 
@@ -415,7 +979,7 @@ bool RsdCpuScriptImpl::init(char const *resName, char const *cacheDir,
     bcinfo::MetadataExtractor bitcodeMetadata((const char *) bitcode, bitcodeSize);
     if (!bitcodeMetadata.extract()) {
         ALOGE("Could not extract metadata from bitcode");
-        mCtx->unlockMutex();
+        mCtx->unlockScriptCache(resName);
         return false;
     }
 
@@ -438,11 +1002,17 @@ bool RsdCpuScriptImpl::init(char const *resName, char const *cacheDir,
     std::string compileCommandLine =
                 bcc::getCommandLine(compileArguments.size() - 1, compileArguments.data());
 
+    // Only the cache entry is guarded by lockScriptCache(). Loading and
+    // relocating an executable still takes the global lock: the linkloader
+    // keeps process-wide state, such as the MIPS GOT, that is updated
+    // without locking.
     if (!is_force_recompile()) {
         // Load the compiled script that's in the cache, if any.
+        mCtx->lockMutex();
         mExecutable = bcc::RSCompilerDriver::loadScript(cacheDir, resName, (const char*)bitcode,
                                                         bitcodeSize, compileCommandLine.c_str(),
                                                         mResolver);
+        mCtx->unlockMutex();
     }
 
     // If we can't, it's either not there or out of date.  We compile the bit code and try loading
@@ -451,15 +1021,17 @@ bool RsdCpuScriptImpl::init(char const *resName, char const *cacheDir,
         if (!compileBitcode(bcFileName, (const char*)bitcode, bitcodeSize, compileArguments.data(),
                             compileCommandLine)) {
             ALOGE("bcc: FAILS to compile '%s'", resName);
-            mCtx->unlockMutex();
+            mCtx->unlockScriptCache(resName);
             return false;
         }
+        mCtx->lockMutex();
         mExecutable = bcc::RSCompilerDriver::loadScript(cacheDir, resName, (const char*)bitcode,
                                                         bitcodeSize, compileCommandLine.c_str(),
                                                         mResolver);
+        mCtx->unlockMutex();
         if (mExecutable == NULL) {
             ALOGE("bcc: FAILS to load freshly compiled executable for '%s'", resName);
-            mCtx->unlockMutex();
+            mCtx->unlockScriptCache(resName);
             return false;
         }
     }
@@ -483,35 +1055,42 @@ bool RsdCpuScriptImpl::init(char const *resName, char const *cacheDir,
     }
 
     for (size_t i = 0; i < bitcodeMetadata.getExportForEachSignatureCount(); i++) {
-        char* name = new char[strlen(bitcodeMetadata.getExportForEachNameList()[i]) + 1];
+        const char *srcName = bitcodeMetadata.getExportForEachNameList()[i];
+        char* name = new char[strlen(srcName) + 1];
+        strcpy(name, srcName);
         mExportedForEachFuncList.push_back(
                     std::make_pair(name, bitcodeMetadata.getExportForEachSignatureList()[i]));
     }
 
 #else  // RS_COMPATIBILITY_LIB is defined
 
-    mScriptSO = loadSharedLibrary(cacheDir, resName);
+    mScriptSO = loadSharedLibrary(cacheDir, resName, &mScriptImage);
 
     if (mScriptSO) {
+        if (loadScriptIndex()) {
+            mCtx->unlockScriptCache(resName);
+            return true;
+        }
+
         char line[MAXLINE];
-        mRoot = (RootFunc_t) dlsym(mScriptSO, "root");
+        mRoot = (RootFunc_t) lookupSymbol("root");
         if (mRoot) {
             //ALOGE("Found root(): %p", mRoot);
         }
-        mRootExpand = (RootFunc_t) dlsym(mScriptSO, "root.expand");
+        mRootExpand = (RootFunc_t) lookupSymbol("root.expand");
         if (mRootExpand) {
             //ALOGE("Found root.expand(): %p", mRootExpand);
         }
-        mInit = (InvokeFunc_t) dlsym(mScriptSO, "init");
+        mInit = (InvokeFunc_t) lookupSymbol("init");
         if (mInit) {
             //ALOGE("Found init(): %p", mInit);
         }
-        mFreeChildren = (InvokeFunc_t) dlsym(mScriptSO, ".rs.dtor");
+        mFreeChildren = (InvokeFunc_t) lookupSymbol(".rs.dtor");
         if (mFreeChildren) {
             //ALOGE("Found .rs.dtor(): %p", mFreeChildren);
         }
 
-        const char *rsInfo = (const char *) dlsym(mScriptSO, ".rs.info");
+        const char *rsInfo = (const char *) lookupSymbol(".rs.info");
         if (rsInfo) {
             //ALOGE("Found .rs.info(): %p - %s", rsInfo, rsInfo);
         }
@@ -547,7 +1126,7 @@ bool RsdCpuScriptImpl::init(char const *resName, char const *cacheDir,
                 if (c) {
                     *c = '\0';
                 }
-                mFieldAddress[i] = dlsym(mScriptSO, line);
+                mFieldAddress[i] = lookupSymbol(line);
                 if (mFieldAddress[i] == NULL) {
                     ALOGE("Failed to find variable address for %s: %s",
                           line, dlerror());
@@ -586,7 +1165,7 @@ bool RsdCpuScriptImpl::init(char const *resName, char const *cacheDir,
                     *c = '\0';
                 }
 
-                mInvokeFunctions[i] = (InvokeFunc_t) dlsym(mScriptSO, line);
+                mInvokeFunctions[i] = (InvokeFunc_t) lookupSymbol(line);
                 if (mInvokeFunctions[i] == NULL) {
                     ALOGE("Failed to get function address for %s(): %s",
                           line, dlerror());
@@ -607,6 +1186,7 @@ bool RsdCpuScriptImpl::init(char const *resName, char const *cacheDir,
             goto error;
         }
 
+        mExportedForEachCount = forEachCount;
         if (forEachCount > 0) {
 
             mForEachSignatures = new uint32_t[forEachCount];
@@ -634,7 +1214,7 @@ bool RsdCpuScriptImpl::init(char const *resName, char const *cacheDir,
                 strncat(tmpName, ".expand", MAXLINE-1-strlen(tmpName));
                 mForEachSignatures[i] = tmpSig;
                 mForEachFunctions[i] =
-                        (ForEachFunc_t) dlsym(mScriptSO, tmpName);
+                        (ForEachFunc_t) lookupSymbol(tmpName);
                 if (i != 0 && mForEachFunctions[i] == NULL) {
                     // Ignore missing root.expand functions.
                     // root() is always specified at location 0.
@@ -687,21 +1267,132 @@ bool RsdCpuScriptImpl::init(char const *resName, char const *cacheDir,
         goto error;
     }
 #endif
-    mCtx->unlockMutex();
+    mCtx->unlockScriptCache(resName);
     return true;
 
 #ifdef RS_COMPATIBILITY_LIB
 error:
 
-    mCtx->unlockMutex();
+    mCtx->unlockScriptCache(resName);
     delete[] mInvokeFunctions;
     delete[] mForEachFunctions;
     delete[] mFieldAddress;
     delete[] mFieldIsObject;
     delete[] mForEachSignatures;
     delete[] mBoundAllocs;
+    delete mScriptImage;
+    mScriptImage = NULL;
     if (mScriptSO) {
         dlclose(mScriptSO);
+        mScriptSO = NULL;
+    }
+    return false;
+#endif
+}
+
+#ifdef RS_COMPATIBILITY_LIB
+// Moves an address in src's copy of the library to the same place in ours.
+static inline void * cloneAddress(const ScriptSOImage *srcImage,
+                                  const ScriptSOImage *image, void *addr) {
+    if (srcImage) {
+        addr = srcImage->original(addr);
+    }
+    return image->translate(addr);
+}
+
+template <typename T>
+static T * cloneArray(const T *src, size_t count) {
+    if (!src || count == 0) {
+        return NULL;
+    }
+    T *a = new T[count];
+    memcpy(a, src, count * sizeof(T));
+    return a;
+}
+#endif
+
+bool RsdCpuScriptImpl::initClone(const RsdCpuScriptImpl *src) {
+#ifndef RS_COMPATIBILITY_LIB
+    // The executable keeps no record of where its data ends, so there is
+    // nothing to copy the globals from.
+    ALOGE("Script cloning is not supported for compiled bitcode");
+    return false;
+#else
+    Dl_info info;
+    void *anchor = NULL;
+    ScriptSOImage *srcImage = src->mScriptImage;
+
+    if (src->mScriptSO) {
+        anchor = dlsym(src->mScriptSO, ".rs.info");
+    }
+    if (anchor == NULL || dladdr(anchor, &info) == 0 || info.dli_fname == NULL) {
+        ALOGE("Unable to locate the library of the script to clone");
+        goto error;
+    }
+
+    // Only takes another reference on the library src was set up from.
+    mScriptSO = dlopen(info.dli_fname, RTLD_NOW | RTLD_LOCAL);
+    if (mScriptSO != src->mScriptSO) {
+        ALOGE("Unable to reopen %s for cloning", info.dli_fname);
+        goto error;
+    }
+    mScriptImage = ScriptSOImage::create(mScriptSO, info.dli_fname);
+    if (mScriptImage == NULL) {
+        ALOGE("Unable to map a private copy of %s", info.dli_fname);
+        goto error;
+    }
+    mScriptImage->copyData(srcImage);
+
+    mRoot = (RootFunc_t) cloneAddress(srcImage, mScriptImage, (void *) src->mRoot);
+    mRootExpand = (RootFunc_t) cloneAddress(srcImage, mScriptImage,
+                                            (void *) src->mRootExpand);
+    mInit = (InvokeFunc_t) cloneAddress(srcImage, mScriptImage, (void *) src->mInit);
+    mFreeChildren = (InvokeFunc_t) cloneAddress(srcImage, mScriptImage,
+                                                (void *) src->mFreeChildren);
+
+    mExportedVariableCount = src->mExportedVariableCount;
+    mExportedFunctionCount = src->mExportedFunctionCount;
+    mExportedForEachCount = src->mExportedForEachCount;
+    mIsThreadable = src->mIsThreadable;
+
+    mFieldIsObject = cloneArray(src->mFieldIsObject, mExportedVariableCount);
+    mFieldAddress = cloneArray(src->mFieldAddress, mExportedVariableCount);
+    mInvokeFunctions = cloneArray(src->mInvokeFunctions, mExportedFunctionCount);
+    mForEachSignatures = cloneArray(src->mForEachSignatures, mExportedForEachCount);
+    mForEachFunctions = cloneArray(src->mForEachFunctions, mExportedForEachCount);
+
+    for (size_t i = 0; mFieldAddress && i < mExportedVariableCount; ++i) {
+        mFieldAddress[i] = cloneAddress(srcImage, mScriptImage, mFieldAddress[i]);
+        // The copied globals hold the same objects as src's.
+        if (mFieldIsObject[i] && mFieldAddress[i]) {
+            rs_object_base *obj = (rs_object_base *) mFieldAddress[i];
+            if (obj->p) {
+                obj->p->incSysRef();
+            }
+        }
+    }
+    for (size_t i = 0; mInvokeFunctions && i < mExportedFunctionCount; ++i) {
+        mInvokeFunctions[i] = (InvokeFunc_t) cloneAddress(
+                srcImage, mScriptImage, (void *) mInvokeFunctions[i]);
+    }
+    for (size_t i = 0; mForEachFunctions && i < mExportedForEachCount; ++i) {
+        mForEachFunctions[i] = (ForEachFunc_t) cloneAddress(
+                srcImage, mScriptImage, (void *) mForEachFunctions[i]);
+    }
+
+    if (mExportedVariableCount > 0) {
+        mBoundAllocs = new Allocation *[mExportedVariableCount];
+        memset(mBoundAllocs, 0, mExportedVariableCount * sizeof(*mBoundAllocs));
+    }
+
+    return true;
+
+error:
+    delete mScriptImage;
+    mScriptImage = NULL;
+    if (mScriptSO) {
+        dlclose(mScriptSO);
+        mScriptSO = NULL;
     }
     return false;
 #endif
@@ -757,7 +1448,10 @@ void RsdCpuScriptImpl::populateScript(Script *script) {
     // Copy info over to runtime
     script->mHal.info.exportedFunctionCount = mExecutable->getExportFuncAddrs().size();
     script->mHal.info.exportedVariableCount = mExecutable->getExportVarAddrs().size();
-    script->mHal.info.exportedForeachFuncList = &mExportedForEachFuncList[0];
+    script->mHal.info.exportedForeachCount = mExportedForEachFuncList.size();
+    if (!mExportedForEachFuncList.empty()) {
+        script->mHal.info.exportedForeachFuncList = &mExportedForEachFuncList[0];
+    }
     script->mHal.info.exportedPragmaCount = mExecutable->getPragmaKeys().size();
     script->mHal.info.exportedPragmaKeyList =
         const_cast<const char**>(mExecutable->getPragmaKeys().array());
@@ -1252,6 +1946,16 @@ void RsdCpuScriptImpl::setGlobalObj(uint32_t slot, ObjectBase *data) {
     rsrSetObject(mCtx->getContext(), (rs_object_base *)destPtr, data);
 }
 
+// The object slot list only describes exported globals, so it cannot rule
+// out handles kept in static globals or in the elements of an exported
+// array.  The compiler emits .rs.dtor for every script that has object
+// globals of any kind, so only a script without one is known to hold no
+// objects outside what the client bound or set.
+bool RsdCpuScriptImpl::getGlobalObj(uint32_t slot, ObjectBase **data) const {
+    *data = NULL;
+    return mFreeChildren == NULL;
+}
+
 RsdCpuScriptImpl::~RsdCpuScriptImpl() {
 #ifndef RS_COMPATIBILITY_LIB
     if (mExecutable) {
@@ -1316,12 +2020,114 @@ RsdCpuScriptImpl::~RsdCpuScriptImpl() {
     if (mFieldIsObject) delete[] mFieldIsObject;
     if (mForEachSignatures) delete[] mForEachSignatures;
     if (mBoundAllocs) delete[] mBoundAllocs;
+    delete mScriptImage;
     if (mScriptSO) {
         dlclose(mScriptSO);
     }
 #endif
 }
 
+#ifdef RS_COMPATIBILITY_LIB
+void * RsdCpuScriptImpl::lookupSymbol(const char *name) const {
+    void *sym = dlsym(mScriptSO, name);
+    if (sym && mScriptImage) {
+        return mScriptImage->translate(sym);
+    }
+    return sym;
+}
+
+// Resolves an offset from the binary index, 0 meaning absent.
+static inline void * indexTarget(const RsScriptIndexHeader *index, int32_t offset) {
+    if (offset == 0) {
+        return NULL;
+    }
+    return (void *)((const char *)index + offset);
+}
+
+bool RsdCpuScriptImpl::loadScriptIndex() {
+    const RsScriptIndexHeader *index =
+            (const RsScriptIndexHeader *) lookupSymbol(RS_SCRIPT_INDEX_SYMBOL);
+    if (!index) {
+        return false;
+    }
+
+    if (index->magic != RS_SCRIPT_INDEX_MAGIC ||
+        index->version != RS_SCRIPT_INDEX_VERSION ||
+        index->headerSize < sizeof(RsScriptIndexHeader) ||
+        (index->headerSize % sizeof(uint32_t)) != 0) {
+        ALOGW("Ignoring unsupported script index (version %u)", index->version);
+        return false;
+    }
+
+    size_t varCount = index->exportVarCount;
+    size_t funcCount = index->exportFuncCount;
+    size_t forEachCount = index->exportForEachCount;
+    uint64_t entryCount = (uint64_t)varCount + funcCount + forEachCount;
+    if (index->headerSize + entryCount * sizeof(RsScriptIndexEntry) > index->size) {
+        ALOGW("Ignoring truncated script index");
+        return false;
+    }
+
+    const RsScriptIndexEntry *vars = (const RsScriptIndexEntry *)
+            ((const char *)index + index->headerSize);
+    const RsScriptIndexEntry *funcs = vars + varCount;
+    const RsScriptIndexEntry *forEachs = funcs + funcCount;
+
+    // Check everything the text path treats as fatal before allocating, so
+    // that a bad index leaves nothing behind for the fallback.
+    for (size_t i = 0; i < funcCount; ++i) {
+        if (funcs[i].offset == 0) {
+            ALOGW("Script index is missing invokable %zu", i);
+            return false;
+        }
+    }
+    // root() is always at slot 0 and may lack an expanded form.
+    for (size_t i = 1; i < forEachCount; ++i) {
+        if (forEachs[i].offset == 0) {
+            ALOGW("Script index is missing forEach %zu", i);
+            return false;
+        }
+    }
+
+    mRoot = (RootFunc_t) indexTarget(index, index->rootOffset);
+    mRootExpand = (RootFunc_t) indexTarget(index, index->rootExpandOffset);
+    mInit = (InvokeFunc_t) indexTarget(index, index->initOffset);
+    mFreeChildren = (InvokeFunc_t) indexTarget(index, index->dtorOffset);
+
+    mExportedVariableCount = varCount;
+    if (varCount > 0) {
+        mFieldIsObject = new bool[varCount];
+        mFieldAddress = new void*[varCount];
+        for (size_t i = 0; i < varCount; ++i) {
+            mFieldAddress[i] = indexTarget(index, vars[i].offset);
+            mFieldIsObject[i] = (vars[i].info & RS_SCRIPT_INDEX_VAR_OBJECT) != 0;
+        }
+        mBoundAllocs = new Allocation *[varCount];
+        memset(mBoundAllocs, 0, varCount * sizeof(*mBoundAllocs));
+    }
+
+    mExportedFunctionCount = funcCount;
+    if (funcCount > 0) {
+        mInvokeFunctions = new InvokeFunc_t[funcCount];
+        for (size_t i = 0; i < funcCount; ++i) {
+            mInvokeFunctions[i] = (InvokeFunc_t) indexTarget(index, funcs[i].offset);
+        }
+    }
+
+    mExportedForEachCount = forEachCount;
+    if (forEachCount > 0) {
+        mForEachSignatures = new uint32_t[forEachCount];
+        mForEachFunctions = new ForEachFunc_t[forEachCount];
+        for (size_t i = 0; i < forEachCount; ++i) {
+            mForEachSignatures[i] = forEachs[i].info;
+            mForEachFunctions[i] = (ForEachFunc_t) indexTarget(index, forEachs[i].offset);
+        }
+    }
+
+    return true;
+}
+#endif
+
 Allocation * RsdCpuScriptImpl::getAllocationForPointer(const void *ptr) const {
     if (!ptr) {
         return NULL;
@@ -42,7 +42,9 @@ namespace bcinfo {
 namespace android {
 namespace renderscript {
 
-
+#ifdef RS_COMPATIBILITY_LIB
+class ScriptSOImage;
+#endif
 
 class RsdCpuScriptImpl : public RsdCpuReferenceImpl::CpuScript {
 public:
@@ -60,6 +62,9 @@ public:
     bool init(char const *resName, char const *cacheDir,
               uint8_t const *bitcode, size_t bitcodeSize, uint32_t flags,
               char const *bccPluginName = NULL);
+    // Sets this up as a copy of src, sharing its code and metadata but with
+    // a private copy of its globals. Bindings are not carried over.
+    bool initClone(const RsdCpuScriptImpl *src);
     virtual void populateScript(Script *);
 
     virtual void invokeFunction(uint32_t slot, const void *params, size_t paramLength);
@@ -93,6 +98,7 @@ public:
                                   const Element *e, const uint32_t *dims, size_t dimLength);
     virtual void setGlobalBind(uint32_t slot, Allocation *data);
     virtual void setGlobalObj(uint32_t slot, ObjectBase *data);
+    virtual bool getGlobalObj(uint32_t slot, ObjectBase **data) const;
 
 
     virtual ~RsdCpuScriptImpl();
@@ -111,7 +117,7 @@ public:
     virtual void forEachKernelSetup(uint32_t slot, MTLaunchStruct *mtls);
 
 
-    const RsdCpuReference::CpuSymbol * lookupSymbolMath(const char *sym);
+    static const RsdCpuReference::CpuSymbol * lookupSymbolMath(const char *sym);
     static void * lookupRuntimeStub(void* pContext, char const* name);
 
     virtual Allocation * getAllocationForPointer(const void *ptr) const;
@@ -142,7 +148,15 @@ protected:
     bcc::SymbolResolverProxy mResolver;
     bcc::RSExecutable *mExecutable;
 #else
+    // dlsym() on mScriptSO, resolved into this instance's copy.
+    void * lookupSymbol(const char *name) const;
+    // Reads the exports from the binary index, if the script carries a
+    // valid one (see rsCpuScriptIndex.h).
+    bool loadScriptIndex();
+
     void *mScriptSO;
+    // Private copy of mScriptSO for repeat instances, or NULL.
+    ScriptSOImage *mScriptImage;
     RootFunc_t mRoot;
     RootFunc_t mRootExpand;
     InvokeFunc_t mInit;
@@ -159,6 +173,7 @@ protected:
     //int mVersionMinor;
     size_t mExportedVariableCount;
     size_t mExportedFunctionCount;
+    size_t mExportedForEachCount;
 #endif
 
     Allocation **mBoundAllocs;
@@ -96,6 +96,14 @@ void CpuScriptGroupImpl::scriptGroupRoot(const RsForEachStubParamStruct *p,
             }
         }
 
+        // Kernels expect in / out to point at element xstart.
+        if (mp->in) {
+            mp->in += istep * xstart;
+        }
+        if (mp->out) {
+            mp->out += ostep * xstart;
+        }
+
         //ALOGE("kernel %i %p,%p  %p,%p", ct, mp->ptrIn, mp->in, mp->ptrOut, mp->out);
         func(p, xstart, xend, istep, ostep);
     }
@@ -144,6 +152,7 @@ void CpuScriptGroupImpl::execute() {
             for (size_t ct3=0; ct3 < n->mInputs.size(); ct3++) {
                 if (n->mInputs[ct3]->mDstKernel.get() == k) {
                     ain = n->mInputs[ct3]->mAlloc.get();
+                    inExt = mSG->mKeepLinkContents;
                     break;
                 }
             }
@@ -160,6 +169,7 @@ void CpuScriptGroupImpl::execute() {
             for (size_t ct3=0; ct3 < n->mOutputs.size(); ct3++) {
                 if (n->mOutputs[ct3]->mSource.get() == k) {
                     aout = n->mOutputs[ct3]->mAlloc.get();
+                    outExt = mSG->mKeepLinkContents;
                     if(n->mOutputs[ct3]->mDstField.get() != NULL) {
                         fieldDep = true;
                     }
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RSD_CPU_SCRIPT_INDEX_H
+#define RSD_CPU_SCRIPT_INDEX_H
+
+#include <stdint.h>
+
+/*
+ * Binary export table of a compatibility library script.
+ *
+ * The compiler may emit this next to the textual .rs.info, exported as
+ * RS_SCRIPT_INDEX_SYMBOL.  It holds the same information, but every export
+ * is given as an offset relative to the start of the table rather than by
+ * name, so the runtime reads it in place without parsing text or resolving
+ * each export with dlsym().  The offsets are link-time constants and need
+ * no dynamic relocations.
+ *
+ * Layout: an RsScriptIndexHeader, then at headerSize the RsScriptIndexEntry
+ * arrays for exported variables, invokable functions and forEach kernels,
+ * in that order.
+ */
+
+#define RS_SCRIPT_INDEX_SYMBOL ".rs.index"
+#define RS_SCRIPT_INDEX_MAGIC 0x58495352  /* "RSIX" */
+#define RS_SCRIPT_INDEX_VERSION 1
+
+/* Variable entry flags. */
+#define RS_SCRIPT_INDEX_VAR_OBJECT (1u << 0)
+
+typedef struct {
+    /* Offset of the export from the start of the table, 0 when absent. */
+    int32_t offset;
+    /* Variables: RS_SCRIPT_INDEX_VAR_* flags.  forEach kernels: the
+     * signature.  Invokables: 0. */
+    uint32_t info;
+} RsScriptIndexEntry;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t headerSize;
+    /* Size of the whole table, entries included. */
+    uint32_t size;
+    uint32_t exportVarCount;
+    uint32_t exportFuncCount;
+    /* forEach entries point at the expanded (".expand") kernels. */
+    uint32_t exportForEachCount;
+    int32_t rootOffset;
+    int32_t rootExpandOffset;
+    int32_t initOffset;
+    int32_t dtorOffset;
+} RsScriptIndexHeader;
+
+#endif  // RSD_CPU_SCRIPT_INDEX_H
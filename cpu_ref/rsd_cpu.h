@@ -93,6 +93,10 @@ public:
                                       const Element *e, const uint32_t *dims, size_t dimLength) = 0;
         virtual void setGlobalBind(uint32_t slot, Allocation *data) = 0;
         virtual void setGlobalObj(uint32_t slot, ObjectBase *obj) = 0;
+        // Reads the object the script currently holds in an exported global.
+        // Returns false if the script may hold objects anywhere other than
+        // single-handle exported globals.
+        virtual bool getGlobalObj(uint32_t slot, ObjectBase **obj) const = 0;
 
         virtual Allocation * getAllocationForPointer(const void *ptr) const = 0;
         virtual ~CpuScript() {}
@@ -130,9 +134,25 @@ public:
                                      uint8_t const *bitcode, size_t bitcodeSize,
                                      uint32_t flags) = 0;
     virtual CpuScript * createIntrinsic(const Script *s, RsScriptIntrinsicID iid, Element *e) = 0;
+    // Returns a new instance of src's script for s, sharing its code but
+    // with a copy of its globals, or NULL if that isn't possible.
+    virtual CpuScript * cloneScript(const ScriptC *s, const CpuScript *src) = 0;
     virtual CpuScriptGroup * createScriptGroup(const ScriptGroup *sg) = 0;
     virtual bool getInForEach() = 0;
 
+    // Runs cbk on the calling thread and on every worker thread, passing each
+    // a distinct idx in [0, getThreadCount()).  When called while a launch is
+    // already in flight, or with no worker threads, cbk only runs once on the
+    // calling thread, so callbacks must keep pulling work until none is left.
+    // Each call runs with a private copy of the caller's script TLS.
+    virtual void launchWorkers(void (*cbk)(void *usr, uint32_t idx), void *data) = 0;
+    virtual uint32_t getThreadCount() const = 0;
+
+    // Called on an extra command queue thread before it replays commands and
+    // after it stops.  Launches made from such a thread run on it alone.
+    virtual void attachQueueThread() = 0;
+    virtual void detachQueueThread() = 0;
+
 #ifndef RS_COMPATIBILITY_LIB
     virtual void setSetupCompilerCallback(
             RSSetupCompilerCallback pSetupCompilerCallback) = 0;
@@ -44,6 +44,16 @@
 #include <malloc.h>
 #endif
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
 using namespace android;
 using namespace android::renderscript;
 
@@ -101,6 +111,49 @@ uint8_t *GetOffsetPtr(const android::renderscript::Allocation *alloc,
 }
 
 
+/*
+ * Larger allocations are backed by their own anonymous mapping rather than
+ * the heap so rsdAllocationClone can later swap the pages underneath them
+ * for a private (copy-on-write) mapping of a memfd without moving them.
+ */
+static const size_t kMappedMinBytes = 64 * 1024;
+
+static uint8_t* allocAlignedMemory(DrvAllocation *drv, size_t allocSize, bool forceZero) {
+    if (allocSize >= kMappedMinBytes) {
+        size_t mapSize = rsRound(allocSize, (size_t)getpagesize());
+        void *ptr = mmap(NULL, mapSize, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr != MAP_FAILED) {
+            // Anonymous mappings are already zero filled.
+            drv->mapSize = mapSize;
+            return (uint8_t *)ptr;
+        }
+    }
+
+    // We align all allocations to a 16-byte boundary.
+    uint8_t* ptr = (uint8_t *)memalign(16, allocSize);
+    if (!ptr) {
+        return NULL;
+    }
+    if (forceZero) {
+        memset(ptr, 0, allocSize);
+    }
+    return ptr;
+}
+
+static void freeAlignedMemory(DrvAllocation *drv, void *ptr) {
+    if (drv->mapSize) {
+        munmap(ptr, drv->mapSize);
+        drv->mapSize = 0;
+    } else {
+        free(ptr);
+    }
+    if (drv->cowFd >= 0) {
+        close(drv->cowFd);
+        drv->cowFd = -1;
+    }
+}
+
 static void Update2DTexture(const Context *rsc, const Allocation *alloc, const void *ptr,
                             uint32_t xoff, uint32_t yoff, uint32_t lod,
                             RsAllocationCubemapFace face, uint32_t w, uint32_t h) {
@@ -192,8 +245,10 @@ static void UploadToTexture(const Context *rsc, const Allocation *alloc) {
 
     if (!(alloc->mHal.state.usageFlags & RS_ALLOCATION_USAGE_SCRIPT)) {
         if (alloc->mHal.drvState.lod[0].mallocPtr) {
-            free(alloc->mHal.drvState.lod[0].mallocPtr);
+            freeAlignedMemory(drv, alloc->mHal.drvState.lod[0].mallocPtr);
             alloc->mHal.drvState.lod[0].mallocPtr = NULL;
+            rsc->mStats.add(ContextStats::ALLOCATION_BYTES_REMOVED, drv->storageSize);
+            drv->storageSize = 0;
         }
     }
     rsdGLCheckError(rsc, "UploadToTexture");
@@ -356,24 +411,13 @@ static size_t AllocationBuildPointerTable(const Context *rsc, const Allocation *
     return allocSize;
 }
 
-static uint8_t* allocAlignedMemory(size_t allocSize, bool forceZero) {
-    // We align all allocations to a 16-byte boundary.
-    uint8_t* ptr = (uint8_t *)memalign(16, allocSize);
-    if (!ptr) {
-        return NULL;
-    }
-    if (forceZero) {
-        memset(ptr, 0, allocSize);
-    }
-    return ptr;
-}
-
 bool rsdAllocationInit(const Context *rsc, Allocation *alloc, bool forceZero) {
     DrvAllocation *drv = (DrvAllocation *)calloc(1, sizeof(DrvAllocation));
     if (!drv) {
         return false;
     }
     alloc->mHal.drv = drv;
+    drv->cowFd = -1;
 
     // Calculate the object size.
     size_t allocSize = AllocationBuildPointerTable(rsc, alloc, alloc->getType(), NULL);
@@ -403,24 +447,26 @@ bool rsdAllocationInit(const Context *rsc, Allocation *alloc, bool forceZero) {
             ALOGV("User-backed allocation failed stride requirement, falling back to separate allocation");
             drv->useUserProvidedPtr = false;
 
-            ptr = allocAlignedMemory(allocSize, forceZero);
+            ptr = allocAlignedMemory(drv, allocSize, forceZero);
             if (!ptr) {
                 alloc->mHal.drv = NULL;
                 free(drv);
                 return false;
             }
+            drv->storageSize = allocSize;
 
         } else {
             drv->useUserProvidedPtr = true;
             ptr = (uint8_t*)alloc->mHal.state.userProvidedPtr;
         }
     } else {
-        ptr = allocAlignedMemory(allocSize, forceZero);
+        ptr = allocAlignedMemory(drv, allocSize, forceZero);
         if (!ptr) {
             alloc->mHal.drv = NULL;
             free(drv);
             return false;
         }
+        drv->storageSize = allocSize;
     }
     // Build the pointer tables
     size_t verifySize = AllocationBuildPointerTable(rsc, alloc, alloc->getType(), ptr);
@@ -469,7 +515,8 @@ bool rsdAllocationInit(const Context *rsc, Allocation *alloc, bool forceZero) {
     ALOGE("pointer for allocation.drv: %p", &alloc->mHal.drv);
 #endif
 
-
+    rsc->mStats.add(ContextStats::ALLOCATIONS_CREATED, 1);
+    rsc->mStats.add(ContextStats::ALLOCATION_BYTES_ADDED, drv->storageSize);
     return true;
 }
 
@@ -498,7 +545,7 @@ void rsdAllocationDestroy(const Context *rsc, Allocation *alloc) {
         if (!(drv->useUserProvidedPtr) &&
             !(alloc->mHal.state.usageFlags & RS_ALLOCATION_USAGE_IO_INPUT) &&
             !(alloc->mHal.state.usageFlags & RS_ALLOCATION_USAGE_IO_OUTPUT)) {
-                free(alloc->mHal.drvState.lod[0].mallocPtr);
+                freeAlignedMemory(drv, alloc->mHal.drvState.lod[0].mallocPtr);
         }
         alloc->mHal.drvState.lod[0].mallocPtr = NULL;
     }
@@ -526,6 +573,8 @@ void rsdAllocationDestroy(const Context *rsc, Allocation *alloc) {
     }
 #endif
 
+    rsc->mStats.add(ContextStats::ALLOCATIONS_DESTROYED, 1);
+    rsc->mStats.add(ContextStats::ALLOCATION_BYTES_REMOVED, drv->storageSize);
     free(drv);
     alloc->mHal.drv = NULL;
 }
@@ -542,13 +591,32 @@ void rsdAllocationResize(const Context *rsc, const Allocation *alloc,
     }
     void * oldPtr = alloc->mHal.drvState.lod[0].mallocPtr;
     // Calculate the object size
+    size_t oldSize = AllocationBuildPointerTable(rsc, alloc, alloc->getType(), NULL);
     size_t s = AllocationBuildPointerTable(rsc, alloc, newType, NULL);
-    uint8_t *ptr = (uint8_t *)realloc(oldPtr, s);
+    uint8_t *ptr;
+    DrvAllocation *drv = (DrvAllocation *)alloc->mHal.drv;
+    if (drv->mapSize) {
+        // Mapped storage may be a private file mapping that can't grow, so
+        // move the contents to fresh memory instead.
+        DrvAllocation tmp = *drv;
+        drv->mapSize = 0;
+        drv->cowFd = -1;
+        ptr = allocAlignedMemory(drv, s, false);
+        if (ptr) {
+            memcpy(ptr, oldPtr, rsMin(oldSize, s));
+        }
+        freeAlignedMemory(&tmp, oldPtr);
+    } else {
+        ptr = (uint8_t *)realloc(oldPtr, s);
+    }
     // Build the relative pointer tables.
     size_t verifySize = AllocationBuildPointerTable(rsc, alloc, newType, ptr);
     if(s != verifySize) {
         rsAssert(!"Size mismatch");
     }
+    rsc->mStats.add(ContextStats::ALLOCATION_BYTES_REMOVED, drv->storageSize);
+    rsc->mStats.add(ContextStats::ALLOCATION_BYTES_ADDED, s);
+    drv->storageSize = s;
 
 
     if (dimX > oldDimX) {
@@ -792,6 +860,149 @@ void rsdAllocationIoReceive(const Context *rsc, Allocation *alloc) {
 }
 
 
+/*
+ * Bulk copy engine shared by the Data/Read/copy-range entry points.  A copy
+ * is described as planes of rows; layouts where rows (and planes) are packed
+ * back to back collapse into a single run of bytes.  Small copies are a plain
+ * memcpy on the calling thread, large ones are cut into slices that the CPU
+ * worker pool pulls from, and copies much larger than the caches use
+ * streaming stores so the destination does not evict the working set.
+ */
+static const size_t kCopyParallelBytes = 256 * 1024;
+static const size_t kCopyStreamBytes = 4 * 1024 * 1024;
+static const size_t kCopySliceBytes = 64 * 1024;
+
+typedef struct {
+    uint8_t *dst;
+    const uint8_t *src;
+    size_t dstStride;
+    size_t srcStride;
+    size_t dstPlaneStride;
+    size_t srcPlaneStride;
+    size_t lineSize;
+    uint32_t h;
+    uint32_t rows;
+
+    bool stream;
+    uint32_t sliceRows;
+    volatile int sliceNum;
+} RsdCopyJob;
+
+static void CopyLine(uint8_t *dst, const uint8_t *src, size_t size, bool stream) {
+#if defined(__SSE2__)
+    if (stream && size >= 128) {
+        size_t head = (16 - ((uintptr_t)dst & 15)) & 15;
+        memcpy(dst, src, head);
+        dst += head;
+        src += head;
+        size -= head;
+        while (size >= 64) {
+            __m128i a = _mm_loadu_si128((const __m128i *)src);
+            __m128i b = _mm_loadu_si128((const __m128i *)(src + 16));
+            __m128i c = _mm_loadu_si128((const __m128i *)(src + 32));
+            __m128i d = _mm_loadu_si128((const __m128i *)(src + 48));
+            _mm_stream_si128((__m128i *)dst, a);
+            _mm_stream_si128((__m128i *)(dst + 16), b);
+            _mm_stream_si128((__m128i *)(dst + 32), c);
+            _mm_stream_si128((__m128i *)(dst + 48), d);
+            dst += 64;
+            src += 64;
+            size -= 64;
+        }
+    }
+#endif
+    memcpy(dst, src, size);
+}
+
+static void CopyRows(const RsdCopyJob *job, uint32_t r1, uint32_t r2) {
+    while (r1 < r2) {
+        uint32_t z = r1 / job->h;
+        uint32_t y = r1 - z * job->h;
+        uint32_t end = rsMin(r2, (z + 1) * job->h);
+        uint8_t *dst = job->dst + z * job->dstPlaneStride + y * job->dstStride;
+        const uint8_t *src = job->src + z * job->srcPlaneStride + y * job->srcStride;
+        for (; r1 < end; r1++) {
+            CopyLine(dst, src, job->lineSize, job->stream);
+            dst += job->dstStride;
+            src += job->srcStride;
+        }
+    }
+#if defined(__SSE2__)
+    if (job->stream) {
+        _mm_sfence();
+    }
+#endif
+}
+
+static void CopyWorker(void *usr, uint32_t idx) {
+    RsdCopyJob *job = (RsdCopyJob *)usr;
+    while (1) {
+        uint32_t slice = (uint32_t)__sync_fetch_and_add(&job->sliceNum, 1);
+        uint32_t r1 = slice * job->sliceRows;
+        if (r1 >= job->rows) {
+            return;
+        }
+        CopyRows(job, r1, rsMin(r1 + job->sliceRows, job->rows));
+    }
+}
+
+static void CopyPlanes(const Context *rsc, uint8_t *dst, size_t dstStride, size_t dstPlaneStride,
+                       const uint8_t *src, size_t srcStride, size_t srcPlaneStride,
+                       size_t lineSize, uint32_t h, uint32_t d) {
+    if (!lineSize || !h || !d) {
+        return;
+    }
+
+    RsdCopyJob job;
+    memset(&job, 0, sizeof(job));
+    job.dst = dst;
+    job.src = src;
+    job.dstStride = dstStride;
+    job.srcStride = srcStride;
+    job.dstPlaneStride = dstPlaneStride;
+    job.srcPlaneStride = srcPlaneStride;
+    job.lineSize = lineSize;
+    job.h = h;
+    job.rows = h * d;
+
+    // Planes that follow each other directly are just more rows.
+    if ((d == 1) || ((srcPlaneStride == srcStride * h) && (dstPlaneStride == dstStride * h))) {
+        job.h = job.rows;
+    }
+
+    const size_t total = lineSize * job.rows;
+    if ((job.h == job.rows) && (srcStride == lineSize) && (dstStride == lineSize)) {
+        if (total < kCopyParallelBytes) {
+            memcpy(dst, src, total);
+            return;
+        }
+        // Re-cut the packed run into fixed size rows so it can be sliced; the
+        // remainder goes on the calling thread first.
+        size_t tail = total % kCopySliceBytes;
+        memcpy(dst + total - tail, src + total - tail, tail);
+        job.lineSize = kCopySliceBytes;
+        job.dstStride = kCopySliceBytes;
+        job.srcStride = kCopySliceBytes;
+        job.rows = total / kCopySliceBytes;
+        job.h = job.rows;
+    }
+
+    job.stream = total >= kCopyStreamBytes;
+    job.sliceRows = rsMax((uint32_t)(kCopySliceBytes / job.lineSize), 1u);
+
+    RsdHal *dc = (RsdHal *)rsc->mHal.drv;
+    if ((total < kCopyParallelBytes) || !dc || !dc->mCpuRef ||
+        (dc->mCpuRef->getThreadCount() <= 1)) {
+        CopyRows(&job, 0, job.rows);
+        return;
+    }
+    dc->mCpuRef->launchWorkers(&CopyWorker, &job);
+}
+
+static size_t PlaneStride(const Allocation *alloc, uint32_t lod) {
+    return alloc->mHal.drvState.lod[lod].dimY * alloc->mHal.drvState.lod[lod].stride;
+}
+
 void rsdAllocationData1D(const Context *rsc, const Allocation *alloc,
                          uint32_t xoff, uint32_t lod, size_t count,
                          const void *data, size_t sizeBytes) {
@@ -833,15 +1044,15 @@ void rsdAllocationData2D(const Context *rsc, const Allocation *alloc,
             return;
         }
 
-        for (uint32_t line=yoff; line < (yoff+h); line++) {
-            if (alloc->mHal.state.hasReferences) {
-                alloc->incRefs(src, w);
-                alloc->decRefs(dst, w);
+        if (alloc->mHal.state.hasReferences) {
+            for (uint32_t line = 0; line < h; line++) {
+                alloc->incRefs(src + line * stride, w);
+                alloc->decRefs(dst + line * alloc->mHal.drvState.lod[lod].stride, w);
             }
-            memcpy(dst, src, lineSize);
-            src += stride;
-            dst += alloc->mHal.drvState.lod[lod].stride;
         }
+        CopyPlanes(rsc, dst, alloc->mHal.drvState.lod[lod].stride, 0,
+                   src, stride, 0, lineSize, h, 1);
+        src += stride * h;
         if (alloc->mHal.state.yuv) {
             size_t clineSize = lineSize;
             int lod = 1;
@@ -887,26 +1098,27 @@ void rsdAllocationData3D(const Context *rsc, const Allocation *alloc,
 
     if (alloc->mHal.drvState.lod[0].mallocPtr) {
         const uint8_t *src = static_cast<const uint8_t *>(data);
-        for (uint32_t z = zoff; z < d; z++) {
-            uint8_t *dst = GetOffsetPtr(alloc, xoff, yoff, z, lod,
-                                        RS_ALLOCATION_CUBEMAP_FACE_POSITIVE_X);
-            if (dst == src) {
-                // Skip the copy if we are the same allocation. This can arise from
-                // our Bitmap optimization, where we share the same storage.
-                drv->uploadDeferred = true;
-                return;
-            }
+        uint8_t *dst = GetOffsetPtr(alloc, xoff, yoff, zoff, lod,
+                                    RS_ALLOCATION_CUBEMAP_FACE_POSITIVE_X);
+        if (dst == src) {
+            // Skip the copy if we are the same allocation. This can arise from
+            // our Bitmap optimization, where we share the same storage.
+            drv->uploadDeferred = true;
+            return;
+        }
 
-            for (uint32_t line=yoff; line < (yoff+h); line++) {
-                if (alloc->mHal.state.hasReferences) {
-                    alloc->incRefs(src, w);
-                    alloc->decRefs(dst, w);
+        const size_t dstStride = alloc->mHal.drvState.lod[lod].stride;
+        const size_t dstPlaneStride = PlaneStride(alloc, lod);
+        if (alloc->mHal.state.hasReferences) {
+            for (uint32_t z = 0; z < d; z++) {
+                for (uint32_t line = 0; line < h; line++) {
+                    alloc->incRefs(src + (z * h + line) * stride, w);
+                    alloc->decRefs(dst + z * dstPlaneStride + line * dstStride, w);
                 }
-                memcpy(dst, src, lineSize);
-                src += stride;
-                dst += alloc->mHal.drvState.lod[lod].stride;
             }
         }
+        CopyPlanes(rsc, dst, dstStride, dstPlaneStride,
+                   src, stride, stride * h, lineSize, h, d);
         drv->uploadDeferred = true;
     }
 }
@@ -941,11 +1153,8 @@ void rsdAllocationRead2D(const Context *rsc, const Allocation *alloc,
             return;
         }
 
-        for (uint32_t line=yoff; line < (yoff+h); line++) {
-            memcpy(dst, src, lineSize);
-            dst += stride;
-            src += alloc->mHal.drvState.lod[lod].stride;
-        }
+        CopyPlanes(rsc, dst, stride, 0,
+                   src, alloc->mHal.drvState.lod[lod].stride, 0, lineSize, h, 1);
     } else {
         ALOGE("Add code to readback from non-script memory");
     }
@@ -964,21 +1173,17 @@ void rsdAllocationRead3D(const Context *rsc, const Allocation *alloc,
 
     if (alloc->mHal.drvState.lod[0].mallocPtr) {
         uint8_t *dst = static_cast<uint8_t *>(data);
-        for (uint32_t z = zoff; z < d; z++) {
-            const uint8_t *src = GetOffsetPtr(alloc, xoff, yoff, z, lod,
-                                              RS_ALLOCATION_CUBEMAP_FACE_POSITIVE_X);
-            if (dst == src) {
-                // Skip the copy if we are the same allocation. This can arise from
-                // our Bitmap optimization, where we share the same storage.
-                return;
-            }
-
-            for (uint32_t line=yoff; line < (yoff+h); line++) {
-                memcpy(dst, src, lineSize);
-                dst += stride;
-                src += alloc->mHal.drvState.lod[lod].stride;
-            }
+        const uint8_t *src = GetOffsetPtr(alloc, xoff, yoff, zoff, lod,
+                                          RS_ALLOCATION_CUBEMAP_FACE_POSITIVE_X);
+        if (dst == src) {
+            // Skip the copy if we are the same allocation. This can arise from
+            // our Bitmap optimization, where we share the same storage.
+            return;
         }
+
+        CopyPlanes(rsc, dst, stride, stride * h,
+                   src, alloc->mHal.drvState.lod[lod].stride, PlaneStride(alloc, lod),
+                   lineSize, h, d);
     }
 }
 
@@ -1008,14 +1213,11 @@ void rsdAllocationData2D_alloc_script(const android::renderscript::Context *rsc,
                                       uint32_t srcXoff, uint32_t srcYoff, uint32_t srcLod,
                                       RsAllocationCubemapFace srcFace) {
     size_t elementSize = dstAlloc->getType()->getElementSizeBytes();
-    for (uint32_t i = 0; i < h; i ++) {
-        uint8_t *dstPtr = GetOffsetPtr(dstAlloc, dstXoff, dstYoff + i, 0, dstLod, dstFace);
-        uint8_t *srcPtr = GetOffsetPtr(srcAlloc, srcXoff, srcYoff + i, 0, srcLod, srcFace);
-        memcpy(dstPtr, srcPtr, w * elementSize);
-
-        //ALOGE("COPIED dstXoff(%u), dstYoff(%u), dstLod(%u), dstFace(%u), w(%u), h(%u), srcXoff(%u), srcYoff(%u), srcLod(%u), srcFace(%u)",
-        //     dstXoff, dstYoff, dstLod, dstFace, w, h, srcXoff, srcYoff, srcLod, srcFace);
-    }
+    uint8_t *dstPtr = GetOffsetPtr(dstAlloc, dstXoff, dstYoff, 0, dstLod, dstFace);
+    uint8_t *srcPtr = GetOffsetPtr(srcAlloc, srcXoff, srcYoff, 0, srcLod, srcFace);
+    CopyPlanes(rsc, dstPtr, dstAlloc->mHal.drvState.lod[dstLod].stride, 0,
+               srcPtr, srcAlloc->mHal.drvState.lod[srcLod].stride, 0,
+               w * elementSize, h, 1);
 }
 
 void rsdAllocationData3D_alloc_script(const android::renderscript::Context *rsc,
@@ -1025,18 +1227,15 @@ void rsdAllocationData3D_alloc_script(const android::renderscript::Context *rsc,
                                       const android::renderscript::Allocation *srcAlloc,
                                       uint32_t srcXoff, uint32_t srcYoff, uint32_t srcZoff, uint32_t srcLod) {
     uint32_t elementSize = dstAlloc->getType()->getElementSizeBytes();
-    for (uint32_t j = 0; j < d; j++) {
-        for (uint32_t i = 0; i < h; i ++) {
-            uint8_t *dstPtr = GetOffsetPtr(dstAlloc, dstXoff, dstYoff + i, dstZoff + j,
-                                           dstLod, RS_ALLOCATION_CUBEMAP_FACE_POSITIVE_X);
-            uint8_t *srcPtr = GetOffsetPtr(srcAlloc, srcXoff, srcYoff + i, srcZoff + j,
-                                           srcLod, RS_ALLOCATION_CUBEMAP_FACE_POSITIVE_X);
-            memcpy(dstPtr, srcPtr, w * elementSize);
-
-            //ALOGE("COPIED dstXoff(%u), dstYoff(%u), dstLod(%u), dstFace(%u), w(%u), h(%u), srcXoff(%u), srcYoff(%u), srcLod(%u), srcFace(%u)",
-            //     dstXoff, dstYoff, dstLod, dstFace, w, h, srcXoff, srcYoff, srcLod, srcFace);
-        }
-    }
+    uint8_t *dstPtr = GetOffsetPtr(dstAlloc, dstXoff, dstYoff, dstZoff,
+                                   dstLod, RS_ALLOCATION_CUBEMAP_FACE_POSITIVE_X);
+    uint8_t *srcPtr = GetOffsetPtr(srcAlloc, srcXoff, srcYoff, srcZoff,
+                                   srcLod, RS_ALLOCATION_CUBEMAP_FACE_POSITIVE_X);
+    CopyPlanes(rsc, dstPtr, dstAlloc->mHal.drvState.lod[dstLod].stride,
+               PlaneStride(dstAlloc, dstLod),
+               srcPtr, srcAlloc->mHal.drvState.lod[srcLod].stride,
+               PlaneStride(srcAlloc, srcLod),
+               w * elementSize, h, d);
 }
 
 void rsdAllocationData2D_alloc(const android::renderscript::Context *rsc,
@@ -1074,6 +1273,150 @@ void rsdAllocationData3D_alloc(const android::renderscript::Context *rsc,
                                      srcXoff, srcYoff, srcZoff, srcLod);
 }
 
+/*
+ * Copy-on-write cloning.  The first clone of a mapped allocation writes its
+ * contents into a memfd once and replaces the source pages, in place, with a
+ * private mapping of that file; the clone gets another private mapping of
+ * the same file.  The file is never written again, so every writer (driver
+ * copies and kernels alike) faults in its own page copies and the others
+ * keep seeing the snapshot.  Cloning a source that already has a file only
+ * needs the pages the source has written since: /proc/self/pagemap reports
+ * those as anonymous, and only they are copied into the clone.
+ */
+static int CowCreateFd(size_t size) {
+#if defined(__NR_memfd_create)
+    int fd = syscall(__NR_memfd_create, "rs-allocation", 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (ftruncate(fd, size)) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+#else
+    return -1;
+#endif
+}
+
+// Maps fd privately and moves the mapping over [ptr, ptr + size) in one step,
+// so the old pages are only dropped once the new ones are in place.
+static bool CowMapOver(int fd, void *ptr, size_t size) {
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+    if (mremap(p, size, size, MREMAP_MAYMOVE | MREMAP_FIXED, ptr) == MAP_FAILED) {
+        munmap(p, size);
+        return false;
+    }
+    return true;
+}
+
+static bool CowWriteAll(int fd, const uint8_t *ptr, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        ssize_t r = pwrite(fd, ptr + done, size - done, done);
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            return false;
+        }
+        done += r;
+    }
+    return true;
+}
+
+// Copies the pages of src that no longer come from its file into dst.
+static void CowCopyDirtyPages(const uint8_t *src, uint8_t *dst, size_t size) {
+    const size_t page = getpagesize();
+    const size_t pages = size / page;
+    int fd = open("/proc/self/pagemap", O_RDONLY);
+    if (fd < 0) {
+        memcpy(dst, src, size);
+        return;
+    }
+
+    uint64_t entries[512];
+    for (size_t p = 0; p < pages; ) {
+        size_t n = rsMin(pages - p, (size_t)512);
+        off_t off = (off_t)(((uintptr_t)src / page + p) * sizeof(uint64_t));
+        if (pread(fd, entries, n * sizeof(uint64_t), off) != (ssize_t)(n * sizeof(uint64_t))) {
+            memcpy(dst + p * page, src + p * page, size - p * page);
+            break;
+        }
+        for (size_t i = 0; i < n; i++) {
+            const uint64_t e = entries[i];
+            const bool present = e & (1ULL << 63);
+            const bool swapped = e & (1ULL << 62);
+            const bool file = e & (1ULL << 61);
+            if (swapped || (present && !file)) {
+                memcpy(dst + (p + i) * page, src + (p + i) * page, page);
+            }
+        }
+        p += n;
+    }
+    close(fd);
+}
+
+static bool CowShare(DrvAllocation *srcDrv, uint8_t *srcPtr,
+                     DrvAllocation *dstDrv, uint8_t *dstPtr, size_t size) {
+    if (!srcDrv->mapSize || (srcDrv->mapSize != dstDrv->mapSize)) {
+        return false;
+    }
+
+    bool fresh = false;
+    if (srcDrv->cowFd < 0) {
+        int fd = CowCreateFd(size);
+        if (fd < 0) {
+            return false;
+        }
+        if (!CowWriteAll(fd, srcPtr, size) || !CowMapOver(fd, srcPtr, size)) {
+            close(fd);
+            return false;
+        }
+        srcDrv->cowFd = fd;
+        fresh = true;
+    }
+
+    int fd = dup(srcDrv->cowFd);
+    if (fd < 0) {
+        return false;
+    }
+    if (!CowMapOver(fd, dstPtr, size)) {
+        close(fd);
+        return false;
+    }
+    if (!fresh) {
+        CowCopyDirtyPages(srcPtr, dstPtr, size);
+    }
+    if (dstDrv->cowFd >= 0) {
+        close(dstDrv->cowFd);
+    }
+    dstDrv->cowFd = fd;
+    return true;
+}
+
+void rsdAllocationClone(const Context *rsc, const Allocation *dstAlloc,
+                        const Allocation *srcAlloc) {
+    DrvAllocation *dstDrv = (DrvAllocation *)dstAlloc->mHal.drv;
+    DrvAllocation *srcDrv = (DrvAllocation *)srcAlloc->mHal.drv;
+    uint8_t *dst = (uint8_t *)dstAlloc->mHal.drvState.lod[0].mallocPtr;
+    uint8_t *src = (uint8_t *)srcAlloc->mHal.drvState.lod[0].mallocPtr;
+    if (!dst || !src) {
+        rsc->setError(RS_ERROR_FATAL_DRIVER, "Clone of an Allocation without script memory.");
+        return;
+    }
+
+    if (!CowShare(srcDrv, src, dstDrv, dst, srcDrv->mapSize)) {
+        const size_t size = srcAlloc->mHal.drvState.faceOffset *
+                            (srcAlloc->mHal.drvState.faceCount ? 6 : 1);
+        CopyPlanes(rsc, dst, size, 0, src, size, 0, size, 1, 1);
+    }
+    dstDrv->uploadDeferred = true;
+}
+
 void rsdAllocationElementData1D(const Context *rsc, const Allocation *alloc,
                                 uint32_t x,
                                 const void *data, uint32_t cIdx, size_t sizeBytes) {
@@ -1114,80 +1457,482 @@ void rsdAllocationElementData2D(const Context *rsc, const Allocation *alloc,
     drv->uploadDeferred = true;
 }
 
-static void mip565(const Allocation *alloc, int lod, RsAllocationCubemapFace face) {
-    uint32_t w = alloc->mHal.drvState.lod[lod + 1].dimX;
-    uint32_t h = alloc->mHal.drvState.lod[lod + 1].dimY;
+/*
+ * Mipmap generation.  Each level is produced from the previous one with a
+ * separable filter whose taps are computed once per level and axis: the
+ * vertical taps are accumulated into a per-worker float row, then the
+ * horizontal taps are applied to it.  A source dimension that is exactly
+ * twice the destination gets the plain 2x2 box; an odd one gets the 3 tap
+ * polyphase box so the last row/column still contributes.  Box levels of
+ * even 8/16 bit integer and float elements skip the float rows and use
+ * vector 2x2 reductions directly.  Rows of a level (over all faces) are
+ * handed out to the CPU worker pool.
+ */
+enum MipFormat {
+    MIP_FORMAT_U8,
+    MIP_FORMAT_U16,
+    MIP_FORMAT_F16,
+    MIP_FORMAT_F32,
+    MIP_FORMAT_565
+};
+
+typedef struct {
+    uint32_t *first;
+    float *weights;
+    uint32_t taps;
+} MipTaps;
+
+typedef struct {
+    const Allocation *alloc;
+    uint32_t lod;
+    MipFormat format;
+    uint32_t channels;
+    bool fastBox;
+
+    MipTaps tx;
+    MipTaps ty;
+
+    uint32_t dstH;
+    uint32_t rows;
+    volatile int nextRow;
+
+    float *scratch;
+    size_t scratchStride;
+} MipJob;
+
+static const uint32_t kMipSliceRows = 4;
+
+static float mipLanczos3(float x) {
+    x = fabsf(x);
+    if (x < 1e-5f) {
+        return 1.f;
+    }
+    if (x >= 3.f) {
+        return 0.f;
+    }
+    const float px = (float)M_PI * x;
+    return 3.f * sinf(px) * sinf(px / 3.f) / (px * px);
+}
+
+static void mipComputeTaps(MipTaps *t, uint32_t src, uint32_t dst, RsMipmapFilter filter) {
+    if (filter == RS_MIPMAP_FILTER_LANCZOS && src > 1) {
+        const float scale = (float)src / dst;
+        const int32_t radius = (int32_t)ceilf(3.f * scale);
+        t->taps = 2 * radius + 1;
+        t->first = new uint32_t[dst * t->taps];
+        t->weights = new float[dst * t->taps];
+        for (uint32_t x = 0; x < dst; x++) {
+            const float center = (x + 0.5f) * scale - 0.5f;
+            const int32_t base = (int32_t)floorf(center) - radius;
+            float sum = 0.f;
+            for (uint32_t i = 0; i < t->taps; i++) {
+                float w = mipLanczos3((base + (int32_t)i - center) / scale);
+                t->first[x * t->taps + i] = (uint32_t)rsMin(rsMax(base + (int32_t)i, 0),
+                                                            (int32_t)src - 1);
+                t->weights[x * t->taps + i] = w;
+                sum += w;
+            }
+            for (uint32_t i = 0; i < t->taps; i++) {
+                t->weights[x * t->taps + i] /= sum;
+            }
+        }
+        return;
+    }
+
+    // Box: 1 tap for a collapsed axis, 2 for an exact halving, otherwise the
+    // 3 tap polyphase box of a (2 * dst + 1) wide source.
+    t->taps = (src == 1) ? 1 : ((src == dst * 2) ? 2 : 3);
+    t->first = new uint32_t[dst * t->taps];
+    t->weights = new float[dst * t->taps];
+    for (uint32_t x = 0; x < dst; x++) {
+        for (uint32_t i = 0; i < t->taps; i++) {
+            t->first[x * t->taps + i] = rsMin(x * 2 + i, src - 1);
+            if (t->taps == 3) {
+                const float w[3] = {(float)(dst - x), (float)dst, (float)(x + 1)};
+                t->weights[x * t->taps + i] = w[i] / src;
+            } else {
+                t->weights[x * t->taps + i] = 1.f / t->taps;
+            }
+        }
+    }
+}
+
+static float mipHalfToFloat(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    uint32_t bits;
+    if (exp == 0x1f) {
+        bits = sign | 0x7f800000 | (mant << 13);
+    } else if (exp) {
+        bits = sign | ((exp + 112) << 23) | (mant << 13);
+    } else if (mant) {
+        float f = mant * (1.f / 16777216.f);
+        memcpy(&bits, &f, sizeof(bits));
+        bits |= sign;
+    } else {
+        bits = sign;
+    }
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static uint16_t mipFloatToHalf(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    uint16_t sign = (bits >> 16) & 0x8000;
+    int32_t exp = (int32_t)((bits >> 23) & 0xff) - 112;
+    uint32_t mant = bits & 0x7fffff;
+    if (((bits >> 23) & 0xff) == 0xff) {
+        return sign | 0x7c00 | (mant ? 0x200 : 0);
+    }
+    if (exp >= 0x1f) {
+        return sign | 0x7c00;
+    }
+    if (exp <= 0) {
+        if (exp < -10) {
+            return sign;
+        }
+        mant |= 0x800000;
+        uint32_t shift = 14 - exp;
+        uint32_t h = mant >> shift;
+        // Round to nearest even.
+        uint32_t rem = mant & ((1u << shift) - 1);
+        uint32_t half = 1u << (shift - 1);
+        if (rem > half || (rem == half && (h & 1))) {
+            h++;
+        }
+        return sign | h;
+    }
+    uint32_t h = ((uint32_t)exp << 10) | (mant >> 13);
+    if ((mant & 0x1fff) > 0x1000 || ((mant & 0x1fff) == 0x1000 && (h & 1))) {
+        h++;
+    }
+    return sign | h;
+}
+
+// Adds w * row into acc, one float per channel.
+static void mipAccumulateRow(const MipJob *job, float *acc, const uint8_t *row,
+                             uint32_t w, float weight) {
+    const uint32_t n = w * job->channels;
+    switch (job->format) {
+    case MIP_FORMAT_U8:
+        for (uint32_t i = 0; i < n; i++) {
+            acc[i] += weight * row[i];
+        }
+        break;
+    case MIP_FORMAT_U16:
+        for (uint32_t i = 0; i < n; i++) {
+            acc[i] += weight * ((const uint16_t *)row)[i];
+        }
+        break;
+    case MIP_FORMAT_F16:
+        for (uint32_t i = 0; i < n; i++) {
+            acc[i] += weight * mipHalfToFloat(((const uint16_t *)row)[i]);
+        }
+        break;
+    case MIP_FORMAT_F32:
+        for (uint32_t i = 0; i < n; i++) {
+            acc[i] += weight * ((const float *)row)[i];
+        }
+        break;
+    case MIP_FORMAT_565:
+        for (uint32_t x = 0; x < w; x++) {
+            uint16_t p = ((const uint16_t *)row)[x];
+            acc[x * 3] += weight * (p & 0x1f);
+            acc[x * 3 + 1] += weight * ((p >> 5) & 0x3f);
+            acc[x * 3 + 2] += weight * (p >> 11);
+        }
+        break;
+    }
+}
 
-    for (uint32_t y=0; y < h; y++) {
-        uint16_t *oPtr = (uint16_t *)GetOffsetPtr(alloc, 0, y, 0, lod + 1, face);
-        const uint16_t *i1 = (uint16_t *)GetOffsetPtr(alloc, 0, 0, y*2, lod, face);
-        const uint16_t *i2 = (uint16_t *)GetOffsetPtr(alloc, 0, 0, y*2+1, lod, face);
+static inline uint32_t mipClampRound(float v, float max) {
+    return (uint32_t)rsMin(rsMax(v + 0.5f, 0.f), max);
+}
 
-        for (uint32_t x=0; x < w; x++) {
-            *oPtr = rsBoxFilter565(i1[0], i1[1], i2[0], i2[1]);
-            oPtr ++;
-            i1 += 2;
-            i2 += 2;
+static void mipStorePixel(const MipJob *job, uint8_t *out, uint32_t x, const float *v) {
+    const uint32_t c = job->channels;
+    switch (job->format) {
+    case MIP_FORMAT_U8:
+        for (uint32_t i = 0; i < c; i++) {
+            out[x * c + i] = (uint8_t)mipClampRound(v[i], 255.f);
+        }
+        break;
+    case MIP_FORMAT_U16:
+        for (uint32_t i = 0; i < c; i++) {
+            ((uint16_t *)out)[x * c + i] = (uint16_t)mipClampRound(v[i], 65535.f);
         }
+        break;
+    case MIP_FORMAT_F16:
+        for (uint32_t i = 0; i < c; i++) {
+            ((uint16_t *)out)[x * c + i] = mipFloatToHalf(v[i]);
+        }
+        break;
+    case MIP_FORMAT_F32:
+        for (uint32_t i = 0; i < c; i++) {
+            ((float *)out)[x * c + i] = v[i];
+        }
+        break;
+    case MIP_FORMAT_565:
+        ((uint16_t *)out)[x] = mipClampRound(v[0], 31.f) |
+                               (mipClampRound(v[1], 63.f) << 5) |
+                               (mipClampRound(v[2], 31.f) << 11);
+        break;
     }
 }
 
-static void mip8888(const Allocation *alloc, int lod, RsAllocationCubemapFace face) {
-    uint32_t w = alloc->mHal.drvState.lod[lod + 1].dimX;
-    uint32_t h = alloc->mHal.drvState.lod[lod + 1].dimY;
+typedef uint8_t MipU8x16 __attribute__((vector_size(16)));
+typedef uint8_t MipU8x8 __attribute__((vector_size(8)));
+typedef uint16_t MipU16x16 __attribute__((vector_size(32)));
+typedef uint16_t MipU16x8 __attribute__((vector_size(16)));
+typedef uint16_t MipU16x4 __attribute__((vector_size(8)));
+typedef uint32_t MipU32x8 __attribute__((vector_size(32)));
+typedef uint32_t MipU32x4 __attribute__((vector_size(16)));
+typedef float MipF32x8 __attribute__((vector_size(32)));
+typedef float MipF32x4 __attribute__((vector_size(16)));
+
+template <typename V>
+static inline V mipLoad(const uint8_t *p) {
+    V v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
 
-    for (uint32_t y=0; y < h; y++) {
-        uint32_t *oPtr = (uint32_t *)GetOffsetPtr(alloc, 0, y, 0, lod + 1, face);
-        const uint32_t *i1 = (uint32_t *)GetOffsetPtr(alloc, 0, y*2, 0, lod, face);
-        const uint32_t *i2 = (uint32_t *)GetOffsetPtr(alloc, 0, y*2+1, 0, lod, face);
+template <typename V>
+static inline void mipStore(uint8_t *p, V v) {
+    memcpy(p, &v, sizeof(v));
+}
 
-        for (uint32_t x=0; x < w; x++) {
-            *oPtr = rsBoxFilter8888(i1[0], i1[1], i2[0], i2[1]);
-            oPtr ++;
-            i1 += 2;
-            i2 += 2;
+// Pairs up horizontally adjacent pixels of a 2 row sum.  Lanes of the first
+// pixel of each pair and of the second, for 1, 2 and 4 lanes per pixel.
+#define MIP_PAIRS_16(c, v, sel)                                                             \
+    ((c) == 1 ? __builtin_shufflevector(v, v, 0 + sel, 2 + sel, 4 + sel, 6 + sel,          \
+                                        8 + sel, 10 + sel, 12 + sel, 14 + sel) :            \
+     (c) == 2 ? __builtin_shufflevector(v, v, 0 + 2 * sel, 1 + 2 * sel, 4 + 2 * sel,        \
+                                        5 + 2 * sel, 8 + 2 * sel, 9 + 2 * sel,              \
+                                        12 + 2 * sel, 13 + 2 * sel) :                       \
+                __builtin_shufflevector(v, v, 0 + 4 * sel, 1 + 4 * sel, 2 + 4 * sel,        \
+                                        3 + 4 * sel, 8 + 4 * sel, 9 + 4 * sel,              \
+                                        10 + 4 * sel, 11 + 4 * sel))
+
+#define MIP_PAIRS_8(c, v, sel)                                                              \
+    ((c) == 1 ? __builtin_shufflevector(v, v, 0 + sel, 2 + sel, 4 + sel, 6 + sel) :         \
+     (c) == 2 ? __builtin_shufflevector(v, v, 0 + 2 * sel, 1 + 2 * sel,                     \
+                                        4 + 2 * sel, 5 + 2 * sel) :                         \
+                __builtin_shufflevector(v, v, 0 + 4 * sel, 1 + 4 * sel,                     \
+                                        2 + 4 * sel, 3 + 4 * sel))
+
+// 2x2 box of an exactly halved row; consumes 16 bytes of each source row per
+// iteration and finishes the tail in the float path.
+template <uint32_t C>
+static uint32_t mipBoxRowU8(uint8_t *out, const uint8_t *i1, const uint8_t *i2, uint32_t w) {
+    uint32_t x = 0;
+    for (; (x + 8 / C) <= w; x += 8 / C) {
+        MipU16x16 s = __builtin_convertvector(mipLoad<MipU8x16>(i1 + x * 2 * C), MipU16x16) +
+                      __builtin_convertvector(mipLoad<MipU8x16>(i2 + x * 2 * C), MipU16x16);
+        MipU16x8 r = MIP_PAIRS_16(C, s, 0) + MIP_PAIRS_16(C, s, 1) + (uint16_t)2;
+        mipStore(out + x * C, __builtin_convertvector(r >> (uint16_t)2, MipU8x8));
+    }
+    return x;
+}
+
+template <uint32_t C>
+static uint32_t mipBoxRowU16(uint8_t *out, const uint8_t *i1, const uint8_t *i2, uint32_t w) {
+    uint32_t x = 0;
+    for (; (x + 4 / C) <= w; x += 4 / C) {
+        MipU32x8 s = __builtin_convertvector(mipLoad<MipU16x8>(i1 + x * 4 * C), MipU32x8) +
+                     __builtin_convertvector(mipLoad<MipU16x8>(i2 + x * 4 * C), MipU32x8);
+        MipU32x4 r = MIP_PAIRS_8(C, s, 0) + MIP_PAIRS_8(C, s, 1) + 2u;
+        mipStore(out + x * 2 * C, __builtin_convertvector(r >> 2u, MipU16x4));
+    }
+    return x;
+}
+
+template <uint32_t C>
+static uint32_t mipBoxRowF32(uint8_t *out, const uint8_t *i1, const uint8_t *i2, uint32_t w) {
+    uint32_t x = 0;
+    for (; (x + 4 / C) <= w; x += 4 / C) {
+        MipF32x8 s = mipLoad<MipF32x8>(i1 + x * 8 * C) + mipLoad<MipF32x8>(i2 + x * 8 * C);
+        MipF32x4 r = (MIP_PAIRS_8(C, s, 0) + MIP_PAIRS_8(C, s, 1)) * 0.25f;
+        mipStore(out + x * 4 * C, r);
+    }
+    return x;
+}
+
+static uint32_t mipBoxRow(const MipJob *job, uint8_t *out, const uint8_t *i1,
+                          const uint8_t *i2, uint32_t w) {
+    switch (job->format) {
+    case MIP_FORMAT_U8:
+        switch (job->channels) {
+        case 1: return mipBoxRowU8<1>(out, i1, i2, w);
+        case 2: return mipBoxRowU8<2>(out, i1, i2, w);
+        case 4: return mipBoxRowU8<4>(out, i1, i2, w);
+        }
+        break;
+    case MIP_FORMAT_U16:
+        switch (job->channels) {
+        case 1: return mipBoxRowU16<1>(out, i1, i2, w);
+        case 2: return mipBoxRowU16<2>(out, i1, i2, w);
+        case 4: return mipBoxRowU16<4>(out, i1, i2, w);
+        }
+        break;
+    case MIP_FORMAT_F32:
+        switch (job->channels) {
+        case 1: return mipBoxRowF32<1>(out, i1, i2, w);
+        case 2: return mipBoxRowF32<2>(out, i1, i2, w);
+        case 4: return mipBoxRowF32<4>(out, i1, i2, w);
         }
+        break;
+    default:
+        break;
     }
+    return 0;
 }
 
-static void mip8(const Allocation *alloc, int lod, RsAllocationCubemapFace face) {
-    uint32_t w = alloc->mHal.drvState.lod[lod + 1].dimX;
-    uint32_t h = alloc->mHal.drvState.lod[lod + 1].dimY;
+static void mipRow(const MipJob *job, uint32_t row, float *acc) {
+    const Allocation *alloc = job->alloc;
+    const uint32_t lod = job->lod;
+    const uint32_t face = row / job->dstH;
+    const uint32_t y = row - face * job->dstH;
+    const uint32_t srcW = alloc->mHal.drvState.lod[lod].dimX;
+    const uint32_t dstW = alloc->mHal.drvState.lod[lod + 1].dimX;
+    const uint32_t c = job->channels;
+    uint8_t *out = GetOffsetPtr(alloc, 0, y, 0, lod + 1, (RsAllocationCubemapFace)face);
+
+    uint32_t x = 0;
+    if (job->fastBox) {
+        x = mipBoxRow(job, out,
+                      GetOffsetPtr(alloc, 0, y * 2, 0, lod, (RsAllocationCubemapFace)face),
+                      GetOffsetPtr(alloc, 0, y * 2 + 1, 0, lod, (RsAllocationCubemapFace)face),
+                      dstW);
+        if (x == dstW) {
+            return;
+        }
+    }
+
+    memset(acc, 0, srcW * c * sizeof(float));
+    for (uint32_t i = 0; i < job->ty.taps; i++) {
+        const uint32_t sy = job->ty.first[y * job->ty.taps + i];
+        mipAccumulateRow(job, acc,
+                         GetOffsetPtr(alloc, 0, sy, 0, lod, (RsAllocationCubemapFace)face),
+                         srcW, job->ty.weights[y * job->ty.taps + i]);
+    }
 
-    for (uint32_t y=0; y < h; y++) {
-        uint8_t *oPtr = GetOffsetPtr(alloc, 0, y, 0, lod + 1, face);
-        const uint8_t *i1 = GetOffsetPtr(alloc, 0, y*2, 0, lod, face);
-        const uint8_t *i2 = GetOffsetPtr(alloc, 0, y*2+1, 0, lod, face);
+    float v[4];
+    for (; x < dstW; x++) {
+        for (uint32_t k = 0; k < c; k++) {
+            v[k] = 0.f;
+        }
+        for (uint32_t i = 0; i < job->tx.taps; i++) {
+            const float *p = acc + job->tx.first[x * job->tx.taps + i] * c;
+            const float w = job->tx.weights[x * job->tx.taps + i];
+            for (uint32_t k = 0; k < c; k++) {
+                v[k] += w * p[k];
+            }
+        }
+        mipStorePixel(job, out, x, v);
+    }
+}
 
-        for (uint32_t x=0; x < w; x++) {
-            *oPtr = (uint8_t)(((uint32_t)i1[0] + i1[1] + i2[0] + i2[1]) * 0.25f);
-            oPtr ++;
-            i1 += 2;
-            i2 += 2;
+static void mipWorker(void *usr, uint32_t idx) {
+    MipJob *job = (MipJob *)usr;
+    float *acc = job->scratch + idx * job->scratchStride;
+    while (1) {
+        uint32_t r1 = (uint32_t)__sync_fetch_and_add(&job->nextRow, kMipSliceRows);
+        if (r1 >= job->rows) {
+            return;
+        }
+        uint32_t r2 = rsMin(r1 + kMipSliceRows, job->rows);
+        for (; r1 < r2; r1++) {
+            mipRow(job, r1, acc);
         }
     }
 }
 
-void rsdAllocationGenerateMipmaps(const Context *rsc, const Allocation *alloc) {
+static bool mipGetFormat(const Element *e, MipFormat *format, uint32_t *channels) {
+    const uint32_t size = e->getSizeBytes();
+    switch (e->getType()) {
+    case RS_TYPE_UNSIGNED_8:
+        *format = MIP_FORMAT_U8;
+        *channels = size;
+        break;
+    case RS_TYPE_UNSIGNED_16:
+        *format = MIP_FORMAT_U16;
+        *channels = size / 2;
+        break;
+    case RS_TYPE_FLOAT_16:
+        *format = MIP_FORMAT_F16;
+        *channels = size / 2;
+        break;
+    case RS_TYPE_FLOAT_32:
+        *format = MIP_FORMAT_F32;
+        *channels = size / 4;
+        break;
+    case RS_TYPE_UNSIGNED_5_6_5:
+        *format = MIP_FORMAT_565;
+        *channels = 3;
+        return true;
+    default:
+        return false;
+    }
+    return !e->getFieldCount() && *channels >= 1 && *channels <= 4;
+}
+
+void rsdAllocationGenerateMipmapsFiltered(const Context *rsc, const Allocation *alloc,
+                                          RsMipmapFilter filter) {
     if(!alloc->mHal.drvState.lod[0].mallocPtr) {
         return;
     }
-    uint32_t numFaces = alloc->getType()->getDimFaces() ? 6 : 1;
-    for (uint32_t face = 0; face < numFaces; face ++) {
-        for (uint32_t lod=0; lod < (alloc->getType()->getLODCount() -1); lod++) {
-            switch (alloc->getType()->getElement()->getSizeBits()) {
-            case 32:
-                mip8888(alloc, lod, (RsAllocationCubemapFace)face);
-                break;
-            case 16:
-                mip565(alloc, lod, (RsAllocationCubemapFace)face);
-                break;
-            case 8:
-                mip8(alloc, lod, (RsAllocationCubemapFace)face);
-                break;
-            }
+
+    MipJob job;
+    memset(&job, 0, sizeof(job));
+    job.alloc = alloc;
+    if (!mipGetFormat(alloc->getType()->getElement(), &job.format, &job.channels)) {
+        ALOGE("Mipmap generation is not supported for this Element");
+        return;
+    }
+
+    RsdHal *dc = (RsdHal *)rsc->mHal.drv;
+    const uint32_t threads = dc->mCpuRef->getThreadCount();
+    const uint32_t numFaces = alloc->getType()->getDimFaces() ? 6 : 1;
+    job.scratchStride = rsRound((size_t)alloc->mHal.drvState.lod[0].dimX * job.channels, 16);
+    job.scratch = new float[job.scratchStride * threads];
+
+    for (uint32_t lod=0; lod < (alloc->getType()->getLODCount() -1); lod++) {
+        const uint32_t srcW = alloc->mHal.drvState.lod[lod].dimX;
+        const uint32_t srcH = rsMax(alloc->mHal.drvState.lod[lod].dimY, 1u);
+        const uint32_t dstW = alloc->mHal.drvState.lod[lod + 1].dimX;
+        const uint32_t dstH = rsMax(alloc->mHal.drvState.lod[lod + 1].dimY, 1u);
+
+        job.lod = lod;
+        mipComputeTaps(&job.tx, srcW, dstW, filter);
+        mipComputeTaps(&job.ty, srcH, dstH, filter);
+        job.fastBox = (filter == RS_MIPMAP_FILTER_BOX) && (srcW == dstW * 2) &&
+                      (srcH == dstH * 2) && (job.format != MIP_FORMAT_F16) &&
+                      (job.format != MIP_FORMAT_565);
+        job.dstH = dstH;
+        job.rows = dstH * numFaces;
+        job.nextRow = 0;
+
+        if ((threads > 1) && ((size_t)dstW * job.rows >= 64 * 64)) {
+            dc->mCpuRef->launchWorkers(&mipWorker, &job);
+        } else {
+            mipWorker(&job, 0);
         }
+
+        delete[] job.tx.first;
+        delete[] job.tx.weights;
+        delete[] job.ty.first;
+        delete[] job.ty.weights;
     }
+
+    delete[] job.scratch;
+}
+
+void rsdAllocationGenerateMipmaps(const Context *rsc, const Allocation *alloc) {
+    rsdAllocationGenerateMipmapsFiltered(rsc, alloc, RS_MIPMAP_FILTER_BOX);
 }
 
 uint32_t rsdAllocationGrallocBits(const android::renderscript::Context *rsc,
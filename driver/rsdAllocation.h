@@ -65,6 +65,13 @@ struct DrvAllocation {
     bool useUserProvidedPtr;
     bool uploadDeferred;
 
+    // Non-zero when the storage is its own mapping rather than heap memory.
+    size_t mapSize;
+    // memfd the storage is a private mapping of after a clone, or -1.
+    int cowFd;
+    // Bytes of storage allocated by the driver, counted in the context stats.
+    size_t storageSize;
+
     RsdFrameBufferObj * readBackFBO;
     ANativeWindow *wnd;
     ANativeWindowBuffer *wndBuffer;
@@ -165,8 +172,15 @@ void rsdAllocationElementData2D(const android::renderscript::Context *rsc,
                                 uint32_t x, uint32_t y,
                                 const void *data, uint32_t elementOff, size_t sizeBytes);
 
+void rsdAllocationClone(const android::renderscript::Context *rsc,
+                        const android::renderscript::Allocation *dstAlloc,
+                        const android::renderscript::Allocation *srcAlloc);
+
 void rsdAllocationGenerateMipmaps(const android::renderscript::Context *rsc,
                                   const android::renderscript::Allocation *alloc);
+void rsdAllocationGenerateMipmapsFiltered(const android::renderscript::Context *rsc,
+                                          const android::renderscript::Allocation *alloc,
+                                          RsMipmapFilter filter);
 
 void rsdAllocationUpdateCachedObject(const android::renderscript::Context *rsc,
                                      const android::renderscript::Allocation *alloc,
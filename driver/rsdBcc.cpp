@@ -53,6 +53,18 @@ bool rsdScriptInit(const Context *rsc,
     return true;
 }
 
+bool rsdScriptClone(const Context *rsc, ScriptC *dst, const ScriptC *src) {
+    RsdHal *dc = (RsdHal *)rsc->mHal.drv;
+    RsdCpuReference::CpuScript * cs = dc->mCpuRef->cloneScript(
+            dst, (const RsdCpuReference::CpuScript *)src->mHal.drv);
+    if (cs == NULL) {
+        return false;
+    }
+    dst->mHal.drv = cs;
+    cs->populateScript(dst);
+    return true;
+}
+
 bool rsdInitIntrinsic(const Context *rsc, Script *s, RsScriptIntrinsicID iid, Element *e) {
     RsdHal *dc = (RsdHal *)rsc->mHal.drv;
     RsdCpuReference::CpuScript * cs = dc->mCpuRef->createIntrinsic(s, iid, e);
@@ -146,6 +158,11 @@ void rsdScriptSetGlobalObj(const Context *dc, const Script *s, uint32_t slot, Ob
     cs->setGlobalObj(slot, data);
 }
 
+bool rsdScriptGetGlobalObj(const Context *dc, const Script *s, uint32_t slot, ObjectBase **data) {
+    RsdCpuReference::CpuScript *cs = (RsdCpuReference::CpuScript *)s->mHal.drv;
+    return cs->getGlobalObj(slot, data);
+}
+
 void rsdScriptDestroy(const Context *dc, Script *s) {
     RsdCpuReference::CpuScript *cs = (RsdCpuReference::CpuScript *)s->mHal.drv;
     delete cs;
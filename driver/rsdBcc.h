@@ -23,6 +23,9 @@
 bool rsdScriptInit(const android::renderscript::Context *, android::renderscript::ScriptC *,
                    char const *resName, char const *cacheDir,
                    uint8_t const *bitcode, size_t bitcodeSize, uint32_t flags);
+bool rsdScriptClone(const android::renderscript::Context *rsc,
+                    android::renderscript::ScriptC *dst,
+                    const android::renderscript::ScriptC *src);
 bool rsdInitIntrinsic(const android::renderscript::Context *rsc,
                       android::renderscript::Script *s,
                       RsScriptIntrinsicID iid,
@@ -79,6 +82,9 @@ void rsdScriptSetGlobalBind(const android::renderscript::Context *,
 void rsdScriptSetGlobalObj(const android::renderscript::Context *,
                            const android::renderscript::Script *,
                            uint32_t slot, android::renderscript::ObjectBase *data);
+bool rsdScriptGetGlobalObj(const android::renderscript::Context *,
+                           const android::renderscript::Script *,
+                           uint32_t slot, android::renderscript::ObjectBase **data);
 
 void rsdScriptSetGlobal(const android::renderscript::Context *dc,
                         const android::renderscript::Script *script,
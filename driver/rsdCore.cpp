@@ -49,6 +49,9 @@ using namespace android::renderscript;
 
 static void Shutdown(Context *rsc);
 static void SetPriority(const Context *rsc, int32_t priority);
+static void AttachQueueThread(const Context *rsc);
+static void DetachQueueThread(const Context *rsc);
+static void LaunchWorkers(const Context *rsc, void (*cbk)(void *usr, uint32_t idx), void *data);
 
 #ifndef RS_COMPATIBILITY_LIB
     #define NATIVE_FUNC(a) a
@@ -83,7 +86,9 @@ static RsdHalFunctions FunctionTable = {
         rsdScriptSetGlobalObj,
         rsdScriptDestroy,
         rsdScriptInvokeForEachMulti,
-        rsdScriptUpdateCachedObject
+        rsdScriptUpdateCachedObject,
+        rsdScriptClone,
+        rsdScriptGetGlobalObj
     },
 
     {
@@ -110,7 +115,9 @@ static RsdHalFunctions FunctionTable = {
         rsdAllocationElementData1D,
         rsdAllocationElementData2D,
         rsdAllocationGenerateMipmaps,
-        rsdAllocationUpdateCachedObject
+        rsdAllocationUpdateCachedObject,
+        rsdAllocationGenerateMipmapsFiltered,
+        rsdAllocationClone
     },
 
 
@@ -184,7 +191,11 @@ static RsdHalFunctions FunctionTable = {
         rsdElementUpdateCachedObject
     },
 
-    NULL // finish
+    NULL, // finish
+
+    AttachQueueThread,
+    DetachQueueThread,
+    LaunchWorkers
 };
 
 extern const RsdCpuReference::CpuSymbol * rsdLookupRuntimeStub(Context * pContext, char const* name);
@@ -247,6 +258,21 @@ void SetPriority(const Context *rsc, int32_t priority) {
 #endif
 }
 
+void AttachQueueThread(const Context *rsc) {
+    RsdHal *dc = (RsdHal *)rsc->mHal.drv;
+    dc->mCpuRef->attachQueueThread();
+}
+
+void DetachQueueThread(const Context *rsc) {
+    RsdHal *dc = (RsdHal *)rsc->mHal.drv;
+    dc->mCpuRef->detachQueueThread();
+}
+
+void LaunchWorkers(const Context *rsc, void (*cbk)(void *usr, uint32_t idx), void *data) {
+    RsdHal *dc = (RsdHal *)rsc->mHal.drv;
+    dc->mCpuRef->launchWorkers(cbk, data);
+}
+
 void Shutdown(Context *rsc) {
     RsdHal *dc = (RsdHal *)rsc->mHal.drv;
     delete dc->mCpuRef;
@@ -11,6 +11,8 @@ declare <2 x float> @llvm.sqrt.v2f32(<2 x float>) nounwind readnone
 declare <3 x float> @llvm.sqrt.v3f32(<3 x float>) nounwind readnone
 declare <4 x float> @llvm.sqrt.v4f32(<4 x float>) nounwind readnone
 
+declare <4 x i32> @llvm.x86.sse2.cvtps2dq(<4 x float>) nounwind readnone
+
 declare float @llvm.exp.f32(float) nounwind readonly
 declare float @llvm.pow.f32(float, float) nounwind readonly
 
@@ -100,3 +102,35 @@ define <4 x float> @_Z4sqrtDv4_f(<4 x float> %in) nounwind readnone alwaysinline
   %1 = tail call <4 x float> @llvm.sqrt.v4f32(<4 x float> %in) nounwind readnone
   ret <4 x float> %1
 }
+
+; cvtps2dq rounds to nearest even under the default MXCSR.  Lanes at or above
+; 2^23 are already integral (or NaN/Inf) and pass through; the sign bit is
+; copied back so that small negative inputs give -0.0.
+define <4 x float> @_Z4rintDv4_f(<4 x float> %in) nounwind readnone alwaysinline {
+  %1 = bitcast <4 x float> %in to <4 x i32>
+  %2 = and <4 x i32> %1, <i32 2147483647, i32 2147483647, i32 2147483647, i32 2147483647>
+  %3 = bitcast <4 x i32> %2 to <4 x float>
+  %4 = fcmp olt <4 x float> %3, <float 0x4160000000000000, float 0x4160000000000000, float 0x4160000000000000, float 0x4160000000000000>
+  %5 = tail call <4 x i32> @llvm.x86.sse2.cvtps2dq(<4 x float> %in) nounwind readnone
+  %6 = sitofp <4 x i32> %5 to <4 x float>
+  %7 = bitcast <4 x float> %6 to <4 x i32>
+  %8 = and <4 x i32> %1, <i32 -2147483648, i32 -2147483648, i32 -2147483648, i32 -2147483648>
+  %9 = or <4 x i32> %7, %8
+  %10 = bitcast <4 x i32> %9 to <4 x float>
+  %11 = select <4 x i1> %4, <4 x float> %10, <4 x float> %in
+  ret <4 x float> %11
+}
+
+define <3 x float> @_Z4rintDv3_f(<3 x float> %in) nounwind readnone alwaysinline {
+  %1 = shufflevector <3 x float> %in, <3 x float> undef, <4 x i32> <i32 0, i32 1, i32 2, i32 3>
+  %2 = tail call <4 x float> @_Z4rintDv4_f(<4 x float> %1) nounwind readnone
+  %3 = shufflevector <4 x float> %2, <4 x float> undef, <3 x i32> <i32 0, i32 1, i32 2>
+  ret <3 x float> %3
+}
+
+define <2 x float> @_Z4rintDv2_f(<2 x float> %in) nounwind readnone alwaysinline {
+  %1 = shufflevector <2 x float> %in, <2 x float> undef, <4 x i32> <i32 0, i32 1, i32 2, i32 3>
+  %2 = tail call <4 x float> @_Z4rintDv4_f(<4 x float> %1) nounwind readnone
+  %3 = shufflevector <4 x float> %2, <4 x float> undef, <2 x i32> <i32 0, i32 1>
+  ret <2 x float> %3
+}
@@ -333,6 +333,138 @@ static bool iszero(float f) {
     return isposzero(f) || isnegzero(f);
 }
 
+/*
+ * Helpers for the vector transcendental functions below.  The FN_FUNC_FN
+ * macros call the scalar libm function once per lane; the float4 versions of
+ * the hot functions instead run the range reduction and polynomial on all
+ * lanes at once and only hand lanes outside the reduced domain (NaN,
+ * infinities, overflow, huge trig arguments) to the scalar function.
+ */
+
+extern float4 __attribute__((overloadable)) rint(float4);
+
+static float4 vSelect(int4 mask, float4 a, float4 b) {
+    return (float4)(((int4)a & mask) | ((int4)b & ~mask));
+}
+
+static bool vAny(int4 mask) {
+    return (mask.x | mask.y | mask.z | mask.w) != 0;
+}
+
+// 2^n for integral n in [-126, 127].
+static float4 vPow2i(float4 n) {
+    return (float4)((convert_int4(n) + 127) << (int4)23);
+}
+
+#define V_FIXUP_FN(r, mask, fnc, v)                 \
+    if (vAny(mask)) {                               \
+        if (mask.x) r.x = fnc(v.x);                 \
+        if (mask.y) r.y = fnc(v.y);                 \
+        if (mask.z) r.z = fnc(v.z);                 \
+        if (mask.w) r.w = fnc(v.w);                 \
+    }
+
+#define V_FIXUP_FN_FN(r, mask, fnc, v1, v2)         \
+    if (vAny(mask)) {                               \
+        if (mask.x) r.x = fnc(v1.x, v2.x);          \
+        if (mask.y) r.y = fnc(v1.y, v2.y);          \
+        if (mask.z) r.z = fnc(v1.z, v2.z);          \
+        if (mask.w) r.w = fnc(v1.w, v2.w);          \
+    }
+
+// float2 and float3 versions padded out to the float4 implementation.
+#define FN_FUNC_FN_V4(fnc)                                      \
+extern float2 __attribute__((overloadable)) fnc(float2 v) {     \
+    float4 t = 1.f;                                             \
+    t.xy = v;                                                   \
+    return fnc(t).xy;                                           \
+}                                                               \
+extern float3 __attribute__((overloadable)) fnc(float3 v) {     \
+    float4 t = 1.f;                                             \
+    t.xyz = v;                                                  \
+    return fnc(t).xyz;                                          \
+}
+
+#define FN_FUNC_FN_FN_V4(fnc)                                               \
+extern float2 __attribute__((overloadable)) fnc(float2 v1, float2 v2) {     \
+    float4 t1 = 1.f;                                                        \
+    float4 t2 = 1.f;                                                        \
+    t1.xy = v1;                                                             \
+    t2.xy = v2;                                                             \
+    return fnc(t1, t2).xy;                                                  \
+}                                                                           \
+extern float3 __attribute__((overloadable)) fnc(float3 v1, float3 v2) {     \
+    float4 t1 = 1.f;                                                        \
+    float4 t2 = 1.f;                                                        \
+    t1.xyz = v1;                                                            \
+    t2.xyz = v2;                                                            \
+    return fnc(t1, t2).xyz;                                                 \
+}
+
+// exp(r) for |r| <= ln(2) / 2.
+static float4 vExpPoly(float4 r) {
+    float4 p = 1.9875691500e-4f;
+    p = p * r + 1.3981999507e-3f;
+    p = p * r + 8.3334519073e-3f;
+    p = p * r + 4.1665795894e-2f;
+    p = p * r + 1.6666665459e-1f;
+    p = p * r + 5.0000001201e-1f;
+    return p * r * r + r + 1.f;
+}
+
+// Exact product: hi + lo == a * b, using Dekker's split so that no fused
+// multiply-add is needed.
+static void vMul12(float4 a, float4 b, float4 *hi, float4 *lo) {
+    float4 ta = a * 4097.f;
+    float4 ah = ta - (ta - a);
+    float4 al = a - ah;
+    float4 tb = b * 4097.f;
+    float4 bh = tb - (tb - b);
+    float4 bl = b - bh;
+    *hi = a * b;
+    *lo = ((ah * bh - *hi) + ah * bl + al * bh) + al * bl;
+}
+
+// Reduces 0 <= av <= 8192 to r + *lo in [-pi/4, pi/4] and returns the even
+// octant index in j.  Cody-Waite: pi/4 is split into four parts of at most
+// 10 significant bits and a float remainder, so each multiple of the first
+// three by j < 2^14 is exact and the first two subtractions cancel without
+// error.  The rounding of the third is kept in *lo with the last two
+// products, which keeps the result accurate to a float ulp even next to the
+// zeros of sin and cos.
+static float4 vTrigReduce(float4 av, int4 *j, float4 *lo) {
+    int4 oct = convert_int4(av * 1.27323954473516f);
+    oct = (oct + 1) & ~1;
+    float4 y = convert_float4(oct);
+    *j = oct;
+
+    float4 r = av - y * 0.78515625f;
+    r = r - y * 0x1.fb8p-13f;
+    float4 t = y * -0x1.5ep-24f;
+    float4 hi = r - t;
+    float4 b = hi - r;
+    float4 l = (r - (hi - b)) - (t + b);
+    l = l - y * 0x1.0b8p-35f;
+    *lo = l - y * -0x1.cf72cep-46f;
+    return hi;
+}
+
+// sin(r + lo), with z = r * r and lo small next to r.
+static float4 vSinPoly(float4 r, float4 z, float4 lo) {
+    float4 p = -1.9515295891e-4f;
+    p = p * z + 8.3321608736e-3f;
+    p = p * z - 1.6666654611e-1f;
+    return (p * z * r + lo * (1.f - 0.5f * z)) + r;
+}
+
+// cos(r + lo), with z = r * r and lo small next to r.
+static float4 vCosPoly(float4 r, float4 z, float4 lo) {
+    float4 p = 2.443315711809948e-5f;
+    p = p * z - 1.388731625493765e-3f;
+    p = p * z + 4.166664568298827e-2f;
+    return ((p * z * z - r * lo * (1.f - z * (1.f / 6.f))) - 0.5f * z) + 1.f;
+}
+
 
 extern float __attribute__((overloadable)) acos(float);
 FN_FUNC_FN(acos)
@@ -387,7 +519,22 @@ extern float __attribute__((overloadable)) copysign(float, float);
 FN_FUNC_FN_FN(copysign)
 
 extern float __attribute__((overloadable)) cos(float);
-FN_FUNC_FN(cos)
+extern float4 __attribute__((overloadable)) cos(float4 v) {
+    int4 iv = (int4)v;
+    float4 av = (float4)(iv & 0x7fffffff);
+    int4 j;
+    float4 lo;
+    float4 r = vTrigReduce(av, &j, &lo);
+    float4 z = r * r;
+    float4 res = vSelect((j & 2) != 0, vSinPoly(r, z, lo), vCosPoly(r, z, lo));
+    int4 sign = (((j + 2) & 4) != 0) & (int)0x80000000;
+    res = (float4)((int4)res ^ sign);
+
+    int4 special = ~(av <= 8192.f);
+    V_FIXUP_FN(res, special, cos, v)
+    return res;
+}
+FN_FUNC_FN_V4(cos)
 
 extern float __attribute__((overloadable)) cosh(float);
 FN_FUNC_FN(cosh)
@@ -404,17 +551,45 @@ extern float __attribute__((overloadable)) erf(float);
 FN_FUNC_FN(erf)
 
 extern float __attribute__((overloadable)) exp(float);
-FN_FUNC_FN(exp)
+extern float4 __attribute__((overloadable)) exp(float4 v) {
+    // exp(v) = 2^n * exp(r) with n = rint(v / ln(2)); ln(2) is split in two
+    // so that r is exact.
+    float4 n = rint(v * 1.44269504089f);
+    float4 r = v - n * 0.693359375f;
+    r = r + n * 2.12194440e-4f;
+    float4 res = vExpPoly(r) * vPow2i(n);
+
+    int4 special = ~((v >= -87.f) & (v <= 88.f));
+    V_FIXUP_FN(res, special, exp, v)
+    return res;
+}
+FN_FUNC_FN_V4(exp)
 
 extern float __attribute__((overloadable)) exp2(float);
-FN_FUNC_FN(exp2)
+extern float4 __attribute__((overloadable)) exp2(float4 v) {
+    float4 n = rint(v);
+    float4 res = vExpPoly((v - n) * 0.693147181f) * vPow2i(n);
+
+    int4 special = ~((v >= -126.f) & (v <= 127.f));
+    V_FIXUP_FN(res, special, exp2, v)
+    return res;
+}
+FN_FUNC_FN_V4(exp2)
 
 extern float __attribute__((overloadable)) pow(float, float);
 
 extern float __attribute__((overloadable)) exp10(float v) {
     return exp2(v * 3.321928095f);
 }
-FN_FUNC_FN(exp10)
+extern float2 __attribute__((overloadable)) exp10(float2 v) {
+    return exp2(v * 3.321928095f);
+}
+extern float3 __attribute__((overloadable)) exp10(float3 v) {
+    return exp2(v * 3.321928095f);
+}
+extern float4 __attribute__((overloadable)) exp10(float4 v) {
+    return exp2(v * 3.321928095f);
+}
 
 extern float __attribute__((overloadable)) expm1(float);
 FN_FUNC_FN(expm1)
@@ -467,16 +642,62 @@ extern float __attribute__((overloadable)) lgamma(float, int*);
 FN_FUNC_FN_PIN(lgamma)
 
 extern float __attribute__((overloadable)) log(float);
-FN_FUNC_FN(log)
+extern float4 __attribute__((overloadable)) log(float4 v) {
+    // v = m * 2^e with m in [sqrt(0.5), sqrt(2)).
+    int4 iv = (int4)v;
+    int4 e = (iv >> (int4)23) - 126;
+    float4 m = (float4)((iv & 0x007fffff) | 0x3f000000);
+    int4 small = m < 0.707106781f;
+    e += small;
+    m = vSelect(small, m + m, m) - 1.f;
+
+    float4 z = m * m;
+    float4 p = 7.0376836292e-2f;
+    p = p * m - 1.1514610310e-1f;
+    p = p * m + 1.1676998740e-1f;
+    p = p * m - 1.2420140846e-1f;
+    p = p * m + 1.4249322787e-1f;
+    p = p * m - 1.6668057665e-1f;
+    p = p * m + 2.0000714765e-1f;
+    p = p * m - 2.4999993993e-1f;
+    p = p * m + 3.3333331174e-1f;
+
+    float4 fe = convert_float4(e);
+    float4 y = p * m * z;
+    y = y - fe * 2.12194440e-4f;
+    y = y - 0.5f * z;
+    float4 res = (m + y) + fe * 0.693359375f;
+
+    int4 special = ~((v >= 0x1.0p-126f) & (v <= 0x1.fffffep127f));
+    V_FIXUP_FN(res, special, log, v)
+    return res;
+}
+FN_FUNC_FN_V4(log)
 
 extern float __attribute__((overloadable)) log10(float);
-FN_FUNC_FN(log10)
+extern float2 __attribute__((overloadable)) log10(float2 v) {
+    return log(v) * 0.434294482f;
+}
+extern float3 __attribute__((overloadable)) log10(float3 v) {
+    return log(v) * 0.434294482f;
+}
+extern float4 __attribute__((overloadable)) log10(float4 v) {
+    return log(v) * 0.434294482f;
+}
 
 
 extern float __attribute__((overloadable)) log2(float v) {
     return log10(v) * 3.321928095f;
 }
-FN_FUNC_FN(log2)
+extern float2 __attribute__((overloadable)) log2(float2 v) {
+    return log(v) * 1.442695041f;
+}
+extern float3 __attribute__((overloadable)) log2(float3 v) {
+    return log(v) * 1.442695041f;
+}
+extern float4 __attribute__((overloadable)) log2(float4 v) {
+    return log(v) * 1.442695041f;
+}
 
 extern float __attribute__((overloadable)) log1p(float);
 FN_FUNC_FN(log1p)
@@ -510,7 +731,62 @@ extern float __attribute__((overloadable)) nan(uint v) {
 extern float __attribute__((overloadable)) nextafter(float, float);
 FN_FUNC_FN_FN(nextafter)
 
-FN_FUNC_FN_FN(pow)
+extern float4 __attribute__((overloadable)) pow(float4 x, float4 y) {
+    // pow(x, y) = 2^(y * log2(x)).  log2(x) and the product are carried as
+    // float pairs so that the error in the product stays around a float ulp
+    // of the result over the whole range.
+    int4 ix = (int4)x;
+    int4 e = (ix >> (int4)23) - 127;
+    float4 m = (float4)((ix & 0x007fffff) | 0x3f800000);
+    int4 big = m > 1.41421356f;
+    e -= big;
+    m = vSelect(big, m * 0.5f, m);
+
+    // log(m) = 2 * atanh(s) with s = (m - 1) / (m + 1), |s| < 0.172.  m - 1
+    // is exact, m + 1 is kept as vh + vl, and sl is the error of s.
+    float4 u = m - 1.f;
+    float4 vh = m + 1.f;
+    float4 vb = vh - m;
+    float4 vl = (m - (vh - vb)) + (1.f - vb);
+    float4 rv = 1.f / vh;
+    float4 s = u * rv;
+    float4 ph, pl;
+    vMul12(s, vh, &ph, &pl);
+    float4 sl = (((u - ph) - pl) - s * vl) * rv;
+    float4 z = s * s;
+    float4 q = 2.f / 11.f;
+    q = q * z + 2.f / 9.f;
+    q = q * z + 2.f / 7.f;
+    q = q * z + 2.f / 5.f;
+    q = q * z + 2.f / 3.f;
+    float4 lh = 2.f * s;
+    float4 ll = 2.f * sl * (1.f + z) + s * z * q;
+
+    // log2(x) = e + log(m) * log2(e), as hi + lo.
+    float4 a, b;
+    vMul12(lh, 1.44269502162933349609375f, &a, &b);
+    b += lh * 1.925963033500011079e-8f + ll * 1.44269502162933349609375f;
+    float4 a2 = a + b;
+    b = b - (a2 - a);
+    float4 fe = convert_float4(e);
+    float4 hi = fe + a2;
+    float4 lo = ((fe - hi) + a2) + b;
+
+    float4 th, tl;
+    vMul12(y, hi, &th, &tl);
+    tl += y * lo;
+    float4 fn = rint(th);
+    float4 g = (th - fn) + tl;
+    float4 res = vExpPoly(g * 0.693147180559945309f) * vPow2i(fn);
+
+    // The split in vMul12 overflows for huge y.
+    int4 ay = (int4)y & 0x7fffffff;
+    int4 special = ~((x >= 0x1.0p-126f) & (x <= 0x1.fffffep127f) &
+                     (ay < 0x5f800000) & (fn >= -125.f) & (fn <= 127.f));
+    V_FIXUP_FN_FN(res, special, pow, x, y)
+    return res;
+}
+FN_FUNC_FN_FN_V4(pow)
 
 extern float __attribute__((overloadable)) pown(float v, int p) {
     /* The mantissa of a float has fewer bits than an int (24 effective vs. 31).
@@ -544,7 +820,21 @@ extern float __attribute__((overloadable)) remquo(float, float, int *);
 FN_FUNC_FN_FN_PIN(remquo)
 
 extern float __attribute__((overloadable)) rint(float);
-FN_FUNC_FN(rint)
+#if !defined(__i386__) && !defined(__x86_64__)
+extern float4 __attribute__((overloadable)) rint(float4 v) {
+    // Adding and subtracting 2^23 rounds to nearest even; anything larger
+    // is already integral.
+    int4 iv = (int4)v;
+    float4 av = (float4)(iv & 0x7fffffff);
+    float4 r = (av + 0x1.0p23f) - 0x1.0p23f;
+    r = (float4)((int4)r | (iv & (int)0x80000000));
+    return vSelect(av < 0x1.0p23f, r, v);
+}
+FN_FUNC_FN_V4(rint)
+#else
+extern float2 __attribute__((overloadable)) rint(float2);
+extern float3 __attribute__((overloadable)) rint(float3);
+#endif // !defined(__i386__) && !defined(__x86_64__)
 
 extern float __attribute__((overloadable)) rootn(float v, int r) {
     if (r == 0) {
@@ -599,7 +889,22 @@ extern float4 __attribute__((overloadable)) sqrt(float4);
 FN_FUNC_FN(rsqrt)
 
 extern float __attribute__((overloadable)) sin(float);
-FN_FUNC_FN(sin)
+extern float4 __attribute__((overloadable)) sin(float4 v) {
+    int4 iv = (int4)v;
+    float4 av = (float4)(iv & 0x7fffffff);
+    int4 j;
+    float4 lo;
+    float4 r = vTrigReduce(av, &j, &lo);
+    float4 z = r * r;
+    float4 res = vSelect((j & 2) != 0, vCosPoly(r, z, lo), vSinPoly(r, z, lo));
+    int4 sign = (((j & 4) != 0) & (int)0x80000000) ^ (iv & (int)0x80000000);
+    res = (float4)((int4)res ^ sign);
+
+    int4 special = ~(av <= 8192.f);
+    V_FIXUP_FN(res, special, sin, v)
+    return res;
+}
+FN_FUNC_FN_V4(sin)
 
 extern float __attribute__((overloadable)) sincos(float v, float *cosptr) {
     *cosptr = cos(v);
@@ -1004,7 +1309,15 @@ extern float4 __attribute__((overloadable)) normalize(float4 v) {
 extern float __attribute__((overloadable)) half_sqrt(float v) {
     return sqrt(v);
 }
-FN_FUNC_FN(half_sqrt)
+extern float2 __attribute__((overloadable)) half_sqrt(float2 v) {
+    return sqrt(v);
+}
+extern float3 __attribute__((overloadable)) half_sqrt(float3 v) {
+    return sqrt(v);
+}
+extern float4 __attribute__((overloadable)) half_sqrt(float4 v) {
+    return sqrt(v);
+}
 
 extern float __attribute__((overloadable)) fast_length(float v) {
     return fabs(v);
@@ -1203,18 +1516,23 @@ extern float __attribute__((overloadable)) native_log2(float v) {
                  ((0.014631916f / 0.693147181f) * ir2*ir2*ir2);
     return (float)(e - 127) + adj2;
 }
-extern float2 __attribute__((overloadable)) native_log2(float2 v) {
-    float2 v2 = {native_log2(v.x), native_log2(v.y)};
-    return v2;
-}
-extern float3 __attribute__((overloadable)) native_log2(float3 v) {
-    float3 v2 = {native_log2(v.x), native_log2(v.y), native_log2(v.z)};
-    return v2;
-}
 extern float4 __attribute__((overloadable)) native_log2(float4 v) {
-    float4 v2 = {native_log2(v.x), native_log2(v.y), native_log2(v.z), native_log2(v.w)};
-    return v2;
-}
+    int4 ibits = (int4)v;
+    int4 e = (ibits >> (int4)23) & 0xff;
+
+    float4 ir = (float4)((ibits & 0x7fffff) | (127 << 23));
+    ir -= 1.5f;
+    float4 ir2 = ir*ir;
+    float4 adj2 = (0.405465108f / 0.693147181f) +
+                  ((0.666666667f / 0.693147181f) * ir) -
+                  ((0.222222222f / 0.693147181f) * ir2) +
+                  ((0.098765432f / 0.693147181f) * ir*ir2) -
+                  ((0.049382716f / 0.693147181f) * ir2*ir2) +
+                  ((0.026337449f / 0.693147181f) * ir*ir2*ir2) -
+                  ((0.014631916f / 0.693147181f) * ir2*ir2*ir2);
+    return convert_float4(e - 127) + adj2;
+}
+FN_FUNC_FN_V4(native_log2)
 
 extern float __attribute__((overloadable)) native_log(float v) {
     return native_log2(v) * (1.f / 1.442695041f);
@@ -1508,6 +1826,10 @@ float4 __attribute__((overloadable)) native_recip(float4 v) { return ((float4)1.
 
 
 #undef FN_FUNC_FN
+#undef FN_FUNC_FN_V4
+#undef FN_FUNC_FN_FN_V4
+#undef V_FIXUP_FN
+#undef V_FIXUP_FN_FN
 #undef IN_FUNC_FN
 #undef FN_FUNC_FN_FN
 #undef FN_FUNC_FN_F
@@ -43,537 +43,388 @@ static float3 getFrom565(uint16_t color) {
     return result;
 }
 
+static inline float getFromHalf(uint16_t h) {
+    union {
+        uint32_t u;
+        float f;
+    } v;
+    uint32_t sign = ((uint32_t)h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+
+    if (exp == 0) {
+        // Zero or denormal, mant * 2^-24.
+        float f = (float)mant * (1.f / 16777216.f);
+        return sign ? -f : f;
+    }
+    if (exp == 0x1f) {
+        v.u = sign | 0x7f800000 | (mant << 13);
+    } else {
+        v.u = sign | ((exp + 112) << 23) | (mant << 13);
+    }
+    return v.f;
+}
+
 /**
 * Allocation sampling
+*
+* Every supported (data kind, data type) pair gets its own set of nearest and
+* linear routines, generated below, with the texel fetch inlined.  rsSample
+* resolves the element and sampler state into a SampleOp_t once per call, or
+* once per batch for the array overloads, and then only pays one indirect
+* call per sample.  Texels are returned as normalized float4 with the usual
+* channel mapping for the pixel kind; RS_KIND_USER elements map their vector
+* lanes directly onto rgba.
 */
-static inline float __attribute__((overloadable))
-        getElementAt1(const uint8_t *p, int32_t x) {
-    float r = p[x];
-    return r;
-}
-
-static inline float2 __attribute__((overloadable))
-        getElementAt2(const uint8_t *p, int32_t x) {
-    x *= 2;
-    float2 r = {p[x], p[x+1]};
-    return r;
-}
 
-static inline float3 __attribute__((overloadable))
-        getElementAt3(const uint8_t *p, int32_t x) {
-    x *= 4;
-    float3 r = {p[x], p[x+1], p[x+2]};
+#define LOAD_U8(p, i)   ((float)((const uint8_t *)(p))[i] * (1.f / 255.f))
+#define LOAD_F16(p, i)  getFromHalf(((const uint16_t *)(p))[i])
+#define LOAD_F32(p, i)  (((const float *)(p))[i])
+
+// vec3 texels are padded to four lanes, as in the Allocation itself.
+#define DEFINE_TEXEL_FETCH(S)                                               \
+static inline float4 fetch_A_##S(const uint8_t *p, int32_t x) {            \
+    float4 r = {0.f, 0.f, 0.f, LOAD_##S(p, x)};                             \
+    return r;                                                               \
+}                                                                           \
+static inline float4 fetch_L_##S(const uint8_t *p, int32_t x) {            \
+    float l = LOAD_##S(p, x);                                               \
+    float4 r = {l, l, l, 1.f};                                              \
+    return r;                                                               \
+}                                                                           \
+static inline float4 fetch_LA_##S(const uint8_t *p, int32_t x) {           \
+    x *= 2;                                                                 \
+    float l = LOAD_##S(p, x);                                               \
+    float4 r = {l, l, l, LOAD_##S(p, x + 1)};                               \
+    return r;                                                               \
+}                                                                           \
+static inline float4 fetch_R_##S(const uint8_t *p, int32_t x) {            \
+    float4 r = {LOAD_##S(p, x), 0.f, 0.f, 1.f};                             \
+    return r;                                                               \
+}                                                                           \
+static inline float4 fetch_RG_##S(const uint8_t *p, int32_t x) {           \
+    x *= 2;                                                                 \
+    float4 r = {LOAD_##S(p, x), LOAD_##S(p, x + 1), 0.f, 1.f};              \
+    return r;                                                               \
+}                                                                           \
+static inline float4 fetch_RGB_##S(const uint8_t *p, int32_t x) {          \
+    x *= 4;                                                                 \
+    float4 r = {LOAD_##S(p, x), LOAD_##S(p, x + 1), LOAD_##S(p, x + 2), 1.f};\
+    return r;                                                               \
+}                                                                           \
+static inline float4 fetch_RGBA_##S(const uint8_t *p, int32_t x) {         \
+    x *= 4;                                                                 \
+    float4 r = {LOAD_##S(p, x), LOAD_##S(p, x + 1),                         \
+                LOAD_##S(p, x + 2), LOAD_##S(p, x + 3)};                    \
+    return r;                                                               \
+}
+
+DEFINE_TEXEL_FETCH(U8)
+DEFINE_TEXEL_FETCH(F16)
+DEFINE_TEXEL_FETCH(F32)
+
+static inline float4 fetch_565(const uint8_t *p, int32_t x) {
+    float4 r;
+    r.xyz = getFrom565(((const uint16_t *)p)[x]) * (1.f / 255.f);
+    r.w = 1.f;
     return r;
 }
 
-static inline float4 __attribute__((overloadable))
-        getElementAt4(const uint8_t *p, int32_t x) {
-    x *= 4;
-    const uchar4 *p2 = (const uchar4 *)&p[x];
-    return convert_float4(p2[0]);
-}
-
-static inline float3 __attribute__((overloadable))
-        getElementAt565(const uint8_t *p, int32_t x) {
-    x *= 2;
-    float3 r = getFrom565(((const uint16_t *)p)[0]);
-    return r;
-}
-
-static inline float __attribute__((overloadable))
-        getElementAt1(const uint8_t *p, size_t stride, int32_t x, int32_t y) {
-    p += y * stride;
-    float r = p[x];
-    return r;
-}
-
-static inline float2 __attribute__((overloadable))
-        getElementAt2(const uint8_t *p, size_t stride, int32_t x, int32_t y) {
-    p += y * stride;
-    x *= 2;
-    float2 r = {p[x], p[x+1]};
-    return r;
-}
-
-static inline float3 __attribute__((overloadable))
-        getElementAt3(const uint8_t *p, size_t stride, int32_t x, int32_t y) {
-    p += y * stride;
-    x *= 4;
-    float3 r = {p[x], p[x+1], p[x+2]};
-    return r;
-}
-
-static inline float4 __attribute__((overloadable))
-        getElementAt4(const uint8_t *p, size_t stride, int32_t x, int32_t y) {
-    p += y * stride;
-    x *= 4;
-    float4 r = {p[x], p[x+1], p[x+2], p[x+3]};
-    return r;
-}
-
-static inline float3 __attribute__((overloadable))
-        getElementAt565(const uint8_t *p, size_t stride, int32_t x, int32_t y) {
-    p += y * stride;
-    x *= 2;
-    float3 r = getFrom565(((const uint16_t *)p)[0]);
-    return r;
-}
-
-
-
-
-
-static float4 __attribute__((overloadable))
-            getSample_A(const uint8_t *p, int32_t iPixel,
-                          int32_t next, float w0, float w1) {
-    float p0 = getElementAt1(p, iPixel);
-    float p1 = getElementAt1(p, next);
-    float r = p0 * w0 + p1 * w1;
-    r *= (1.f / 255.f);
-    float4 ret = {0.f, 0.f, 0.f, r};
-    return ret;
-}
-static float4 __attribute__((overloadable))
-            getSample_L(const uint8_t *p, int32_t iPixel,
-                          int32_t next, float w0, float w1) {
-    float p0 = getElementAt1(p, iPixel);
-    float p1 = getElementAt1(p, next);
-    float r = p0 * w0 + p1 * w1;
-    r *= (1.f / 255.f);
-    float4 ret = {r, r, r, 1.f};
-    return ret;
-}
-static float4 __attribute__((overloadable))
-            getSample_LA(const uint8_t *p, int32_t iPixel,
-                           int32_t next, float w0, float w1) {
-    float2 p0 = getElementAt2(p, iPixel);
-    float2 p1 = getElementAt2(p, next);
-    float2 r = p0 * w0 + p1 * w1;
-    r *= (1.f / 255.f);
-    float4 ret = {r.x, r.x, r.x, r.y};
-    return ret;
-}
-static float4 __attribute__((overloadable))
-            getSample_RGB(const uint8_t *p, int32_t iPixel,
-                            int32_t next, float w0, float w1) {
-    float3 p0 = getElementAt3(p, iPixel);
-    float3 p1 = getElementAt3(p, next);
-    float3 r = p0 * w0 + p1 * w1;
-    r *= (1.f / 255.f);
-    float4 ret = {r.x, r.x, r.z, 1.f};
-    return ret;
-}
-static float4 __attribute__((overloadable))
-            getSample_565(const uint8_t *p, int32_t iPixel,
-                           int32_t next, float w0, float w1) {
-    float3 p0 = getElementAt565(p, iPixel);
-    float3 p1 = getElementAt565(p, next);
-    float3 r = p0 * w0 + p1 * w1;
-    r *= (1.f / 255.f);
-    float4 ret = {r.x, r.x, r.z, 1.f};
-    return ret;
-}
-static float4 __attribute__((overloadable))
-            getSample_RGBA(const uint8_t *p, int32_t iPixel,
-                             int32_t next, float w0, float w1) {
-    float4 p0 = getElementAt4(p, iPixel);
-    float4 p1 = getElementAt4(p, next);
-    float4 r = p0 * w0 + p1 * w1;
-    r *= (1.f / 255.f);
-    return r;
-}
-
-
-static float4 __attribute__((overloadable))
-            getSample_A(const uint8_t *p, size_t stride,
-                          int locX, int locY, int nextX, int nextY,
-                          float w0, float w1, float w2, float w3) {
-    float p0 = getElementAt1(p, stride, locX, locY);
-    float p1 = getElementAt1(p, stride, nextX, locY);
-    float p2 = getElementAt1(p, stride, locX, nextY);
-    float p3 = getElementAt1(p, stride, nextX, nextY);
-    float r = p0 * w0 + p1 * w1 + p2 * w2 + p3 * w3;
-    r *= (1.f / 255.f);
-    float4 ret = {0.f, 0.f, 0.f, r};
-    return ret;
-}
-static float4 __attribute__((overloadable))
-            getSample_L(const uint8_t *p, size_t stride,
-                         int locX, int locY, int nextX, int nextY,
-                         float w0, float w1, float w2, float w3) {
-    float p0 = getElementAt1(p, stride, locX, locY);
-    float p1 = getElementAt1(p, stride, nextX, locY);
-    float p2 = getElementAt1(p, stride, locX, nextY);
-    float p3 = getElementAt1(p, stride, nextX, nextY);
-    float r = p0 * w0 + p1 * w1 + p2 * w2 + p3 * w3;
-    r *= (1.f / 255.f);
-    float4 ret = {r, r, r, 1.f};
-    return ret;
-}
-static float4 __attribute__((overloadable))
-            getSample_LA(const uint8_t *p, size_t stride,
-                         int locX, int locY, int nextX, int nextY,
-                         float w0, float w1, float w2, float w3) {
-    float2 p0 = getElementAt2(p, stride, locX, locY);
-    float2 p1 = getElementAt2(p, stride, nextX, locY);
-    float2 p2 = getElementAt2(p, stride, locX, nextY);
-    float2 p3 = getElementAt2(p, stride, nextX, nextY);
-    float2 r = p0 * w0 + p1 * w1 + p2 * w2 + p3 * w3;
-    r *= (1.f / 255.f);
-    float4 ret = {r.x, r.x, r.x, r.y};
-    return ret;
-}
-static float4 __attribute__((overloadable))
-            getSample_RGB(const uint8_t *p, size_t stride,
-                         int locX, int locY, int nextX, int nextY,
-                         float w0, float w1, float w2, float w3) {
-    float4 p0 = getElementAt4(p, stride, locX, locY);
-    float4 p1 = getElementAt4(p, stride, nextX, locY);
-    float4 p2 = getElementAt4(p, stride, locX, nextY);
-    float4 p3 = getElementAt4(p, stride, nextX, nextY);
-    float4 r = p0 * w0 + p1 * w1 + p2 * w2 + p3 * w3;
-    r *= (1.f / 255.f);
-    float4 ret = {r.x, r.y, r.z, 1.f};
-    return ret;
-}
-static float4 __attribute__((overloadable))
-            getSample_RGBA(const uint8_t *p, size_t stride,
-                         int locX, int locY, int nextX, int nextY,
-                         float w0, float w1, float w2, float w3) {
-    float4 p0 = getElementAt4(p, stride, locX, locY);
-    float4 p1 = getElementAt4(p, stride, nextX, locY);
-    float4 p2 = getElementAt4(p, stride, locX, nextY);
-    float4 p3 = getElementAt4(p, stride, nextX, nextY);
-    float4 r = p0 * w0 + p1 * w1 + p2 * w2 + p3 * w3;
-    r *= (1.f / 255.f);
-    return r;
-}
-static float4 __attribute__((overloadable))
-            getSample_565(const uint8_t *p, size_t stride,
-                         int locX, int locY, int nextX, int nextY,
-                         float w0, float w1, float w2, float w3) {
-    float3 p0 = getElementAt565(p, stride, locX, locY);
-    float3 p1 = getElementAt565(p, stride, nextX, locY);
-    float3 p2 = getElementAt565(p, stride, locX, nextY);
-    float3 p3 = getElementAt565(p, stride, nextX, nextY);
-    float3 r = p0 * w0 + p1 * w1 + p2 * w2 + p3 * w3;
-    r *= (1.f / 255.f);
-    float4 ret;
-    ret.rgb = r;
-    ret.w = 1.f;
-    return ret;
-}
-
-static float4 __attribute__((overloadable))
-        getBilinearSample1D(const Allocation_t *alloc, float2 weights,
-                          uint32_t iPixel, uint32_t next,
-                          rs_data_kind dk, rs_data_type dt, uint32_t lod) {
-
-     const uint8_t *p = (const uint8_t *)alloc->mHal.drvState.lod[lod].mallocPtr;
-
-     switch(dk) {
-     case RS_KIND_PIXEL_RGBA:
-         return getSample_RGBA(p, iPixel, next, weights.x, weights.y);
-     case RS_KIND_PIXEL_A:
-         return getSample_A(p, iPixel, next, weights.x, weights.y);
-     case RS_KIND_PIXEL_RGB:
-         if (dt == RS_TYPE_UNSIGNED_5_6_5) {
-             return getSample_565(p, iPixel, next, weights.x, weights.y);
-         }
-         return getSample_RGB(p, iPixel, next, weights.x, weights.y);
-     case RS_KIND_PIXEL_L:
-         return getSample_L(p, iPixel, next, weights.x, weights.y);
-     case RS_KIND_PIXEL_LA:
-         return getSample_LA(p, iPixel, next, weights.x, weights.y);
-
-     default:
-         //__builtin_unreachable();
-         break;
-     }
-
-     //__builtin_unreachable();
-     return 0.f;
-}
-
-static uint32_t wrapI(rs_sampler_value wrap, int32_t coord, int32_t size) {
+/*
+ * Texture coordinate wrapping.  Power of two sizes, the common case for
+ * textures, wrap with a mask instead of an integer modulo.
+ */
+static inline int32_t wrapCoord(rs_sampler_value wrap, int32_t coord, int32_t size) {
+    const bool pow2 = (size & (size - 1)) == 0;
     if (wrap == RS_SAMPLER_WRAP) {
+        if (pow2) {
+            return coord & (size - 1);
+        }
         coord = coord % size;
         if (coord < 0) {
             coord += size;
         }
+        return coord;
     }
     if (wrap == RS_SAMPLER_MIRRORED_REPEAT) {
-        coord = coord % (size * 2);
-        if (coord < 0) {
-            coord = (size * 2) + coord;
+        int32_t period = size * 2;
+        if (pow2) {
+            coord &= period - 1;
+        } else {
+            coord = coord % period;
+            if (coord < 0) {
+                coord += period;
+            }
         }
         if (coord >= size) {
-            coord = (size * 2) - coord;
+            coord = period - 1 - coord;
         }
+        return coord;
     }
-    return (uint32_t)max(0, min(coord, size - 1));
-}
-
-static float4 __attribute__((overloadable))
-        getBilinearSample2D(const Allocation_t *alloc, float w0, float w1, float w2, float w3,
-                          int lx, int ly, int nx, int ny,
-                          rs_data_kind dk, rs_data_type dt, uint32_t lod) {
-
-    const uint8_t *p = (const uint8_t *)alloc->mHal.drvState.lod[lod].mallocPtr;
-    size_t stride = alloc->mHal.drvState.lod[lod].stride;
+    return max(0, min(coord, size - 1));
+}
+
+struct SampleOp;
+
+typedef float4 (*Sample1D_t)(const struct SampleOp *op, uint32_t lod, float u);
+typedef float4 (*Sample2D_t)(const struct SampleOp *op, uint32_t lod, float2 uv);
+
+typedef struct {
+    Sample1D_t nearest1D;
+    Sample1D_t linear1D;
+    Sample2D_t nearest2D;
+    Sample2D_t linear2D;
+} SampleFuncs_t;
+
+typedef struct SampleOp {
+    const Allocation_t *alloc;
+    const SampleFuncs_t *funcs;
+    rs_sampler_value magFilter;
+    rs_sampler_value minFilter;
+    rs_sampler_value wrapS;
+    rs_sampler_value wrapT;
+    uint32_t maxLOD;
+} SampleOp_t;
+
+#define DEFINE_SAMPLERS(NAME)                                                   \
+static float4 nearest1D_##NAME(const SampleOp_t *op, uint32_t lod, float u) {  \
+    const uint8_t *p = (const uint8_t *)op->alloc->mHal.drvState.lod[lod].mallocPtr; \
+    int32_t w = op->alloc->mHal.drvState.lod[lod].dimX;                         \
+    int32_t x = wrapCoord(op->wrapS, (int32_t)floor(u * (float)w), w);          \
+    return fetch_##NAME(p, x);                                                  \
+}                                                                               \
+static float4 linear1D_##NAME(const SampleOp_t *op, uint32_t lod, float u) {   \
+    const uint8_t *p = (const uint8_t *)op->alloc->mHal.drvState.lod[lod].mallocPtr; \
+    int32_t w = op->alloc->mHal.drvState.lod[lod].dimX;                         \
+    float pu = u * (float)w - 0.5f;                                             \
+    float iu = floor(pu);                                                       \
+    float fu = pu - iu;                                                         \
+    int32_t x0 = wrapCoord(op->wrapS, (int32_t)iu, w);                          \
+    int32_t x1 = wrapCoord(op->wrapS, (int32_t)iu + 1, w);                      \
+    return fetch_##NAME(p, x0) * (1.f - fu) + fetch_##NAME(p, x1) * fu;         \
+}                                                                               \
+static float4 nearest2D_##NAME(const SampleOp_t *op, uint32_t lod, float2 uv) {\
+    const uint8_t *p = (const uint8_t *)op->alloc->mHal.drvState.lod[lod].mallocPtr; \
+    size_t stride = op->alloc->mHal.drvState.lod[lod].stride;                   \
+    int32_t w = op->alloc->mHal.drvState.lod[lod].dimX;                         \
+    int32_t h = op->alloc->mHal.drvState.lod[lod].dimY;                         \
+    int32_t x = wrapCoord(op->wrapS, (int32_t)floor(uv.x * (float)w), w);       \
+    int32_t y = wrapCoord(op->wrapT, (int32_t)floor(uv.y * (float)h), h);       \
+    return fetch_##NAME(p + y * stride, x);                                     \
+}                                                                               \
+static float4 linear2D_##NAME(const SampleOp_t *op, uint32_t lod, float2 uv) { \
+    const uint8_t *p = (const uint8_t *)op->alloc->mHal.drvState.lod[lod].mallocPtr; \
+    size_t stride = op->alloc->mHal.drvState.lod[lod].stride;                   \
+    int32_t w = op->alloc->mHal.drvState.lod[lod].dimX;                         \
+    int32_t h = op->alloc->mHal.drvState.lod[lod].dimY;                         \
+    float pu = uv.x * (float)w - 0.5f;                                          \
+    float pv = uv.y * (float)h - 0.5f;                                          \
+    float iu = floor(pu);                                                       \
+    float iv = floor(pv);                                                       \
+    float fu = pu - iu;                                                         \
+    float fv = pv - iv;                                                         \
+    int32_t x0 = wrapCoord(op->wrapS, (int32_t)iu, w);                          \
+    int32_t x1 = wrapCoord(op->wrapS, (int32_t)iu + 1, w);                      \
+    const uint8_t *r0 = p + wrapCoord(op->wrapT, (int32_t)iv, h) * stride;      \
+    const uint8_t *r1 = p + wrapCoord(op->wrapT, (int32_t)iv + 1, h) * stride;  \
+    float4 t = fetch_##NAME(r0, x0) * (1.f - fu) + fetch_##NAME(r0, x1) * fu;   \
+    float4 b = fetch_##NAME(r1, x0) * (1.f - fu) + fetch_##NAME(r1, x1) * fu;   \
+    return t * (1.f - fv) + b * fv;                                             \
+}
+
+#define DEFINE_SAMPLERS_ALL_KINDS(S)    \
+    DEFINE_SAMPLERS(A_##S)              \
+    DEFINE_SAMPLERS(L_##S)              \
+    DEFINE_SAMPLERS(LA_##S)             \
+    DEFINE_SAMPLERS(R_##S)              \
+    DEFINE_SAMPLERS(RG_##S)             \
+    DEFINE_SAMPLERS(RGB_##S)            \
+    DEFINE_SAMPLERS(RGBA_##S)
+
+DEFINE_SAMPLERS_ALL_KINDS(U8)
+DEFINE_SAMPLERS_ALL_KINDS(F16)
+DEFINE_SAMPLERS_ALL_KINDS(F32)
+DEFINE_SAMPLERS(565)
+
+typedef enum {
+    SAMPLE_KIND_A,
+    SAMPLE_KIND_L,
+    SAMPLE_KIND_LA,
+    SAMPLE_KIND_R,
+    SAMPLE_KIND_RG,
+    SAMPLE_KIND_RGB,
+    SAMPLE_KIND_RGBA,
+    SAMPLE_KIND_COUNT
+} SampleKind;
+
+typedef enum {
+    SAMPLE_STORAGE_U8,
+    SAMPLE_STORAGE_F16,
+    SAMPLE_STORAGE_F32,
+    SAMPLE_STORAGE_COUNT
+} SampleStorage;
+
+#define SAMPLE_FUNCS(NAME) \
+    { nearest1D_##NAME, linear1D_##NAME, nearest2D_##NAME, linear2D_##NAME }
+
+#define SAMPLE_FUNCS_ALL_STORAGE(K) \
+    { SAMPLE_FUNCS(K##_U8), SAMPLE_FUNCS(K##_F16), SAMPLE_FUNCS(K##_F32) }
+
+static const SampleFuncs_t gSampleFuncs[SAMPLE_KIND_COUNT][SAMPLE_STORAGE_COUNT] = {
+    SAMPLE_FUNCS_ALL_STORAGE(A),
+    SAMPLE_FUNCS_ALL_STORAGE(L),
+    SAMPLE_FUNCS_ALL_STORAGE(LA),
+    SAMPLE_FUNCS_ALL_STORAGE(R),
+    SAMPLE_FUNCS_ALL_STORAGE(RG),
+    SAMPLE_FUNCS_ALL_STORAGE(RGB),
+    SAMPLE_FUNCS_ALL_STORAGE(RGBA),
+};
+
+static const SampleFuncs_t gSampleFuncs565 = SAMPLE_FUNCS(565);
+
+static const SampleFuncs_t * getSampleFuncs(const Element_t *elem) {
+    rs_data_type dt = elem->mHal.state.dataType;
+    int32_t kind;
+    int32_t storage;
 
-    switch(dk) {
-    case RS_KIND_PIXEL_RGBA:
-        return getSample_RGBA(p, stride, lx, ly, nx, ny, w0, w1, w2, w3);
+    switch (elem->mHal.state.dataKind) {
     case RS_KIND_PIXEL_A:
-        return getSample_A(p, stride, lx, ly, nx, ny, w0, w1, w2, w3);
+        kind = SAMPLE_KIND_A;
+        break;
+    case RS_KIND_PIXEL_L:
+        kind = SAMPLE_KIND_L;
+        break;
     case RS_KIND_PIXEL_LA:
-        return getSample_LA(p, stride, lx, ly, nx, ny, w0, w1, w2, w3);
+        kind = SAMPLE_KIND_LA;
+        break;
     case RS_KIND_PIXEL_RGB:
         if (dt == RS_TYPE_UNSIGNED_5_6_5) {
-            return getSample_565(p, stride, lx, ly, nx, ny, w0, w1, w2, w3);
+            return &gSampleFuncs565;
         }
-        return getSample_RGB(p, stride, lx, ly, nx, ny, w0, w1, w2, w3);
-    case RS_KIND_PIXEL_L:
-        return getSample_L(p, stride, lx, ly, nx, ny, w0, w1, w2, w3);
-
-    default:
+        kind = SAMPLE_KIND_RGB;
         break;
-    }
-
-    return 0.f;
-}
-
-static float4  __attribute__((overloadable))
-        getNearestSample(const Allocation_t *alloc, uint32_t iPixel, rs_data_kind dk,
-                         rs_data_type dt, uint32_t lod) {
-
-    const uint8_t *p = (const uint8_t *)alloc->mHal.drvState.lod[lod].mallocPtr;
-
-    float4 result = {0.f, 0.f, 0.f, 255.f};
-
-    switch(dk) {
     case RS_KIND_PIXEL_RGBA:
-        result = getElementAt4(p, iPixel);
-        break;
-    case RS_KIND_PIXEL_A:
-        result.w = getElementAt1(p, iPixel);
-        break;
-    case RS_KIND_PIXEL_LA:
-        result.zw = getElementAt2(p, iPixel);
-        result.xy = result.z;
+        kind = SAMPLE_KIND_RGBA;
         break;
-    case RS_KIND_PIXEL_RGB:
-        if (dt == RS_TYPE_UNSIGNED_5_6_5) {
-            result.xyz = getElementAt565(p, iPixel);
-        } else {
-            result.xyz = getElementAt3(p, iPixel);
+    case RS_KIND_USER:
+        switch (elem->mHal.state.vectorSize) {
+        case 1:
+            kind = SAMPLE_KIND_R;
+            break;
+        case 2:
+            kind = SAMPLE_KIND_RG;
+            break;
+        case 3:
+            kind = SAMPLE_KIND_RGB;
+            break;
+        case 4:
+            kind = SAMPLE_KIND_RGBA;
+            break;
+        default:
+            return NULL;
         }
         break;
-    case RS_KIND_PIXEL_L:
-        result.xyz = getElementAt1(p, iPixel);
-
     default:
-        //__builtin_unreachable();
-        break;
+        return NULL;
     }
 
-    return result * 0.003921569f;
-}
-
-static float4  __attribute__((overloadable))
-        getNearestSample(const Allocation_t *alloc, uint2 iPixel, rs_data_kind dk,
-                         rs_data_type dt, uint32_t lod) {
-
-    const uint8_t *p = (const uint8_t *)alloc->mHal.drvState.lod[lod].mallocPtr;
-    size_t stride = alloc->mHal.drvState.lod[lod].stride;
-
-    float4 result = {0.f, 0.f, 0.f, 255.f};
-
-    switch(dk) {
-    case RS_KIND_PIXEL_RGBA:
-        result = getElementAt4(p, stride, iPixel.x, iPixel.y);
+    switch (dt) {
+    case RS_TYPE_UNSIGNED_8:
+        storage = SAMPLE_STORAGE_U8;
         break;
-    case RS_KIND_PIXEL_A:
-        result.w = getElementAt1(p, stride, iPixel.x, iPixel.y);
+    case RS_TYPE_FLOAT_16:
+        storage = SAMPLE_STORAGE_F16;
         break;
-    case RS_KIND_PIXEL_LA:
-        result.zw = getElementAt2(p, stride, iPixel.x, iPixel.y);
-        result.xy = result.z;
+    case RS_TYPE_FLOAT_32:
+        storage = SAMPLE_STORAGE_F32;
         break;
-    case RS_KIND_PIXEL_RGB:
-        if (dt == RS_TYPE_UNSIGNED_5_6_5) {
-            result.xyz = getElementAt565(p, stride, iPixel.x, iPixel.y);
-        } else {
-            result.xyz = getElementAt3(p, stride, iPixel.x, iPixel.y);
-        }
-        break;
-
     default:
-        //__builtin_unreachable();
-        break;
+        return NULL;
     }
-
-    return result * 0.003921569f;
+    return &gSampleFuncs[kind][storage];
 }
 
-static float4 __attribute__((overloadable))
-        sample_LOD_LinearPixel(const Allocation_t *alloc,
-                               rs_data_kind dk, rs_data_type dt,
-                               rs_sampler_value wrapS,
-                               float uv, uint32_t lod) {
-
-    const uint8_t *p = (const uint8_t *)alloc->mHal.drvState.lod[lod].mallocPtr;
-
-    int32_t sourceW = alloc->mHal.drvState.lod[lod].dimX;
-    float pixelUV = uv * (float)(sourceW);
-    int32_t iPixel = (int32_t)(pixelUV);
-    float frac = pixelUV - (float)iPixel;
+static bool resolveSampleOp(SampleOp_t *op, rs_allocation a, rs_sampler s) {
+    const Allocation_t *alloc = (const Allocation_t *)a.p;
+    const Sampler_t *prog = (const Sampler_t *)s.p;
 
-    if (frac < 0.5f) {
-        iPixel -= 1;
-        frac += 0.5f;
-    } else {
-        frac -= 0.5f;
+    if (!(alloc->mHal.state.usageFlags & RS_ALLOCATION_USAGE_GRAPHICS_TEXTURE)) {
+        return false;
     }
 
-    float oneMinusFrac = 1.0f - frac;
-
-    float2 weights;
-    weights.x = oneMinusFrac;
-    weights.y = frac;
-
-    uint32_t next = wrapI(wrapS, iPixel + 1, sourceW);
-    uint32_t location = wrapI(wrapS, iPixel, sourceW);
-
-    return getBilinearSample1D(alloc, weights, location, next, dk, dt, lod);
-}
-
-static float4 __attribute__((overloadable))
-        sample_LOD_NearestPixel(const Allocation_t *alloc,
-                                rs_data_kind dk, rs_data_type dt,
-                                rs_sampler_value wrapS,
-                                float uv, uint32_t lod) {
-
-    int32_t sourceW = alloc->mHal.drvState.lod[lod].dimX;
-    int32_t iPixel = (int32_t)(uv * (float)(sourceW));
-    uint32_t location = wrapI(wrapS, iPixel, sourceW);
-
-    return getNearestSample(alloc, location, dk, dt, lod);
+    const Type_t *type = (const Type_t *)alloc->mHal.state.type;
+    op->funcs = getSampleFuncs((const Element_t *)type->mHal.state.element);
+    if (op->funcs == NULL) {
+        return false;
+    }
+    op->alloc = alloc;
+    op->magFilter = prog->mHal.state.magFilter;
+    op->minFilter = prog->mHal.state.minFilter;
+    op->wrapS = prog->mHal.state.wrapS;
+    op->wrapT = prog->mHal.state.wrapT;
+    op->maxLOD = type->mHal.state.lodCount - 1;
+    return true;
 }
 
-static float4 __attribute__((overloadable))
-        sample_LOD_LinearPixel(const Allocation_t *alloc,
-                               rs_data_kind dk, rs_data_type dt,
-                               rs_sampler_value wrapS,
-                               rs_sampler_value wrapT,
-                               float2 uv, uint32_t lod) {
-
-    const uint8_t *p = (const uint8_t *)alloc->mHal.drvState.lod[lod].mallocPtr;
-
-    int sourceW = alloc->mHal.drvState.lod[lod].dimX;
-    int sourceH = alloc->mHal.drvState.lod[lod].dimY;
-
-    float pixelU = uv.x * sourceW;
-    float pixelV = uv.y * sourceH;
-    int iPixelU = pixelU;
-    int iPixelV = pixelV;
-    float fracU = pixelU - iPixelU;
-    float fracV = pixelV - iPixelV;
-
-    if (fracU < 0.5f) {
-        iPixelU -= 1;
-        fracU += 0.5f;
-    } else {
-        fracU -= 0.5f;
-    }
-    if (fracV < 0.5f) {
-        iPixelV -= 1;
-        fracV += 0.5f;
-    } else {
-        fracV -= 0.5f;
+static float4 sample1D(const SampleOp_t *op, float uv, float lod) {
+    if (lod <= 0.0f) {
+        if (op->magFilter == RS_SAMPLER_NEAREST) {
+            return op->funcs->nearest1D(op, 0, uv);
+        }
+        return op->funcs->linear1D(op, 0, uv);
     }
-    float oneMinusFracU = 1.0f - fracU;
-    float oneMinusFracV = 1.0f - fracV;
-
-    float w0 = oneMinusFracU * oneMinusFracV;
-    float w1 = fracU * oneMinusFracV;
-    float w2 = oneMinusFracU * fracV;
-    float w3 = fracU * fracV;
-
-    int nx = wrapI(wrapS, iPixelU + 1, sourceW);
-    int ny = wrapI(wrapT, iPixelV + 1, sourceH);
-    int lx = wrapI(wrapS, iPixelU, sourceW);
-    int ly = wrapI(wrapT, iPixelV, sourceH);
 
-    return getBilinearSample2D(alloc, w0, w1, w2, w3, lx, ly, nx, ny, dk, dt, lod);
+    if (op->minFilter == RS_SAMPLER_LINEAR_MIP_NEAREST) {
+        lod = min(lod, (float)op->maxLOD);
+        uint32_t nearestLOD = (uint32_t)round(lod);
+        return op->funcs->linear1D(op, nearestLOD, uv);
+    }
 
-}
+    if (op->minFilter == RS_SAMPLER_LINEAR_MIP_LINEAR) {
+        uint32_t lod0 = min((uint32_t)floor(lod), op->maxLOD);
+        uint32_t lod1 = min((uint32_t)ceil(lod), op->maxLOD);
+        float4 sample0 = op->funcs->linear1D(op, lod0, uv);
+        float4 sample1 = op->funcs->linear1D(op, lod1, uv);
+        float frac = lod - (float)lod0;
+        return sample0 * (1.0f - frac) + sample1 * frac;
+    }
 
-static float4 __attribute__((overloadable))
-        sample_LOD_NearestPixel(const Allocation_t *alloc,
-                                rs_data_kind dk, rs_data_type dt,
-                                rs_sampler_value wrapS,
-                                rs_sampler_value wrapT,
-                                float2 uv, uint32_t lod) {
-    int sourceW = alloc->mHal.drvState.lod[lod].dimX;
-    int sourceH = alloc->mHal.drvState.lod[lod].dimY;
-
-    float2 dimF;
-    dimF.x = (float)(sourceW);
-    dimF.y = (float)(sourceH);
-    int2 iPixel = convert_int2(uv * dimF);
-
-    uint2 location;
-    location.x = wrapI(wrapS, iPixel.x, sourceW);
-    location.y = wrapI(wrapT, iPixel.y, sourceH);
-    return getNearestSample(alloc, location, dk, dt, lod);
+    return op->funcs->nearest1D(op, 0, uv);
 }
 
-extern const float4 __attribute__((overloadable))
-        rsSample(rs_allocation a, rs_sampler s, float uv, float lod) {
-
-    const Allocation_t *alloc = (const Allocation_t *)a.p;
-    const Sampler_t *prog = (Sampler_t *)s.p;
-    const Type_t *type = (Type_t *)alloc->mHal.state.type;
-    const Element_t *elem = type->mHal.state.element;
-    rs_data_kind dk = elem->mHal.state.dataKind;
-    rs_data_type dt = elem->mHal.state.dataType;
-    rs_sampler_value sampleMin = prog->mHal.state.minFilter;
-    rs_sampler_value sampleMag = prog->mHal.state.magFilter;
-    rs_sampler_value wrapS = prog->mHal.state.wrapS;
-
-    if (!(alloc->mHal.state.usageFlags & RS_ALLOCATION_USAGE_GRAPHICS_TEXTURE)) {
-        return 0.f;
-    }
-
+static float4 sample2D(const SampleOp_t *op, float2 uv, float lod) {
     if (lod <= 0.0f) {
-        if (sampleMag == RS_SAMPLER_NEAREST) {
-            return sample_LOD_NearestPixel(alloc, dk, dt, wrapS, uv, 0);
+        if (op->magFilter == RS_SAMPLER_NEAREST) {
+            return op->funcs->nearest2D(op, 0, uv);
         }
-        return sample_LOD_LinearPixel(alloc, dk, dt, wrapS, uv, 0);
+        return op->funcs->linear2D(op, 0, uv);
     }
 
-    if (sampleMin == RS_SAMPLER_LINEAR_MIP_NEAREST) {
-        uint32_t maxLOD = type->mHal.state.lodCount - 1;
-        lod = min(lod, (float)maxLOD);
+    if (op->minFilter == RS_SAMPLER_LINEAR_MIP_NEAREST) {
+        lod = min(lod, (float)op->maxLOD);
         uint32_t nearestLOD = (uint32_t)round(lod);
-        return sample_LOD_LinearPixel(alloc, dk, dt, wrapS, uv, nearestLOD);
+        return op->funcs->linear2D(op, nearestLOD, uv);
     }
 
-    if (sampleMin == RS_SAMPLER_LINEAR_MIP_LINEAR) {
-        uint32_t lod0 = (uint32_t)floor(lod);
-        uint32_t lod1 = (uint32_t)ceil(lod);
-        uint32_t maxLOD = type->mHal.state.lodCount - 1;
-        lod0 = min(lod0, maxLOD);
-        lod1 = min(lod1, maxLOD);
-        float4 sample0 = sample_LOD_LinearPixel(alloc, dk, dt, wrapS, uv, lod0);
-        float4 sample1 = sample_LOD_LinearPixel(alloc, dk, dt, wrapS, uv, lod1);
+    if (op->minFilter == RS_SAMPLER_LINEAR_MIP_LINEAR) {
+        uint32_t lod0 = min((uint32_t)floor(lod), op->maxLOD);
+        uint32_t lod1 = min((uint32_t)ceil(lod), op->maxLOD);
+        float4 sample0 = op->funcs->linear2D(op, lod0, uv);
+        float4 sample1 = op->funcs->linear2D(op, lod1, uv);
         float frac = lod - (float)lod0;
         return sample0 * (1.0f - frac) + sample1 * frac;
     }
 
-    return sample_LOD_NearestPixel(alloc, dk, dt, wrapS, uv, 0);
+    return op->funcs->nearest2D(op, 0, uv);
+}
+
+extern const float4 __attribute__((overloadable))
+        rsSample(rs_allocation a, rs_sampler s, float uv, float lod) {
+    SampleOp_t op;
+    if (!resolveSampleOp(&op, a, s)) {
+        return 0.f;
+    }
+    return sample1D(&op, uv, lod);
 }
 
 extern const float4 __attribute__((overloadable))
@@ -584,70 +435,88 @@ extern const float4 __attribute__((overloadable))
 
 extern const float4 __attribute__((overloadable))
         rsSample(rs_allocation a, rs_sampler s, float2 uv, float lod) {
-
-    const Allocation_t *alloc = (const Allocation_t *)a.p;
-    const Sampler_t *prog = (Sampler_t *)s.p;
-    const Type_t *type = (Type_t *)alloc->mHal.state.type;
-    const Element_t *elem = type->mHal.state.element;
-    rs_data_kind dk = elem->mHal.state.dataKind;
-    rs_data_type dt = elem->mHal.state.dataType;
-    rs_sampler_value sampleMin = prog->mHal.state.minFilter;
-    rs_sampler_value sampleMag = prog->mHal.state.magFilter;
-    rs_sampler_value wrapS = prog->mHal.state.wrapS;
-    rs_sampler_value wrapT = prog->mHal.state.wrapT;
-
-    if (!(alloc->mHal.state.usageFlags & RS_ALLOCATION_USAGE_GRAPHICS_TEXTURE)) {
+    SampleOp_t op;
+    if (!resolveSampleOp(&op, a, s)) {
         return 0.f;
     }
+    return sample2D(&op, uv, lod);
+}
 
-    if (lod <= 0.0f) {
-        if (sampleMag == RS_SAMPLER_NEAREST) {
-            return sample_LOD_NearestPixel(alloc, dk, dt, wrapS, wrapT, uv, 0);
+extern const float4 __attribute__((overloadable))
+        rsSample(rs_allocation a, rs_sampler s, float2 uv) {
+    SampleOp_t op;
+    if (!resolveSampleOp(&op, a, s)) {
+        return 0.f;
+    }
+    if (op.magFilter == RS_SAMPLER_NEAREST) {
+        return op.funcs->nearest2D(&op, 0, uv);
+    }
+    return op.funcs->linear2D(&op, 0, uv);
+}
+
+/*
+ * Batch sampling.  The allocation and sampler are resolved once for the
+ * whole array, and the common level 0 case hoists the filter choice out of
+ * the loop as well.
+ */
+extern void __attribute__((overloadable))
+        rsSample(rs_allocation a, rs_sampler s, float4 *out,
+                 const float *locations, uint32_t count, float lod) {
+    SampleOp_t op;
+    if (!resolveSampleOp(&op, a, s)) {
+        for (uint32_t i = 0; i < count; i++) {
+            out[i] = 0.f;
         }
-        return sample_LOD_LinearPixel(alloc, dk, dt, wrapS, wrapT, uv, 0);
+        return;
     }
 
-    if (sampleMin == RS_SAMPLER_LINEAR_MIP_NEAREST) {
-        uint32_t maxLOD = type->mHal.state.lodCount - 1;
-        lod = min(lod, (float)maxLOD);
-        uint32_t nearestLOD = (uint32_t)round(lod);
-        return sample_LOD_LinearPixel(alloc, dk, dt, wrapS, wrapT, uv, nearestLOD);
+    if (lod <= 0.0f) {
+        Sample1D_t fn = (op.magFilter == RS_SAMPLER_NEAREST) ?
+                op.funcs->nearest1D : op.funcs->linear1D;
+        for (uint32_t i = 0; i < count; i++) {
+            out[i] = fn(&op, 0, locations[i]);
+        }
+        return;
     }
 
-    if (sampleMin == RS_SAMPLER_LINEAR_MIP_LINEAR) {
-        uint32_t lod0 = (uint32_t)floor(lod);
-        uint32_t lod1 = (uint32_t)ceil(lod);
-        uint32_t maxLOD = type->mHal.state.lodCount - 1;
-        lod0 = min(lod0, maxLOD);
-        lod1 = min(lod1, maxLOD);
-        float4 sample0 = sample_LOD_LinearPixel(alloc, dk, dt, wrapS, wrapT, uv, lod0);
-        float4 sample1 = sample_LOD_LinearPixel(alloc, dk, dt, wrapS, wrapT, uv, lod1);
-        float frac = lod - (float)lod0;
-        return sample0 * (1.0f - frac) + sample1 * frac;
+    for (uint32_t i = 0; i < count; i++) {
+        out[i] = sample1D(&op, locations[i], lod);
     }
-
-    return sample_LOD_NearestPixel(alloc, dk, dt, wrapS, wrapT, uv, 0);
 }
 
-extern const float4 __attribute__((overloadable))
-        rsSample(rs_allocation a, rs_sampler s, float2 uv) {
+extern void __attribute__((overloadable))
+        rsSample(rs_allocation a, rs_sampler s, float4 *out,
+                 const float *locations, uint32_t count) {
+    rsSample(a, s, out, locations, count, 0.f);
+}
 
-    const Allocation_t *alloc = (const Allocation_t *)a.p;
-    const Sampler_t *prog = (Sampler_t *)s.p;
-    const Type_t *type = (Type_t *)alloc->mHal.state.type;
-    const Element_t *elem = type->mHal.state.element;
-    rs_data_kind dk = elem->mHal.state.dataKind;
-    rs_data_type dt = elem->mHal.state.dataType;
-    rs_sampler_value wrapS = prog->mHal.state.wrapS;
-    rs_sampler_value wrapT = prog->mHal.state.wrapT;
+extern void __attribute__((overloadable))
+        rsSample(rs_allocation a, rs_sampler s, float4 *out,
+                 const float2 *locations, uint32_t count, float lod) {
+    SampleOp_t op;
+    if (!resolveSampleOp(&op, a, s)) {
+        for (uint32_t i = 0; i < count; i++) {
+            out[i] = 0.f;
+        }
+        return;
+    }
 
-    if (!(alloc->mHal.state.usageFlags & RS_ALLOCATION_USAGE_GRAPHICS_TEXTURE)) {
-        return 0.f;
+    if (lod <= 0.0f) {
+        Sample2D_t fn = (op.magFilter == RS_SAMPLER_NEAREST) ?
+                op.funcs->nearest2D : op.funcs->linear2D;
+        for (uint32_t i = 0; i < count; i++) {
+            out[i] = fn(&op, 0, locations[i]);
+        }
+        return;
     }
 
-    if (prog->mHal.state.magFilter == RS_SAMPLER_NEAREST) {
-        return sample_LOD_NearestPixel(alloc, dk, dt, wrapS, wrapT, uv, 0);
+    for (uint32_t i = 0; i < count; i++) {
+        out[i] = sample2D(&op, locations[i], lod);
     }
-    return sample_LOD_LinearPixel(alloc, dk, dt, wrapS, wrapT, uv, 0);
 }
 
+extern void __attribute__((overloadable))
+        rsSample(rs_allocation a, rs_sampler s, float4 *out,
+                 const float2 *locations, uint32_t count) {
+    rsSample(a, s, out, locations, count, 0.f);
+}
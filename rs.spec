@@ -18,6 +18,16 @@ ContextPeekMessage {
     ret RsMessageToClientType
 }
 
+ContextAcquireMessages {
+    direct
+    param RsMessageToClient *messages
+    param size_t *count
+}
+
+ContextReleaseMessages {
+    direct
+}
+
 ContextSendMessage {
     param uint32_t id
     param const uint8_t *data
@@ -52,6 +62,12 @@ AllocationCreateTyped {
     ret RsAllocation
 }
 
+AllocationClone {
+    param RsAllocation src
+    sync
+    ret RsAllocation
+}
+
 AllocationCreateFromBitmap {
     direct
     param RsType vtype
@@ -86,10 +102,65 @@ ContextFinish {
     sync
     }
 
+FenceCreate {
+    direct
+    ret RsFence
+}
+
+ContextInsertFence {
+    param RsFence fence
+}
+
+FenceWait {
+    direct
+    param RsFence fence
+    param int64_t timeout
+    ret bool
+}
+
+FenceSetNotify {
+    direct
+    param RsFence fence
+    param uintptr_t cookie
+}
+
+ContextCreateQueue {
+    direct
+    ret RsCommandQueue
+}
+
+ContextBindQueue {
+    direct
+    param RsCommandQueue queue
+    ret RsCommandQueue
+}
+
 ContextDump {
     param int32_t bits
 }
 
+ContextSetAutoFusion {
+    param uint32_t enable
+}
+
+ContextSetSliceSize {
+    param uint32_t sliceSize
+}
+
+ContextSetTracing {
+    param uint32_t enable
+}
+
+ContextDumpTrace {
+    param const char *path
+    ret bool
+}
+
+ContextGetStats {
+    direct
+    param RsContextStats *stats
+}
+
 ContextSetPriority {
     param int32_t priority
     }
@@ -185,6 +256,11 @@ AllocationGenerateMipmaps {
     param RsAllocation va
 }
 
+AllocationGenerateMipmapsFiltered {
+    param RsAllocation va
+    param RsMipmapFilter filter
+}
+
 AllocationRead {
     param RsAllocation va
     param void * data
@@ -363,6 +439,24 @@ ScriptCCreate {
     ret RsScript
     }
 
+ScriptCCreateAsync {
+        param const char * resName
+        param const char * cacheDir
+    param const char * text
+    ret RsScript
+    }
+
+ScriptCWait {
+    param RsScript s
+    ret bool
+    }
+
+ScriptCClone {
+    param RsScript src
+    sync
+    ret RsScript
+    }
+
 ScriptIntrinsicCreate {
     param uint32_t id
     param RsElement eid
@@ -19,6 +19,8 @@
 #include "rsAdapter.h"
 #include "rs_hal.h"
 
+#include <unistd.h>
+
 #if !defined(RS_SERVER) && !defined(RS_COMPATIBILITY_LIB)
 #include "system/window.h"
 #include "gui/GLConsumer.h"
@@ -69,6 +71,30 @@ Allocation * Allocation::createAllocation(Context *rsc, const Type *type, uint32
     return a;
 }
 
+Allocation * Allocation::createClone(Context *rsc, const Allocation *src) {
+    if (src->mHal.state.usageFlags &
+        (RS_ALLOCATION_USAGE_IO_INPUT | RS_ALLOCATION_USAGE_IO_OUTPUT)) {
+        rsc->setError(RS_ERROR_BAD_VALUE, "Can't clone an IO Allocation");
+        return NULL;
+    }
+    if (rsc->mHal.funcs.allocation.clone == NULL) {
+        rsc->setError(RS_ERROR_DRIVER, "Allocation cloning is not supported by the driver");
+        return NULL;
+    }
+
+    Allocation *a = createAllocation(rsc, src->getType(), src->mHal.state.usageFlags,
+                                     src->mHal.state.mipmapControl);
+    if (!a) {
+        return NULL;
+    }
+
+    rsc->mHal.funcs.allocation.clone(rsc, a, src);
+    if (a->mHal.state.hasReferences) {
+        a->incRefs(a->mHal.drvState.lod[0].mallocPtr, a->getType()->getCellCount());
+    }
+    return a;
+}
+
 void Allocation::updateCache() {
     const Type *type = mHal.state.type;
     mHal.state.yuv = type->getDimYuv();
@@ -125,12 +151,16 @@ void Allocation::data(Context *rsc, uint32_t xoff, uint32_t lod,
         return;
     }
 
+    TraceScope trace(Tracer::CAT_COPY, "data1D", sizeBytes);
+    rsc->mStats.add(ContextStats::BYTES_COPIED, sizeBytes);
     rsc->mHal.funcs.allocation.data1D(rsc, this, xoff, lod, count, data, sizeBytes);
     sendDirty(rsc);
 }
 
 void Allocation::data(Context *rsc, uint32_t xoff, uint32_t yoff, uint32_t lod, RsAllocationCubemapFace face,
                       uint32_t w, uint32_t h, const void *data, size_t sizeBytes, size_t stride) {
+    TraceScope trace(Tracer::CAT_COPY, "data2D", sizeBytes);
+    rsc->mStats.add(ContextStats::BYTES_COPIED, sizeBytes);
     rsc->mHal.funcs.allocation.data2D(rsc, this, xoff, yoff, lod, face, w, h, data, sizeBytes, stride);
     sendDirty(rsc);
 }
@@ -138,6 +168,8 @@ void Allocation::data(Context *rsc, uint32_t xoff, uint32_t yoff, uint32_t lod,
 void Allocation::data(Context *rsc, uint32_t xoff, uint32_t yoff, uint32_t zoff,
                       uint32_t lod,
                       uint32_t w, uint32_t h, uint32_t d, const void *data, size_t sizeBytes, size_t stride) {
+    TraceScope trace(Tracer::CAT_COPY, "data3D", sizeBytes);
+    rsc->mStats.add(ContextStats::BYTES_COPIED, sizeBytes);
     rsc->mHal.funcs.allocation.data3D(rsc, this, xoff, yoff, zoff, lod, w, h, d, data, sizeBytes, stride);
     sendDirty(rsc);
 }
@@ -155,6 +187,8 @@ void Allocation::read(Context *rsc, uint32_t xoff, uint32_t lod,
         return;
     }
 
+    TraceScope trace(Tracer::CAT_COPY, "read1D", sizeBytes);
+    rsc->mStats.add(ContextStats::BYTES_COPIED, sizeBytes);
     rsc->mHal.funcs.allocation.read1D(rsc, this, xoff, lod, count, data, sizeBytes);
 }
 
@@ -173,6 +207,8 @@ void Allocation::read(Context *rsc, uint32_t xoff, uint32_t yoff, uint32_t lod,
         }
     }
 
+    TraceScope trace(Tracer::CAT_COPY, "read2D", sizeBytes);
+    rsc->mStats.add(ContextStats::BYTES_COPIED, sizeBytes);
     rsc->mHal.funcs.allocation.read2D(rsc, this, xoff, yoff, lod, face, w, h, data, sizeBytes, stride);
 }
 
@@ -184,6 +220,8 @@ void Allocation::read(Context *rsc, uint32_t xoff, uint32_t yoff, uint32_t zoff,
         stride = lineSize;
     }
 
+    TraceScope trace(Tracer::CAT_COPY, "read3D", sizeBytes);
+    rsc->mStats.add(ContextStats::BYTES_COPIED, sizeBytes);
     rsc->mHal.funcs.allocation.read3D(rsc, this, xoff, yoff, zoff, lod, w, h, d, data, sizeBytes, stride);
 
 }
@@ -276,53 +314,208 @@ uint32_t Allocation::getPackedSize() const {
     return numItems * mHal.state.type->getElement()->getSizeBytesUnpadded();
 }
 
-void Allocation::writePackedData(Context *rsc, const Type *type,
-                                 uint8_t *dst, const uint8_t *src, bool dstPadded) {
-    const Element *elem = type->getElement();
-    uint32_t unpaddedBytes = elem->getSizeBytesUnpadded();
-    uint32_t paddedBytes = elem->getSizeBytes();
-    uint32_t numItems = type->getPackedSizeBytes() / paddedBytes;
-
-    uint32_t srcInc = !dstPadded ? paddedBytes : unpaddedBytes;
-    uint32_t dstInc =  dstPadded ? paddedBytes : unpaddedBytes;
-
-    // no sub-elements
-    uint32_t fieldCount = elem->getFieldCount();
-    if (fieldCount == 0) {
-        for (uint32_t i = 0; i < numItems; i ++) {
-            memcpy(dst, src, unpaddedBytes);
-            src += srcInc;
-            dst += dstInc;
-        }
-        return;
-    }
+/*
+ * Conversion between the padded in-memory layout and the unpadded serialized
+ * layout.  Each Element carries the byte runs that map one layout onto the
+ * other; the common single-run vec3 layouts (3 x 1, 2 or 4 byte lanes) use
+ * shuffle kernels that convert a 64 byte padded block per iteration, and
+ * everything else walks the runs.  Large buffers are split across threads.
+ */
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_shufflevector)
+#define RS_PACK_VEC3_SIMD
+#endif
+#endif
 
-    // Cache offsets
-    uint32_t *offsetsPadded = new uint32_t[fieldCount];
-    uint32_t *offsetsUnpadded = new uint32_t[fieldCount];
-    uint32_t *sizeUnpadded = new uint32_t[fieldCount];
+#ifdef RS_PACK_VEC3_SIMD
+typedef uint32_t PackU32x4 __attribute__((vector_size(16)));
+typedef uint16_t PackU16x8 __attribute__((vector_size(16)));
+typedef uint8_t PackU8x16 __attribute__((vector_size(16)));
+
+template <typename V>
+static inline V packLoad(const uint8_t *p) {
+    V v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+template <typename V>
+static inline void packStore(uint8_t *p, V v) {
+    memcpy(p, &v, sizeof(v));
+}
+
+// Padded to packed, 64 bytes in, 48 bytes out.
+static void packVec3Block(uint8_t *dst, const uint8_t *src, uint32_t lane) {
+    if (lane == 4) {
+        PackU32x4 a = packLoad<PackU32x4>(src), b = packLoad<PackU32x4>(src + 16);
+        PackU32x4 c = packLoad<PackU32x4>(src + 32), d = packLoad<PackU32x4>(src + 48);
+        packStore(dst, __builtin_shufflevector(a, b, 0, 1, 2, 4));
+        packStore(dst + 16, __builtin_shufflevector(b, c, 1, 2, 4, 5));
+        packStore(dst + 32, __builtin_shufflevector(c, d, 2, 4, 5, 6));
+    } else if (lane == 2) {
+        PackU16x8 a = packLoad<PackU16x8>(src), b = packLoad<PackU16x8>(src + 16);
+        PackU16x8 c = packLoad<PackU16x8>(src + 32), d = packLoad<PackU16x8>(src + 48);
+        packStore(dst, __builtin_shufflevector(a, b, 0, 1, 2, 4, 5, 6, 8, 9));
+        packStore(dst + 16, __builtin_shufflevector(b, c, 2, 4, 5, 6, 8, 9, 10, 12));
+        packStore(dst + 32, __builtin_shufflevector(c, d, 5, 6, 8, 9, 10, 12, 13, 14));
+    } else {
+        PackU8x16 a = packLoad<PackU8x16>(src), b = packLoad<PackU8x16>(src + 16);
+        PackU8x16 c = packLoad<PackU8x16>(src + 32), d = packLoad<PackU8x16>(src + 48);
+        packStore(dst, __builtin_shufflevector(a, b, 0, 1, 2, 4, 5, 6, 8, 9,
+                                               10, 12, 13, 14, 16, 17, 18, 20));
+        packStore(dst + 16, __builtin_shufflevector(b, c, 5, 6, 8, 9, 10, 12, 13, 14,
+                                                    16, 17, 18, 20, 21, 22, 24, 25));
+        packStore(dst + 32, __builtin_shufflevector(c, d, 10, 12, 13, 14, 16, 17, 18, 20,
+                                                    21, 22, 24, 25, 26, 28, 29, 30));
+    }
+}
+
+// Packed to padded, 48 bytes in, 64 bytes out.  The padding lane is zeroed.
+static void unpackVec3Block(uint8_t *dst, const uint8_t *src, uint32_t lane) {
+    if (lane == 4) {
+        const PackU32x4 m = {~0u, ~0u, ~0u, 0};
+        PackU32x4 a = packLoad<PackU32x4>(src), b = packLoad<PackU32x4>(src + 16);
+        PackU32x4 c = packLoad<PackU32x4>(src + 32);
+        packStore(dst, __builtin_shufflevector(a, a, 0, 1, 2, 2) & m);
+        packStore(dst + 16, __builtin_shufflevector(a, b, 3, 4, 5, 5) & m);
+        packStore(dst + 32, __builtin_shufflevector(b, c, 2, 3, 4, 4) & m);
+        packStore(dst + 48, __builtin_shufflevector(c, c, 1, 2, 3, 3) & m);
+    } else if (lane == 2) {
+        const PackU16x8 m = {0xffff, 0xffff, 0xffff, 0, 0xffff, 0xffff, 0xffff, 0};
+        PackU16x8 a = packLoad<PackU16x8>(src), b = packLoad<PackU16x8>(src + 16);
+        PackU16x8 c = packLoad<PackU16x8>(src + 32);
+        packStore(dst, __builtin_shufflevector(a, a, 0, 1, 2, 2, 3, 4, 5, 5) & m);
+        packStore(dst + 16, __builtin_shufflevector(a, b, 6, 7, 8, 8, 9, 10, 11, 11) & m);
+        packStore(dst + 32, __builtin_shufflevector(b, c, 4, 5, 6, 6, 7, 8, 9, 9) & m);
+        packStore(dst + 48, __builtin_shufflevector(c, c, 2, 3, 4, 4, 5, 6, 7, 7) & m);
+    } else {
+        const PackU8x16 m = {0xff, 0xff, 0xff, 0, 0xff, 0xff, 0xff, 0,
+                             0xff, 0xff, 0xff, 0, 0xff, 0xff, 0xff, 0};
+        PackU8x16 a = packLoad<PackU8x16>(src), b = packLoad<PackU8x16>(src + 16);
+        PackU8x16 c = packLoad<PackU8x16>(src + 32);
+        packStore(dst, __builtin_shufflevector(a, a, 0, 1, 2, 2, 3, 4, 5, 5,
+                                               6, 7, 8, 8, 9, 10, 11, 11) & m);
+        packStore(dst + 16, __builtin_shufflevector(a, b, 12, 13, 14, 14, 15, 16, 17, 17,
+                                                    18, 19, 20, 20, 21, 22, 23, 23) & m);
+        packStore(dst + 32, __builtin_shufflevector(b, c, 8, 9, 10, 10, 11, 12, 13, 13,
+                                                    14, 15, 16, 16, 17, 18, 19, 19) & m);
+        packStore(dst + 48, __builtin_shufflevector(c, c, 4, 5, 6, 6, 7, 8, 9, 9,
+                                                    10, 11, 12, 12, 13, 14, 15, 15) & m);
+    }
+}
+#endif
 
-    for (uint32_t i = 0; i < fieldCount; i++) {
-        offsetsPadded[i] = elem->getFieldOffsetBytes(i);
-        offsetsUnpadded[i] = elem->getFieldOffsetBytesUnpadded(i);
-        sizeUnpadded[i] = elem->getField(i)->getSizeBytesUnpadded();
+typedef struct {
+    const Element::PackRun_t *runs;
+    uint32_t runCount;
+    uint32_t paddedBytes;
+    uint32_t unpaddedBytes;
+    uint8_t *dst;
+    const uint8_t *src;
+    bool dstPadded;
+    uint32_t itemStart;
+    uint32_t itemEnd;
+} PackJob_t;
+
+static void packItems(const PackJob_t *job) {
+    const uint32_t srcInc = job->dstPadded ? job->unpaddedBytes : job->paddedBytes;
+    const uint32_t dstInc = job->dstPadded ? job->paddedBytes : job->unpaddedBytes;
+    const uint8_t *src = job->src + (size_t)job->itemStart * srcInc;
+    uint8_t *dst = job->dst + (size_t)job->itemStart * dstInc;
+    uint32_t count = job->itemEnd - job->itemStart;
+
+    if (job->paddedBytes == job->unpaddedBytes) {
+        memcpy(dst, src, (size_t)count * dstInc);
+        return;
     }
 
-    uint32_t *srcOffsets = !dstPadded ? offsetsPadded : offsetsUnpadded;
-    uint32_t *dstOffsets =  dstPadded ? offsetsPadded : offsetsUnpadded;
+#ifdef RS_PACK_VEC3_SIMD
+    const Element::PackRun_t *r = job->runs;
+    if ((job->runCount == 1) && !r->offsetPadded && !r->offsetUnpadded &&
+        (job->paddedBytes * 3 == r->size * 4) && (job->paddedBytes <= 16)) {
+        const uint32_t lane = job->paddedBytes >> 2;
+        const uint32_t block = 16 / lane;
+        while (count >= block) {
+            if (job->dstPadded) {
+                unpackVec3Block(dst, src, lane);
+            } else {
+                packVec3Block(dst, src, lane);
+            }
+            src += block * srcInc;
+            dst += block * dstInc;
+            count -= block;
+        }
+    }
+#endif
 
-    // complex elements, need to copy subelem after subelem
-    for (uint32_t i = 0; i < numItems; i ++) {
-        for (uint32_t fI = 0; fI < fieldCount; fI++) {
-            memcpy(dst + dstOffsets[fI], src + srcOffsets[fI], sizeUnpadded[fI]);
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint32_t ct = 0; ct < job->runCount; ct++) {
+            const Element::PackRun_t &run = job->runs[ct];
+            if (job->dstPadded) {
+                memcpy(dst + run.offsetPadded, src + run.offsetUnpadded, run.size);
+            } else {
+                memcpy(dst + run.offsetUnpadded, src + run.offsetPadded, run.size);
+            }
         }
         src += srcInc;
         dst += dstInc;
     }
+}
 
-    delete[] offsetsPadded;
-    delete[] offsetsUnpadded;
-    delete[] sizeUnpadded;
+static void * packThreadProc(void *data) {
+    packItems((const PackJob_t *)data);
+    return NULL;
+}
+
+void Allocation::writePackedData(Context *rsc, const Type *type,
+                                 uint8_t *dst, const uint8_t *src, bool dstPadded) {
+    const Element *elem = type->getElement();
+
+    PackJob_t job;
+    job.runs = elem->getPackRuns();
+    job.runCount = elem->getPackRunCount();
+    job.paddedBytes = elem->getSizeBytes();
+    job.unpaddedBytes = elem->getSizeBytesUnpadded();
+    job.dst = dst;
+    job.src = src;
+    job.dstPadded = dstPadded;
+    job.itemStart = 0;
+    job.itemEnd = type->getPackedSizeBytes() / job.paddedBytes;
+
+    // Split big conversions into one contiguous range of items per thread;
+    // below a few MB the thread startup costs more than it saves.
+    const size_t kThreadBytes = 4 * 1024 * 1024;
+    const size_t bytes = (size_t)job.itemEnd * job.paddedBytes;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t threadCount = (uint32_t)rsMin((size_t)rsMax(cpus, 1L), bytes / kThreadBytes + 1);
+    threadCount = rsMin(threadCount, 8u);
+    if (threadCount <= 1) {
+        packItems(&job);
+        return;
+    }
+
+    PackJob_t jobs[8];
+    pthread_t threads[8];
+    uint32_t itemsPerThread = (job.itemEnd + threadCount - 1) / threadCount;
+    for (uint32_t ct = 0; ct < threadCount; ct++) {
+        jobs[ct] = job;
+        jobs[ct].itemStart = rsMin(ct * itemsPerThread, job.itemEnd);
+        jobs[ct].itemEnd = rsMin((ct + 1) * itemsPerThread, job.itemEnd);
+    }
+    uint32_t started = 1;
+    for (; started < threadCount; started++) {
+        if (pthread_create(&threads[started], NULL, packThreadProc, &jobs[started])) {
+            break;
+        }
+    }
+    packItems(&jobs[0]);
+    // Any range whose thread could not be started is done here.
+    for (uint32_t ct = started; ct < threadCount; ct++) {
+        packItems(&jobs[ct]);
+    }
+    for (uint32_t ct = 1; ct < started; ct++) {
+        pthread_join(threads[ct], NULL);
+    }
 }
 
 void Allocation::unpackVec3Allocation(Context *rsc, const void *data, size_t dataSize) {
@@ -572,6 +765,20 @@ void rsi_AllocationGenerateMipmaps(Context *rsc, RsAllocation va) {
     rsc->mHal.funcs.allocation.generateMipmaps(rsc, alloc);
 }
 
+void rsi_AllocationGenerateMipmapsFiltered(Context *rsc, RsAllocation va, RsMipmapFilter filter) {
+    Allocation *alloc = static_cast<Allocation *>(va);
+    if (rsc->mHal.funcs.allocation.generateMipmapsFiltered == NULL) {
+        // Drivers without the filtered path still provide the box filter.
+        if (filter == RS_MIPMAP_FILTER_BOX) {
+            rsc->mHal.funcs.allocation.generateMipmaps(rsc, alloc);
+        } else {
+            rsc->setError(RS_ERROR_DRIVER, "Filtered mipmap generation is not supported by the driver");
+        }
+        return;
+    }
+    rsc->mHal.funcs.allocation.generateMipmapsFiltered(rsc, alloc, filter);
+}
+
 void rsi_AllocationCopyToBitmap(Context *rsc, RsAllocation va, void *data, size_t sizeBytes) {
     Allocation *a = static_cast<Allocation *>(va);
     const Type * t = a->getType();
@@ -643,6 +850,15 @@ RsAllocation rsi_AllocationCreateTyped(Context *rsc, RsType vtype,
     return alloc;
 }
 
+RsAllocation rsi_AllocationClone(Context *rsc, RsAllocation src) {
+    Allocation *alloc = Allocation::createClone(rsc, static_cast<Allocation *>(src));
+    if (!alloc) {
+        return NULL;
+    }
+    alloc->incUserRef();
+    return alloc;
+}
+
 RsAllocation rsi_AllocationCreateFromBitmap(Context *rsc, RsType vtype,
                                             RsAllocationMipmapControl mipmaps,
                                             const void *data, size_t sizeBytes, uint32_t usages) {
@@ -713,6 +929,9 @@ void rsi_AllocationCopy2DRange(Context *rsc,
                                uint32_t srcMip, uint32_t srcFace) {
     Allocation *dst = static_cast<Allocation *>(dstAlloc);
     Allocation *src= static_cast<Allocation *>(srcAlloc);
+    const size_t bytes = width * height * src->getType()->getElementSizeBytes();
+    TraceScope trace(Tracer::CAT_COPY, "copy2D", bytes);
+    rsc->mStats.add(ContextStats::BYTES_COPIED, bytes);
     rsc->mHal.funcs.allocation.allocData2D(rsc, dst, dstXoff, dstYoff, dstMip,
                                            (RsAllocationCubemapFace)dstFace,
                                            width, height,
@@ -730,6 +949,9 @@ void rsi_AllocationCopy3DRange(Context *rsc,
                                uint32_t srcMip) {
     Allocation *dst = static_cast<Allocation *>(dstAlloc);
     Allocation *src= static_cast<Allocation *>(srcAlloc);
+    const size_t bytes = width * height * depth * src->getType()->getElementSizeBytes();
+    TraceScope trace(Tracer::CAT_COPY, "copy3D", bytes);
+    rsc->mStats.add(ContextStats::BYTES_COPIED, bytes);
     rsc->mHal.funcs.allocation.allocData3D(rsc, dst, dstXoff, dstYoff, dstZoff, dstMip,
                                            width, height, depth,
                                            src, srcXoff, srcYoff, srcZoff, srcMip);
@@ -769,6 +991,8 @@ void *rsi_AllocationGetPointer(Context *rsc, RsAllocation valloc,
 void rsi_Allocation1DRead(Context *rsc, RsAllocation va, uint32_t xoff, uint32_t lod,
                           uint32_t count, void *data, size_t sizeBytes) {
     Allocation *a = static_cast<Allocation *>(va);
+    TraceScope trace(Tracer::CAT_COPY, "read1D", sizeBytes);
+    rsc->mStats.add(ContextStats::BYTES_COPIED, sizeBytes);
     rsc->mHal.funcs.allocation.read1D(rsc, a, xoff, lod, count, data, sizeBytes);
 }
 
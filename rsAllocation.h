@@ -99,6 +99,9 @@ public:
     static Allocation * createAllocation(Context *rsc, const Type *, uint32_t usages,
                                          RsAllocationMipmapControl mc = RS_ALLOCATION_MIPMAP_NONE,
                                          void *ptr = 0);
+    // Creates an Allocation with the same Type, usage and contents as src.
+    // Where the driver supports it the storage is shared copy-on-write.
+    static Allocation * createClone(Context *rsc, const Allocation *src);
     virtual ~Allocation();
     void updateCache();
 
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rsContext.h"
+#include "rsCommandQueue.h"
+
+using namespace android;
+using namespace android::renderscript;
+
+static pthread_key_t gQueueKey;
+static pthread_once_t gQueueKeyOnce = PTHREAD_ONCE_INIT;
+static bool gQueueKeyValid = false;
+
+static void createQueueKey() {
+    gQueueKeyValid = !pthread_key_create(&gQueueKey, NULL);
+}
+
+CommandQueue::CommandQueue(Context *rsc) : ObjectBase(rsc) {
+    mExit = false;
+    mRunning = false;
+}
+
+CommandQueue::~CommandQueue() {
+    if (mRunning) {
+        rsAssert(!pthread_equal(pthread_self(), mThreadId));
+        mExit = true;
+        mIO.shutdown();
+        pthread_join(mThreadId, NULL);
+    }
+}
+
+CommandQueue * CommandQueue::create(Context *rsc) {
+    pthread_once(&gQueueKeyOnce, createQueueKey);
+
+    CommandQueue *q = new CommandQueue(rsc);
+    q->mIO.init(false);
+    if (pthread_create(&q->mThreadId, NULL, threadProc, q)) {
+        ALOGE("Failed to start RS command queue thread.");
+        delete q;
+        return NULL;
+    }
+    q->mRunning = true;
+    return q;
+}
+
+void * CommandQueue::threadProc(void *vq) {
+    CommandQueue *q = static_cast<CommandQueue *>(vq);
+    Context *rsc = q->getContext();
+
+    // Replies to sync commands must go back through this queue's IO.
+    pthread_setspecific(gQueueKey, q);
+    if (rsc->mHal.funcs.attachQueueThread) {
+        rsc->mHal.funcs.attachQueueThread(rsc);
+    }
+
+    while (!q->mExit) {
+        q->mIO.playCoreCommands(rsc, -1);
+    }
+    // Each queue has its own recorder; drop its cache while the context
+    // is still alive.
+    q->mIO.releaseFusionCache(rsc);
+
+    if (rsc->mHal.funcs.detachQueueThread) {
+        rsc->mHal.funcs.detachQueueThread(rsc);
+    }
+    return NULL;
+}
+
+CommandQueue * CommandQueue::bind(Context *rsc, CommandQueue *q) {
+    pthread_once(&gQueueKeyOnce, createQueueKey);
+
+    CommandQueue *old = (CommandQueue *)pthread_getspecific(gQueueKey);
+    if (old && (old->getContext() != rsc)) {
+        old = NULL;
+    }
+    pthread_setspecific(gQueueKey, q);
+    return old;
+}
+
+ThreadIO * CommandQueue::getBoundIO(const Context *rsc) {
+    // The key only exists once some queue has been created.
+    if (!gQueueKeyValid) {
+        return NULL;
+    }
+    CommandQueue *q = (CommandQueue *)pthread_getspecific(gQueueKey);
+    if (q && (q->getContext() == rsc)) {
+        return &q->mIO;
+    }
+    return NULL;
+}
+
+namespace android {
+namespace renderscript {
+
+RsCommandQueue rsi_ContextCreateQueue(Context *rsc) {
+    if (rsc->isSynchronous() || rsc->mIsGraphicsContext) {
+        rsc->setError(RS_ERROR_BAD_VALUE,
+                      "Command queues require an asynchronous compute context");
+        return NULL;
+    }
+    CommandQueue *q = CommandQueue::create(rsc);
+    if (q) {
+        q->incUserRef();
+    }
+    return q;
+}
+
+RsCommandQueue rsi_ContextBindQueue(Context *rsc, RsCommandQueue vq) {
+    return CommandQueue::bind(rsc, static_cast<CommandQueue *>(vq));
+}
+
+}
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_RS_COMMAND_QUEUE_H
+#define ANDROID_RS_COMMAND_QUEUE_H
+
+#include "rsObjectBase.h"
+#include "rsThreadIO.h"
+
+// ---------------------------------------------------------------------------
+namespace android {
+namespace renderscript {
+
+/*
+ * An additional command stream on a compute context.  Each queue has its own
+ * FIFO and replay thread, so commands issued to different queues are ordered
+ * only within their own queue and may run concurrently.  A client thread
+ * routes its calls to a queue by binding it; unbound threads use the
+ * context's default queue.
+ *
+ * Launches replayed on a queue thread run on that thread alone rather than on
+ * the shared worker pool, which stays with the default queue.  The caller is
+ * responsible for not touching the same Allocations or Script globals from
+ * two queues without synchronizing through fences.
+ */
+class CommandQueue : public ObjectBase {
+public:
+    static CommandQueue * create(Context *rsc);
+
+    ThreadIO * getIO() {
+        return &mIO;
+    }
+
+    // Binds q to the calling thread, NULL selects the default queue.
+    // Returns the previous binding.
+    static CommandQueue * bind(Context *rsc, CommandQueue *q);
+
+    // Returns the IO the calling thread should use for rsc, or NULL for the
+    // context's default queue.
+    static ThreadIO * getBoundIO(const Context *rsc);
+
+    virtual void serialize(Context *rsc, OStream *stream) const {
+    }
+    virtual RsA3DClassID getClassId() const {
+        return RS_A3D_CLASS_ID_UNKNOWN;
+    }
+
+protected:
+    CommandQueue(Context *);
+    virtual ~CommandQueue();
+
+    static void * threadProc(void *);
+
+    ThreadIO mIO;
+    pthread_t mThreadId;
+    bool mExit;
+    bool mRunning;
+};
+
+}
+}
+#endif
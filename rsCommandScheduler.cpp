@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rsContext.h"
+#include "rsCommandScheduler.h"
+#include "rsgApiStructs.h"
+
+using namespace android;
+using namespace android::renderscript;
+
+CommandScheduler::CommandScheduler() {
+    mRSC = NULL;
+    mCount = 0;
+    mClaimed = 0;
+    mDone = 0;
+    for (uint32_t ct = 0; ct < kMaxDeferred; ct++) {
+        mCommands[ct].data = NULL;
+        mCommands[ct].capacity = 0;
+    }
+    pthread_mutex_init(&mLock, NULL);
+    pthread_cond_init(&mCond, NULL);
+}
+
+CommandScheduler::~CommandScheduler() {
+    rsAssert(!mCount);
+    for (uint32_t ct = 0; ct < kMaxDeferred; ct++) {
+        free(mCommands[ct].data);
+    }
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mLock);
+}
+
+// Commands whose pointer arguments were too large to inline carry no payload.
+// The data stays in client memory and the client blocks until the command is
+// replayed, so such commands have to run in order.
+bool CommandScheduler::getAccess(uint32_t cmdID, const void *data, size_t bytes,
+                                 Command *c) const {
+    switch (cmdID) {
+    case RS_CMD_ID_ScriptForEach: {
+        const RS_CMD_ScriptForEach *cmd = (const RS_CMD_ScriptForEach *)data;
+        if ((bytes == sizeof(*cmd)) && (cmd->usr_length || cmd->sc_length)) {
+            return false;
+        }
+        const Script *s = static_cast<const Script *>(cmd->s);
+        if (!s->getGlobalObjects(&c->writes)) {
+            return false;
+        }
+        c->writes.add(s);
+        if (cmd->aout) {
+            c->writes.add(static_cast<const Allocation *>(cmd->aout));
+        }
+        if (cmd->ain) {
+            c->reads.add(static_cast<const Allocation *>(cmd->ain));
+        }
+        return true;
+    }
+    case RS_CMD_ID_Allocation1DData: {
+        const RS_CMD_Allocation1DData *cmd = (const RS_CMD_Allocation1DData *)data;
+        if ((bytes == sizeof(*cmd)) && cmd->data_length) {
+            return false;
+        }
+        c->writes.add(static_cast<const Allocation *>(cmd->va));
+        return true;
+    }
+    case RS_CMD_ID_Allocation2DData: {
+        const RS_CMD_Allocation2DData *cmd = (const RS_CMD_Allocation2DData *)data;
+        if ((bytes == sizeof(*cmd)) && cmd->data_length) {
+            return false;
+        }
+        c->writes.add(static_cast<const Allocation *>(cmd->va));
+        return true;
+    }
+    case RS_CMD_ID_Allocation3DData: {
+        const RS_CMD_Allocation3DData *cmd = (const RS_CMD_Allocation3DData *)data;
+        if ((bytes == sizeof(*cmd)) && cmd->data_length) {
+            return false;
+        }
+        c->writes.add(static_cast<const Allocation *>(cmd->va));
+        return true;
+    }
+    case RS_CMD_ID_AllocationCopy2DRange: {
+        const RS_CMD_AllocationCopy2DRange *cmd = (const RS_CMD_AllocationCopy2DRange *)data;
+        c->writes.add(static_cast<const Allocation *>(cmd->dest));
+        c->reads.add(static_cast<const Allocation *>(cmd->src));
+        return true;
+    }
+    case RS_CMD_ID_AllocationCopy3DRange: {
+        const RS_CMD_AllocationCopy3DRange *cmd = (const RS_CMD_AllocationCopy3DRange *)data;
+        c->writes.add(static_cast<const Allocation *>(cmd->dest));
+        c->reads.add(static_cast<const Allocation *>(cmd->src));
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+static bool intersects(const Vector<const ObjectBase *> &a,
+                       const Vector<const ObjectBase *> &b) {
+    for (size_t i = 0; i < a.size(); i++) {
+        for (size_t j = 0; j < b.size(); j++) {
+            if (a[i] == b[j]) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool CommandScheduler::conflicts(const Command &a, const Command &b) {
+    return intersects(a.writes, b.writes) ||
+           intersects(a.writes, b.reads) ||
+           intersects(a.reads, b.writes);
+}
+
+bool CommandScheduler::defer(Context *rsc, uint32_t cmdID, const void *data, size_t bytes) {
+    if (mCount == kMaxDeferred) {
+        flush(rsc);
+    }
+
+    Command *c = &mCommands[mCount];
+    c->reads.clear();
+    c->writes.clear();
+    if (!getAccess(cmdID, data, bytes, c)) {
+        return false;
+    }
+
+    if (c->capacity < bytes) {
+        free(c->data);
+        c->data = (uint8_t *)malloc(bytes);
+        c->capacity = bytes;
+    }
+    memcpy(c->data, data, bytes);
+    c->cmdID = cmdID;
+    c->bytes = bytes;
+
+    c->preds = 0;
+    for (uint32_t ct = 0; ct < mCount; ct++) {
+        if (conflicts(mCommands[ct], *c)) {
+            c->preds |= (uint64_t)1 << ct;
+        }
+    }
+    mCount++;
+    return true;
+}
+
+// True if every command depends, directly or not, on all the ones before it.
+bool CommandScheduler::isChain() const {
+    uint64_t closure[kMaxDeferred];
+    for (uint32_t ct = 0; ct < mCount; ct++) {
+        closure[ct] = 0;
+        for (uint32_t p = 0; p < ct; p++) {
+            if (mCommands[ct].preds & ((uint64_t)1 << p)) {
+                closure[ct] |= closure[p] | ((uint64_t)1 << p);
+            }
+        }
+        if (closure[ct] != (((uint64_t)1 << ct) - 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CommandScheduler::run(uint32_t idx) {
+    const Command &c = mCommands[idx];
+    gPlaybackFuncs[c.cmdID](mRSC, c.data, c.bytes);
+}
+
+void CommandScheduler::worker(void *usr, uint32_t idx) {
+    CommandScheduler *cs = (CommandScheduler *)usr;
+    const uint64_t all = (cs->mCount == kMaxDeferred) ? ~(uint64_t)0 :
+                         (((uint64_t)1 << cs->mCount) - 1);
+
+    pthread_mutex_lock(&cs->mLock);
+    while (cs->mDone != all) {
+        uint32_t ready = kMaxDeferred;
+        for (uint32_t ct = 0; ct < cs->mCount; ct++) {
+            const uint64_t bit = (uint64_t)1 << ct;
+            const uint64_t preds = cs->mCommands[ct].preds;
+            if (!(cs->mClaimed & bit) && ((preds & cs->mDone) == preds)) {
+                ready = ct;
+                break;
+            }
+        }
+        if (ready == kMaxDeferred) {
+            pthread_cond_wait(&cs->mCond, &cs->mLock);
+            continue;
+        }
+
+        cs->mClaimed |= (uint64_t)1 << ready;
+        pthread_mutex_unlock(&cs->mLock);
+        cs->run(ready);
+        pthread_mutex_lock(&cs->mLock);
+        cs->mDone |= (uint64_t)1 << ready;
+        pthread_cond_broadcast(&cs->mCond);
+    }
+    pthread_mutex_unlock(&cs->mLock);
+}
+
+void CommandScheduler::flush(Context *rsc) {
+    if (!mCount) {
+        return;
+    }
+    mRSC = rsc;
+
+    if ((mCount == 1) || isChain() || !rsc->mHal.funcs.launchWorkers) {
+        for (uint32_t ct = 0; ct < mCount; ct++) {
+            run(ct);
+        }
+    } else {
+        mClaimed = 0;
+        mDone = 0;
+        rsc->mHal.funcs.launchWorkers(rsc, worker, this);
+    }
+    mCount = 0;
+}
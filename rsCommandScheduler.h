@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_RS_COMMAND_SCHEDULER_H
+#define ANDROID_RS_COMMAND_SCHEDULER_H
+
+#include "rsUtils.h"
+
+// ---------------------------------------------------------------------------
+namespace android {
+namespace renderscript {
+
+class Context;
+class ObjectBase;
+
+/*
+ * Out-of-order replay for contexts created with RS_CONTEXT_OUT_OF_ORDER.
+ *
+ * Asynchronous kernel launches and Allocation updates are not run as they
+ * are read from the command stream.  The scheduler copies them and records
+ * the objects each one reads and writes.  A launch reads its inputs and
+ * writes its output, its Script, and everything reachable through the
+ * Script's object globals as they stand when the launch is deferred.
+ * Scripts whose object globals the driver cannot enumerate make the launch
+ * a barrier.  Any other command is a barrier as well: the caller flushes
+ * the deferred work and then runs the command in order.  Invokables, where
+ * scripts normally reassign their object globals, are therefore never
+ * deferred.
+ *
+ * A flush builds a DAG from the conflicts between deferred commands.  If the
+ * DAG is a chain, the commands run in order on the calling thread and each
+ * launch still uses the whole worker pool.  Otherwise every worker pulls
+ * ready commands and runs each on its own thread, so independent branches
+ * overlap.  Conflicting commands always run in their original order, and
+ * the client observes the same results as with in-order replay.
+ */
+class CommandScheduler {
+public:
+    CommandScheduler();
+    ~CommandScheduler();
+
+    // Defers a copy of the command if it can be reordered. Returns false if
+    // the caller must flush() and then run the command itself.
+    bool defer(Context *rsc, uint32_t cmdID, const void *data, size_t bytes);
+
+    // Runs everything deferred so far and waits for it to finish.
+    void flush(Context *rsc);
+
+    bool hasPending() const {
+        return mCount > 0;
+    }
+
+protected:
+    static const uint32_t kMaxDeferred = 64;
+
+    struct Command {
+        uint32_t cmdID;
+        size_t bytes;
+        size_t capacity;
+        uint8_t *data;
+        Vector<const ObjectBase *> reads;
+        Vector<const ObjectBase *> writes;
+        // Bit i is set if this command must wait for command i.
+        uint64_t preds;
+    };
+
+    bool getAccess(uint32_t cmdID, const void *data, size_t bytes, Command *c) const;
+    static bool conflicts(const Command &a, const Command &b);
+    bool isChain() const;
+    void run(uint32_t idx);
+    static void worker(void *usr, uint32_t idx);
+
+    Context *mRSC;
+    Command mCommands[kMaxDeferred];
+    uint32_t mCount;
+
+    pthread_mutex_t mLock;
+    pthread_cond_t mCond;
+    uint64_t mClaimed;
+    uint64_t mDone;
+};
+
+}
+}
+#endif
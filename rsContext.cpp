@@ -56,7 +56,6 @@ using namespace android;
 using namespace android::renderscript;
 
 pthread_mutex_t Context::gInitMutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t Context::gMessageMutex = PTHREAD_MUTEX_INITIALIZER;
 pthread_mutex_t Context::gLibMutex = PTHREAD_MUTEX_INITIALIZER;
 
 bool Context::initGLThread() {
@@ -311,6 +310,11 @@ void * Context::threadProc(void *vrsc) {
     rsc->props.mLogShadersUniforms = getProp("debug.rs.shader.uniforms") != 0;
     rsc->props.mLogVisual = getProp("debug.rs.visual") != 0;
     rsc->props.mDebugMaxThreads = getProp("debug.rs.max-threads");
+    rsc->props.mDebugWorkerSpin = getProp("debug.rs.worker-spin-us");
+    rsc->setSliceSize(getProp("debug.rs.slice-size"));
+    if (getProp("debug.rs.trace") != 0) {
+        Tracer::setEnabled(true);
+    }
 
     if (getProp("debug.rs.debug") != 0) {
         ALOGD("Forcing debug context due to debug.rs.debug.");
@@ -467,6 +471,8 @@ void * Context::threadProc(void *vrsc) {
 
 void Context::destroyWorkerThreadResources() {
     //ALOGV("destroyWorkerThreadResources 1");
+    mAutoFusion = false;
+    mIO.releaseFusionCache(this);
     ObjectBase::zeroAllUserRef(this);
 #ifndef RS_COMPATIBILITY_LIB
     if (mIsGraphicsContext) {
@@ -526,6 +532,8 @@ Context::Context() {
     mForceCpu = false;
     mContextType = RS_CONTEXT_TYPE_NORMAL;
     mSynchronous = false;
+    mAutoFusion = false;
+    mSliceSize = 0;
 }
 
 Context * Context::createContext(Device *dev, const RsSurfaceConfig *sc,
@@ -763,6 +771,11 @@ void Context::removeName(ObjectBase *obj) {
     }
 }
 
+ThreadIO * Context::getIO() const {
+    ThreadIO *io = CommandQueue::getBoundIO(this);
+    return io ? io : &mIO;
+}
+
 RsMessageToClientType Context::peekMessageToClient(size_t *receiveLen, uint32_t *subID) {
     return (RsMessageToClientType)mIO.getClientHeader(receiveLen, subID);
 }
@@ -771,13 +784,17 @@ RsMessageToClientType Context::getMessageToClient(void *data, size_t *receiveLen
     return (RsMessageToClientType)mIO.getClientPayload(data, receiveLen, subID, bufferLen);
 }
 
+size_t Context::acquireMessagesToClient(RsMessageToClient *msgs, size_t maxCount) {
+    return mIO.acquireClientMessages(msgs, maxCount);
+}
+
+void Context::releaseMessagesToClient() {
+    mIO.releaseClientMessages();
+}
+
 bool Context::sendMessageToClient(const void *data, RsMessageToClientType cmdID,
                                   uint32_t subID, size_t len, bool waitForSpace) const {
-
-    pthread_mutex_lock(&gMessageMutex);
-    bool ret = mIO.sendToClient(cmdID, subID, data, len, waitForSpace);
-    pthread_mutex_unlock(&gMessageMutex);
-    return ret;
+    return mIO.sendToClient(cmdID, subID, data, len, waitForSpace);
 }
 
 void Context::initToClient() {
@@ -889,6 +906,30 @@ void rsi_ContextSetPriority(Context *rsc, int32_t p) {
     rsc->setPriority(p);
 }
 
+void rsi_ContextSetAutoFusion(Context *rsc, uint32_t enable) {
+    rsc->setAutoFusion(enable != 0);
+}
+
+void rsi_ContextSetSliceSize(Context *rsc, uint32_t sliceSize) {
+    rsc->setSliceSize(sliceSize);
+}
+
+void rsi_ContextSetTracing(Context *rsc, uint32_t enable) {
+    Tracer::setEnabled(enable != 0);
+}
+
+bool rsi_ContextDumpTrace(Context *rsc, const char *path, size_t path_length) {
+    String8 p(path, path_length);
+    return Tracer::dump(p.string());
+}
+
+void rsi_ContextGetStats(Context *rsc, RsContextStats *stats, size_t stats_length) {
+    // Older callers may pass a shorter struct.
+    RsContextStats s;
+    rsc->mStats.read(&s);
+    memcpy(stats, &s, rsMin(stats_length, sizeof(s)));
+}
+
 void rsi_ContextDump(Context *rsc, int32_t bits) {
     ObjectBase::dumpAll(rsc);
 }
@@ -918,6 +959,16 @@ RsMessageToClientType rsi_ContextGetMessage(Context *rsc, void * data, size_t da
     return rsc->getMessageToClient(data, receiveLen, subID, data_length);
 }
 
+void rsi_ContextAcquireMessages(Context *rsc, RsMessageToClient *messages, size_t messages_length,
+                                size_t *count, size_t count_length) {
+    rsAssert(count_length == sizeof(size_t));
+    count[0] = rsc->acquireMessagesToClient(messages, messages_length / sizeof(RsMessageToClient));
+}
+
+void rsi_ContextReleaseMessages(Context *rsc) {
+    rsc->releaseMessagesToClient();
+}
+
 void rsi_ContextInitToClient(Context *rsc) {
     rsc->initToClient();
 }
@@ -951,7 +1002,7 @@ void LF_ObjDestroy_handcode(const Context *rsc, RsAsyncVoidPtr objPtr) {
     cmd.cmdID = RS_CMD_ID_ObjDestroy;
     cmd.bytes = sizeof(RsAsyncVoidPtr);
     cmd.ptr = objPtr;
-    ThreadIO *io = &((Context *)rsc)->mIO;
+    ThreadIO *io = ((Context *)rsc)->getIO();
     io->coreWrite((void*)&cmd, sizeof(destroyCmd));
 
 }
@@ -22,9 +22,13 @@
 #include <string.h>
 
 #include "rsThreadIO.h"
+#include "rsFence.h"
+#include "rsCommandQueue.h"
 #include "rsScriptC.h"
 #include "rsScriptGroup.h"
 #include "rsSampler.h"
+#include "rsStats.h"
+#include "rsTrace.h"
 
 #if !defined(RS_SERVER) && !defined(RS_COMPATIBILITY_LIB)
 #define ATRACE_TAG ATRACE_TAG_RS
@@ -90,7 +94,6 @@ public:
     static Context * createContextLite();
     ~Context();
 
-    static pthread_mutex_t gMessageMutex;
     static pthread_mutex_t gInitMutex;
     // Library mutex (for providing thread-safe calls from the runtime)
     static pthread_mutex_t gLibMutex;
@@ -118,6 +121,11 @@ public:
     SamplerState mStateSampler;
 
     bool isSynchronous() {return mSynchronous;}
+    bool getAutoFusion() const {return mAutoFusion;}
+    void setAutoFusion(bool enable) {mAutoFusion = enable;}
+    // Slice size of all threaded launches, or 0 to tune it per launch.
+    uint32_t getSliceSize() const {return mSliceSize;}
+    void setSliceSize(uint32_t size) {mSliceSize = size;}
     bool setupCheck();
 
 #ifndef RS_COMPATIBILITY_LIB
@@ -161,6 +169,8 @@ public:
 
     RsMessageToClientType peekMessageToClient(size_t *receiveLen, uint32_t *subID);
     RsMessageToClientType getMessageToClient(void *data, size_t *receiveLen, uint32_t *subID, size_t bufferLen);
+    size_t acquireMessagesToClient(RsMessageToClient *msgs, size_t maxCount);
+    void releaseMessagesToClient();
     bool sendMessageToClient(const void *data, RsMessageToClientType cmdID, uint32_t subID, size_t len, bool waitForSpace) const;
     uint32_t runScript(Script *s);
 
@@ -199,6 +209,10 @@ public:
 
     mutable ThreadIO mIO;
 
+    // The command stream for the calling thread: its bound CommandQueue if
+    // any, otherwise mIO.
+    ThreadIO * getIO() const;
+
     // Timers
     enum Timers {
         RS_TIMER_IDLE,
@@ -223,8 +237,13 @@ public:
         bool mLogShadersUniforms;
         bool mLogVisual;
         uint32_t mDebugMaxThreads;
+        // Microseconds idle CPU workers spin before sleeping, 0 for the default.
+        uint32_t mDebugWorkerSpin;
     } props;
 
+    // Updated by the core, the driver and the worker threads.
+    ContextStats mStats;
+
     mutable struct {
         bool inRoot;
         const char *command;
@@ -285,6 +304,8 @@ private:
     bool initContext(Device *, const RsSurfaceConfig *sc);
 
     bool mSynchronous;
+    bool mAutoFusion;
+    uint32_t mSliceSize;
     bool initGLThread();
     void deinitEGL();
 
@@ -36,6 +36,8 @@ typedef void * RsAnimation;
 typedef void * RsContext;
 typedef void * RsDevice;
 typedef void * RsElement;
+typedef void * RsFence;
+typedef void * RsCommandQueue;
 typedef void * RsFile;
 typedef void * RsFont;
 typedef void * RsSampler;
@@ -102,9 +104,37 @@ enum RsMessageToClientType {
     RS_MESSAGE_TO_CLIENT_RESIZE = 2,
     RS_MESSAGE_TO_CLIENT_ERROR = 3,
     RS_MESSAGE_TO_CLIENT_USER = 4,
-    RS_MESSAGE_TO_CLIENT_NEW_BUFFER = 5
+    RS_MESSAGE_TO_CLIENT_NEW_BUFFER = 5,
+    RS_MESSAGE_TO_CLIENT_FENCE = 6
 };
 
+typedef struct {
+    RsMessageToClientType type;
+    uint32_t usrID;
+    const void *data;
+    size_t dataLen;
+} RsMessageToClient;
+
+// Totals accumulated by a context since it was created. Times are in
+// nanoseconds.
+typedef struct {
+    // Commands played from the command FIFO.
+    uint64_t commands;
+    // Time the RS thread spent blocked waiting for commands.
+    uint64_t fifoWaitTime;
+    // forEach launches and ScriptGroup executions.
+    uint64_t launches;
+    // Bytes moved by Allocation data, read and copy range calls.
+    uint64_t bytesCopied;
+    uint64_t allocationsCreated;
+    uint64_t allocationsLive;
+    // Storage of live Allocations owned by the driver.
+    uint64_t allocationBytesLive;
+    // Time worker threads spent running launches and waiting for them.
+    uint64_t workerBusyTime;
+    uint64_t workerIdleTime;
+} RsContextStats;
+
 enum RsAllocationUsageType {
     RS_ALLOCATION_USAGE_SCRIPT = 0x0001,
     RS_ALLOCATION_USAGE_GRAPHICS_TEXTURE = 0x0002,
@@ -124,6 +154,11 @@ enum RsAllocationMipmapControl {
     RS_ALLOCATION_MIPMAP_ON_SYNC_TO_TEXTURE = 2
 };
 
+enum RsMipmapFilter {
+    RS_MIPMAP_FILTER_BOX = 0,
+    RS_MIPMAP_FILTER_LANCZOS = 1
+};
+
 enum RsAllocationCubemapFace {
     RS_ALLOCATION_CUBEMAP_FACE_POSITIVE_X = 0,
     RS_ALLOCATION_CUBEMAP_FACE_NEGATIVE_X = 1,
@@ -366,7 +401,16 @@ enum RsScriptIntrinsicID {
     RS_SCRIPT_INTRINSIC_ID_3DLUT = 8,
     RS_SCRIPT_INTRINSIC_ID_HISTOGRAM = 9,
     // unused 10, 11
-    RS_SCRIPT_INTRINSIC_ID_RESIZE = 12
+    RS_SCRIPT_INTRINSIC_ID_RESIZE = 12,
+    RS_SCRIPT_INTRINSIC_ID_RGB_TO_YUV = 13,
+    RS_SCRIPT_INTRINSIC_ID_MORPHOLOGY = 14,
+    RS_SCRIPT_INTRINSIC_ID_MEDIAN = 15
+};
+
+enum RsResizeMode {
+    RS_RESIZE_MODE_BICUBIC = 0,
+    RS_RESIZE_MODE_BILINEAR = 1,
+    RS_RESIZE_MODE_AREA = 2
 };
 
 typedef struct {
@@ -400,7 +444,8 @@ typedef struct {
 enum RsContextFlags {
     RS_CONTEXT_SYNCHRONOUS      = 0x0001,
     RS_CONTEXT_LOW_LATENCY      = 0x0002,
-    RS_CONTEXT_LOW_POWER        = 0x0004
+    RS_CONTEXT_LOW_POWER        = 0x0004,
+    RS_CONTEXT_OUT_OF_ORDER     = 0x0008
 };
 
 
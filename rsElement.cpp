@@ -27,6 +27,8 @@ Element::Element(Context *rsc) : ObjectBase(rsc) {
     mFields = NULL;
     mFieldCount = 0;
     mHasReference = false;
+    mPackRuns = NULL;
+    mPackRunCount = 0;
     memset(&mHal, 0, sizeof(mHal));
 }
 
@@ -61,6 +63,10 @@ void Element::clear() {
     mFieldCount = 0;
     mHasReference = false;
 
+    delete [] mPackRuns;
+    mPackRuns = NULL;
+    mPackRunCount = 0;
+
     delete [] mHal.state.fields;
     delete [] mHal.state.fieldArraySizes;
     delete [] mHal.state.fieldNames;
@@ -180,6 +186,7 @@ void Element::compute() {
         mHasReference = mComponent.isReference();
 
         mHal.state.elementSizeBytes = getSizeBytes();
+        computePackRuns();
         return;
     }
 
@@ -223,6 +230,50 @@ void Element::compute() {
     }
 
     mHal.state.elementSizeBytes = getSizeBytes();
+    computePackRuns();
+}
+
+// Appends the runs of this element placed at the given offsets, merging with
+// the previous run where both layouts continue it.  With runs == NULL only the
+// (unmerged) upper bound on the count is returned.
+uint32_t Element::appendPackRuns(PackRun_t *runs, uint32_t count,
+                                 uint32_t offsetPadded, uint32_t offsetUnpadded) const {
+    if (!mFieldCount) {
+        uint32_t size = getSizeBytesUnpadded();
+        if (!runs) {
+            return count + 1;
+        }
+        if (count) {
+            PackRun_t *last = &runs[count - 1];
+            if ((last->offsetPadded + last->size == offsetPadded) &&
+                (last->offsetUnpadded + last->size == offsetUnpadded)) {
+                last->size += size;
+                return count;
+            }
+        }
+        runs[count].offsetPadded = offsetPadded;
+        runs[count].offsetUnpadded = offsetUnpadded;
+        runs[count].size = size;
+        return count + 1;
+    }
+
+    for (size_t ct = 0; ct < mFieldCount; ct++) {
+        const Element *e = mFields[ct].e.get();
+        uint32_t padded = offsetPadded + (mFields[ct].offsetBits >> 3);
+        uint32_t unpadded = offsetUnpadded + (mFields[ct].offsetBitsUnpadded >> 3);
+        for (uint32_t i = 0; i < mFields[ct].arraySize; i++) {
+            count = e->appendPackRuns(runs, count, padded, unpadded);
+            padded += e->getSizeBytes();
+            unpadded += e->getSizeBytesUnpadded();
+        }
+    }
+    return count;
+}
+
+void Element::computePackRuns() {
+    delete [] mPackRuns;
+    mPackRuns = new PackRun_t[appendPackRuns(NULL, 0, 0, 0)];
+    mPackRunCount = appendPackRuns(mPackRuns, 0, 0, 0);
 }
 
 ObjectBaseRef<const Element> Element::createRef(Context *rsc, RsDataType dt, RsDataKind dk,
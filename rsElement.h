@@ -135,6 +135,17 @@ public:
     virtual void callUpdateCacheObject(const Context *rsc, void *dstObj) const;
     bool getHasReferences() const {return mHasReference;}
 
+    // A run of bytes that is contiguous in both the padded and the unpadded
+    // layout of one element.  The runs of an element, in order, describe how
+    // to convert between the two (see Allocation::writePackedData).
+    typedef struct {
+        uint32_t offsetPadded;
+        uint32_t offsetUnpadded;
+        uint32_t size;
+    } PackRun_t;
+    const PackRun_t * getPackRuns() const {return mPackRuns;}
+    uint32_t getPackRunCount() const {return mPackRunCount;}
+
 protected:
     // deallocate any components that are part of this element.
     void clear();
@@ -150,6 +161,9 @@ protected:
     size_t mFieldCount;
     bool mHasReference;
 
+    PackRun_t *mPackRuns;
+    uint32_t mPackRunCount;
+
 
     virtual ~Element();
     Element(Context *);
@@ -159,6 +173,9 @@ protected:
     uint32_t mBits;
 
     void compute();
+    void computePackRuns();
+    uint32_t appendPackRuns(PackRun_t *runs, uint32_t count,
+                            uint32_t offsetPadded, uint32_t offsetUnpadded) const;
 
     virtual void preDestroy() const;
 };
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rsContext.h"
+#include "rsFence.h"
+
+#include <errno.h>
+#include <time.h>
+
+// Defined inside the namespace: android::Fence from ui/Fence.h is visible
+// here through rsContext.h, so an unqualified Fence at global scope after
+// using-directives would be ambiguous.
+namespace android {
+namespace renderscript {
+
+Fence::Fence(Context *rsc) : ObjectBase(rsc) {
+    pthread_mutex_init(&mLock, NULL);
+    // Timed waits are measured on the monotonic clock so they are not
+    // affected by changes to the wall clock.
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&mCond, &attr);
+    pthread_condattr_destroy(&attr);
+    mSignaled = false;
+    mNotify = false;
+    mNotifyCookie = 0;
+}
+
+Fence::~Fence() {
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mLock);
+}
+
+void Fence::sendNotify() {
+    mRSC->sendMessageToClient(&mNotifyCookie, RS_MESSAGE_TO_CLIENT_FENCE, 0,
+                              sizeof(mNotifyCookie), true);
+}
+
+void Fence::signal() {
+    pthread_mutex_lock(&mLock);
+    bool notify = !mSignaled && mNotify;
+    mSignaled = true;
+    pthread_cond_broadcast(&mCond);
+    pthread_mutex_unlock(&mLock);
+
+    if (notify) {
+        sendNotify();
+    }
+}
+
+bool Fence::isSignaled() {
+    pthread_mutex_lock(&mLock);
+    bool ret = mSignaled;
+    pthread_mutex_unlock(&mLock);
+    return ret;
+}
+
+bool Fence::wait(int64_t timeout) {
+    pthread_mutex_lock(&mLock);
+    if (!mSignaled && timeout) {
+        if (timeout < 0) {
+            while (!mSignaled) {
+                pthread_cond_wait(&mCond, &mLock);
+            }
+        } else {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            int64_t ns = (int64_t)now.tv_nsec + timeout;
+            struct timespec until;
+            until.tv_sec = now.tv_sec + (time_t)(ns / 1000000000);
+            until.tv_nsec = (long)(ns % 1000000000);
+            while (!mSignaled) {
+                if (pthread_cond_timedwait(&mCond, &mLock, &until) == ETIMEDOUT) {
+                    break;
+                }
+            }
+        }
+    }
+    bool ret = mSignaled;
+    pthread_mutex_unlock(&mLock);
+    return ret;
+}
+
+void Fence::setNotify(uintptr_t cookie) {
+    pthread_mutex_lock(&mLock);
+    bool now = mSignaled && !mNotify;
+    mNotify = true;
+    mNotifyCookie = cookie;
+    pthread_mutex_unlock(&mLock);
+
+    if (now) {
+        sendNotify();
+    }
+}
+
+RsFence rsi_FenceCreate(Context *rsc) {
+    Fence *f = new Fence(rsc);
+    f->incUserRef();
+    return f;
+}
+
+void rsi_ContextInsertFence(Context *rsc, RsFence vf) {
+    Fence *f = static_cast<Fence *>(vf);
+    f->signal();
+}
+
+bool rsi_FenceWait(Context *rsc, RsFence vf, int64_t timeout) {
+    Fence *f = static_cast<Fence *>(vf);
+    return f->wait(timeout);
+}
+
+void rsi_FenceSetNotify(Context *rsc, RsFence vf, uintptr_t cookie) {
+    Fence *f = static_cast<Fence *>(vf);
+    f->setNotify(cookie);
+}
+
+}
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_RS_FENCE_H
+#define ANDROID_RS_FENCE_H
+
+#include "rsObjectBase.h"
+
+// ---------------------------------------------------------------------------
+namespace android {
+namespace renderscript {
+
+/*
+ * A one-shot marker in the command stream.  Commands replay in order on the
+ * RS thread and each one completes before the next starts, so by the time
+ * the fence command itself replays every command queued ahead of it has
+ * finished.  Clients can poll or wait on the fence from any thread, or ask
+ * for an RS_MESSAGE_TO_CLIENT_FENCE message when it signals.
+ */
+class Fence : public ObjectBase {
+public:
+    Fence(Context *);
+
+    void signal();
+    bool isSignaled();
+
+    // Waits up to timeout nanoseconds; a negative timeout waits forever.
+    // Returns true if the fence signaled.
+    bool wait(int64_t timeout);
+
+    // Sends cookie to the client once the fence signals, immediately if it
+    // already has.
+    void setNotify(uintptr_t cookie);
+
+    virtual void serialize(Context *rsc, OStream *stream) const {
+    }
+    virtual RsA3DClassID getClassId() const {
+        return RS_A3D_CLASS_ID_UNKNOWN;
+    }
+
+protected:
+    virtual ~Fence();
+
+    void sendNotify();
+
+    pthread_mutex_t mLock;
+    pthread_cond_t mCond;
+    bool mSignaled;
+    bool mNotify;
+    uintptr_t mNotifyCookie;
+};
+
+}
+}
+#endif
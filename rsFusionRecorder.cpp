@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rsContext.h"
+#include "rsFusionRecorder.h"
+#include "rsScriptGroup.h"
+#include "rsgApiStructs.h"
+
+using namespace android;
+using namespace android::renderscript;
+
+FusionRecorder::FusionRecorder() {
+    mPending.count = 0;
+    for (uint32_t ct = 0; ct < kMaxCached; ct++) {
+        mCache[ct].chain.count = 0;
+        mCache[ct].lastUse = 0;
+    }
+    mClock = 0;
+}
+
+FusionRecorder::~FusionRecorder() {
+    // The owner flushes first; launches still pending here are dropped.
+    if (mPending.count) {
+        ALOGW("FusionRecorder destroyed with %u pending launches", mPending.count);
+        mPending.count = 0;
+    }
+    clearCache();
+}
+
+bool FusionRecorder::sameShape(const Allocation *a, const Allocation *b) {
+    const Type *ta = a->getType();
+    const Type *tb = b->getType();
+    return (ta->getDimX() == tb->getDimX()) && (ta->getDimY() == tb->getDimY());
+}
+
+bool FusionRecorder::canCapture(uint32_t cmdID, const void *data, size_t bytes) const {
+    if (cmdID != RS_CMD_ID_ScriptForEach) {
+        return false;
+    }
+    const RS_CMD_ScriptForEach *cmd = (const RS_CMD_ScriptForEach *)data;
+    if (cmd->usr_length || cmd->sc_length || !cmd->aout) {
+        return false;
+    }
+
+    const Script *s = static_cast<const Script *>(cmd->s);
+    if (s->hasObjectSlots() || s->hasOpaqueGlobals()) {
+        return false;
+    }
+
+    const Allocation *aout = static_cast<const Allocation *>(cmd->aout);
+    const Type *t = aout->getType();
+    if (t->getDimZ() || t->getDimFaces() || t->getDimYuv()) {
+        return false;
+    }
+    const Allocation *ain = static_cast<const Allocation *>(cmd->ain);
+    return !ain || sameShape(ain, aout);
+}
+
+bool FusionRecorder::extends(const Script *s, const Allocation *ain,
+                             const Allocation *aout) const {
+    const uint32_t count = mPending.count;
+    if (!count || (count == kMaxChain) || (ain != mPending.allocs[count])) {
+        return false;
+    }
+    if (!sameShape(ain, aout)) {
+        return false;
+    }
+    // Each script may appear once, and the only Allocation shared by two
+    // launches is the link between them.
+    for (uint32_t ct = 0; ct < count; ct++) {
+        if (mPending.scripts[ct] == s) {
+            return false;
+        }
+    }
+    for (uint32_t ct = 0; ct <= count; ct++) {
+        if (mPending.allocs[ct] == aout) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FusionRecorder::capture(Context *rsc, const void *data) {
+    const RS_CMD_ScriptForEach *cmd = (const RS_CMD_ScriptForEach *)data;
+    Script *s = static_cast<Script *>(cmd->s);
+    Allocation *ain = static_cast<Allocation *>(cmd->ain);
+    Allocation *aout = static_cast<Allocation *>(cmd->aout);
+
+    if (!extends(s, ain, aout)) {
+        flush(rsc);
+        mPending.allocs[0] = ain;
+    }
+    const uint32_t count = mPending.count;
+    mPending.scripts[count] = s;
+    mPending.slots[count] = cmd->slot;
+    mPending.allocs[count + 1] = aout;
+    mPending.count = count + 1;
+}
+
+FusionRecorder::CacheEntry * FusionRecorder::lookup() {
+    const size_t bytes = sizeof(Script *) * mPending.count;
+    for (uint32_t ct = 0; ct < kMaxCached; ct++) {
+        const Chain &c = mCache[ct].chain;
+        if ((c.count == mPending.count) &&
+            !memcmp(c.scripts, mPending.scripts, bytes) &&
+            !memcmp(c.slots, mPending.slots, sizeof(uint32_t) * c.count) &&
+            !memcmp(c.allocs, mPending.allocs, sizeof(Allocation *) * (c.count + 1))) {
+            return &mCache[ct];
+        }
+    }
+    return NULL;
+}
+
+void FusionRecorder::runUnfused(Context *rsc) {
+    for (uint32_t ct = 0; ct < mPending.count; ct++) {
+        mPending.scripts[ct]->runForEach(rsc, mPending.slots[ct], mPending.allocs[ct],
+                                         mPending.allocs[ct + 1], NULL, 0);
+    }
+}
+
+void FusionRecorder::flush(Context *rsc) {
+    if (!mPending.count) {
+        return;
+    }
+    if (mPending.count == 1) {
+        runUnfused(rsc);
+        mPending.count = 0;
+        return;
+    }
+
+    mClock++;
+    CacheEntry *e = lookup();
+    if (!e) {
+        // First sighting: remember the chain, replacing the stalest entry.
+        e = &mCache[0];
+        for (uint32_t ct = 1; ct < kMaxCached; ct++) {
+            if (mCache[ct].lastUse < e->lastUse) {
+                e = &mCache[ct];
+            }
+        }
+        e->group.clear();
+        for (uint32_t ct = 0; ct < kMaxChain; ct++) {
+            e->scriptRefs[ct].clear();
+        }
+        e->chain = mPending;
+        e->lastUse = mClock;
+        runUnfused(rsc);
+        mPending.count = 0;
+        return;
+    }
+
+    e->lastUse = mClock;
+    if (!e->group.get()) {
+        // The group holds the Allocations, the entry holds the Scripts, so
+        // the pointers in the key stay valid while it is cached.
+        for (uint32_t ct = 0; ct < mPending.count; ct++) {
+            e->scriptRefs[ct].set(mPending.scripts[ct]);
+        }
+        e->group.set(ScriptGroup::createFromChain(rsc, mPending.scripts, mPending.slots,
+                                                  mPending.allocs, mPending.count));
+    }
+    if (e->group.get()) {
+        e->group->execute(rsc);
+    } else {
+        runUnfused(rsc);
+    }
+    mPending.count = 0;
+}
+
+void FusionRecorder::clearCache() {
+    for (uint32_t ct = 0; ct < kMaxCached; ct++) {
+        mCache[ct].group.clear();
+        for (uint32_t ct2 = 0; ct2 < kMaxChain; ct2++) {
+            mCache[ct].scriptRefs[ct2].clear();
+        }
+        mCache[ct].chain.count = 0;
+        mCache[ct].lastUse = 0;
+    }
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_RS_FUSION_RECORDER_H
+#define ANDROID_RS_FUSION_RECORDER_H
+
+#include "rsObjectBase.h"
+
+// ---------------------------------------------------------------------------
+namespace android {
+namespace renderscript {
+
+class Allocation;
+class Script;
+class ScriptGroup;
+
+/*
+ * Automatic kernel fusion for contexts with auto fusion enabled.
+ *
+ * Plain forEach launches are held back while each one consumes the output
+ * of the previous one. Any other command ends the chain. A chain seen for
+ * the first time runs launch by launch. Its shape (scripts, slots and
+ * Allocations) is remembered, and the next time the same chain is issued a
+ * ScriptGroup is built for it, cached and executed, so the driver can run
+ * the kernels row by row while the data is still in cache.
+ *
+ * Only launches without user parameters or launch options are captured, on
+ * Scripts without object globals, over matching 1D or 2D Allocations.
+ */
+class FusionRecorder {
+public:
+    FusionRecorder();
+    ~FusionRecorder();
+
+    // Returns true if the command is a launch that can join a chain.
+    bool canCapture(uint32_t cmdID, const void *data, size_t bytes) const;
+
+    // Appends the launch to the pending chain, first running the chain if
+    // the launch does not continue it.  The caller must have run any other
+    // work that is still deferred.
+    void capture(Context *rsc, const void *data);
+
+    // Runs the pending chain, fused if it has been seen before.
+    void flush(Context *rsc);
+
+    // Drops the cached groups and the references they hold.
+    void clearCache();
+
+protected:
+    static const uint32_t kMaxChain = 8;
+    static const uint32_t kMaxCached = 8;
+
+    struct Chain {
+        Script *scripts[kMaxChain];
+        uint32_t slots[kMaxChain];
+        // allocs[i] is read by launch i, allocs[i + 1] written by it.
+        Allocation *allocs[kMaxChain + 1];
+        uint32_t count;
+    };
+
+    struct CacheEntry {
+        Chain chain;
+        uint32_t lastUse;
+        ObjectBaseRef<ScriptGroup> group;
+        ObjectBaseRef<Script> scriptRefs[kMaxChain];
+    };
+
+    static bool sameShape(const Allocation *a, const Allocation *b);
+    bool extends(const Script *s, const Allocation *ain, const Allocation *aout) const;
+    CacheEntry * lookup();
+    void runUnfused(Context *rsc);
+
+    Chain mPending;
+    CacheEntry mCache[kMaxCached];
+    uint32_t mClock;
+};
+
+}
+}
+#endif
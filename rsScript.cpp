@@ -26,8 +26,10 @@ Script::Script(Context *rsc) : ObjectBase(rsc) {
 
     mSlots = NULL;
     mTypes = NULL;
+    mGlobalObjs = NULL;
     mInitialized = false;
     mHasObjectSlots = false;
+    mHasOpaqueGlobals = false;
 }
 
 Script::~Script() {
@@ -39,10 +41,12 @@ Script::~Script() {
         delete [] mTypes;
         mTypes = NULL;
     }
+    delete [] mGlobalObjs;
 }
 
 void Script::setSlot(uint32_t slot, Allocation *a) {
     //ALOGE("setSlot %i %p", slot, a);
+    waitReady();
     if (slot >= mHal.info.exportedVariableCount) {
         ALOGE("Script::setSlot unable to set allocation, invalid slot index");
         return;
@@ -55,6 +59,7 @@ void Script::setSlot(uint32_t slot, Allocation *a) {
 
 void Script::setVar(uint32_t slot, const void *val, size_t len) {
     //ALOGE("setVar %i %p %i", slot, val, len);
+    waitReady();
     if (slot >= mHal.info.exportedVariableCount) {
         ALOGE("Script::setVar unable to set allocation, invalid slot index");
         return;
@@ -64,6 +69,7 @@ void Script::setVar(uint32_t slot, const void *val, size_t len) {
 
 void Script::getVar(uint32_t slot, const void *val, size_t len) {
     //ALOGE("getVar %i %p %i", slot, val, len);
+    waitReady();
     if (slot >= mHal.info.exportedVariableCount) {
         ALOGE("Script::getVar unable to set allocation, invalid slot index: "
               "%u >= %zu", slot, mHal.info.exportedVariableCount);
@@ -74,26 +80,80 @@ void Script::getVar(uint32_t slot, const void *val, size_t len) {
 
 void Script::setVar(uint32_t slot, const void *val, size_t len, Element *e,
                     const uint32_t *dims, size_t dimLen) {
+    waitReady();
     if (slot >= mHal.info.exportedVariableCount) {
         ALOGE("Script::setVar unable to set allocation, invalid slot index: "
               "%u >= %zu", slot, mHal.info.exportedVariableCount);
         return;
     }
+    if (e && e->getHasReferences()) {
+        mHasOpaqueGlobals = true;
+    }
     mRSC->mHal.funcs.script.setGlobalVarWithElemDims(mRSC, this, slot,
             (void *)val, len, e, dims, dimLen);
 }
 
 void Script::setVarObj(uint32_t slot, ObjectBase *val) {
     //ALOGE("setVarObj %i %p", slot, val);
+    waitReady();
     if (slot >= mHal.info.exportedVariableCount) {
         ALOGE("Script::setVarObj unable to set allocation, invalid slot index: "
               "%u >= %zu", slot, mHal.info.exportedVariableCount);
         return;
     }
     mHasObjectSlots = true;
+    if (!mGlobalObjs) {
+        mGlobalObjs = new ObjectBaseRef<const ObjectBase>[mHal.info.exportedVariableCount];
+    }
+    mGlobalObjs[slot].set(val);
     mRSC->mHal.funcs.script.setGlobalObj(mRSC, this, slot, val);
 }
 
+bool Script::getGlobalObjects(Vector<const ObjectBase *> *objs, uint32_t depth) const {
+    if (mHasOpaqueGlobals || (depth > 4) || !isReady()) {
+        return false;
+    }
+    if (mRSC->mHal.funcs.script.getGlobalObj == NULL) {
+        return false;
+    }
+    if (!mHal.info.exportedVariableCount) {
+        // Static globals may still hold objects; let the driver say so.
+        ObjectBase *live = NULL;
+        return mRSC->mHal.funcs.script.getGlobalObj(mRSC, this, 0, &live);
+    }
+    for (size_t ct = 0; ct < mHal.info.exportedVariableCount; ct++) {
+        if (mSlots && mSlots[ct].get()) {
+            objs->add(mSlots[ct].get());
+        }
+
+        // The script may have replaced what the client set, in init(), an
+        // invokable or with rsSetObject, so the handle it holds now counts
+        // as well.
+        ObjectBase *live = NULL;
+        if (!mRSC->mHal.funcs.script.getGlobalObj(mRSC, this, ct, &live)) {
+            return false;
+        }
+        const ObjectBase *set = mGlobalObjs ? mGlobalObjs[ct].get() : NULL;
+        if (!addGlobalObject(objs, live, depth) ||
+            ((set != live) && !addGlobalObject(objs, set, depth))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Script::addGlobalObject(Vector<const ObjectBase *> *objs, const ObjectBase *o,
+                             uint32_t depth) const {
+    if (!o) {
+        return true;
+    }
+    objs->add(o);
+    if ((o != this) && (o->getClassId() == RS_A3D_CLASS_ID_SCRIPT_C)) {
+        return static_cast<const Script *>(o)->getGlobalObjects(objs, depth + 1);
+    }
+    return true;
+}
+
 void Script::callUpdateCacheObject(const Context *rsc, void *dstObj) const {
     if (rsc->mHal.funcs.script.updateCachedObject != NULL) {
         rsc->mHal.funcs.script.updateCachedObject(rsc, this, (rs_script *)dstObj);
@@ -104,6 +164,11 @@ void Script::callUpdateCacheObject(const Context *rsc, void *dstObj) const {
 
 bool Script::freeChildren() {
     incSysRef();
+    if (mGlobalObjs) {
+        for (size_t ct = 0; ct < mHal.info.exportedVariableCount; ct++) {
+            mGlobalObjs[ct].clear();
+        }
+    }
     mRSC->mHal.funcs.script.invokeFreeChildren(mRSC, this);
     return decSysRef();
 }
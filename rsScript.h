@@ -71,6 +71,7 @@ public:
             size_t exportedVariableCount;
             size_t exportedFunctionCount;
             size_t exportedPragmaCount;
+            size_t exportedForeachCount;
             char const **exportedPragmaKeyList;
             char const **exportedPragmaValueList;
             const std::pair<const char *, uint32_t> *exportedForeachFuncList;
@@ -132,12 +133,37 @@ public:
     bool hasObjectSlots() const {
         return mHasObjectSlots;
     }
+
+    // True once a struct global carrying object references has been set.
+    bool hasOpaqueGlobals() const {
+        return mHasOpaqueGlobals;
+    }
+
+    // False while a script created asynchronously is still compiling.
+    virtual bool isReady() const { return true; }
+    // Waits for an asynchronous creation to finish. Returns false if the
+    // script could not be created.
+    virtual bool waitReady() { return true; }
+
+    // Appends every object a launch of this script may reach through its
+    // globals: bound Allocations, objects set with setVarObj, the objects
+    // the script holds in its object globals right now and, for Scripts
+    // among those, their globals in turn.  Returns false if the set cannot
+    // be known, e.g. when a struct global carries object references or the
+    // driver cannot rule out objects outside single-handle exported globals.
+    bool getGlobalObjects(Vector<const ObjectBase *> *objs, uint32_t depth = 0) const;
     virtual void callUpdateCacheObject(const Context *rsc, void *dstObj) const;
 
 protected:
+    bool addGlobalObject(Vector<const ObjectBase *> *objs, const ObjectBase *o,
+                         uint32_t depth) const;
+
     bool mInitialized;
     bool mHasObjectSlots;
+    bool mHasOpaqueGlobals;
     ObjectBaseRef<Allocation> *mSlots;
+    // Objects last set through setVarObj.
+    ObjectBaseRef<const ObjectBase> *mGlobalObjs;
     ObjectBaseRef<const Type> *mTypes;
 
 };
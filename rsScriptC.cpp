@@ -37,13 +37,31 @@ using namespace android::renderscript;
     Context * rsc = tls->mContext; \
     ScriptC * sc = (ScriptC *) tls->mScript
 
+// Arguments of a compile running on a background thread, copied so that the
+// caller's buffers can go away.
+struct ScriptC::AsyncCompile {
+    pthread_t thread;
+    Context *rsc;
+    ScriptC *script;
+    char *resName;
+    char *cacheDir;
+    uint8_t *bitcode;
+    size_t bitcodeLen;
+    bool compiled;
+};
+
 ScriptC::ScriptC(Context *rsc) : Script(rsc) {
 #if !defined(RS_COMPATIBILITY_LIB) && !defined(ANDROID_RS_SERIALIZE)
     BT = NULL;
 #endif
+    mAsync = NULL;
 }
 
 ScriptC::~ScriptC() {
+    if (mAsync && joinCompile()) {
+        // Never used, so init() has not run and there is nothing to free.
+        mRSC->mHal.funcs.script.destroy(mRSC, this);
+    }
 #if !defined(RS_COMPATIBILITY_LIB) && !defined(ANDROID_RS_SERIALIZE)
     if (BT) {
         delete BT;
@@ -78,7 +96,9 @@ bool ScriptC::createCacheDir(const char *cacheDir) {
         statReturn = stat(currentDir.string(), &statBuf);
         if (statReturn) {
             if (errno == ENOENT) {
-                if (mkdir(currentDir.string(), S_IRUSR | S_IWUSR | S_IXUSR)) {
+                // Scripts compiling in the background may race us here.
+                if (mkdir(currentDir.string(), S_IRUSR | S_IWUSR | S_IXUSR) &&
+                    errno != EEXIST) {
                     ALOGE("Couldn't create cache directory: %s",
                           currentDir.string());
                     ALOGE("Error: %s", strerror(errno));
@@ -112,6 +132,17 @@ void ScriptC::setupScript(Context *rsc) {
     }
 }
 
+// Kernels are traced by their exported name.  Drivers that do not export
+// the names, such as the compatibility library, get the slot instead.
+void ScriptC::getTraceName(uint32_t slot, char *name, size_t len) const {
+    if (mHal.info.exportedForeachFuncList &&
+        (slot < mHal.info.exportedForeachCount)) {
+        snprintf(name, len, "%s", mHal.info.exportedForeachFuncList[slot].first);
+    } else {
+        snprintf(name, len, "forEach_%u", slot);
+    }
+}
+
 void ScriptC::setupGLState(Context *rsc) {
 #ifndef RS_COMPATIBILITY_LIB
     if (mEnviroment.mFragmentStore.get()) {
@@ -130,6 +161,7 @@ void ScriptC::setupGLState(Context *rsc) {
 }
 
 uint32_t ScriptC::run(Context *rsc) {
+    waitReady();
     if (mHal.info.root == NULL) {
         rsc->setError(RS_ERROR_BAD_SCRIPT, "Attempted to run bad script");
         return 0;
@@ -161,6 +193,11 @@ void ScriptC::runForEach(Context *rsc,
                          const void * usr,
                          size_t usrBytes,
                          const RsScriptCall *sc) {
+    if (!waitReady()) {
+        rsc->setError(RS_ERROR_BAD_SCRIPT, "Attempted to launch bad script");
+        return;
+    }
+
     // Trace this function call.
     // To avoid overhead, we only build the string, if tracing is actually
     // enabled.
@@ -176,6 +213,16 @@ void ScriptC::runForEach(Context *rsc,
 
     Context::PushState ps(rsc);
 
+    char traceName[Tracer::kNameLength] = "";
+    if (Tracer::isEnabled()) {
+        getTraceName(slot, traceName, sizeof(traceName));
+    }
+    const Allocation *shape = aout ? aout : ain;
+    TraceScope trace(Tracer::CAT_LAUNCH, traceName,
+                     shape ? shape->getType()->getDimX() : 0,
+                     shape ? shape->getType()->getDimY() : 0);
+    rsc->mStats.add(ContextStats::LAUNCHES, 1);
+
     setupGLState(rsc);
     setupScript(rsc);
     rsc->mHal.funcs.script.invokeForEach(rsc, this, slot, ain, aout, usr, usrBytes, sc);
@@ -192,6 +239,11 @@ void ScriptC::runForEach(Context *rsc,
                          const void * usr,
                          size_t usrBytes,
                          const RsScriptCall *sc) {
+    if (!waitReady()) {
+        rsc->setError(RS_ERROR_BAD_SCRIPT, "Attempted to launch bad script");
+        return;
+    }
+
     // Trace this function call.
     // To avoid overhead we only build the string if tracing is actually
     // enabled.
@@ -207,6 +259,16 @@ void ScriptC::runForEach(Context *rsc,
 
     Context::PushState ps(rsc);
 
+    char traceName[Tracer::kNameLength] = "";
+    if (Tracer::isEnabled()) {
+        getTraceName(slot, traceName, sizeof(traceName));
+    }
+    const Allocation *shape = aout ? aout : (inLen ? ains[0] : NULL);
+    TraceScope trace(Tracer::CAT_LAUNCH, traceName,
+                     shape ? shape->getType()->getDimX() : 0,
+                     shape ? shape->getType()->getDimY() : 0);
+    rsc->mStats.add(ContextStats::LAUNCHES, 1);
+
     setupGLState(rsc);
     setupScript(rsc);
 
@@ -218,6 +280,7 @@ void ScriptC::runForEach(Context *rsc,
 
 void ScriptC::Invoke(Context *rsc, uint32_t slot, const void *data, size_t len) {
     ATRACE_CALL();
+    waitReady();
 
     if (slot >= mHal.info.exportedFunctionCount) {
         rsc->setError(RS_ERROR_BAD_SCRIPT, "Calling invoke on bad script");
@@ -238,6 +301,88 @@ bool ScriptC::runCompiler(Context *rsc,
                           size_t bitcodeLen) {
     ATRACE_CALL();
     //ALOGE("runCompiler %p %p %p %p %p %i", rsc, this, resName, cacheDir, bitcode, bitcodeLen);
+    if (!compile(rsc, resName, cacheDir, bitcode, bitcodeLen)) {
+        return false;
+    }
+    return finishCompile(rsc);
+}
+
+bool ScriptC::runCompilerAsync(Context *rsc,
+                               const char *resName,
+                               const char *cacheDir,
+                               const uint8_t *bitcode,
+                               size_t bitcodeLen) {
+    AsyncCompile *job = new AsyncCompile;
+    job->rsc = rsc;
+    job->script = this;
+    job->resName = resName ? strdup(resName) : NULL;
+    job->cacheDir = cacheDir ? strdup(cacheDir) : NULL;
+    job->bitcode = (uint8_t *)malloc(bitcodeLen);
+    job->bitcodeLen = bitcodeLen;
+    job->compiled = false;
+    if (job->bitcode) {
+        memcpy(job->bitcode, bitcode, bitcodeLen);
+    }
+
+    if (!job->bitcode ||
+        pthread_create(&job->thread, NULL, asyncCompileProc, job)) {
+        ALOGE("Failed to start background compile of %s", resName);
+        free(job->resName);
+        free(job->cacheDir);
+        free(job->bitcode);
+        delete job;
+        return false;
+    }
+    mAsync = job;
+    return true;
+}
+
+void * ScriptC::asyncCompileProc(void *vjob) {
+    AsyncCompile *job = (AsyncCompile *)vjob;
+    job->compiled = job->script->compile(job->rsc, job->resName, job->cacheDir,
+                                         job->bitcode, job->bitcodeLen);
+    return NULL;
+}
+
+bool ScriptC::joinCompile() {
+    pthread_join(mAsync->thread, NULL);
+    bool compiled = mAsync->compiled;
+    free(mAsync->resName);
+    free(mAsync->cacheDir);
+    free(mAsync->bitcode);
+    delete mAsync;
+    mAsync = NULL;
+    return compiled;
+}
+
+bool ScriptC::waitReady() {
+    if (!mAsync) {
+        return mInitialized;
+    }
+
+    if (!joinCompile()) {
+        mRSC->setError(RS_ERROR_BAD_SCRIPT, "Failed to create script");
+        return false;
+    }
+    if (!finishCompile(mRSC)) {
+        // Leave it looking like a script that never compiled.
+        mRSC->mHal.funcs.script.invokeFreeChildren(mRSC, this);
+        mRSC->mHal.funcs.script.destroy(mRSC, this);
+        memset(&mHal, 0, sizeof(mHal));
+        mInitialized = false;
+        mRSC->setError(RS_ERROR_BAD_SCRIPT, "Failed to create script");
+        return false;
+    }
+    return true;
+}
+
+// Everything up to the driver init. This only touches the script itself, so
+// it may run on any thread.
+bool ScriptC::compile(Context *rsc,
+                      const char *resName,
+                      const char *cacheDir,
+                      const uint8_t *bitcode,
+                      size_t bitcodeLen) {
 #ifndef RS_COMPATIBILITY_LIB
 #ifndef ANDROID_RS_SERIALIZE
     uint32_t sdkVersion = 0;
@@ -287,7 +432,11 @@ bool ScriptC::runCompiler(Context *rsc,
     if (!rsc->mHal.funcs.script.init(rsc, this, resName, cacheDir, bitcode, bitcodeLen, 0)) {
         return false;
     }
+    return true;
+}
 
+// Runs the script's init() and applies its pragmas, on the thread using it.
+bool ScriptC::finishCompile(Context *rsc) {
     mInitialized = true;
 #ifndef RS_COMPATIBILITY_LIB
     mEnviroment.mFragment.set(rsc->getDefaultProgramFragment());
@@ -368,6 +517,53 @@ bool ScriptC::runCompiler(Context *rsc,
     return true;
 }
 
+ScriptC * ScriptC::createClone(Context *rsc, ScriptC *src) {
+    if (!src->waitReady()) {
+        rsc->setError(RS_ERROR_BAD_SCRIPT, "Can't clone a script that failed to compile");
+        return NULL;
+    }
+    if (rsc->mHal.funcs.script.clone == NULL) {
+        rsc->setError(RS_ERROR_DRIVER, "Script cloning is not supported by the driver");
+        return NULL;
+    }
+
+    ScriptC *s = new ScriptC(rsc);
+    if (!rsc->mHal.funcs.script.clone(rsc, s, src)) {
+        rsc->setError(RS_ERROR_BAD_SCRIPT, "Unable to clone script");
+        ObjectBase::checkDelete(s);
+        return NULL;
+    }
+
+    s->mInitialized = true;
+#ifndef RS_COMPATIBILITY_LIB
+    s->mEnviroment.mFragment.set(src->mEnviroment.mFragment.get());
+    s->mEnviroment.mVertex.set(src->mEnviroment.mVertex.get());
+    s->mEnviroment.mFragmentStore.set(src->mEnviroment.mFragmentStore.get());
+    s->mEnviroment.mRaster.set(src->mEnviroment.mRaster.get());
+#endif
+    s->mHasOpaqueGlobals = src->mHasOpaqueGlobals;
+
+    // The driver copied the globals, object references included; only the
+    // bound Allocations need to be told about the new instance.
+    size_t count = s->mHal.info.exportedVariableCount;
+    s->mSlots = new ObjectBaseRef<Allocation>[count];
+    s->mTypes = new ObjectBaseRef<const Type>[count];
+    for (size_t ct = 0; ct < count; ct++) {
+        s->mTypes[ct].set(src->mTypes[ct].get());
+        if (src->mSlots[ct].get()) {
+            s->setSlot(ct, src->mSlots[ct].get());
+        }
+    }
+    if (src->mGlobalObjs) {
+        s->mGlobalObjs = new ObjectBaseRef<const ObjectBase>[count];
+        for (size_t ct = 0; ct < count; ct++) {
+            s->mGlobalObjs[ct].set(src->mGlobalObjs[ct].get());
+        }
+        s->mHasObjectSlots = true;
+    }
+    return s;
+}
+
 namespace android {
 namespace renderscript {
 
@@ -388,5 +584,35 @@ RsScript rsi_ScriptCCreate(Context *rsc,
     return s;
 }
 
+RsScript rsi_ScriptCCreateAsync(Context *rsc,
+                                const char *resName, size_t resName_length,
+                                const char *cacheDir, size_t cacheDir_length,
+                                const char *text, size_t text_length)
+{
+    ScriptC *s = new ScriptC(rsc);
+
+    if (!s->runCompilerAsync(rsc, resName, cacheDir, (uint8_t *)text, text_length)) {
+        ObjectBase::checkDelete(s);
+        return NULL;
+    }
+
+    s->incUserRef();
+    return s;
+}
+
+bool rsi_ScriptCWait(Context *rsc, RsScript vs) {
+    ScriptC *s = static_cast<ScriptC *>(vs);
+    return s->waitReady();
+}
+
+RsScript rsi_ScriptCClone(Context *rsc, RsScript src) {
+    ScriptC *s = ScriptC::createClone(rsc, static_cast<ScriptC *>(src));
+    if (!s) {
+        return NULL;
+    }
+    s->incUserRef();
+    return s;
+}
+
 }
 }
@@ -65,6 +65,17 @@ public:
 
     bool runCompiler(Context *rsc, const char *resName, const char *cacheDir,
                      const uint8_t *bitcode, size_t bitcodeLen);
+    // Starts runCompiler() on a background thread and returns at once. The
+    // driver part runs there; the script's init() runs on the first call to
+    // waitReady(), which every use of the script makes.
+    bool runCompilerAsync(Context *rsc, const char *resName, const char *cacheDir,
+                          const uint8_t *bitcode, size_t bitcodeLen);
+    virtual bool isReady() const { return mAsync == NULL; }
+    virtual bool waitReady();
+
+    // Creates another instance of src's script without compiling it again.
+    // Globals are copied and bindings rebound; init() is not rerun.
+    static ScriptC * createClone(Context *rsc, ScriptC *src);
 
 //protected:
     void setupScript(Context *);
@@ -77,6 +88,17 @@ private:
 #if !defined(RS_COMPATIBILITY_LIB)
     bool createCacheDir(const char *cacheDir);
 #endif
+
+    bool compile(Context *rsc, const char *resName, const char *cacheDir,
+                 const uint8_t *bitcode, size_t bitcodeLen);
+    bool finishCompile(Context *rsc);
+    void getTraceName(uint32_t slot, char *name, size_t len) const;
+
+    struct AsyncCompile;
+    // Pending background compile, if any.
+    AsyncCompile *mAsync;
+    static void * asyncCompileProc(void *);
+    bool joinCompile();
 };
 
 }
@@ -21,6 +21,7 @@ using namespace android;
 using namespace android::renderscript;
 
 ScriptGroup::ScriptGroup(Context *rsc) : ObjectBase(rsc) {
+    mKeepLinkContents = false;
 }
 
 ScriptGroup::~ScriptGroup() {
@@ -253,6 +254,46 @@ ScriptGroup * ScriptGroup::create(Context *rsc,
     return sg;
 }
 
+ScriptGroup * ScriptGroup::createFromChain(Context *rsc, Script *const *scripts,
+                                           const uint32_t *slots,
+                                           Allocation *const *allocs, size_t count) {
+    ScriptGroup *sg = new ScriptGroup(rsc);
+    sg->mKeepLinkContents = true;
+
+    sg->mKernels.reserve(count);
+    for (size_t ct=0; ct < count; ct++) {
+        int sig = 2;
+        if (allocs[ct]) {
+            sig |= 1;
+        }
+        sg->mKernels.add(new ScriptKernelID(rsc, scripts[ct], slots[ct], sig));
+    }
+
+    sg->mLinks.reserve(count - 1);
+    for (size_t ct=0; ct + 1 < count; ct++) {
+        Link *l = new Link();
+        l->mType = allocs[ct + 1]->getType();
+        l->mSource = sg->mKernels[ct].get();
+        l->mDstKernel = sg->mKernels[ct + 1].get();
+        l->mAlloc = allocs[ct + 1];
+        sg->mLinks.add(l);
+    }
+
+    if (!sg->calcOrder()) {
+        delete sg;
+        return NULL;
+    }
+
+    if (rsc->mHal.funcs.scriptgroup.init) {
+        rsc->mHal.funcs.scriptgroup.init(rsc, sg);
+    }
+    if (allocs[0]) {
+        sg->setInput(rsc, sg->mKernels[0].get(), allocs[0]);
+    }
+    sg->setOutput(rsc, sg->mKernels[count - 1].get(), allocs[count]);
+    return sg;
+}
+
 void ScriptGroup::setInput(Context *rsc, ScriptKernelID *kid, Allocation *a) {
     for (size_t ct=0; ct < mInputs.size(); ct++) {
         if (mInputs[ct]->mKernel == kid) {
@@ -301,10 +342,20 @@ bool ScriptGroup::validateInputAndOutput(Context *rsc) {
 
 void ScriptGroup::execute(Context *rsc) {
 
+    for (size_t ct = 0; ct < mKernels.size(); ct++) {
+        if (!mKernels[ct]->mScript->waitReady()) {
+            rsc->setError(RS_ERROR_BAD_SCRIPT, "ScriptGroup contains a bad script.");
+            return;
+        }
+    }
+
     if (!validateInputAndOutput(rsc)) {
         return;
     }
 
+    TraceScope trace(Tracer::CAT_LAUNCH, "ScriptGroup");
+    rsc->mStats.add(ContextStats::LAUNCHES, 1);
+
     //ALOGE("ScriptGroup::execute");
     if (rsc->mHal.funcs.scriptgroup.execute) {
         rsc->mHal.funcs.scriptgroup.execute(rsc, this);
@@ -79,6 +79,10 @@ public:
     };
     Hal mHal;
 
+    // Set when link Allocations must hold the full result of their source
+    // kernel rather than per-thread scratch rows.
+    bool mKeepLinkContents;
+
     static ScriptGroup * create(Context *rsc,
                            ScriptKernelID ** kernels, size_t kernelsSize,
                            ScriptKernelID ** src, size_t srcSize,
@@ -86,6 +90,13 @@ public:
                            ScriptFieldID ** dstF, size_t dstFSize,
                            const Type ** type, size_t typeSize);
 
+    // Builds a group running count kernels back to back, where kernel i
+    // reads allocs[i] and writes allocs[i + 1].  allocs[0] may be NULL.  The
+    // intermediate Allocations are the caller's and keep their contents.
+    static ScriptGroup * createFromChain(Context *rsc, Script *const *scripts,
+                                         const uint32_t *slots,
+                                         Allocation *const *allocs, size_t count);
+
     virtual void serialize(Context *rsc, OStream *stream) const;
     virtual RsA3DClassID getClassId() const;
 
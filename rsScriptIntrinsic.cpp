@@ -64,6 +64,17 @@ void ScriptIntrinsic::runForEach(Context *rsc,
                          size_t usrBytes,
                          const RsScriptCall *sc) {
 
+    // Intrinsics have no kernel names, so launches are traced by id.
+    char traceName[24] = "";
+    if (Tracer::isEnabled()) {
+        snprintf(traceName, sizeof(traceName), "intrinsic_%u", mIntrinsicID);
+    }
+    const Allocation *shape = aout ? aout : ain;
+    TraceScope trace(Tracer::CAT_LAUNCH, traceName,
+                     shape ? shape->getType()->getDimX() : 0,
+                     shape ? shape->getType()->getDimY() : 0);
+    rsc->mStats.add(ContextStats::LAUNCHES, 1);
+
     rsc->mHal.funcs.script.invokeForEach(rsc, this, slot, ain, aout, usr, usrBytes, sc);
 }
 
@@ -76,6 +87,16 @@ void ScriptIntrinsic::runForEach(Context* rsc,
                          size_t usrBytes,
                          const RsScriptCall* sc) {
 
+    char traceName[24] = "";
+    if (Tracer::isEnabled()) {
+        snprintf(traceName, sizeof(traceName), "intrinsic_%u", mIntrinsicID);
+    }
+    const Allocation *shape = aout ? aout : (inLen ? ains[0] : NULL);
+    TraceScope trace(Tracer::CAT_LAUNCH, traceName,
+                     shape ? shape->getType()->getDimX() : 0,
+                     shape ? shape->getType()->getDimY() : 0);
+    rsc->mStats.add(ContextStats::LAUNCHES, 1);
+
     rsc->mHal.funcs.script.invokeForEachMulti(rsc, this, slot, ains, inLen, aout, usr, usrBytes, sc);
 }
 
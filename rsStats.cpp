@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rsStats.h"
+
+#include <pthread.h>
+#include <string.h>
+
+using namespace android;
+using namespace android::renderscript;
+
+// Each thread is given the next index the first time it updates a counter.
+// The key holds the index plus one, so zero means none has been assigned.
+static pthread_key_t gStripeKey;
+static pthread_once_t gStripeOnce = PTHREAD_ONCE_INIT;
+static volatile int32_t gStripeCount = 0;
+
+static void initStripeKey() {
+    pthread_key_create(&gStripeKey, NULL);
+}
+
+uint32_t ContextStats::getStripe() {
+    pthread_once(&gStripeOnce, initStripeKey);
+    uintptr_t index = (uintptr_t)pthread_getspecific(gStripeKey);
+    if (!index) {
+        index = (uint32_t)__sync_add_and_fetch(&gStripeCount, 1);
+        pthread_setspecific(gStripeKey, (void *)index);
+    }
+    return (uint32_t)(index - 1) % kStripeCount;
+}
+
+ContextStats::ContextStats() {
+    memset(mStripes, 0, sizeof(mStripes));
+}
+
+static uint64_t difference(uint64_t added, uint64_t removed) {
+    // The two sums are not read atomically, so a removal may be seen
+    // before the matching addition.
+    return added > removed ? added - removed : 0;
+}
+
+void ContextStats::read(RsContextStats *stats) const {
+    uint64_t sums[_COUNTER_COUNT];
+    memset(sums, 0, sizeof(sums));
+    for (uint32_t ct = 0; ct < kStripeCount; ct++) {
+        for (uint32_t c = 0; c < _COUNTER_COUNT; c++) {
+            sums[c] += __sync_fetch_and_add(&mStripes[ct].values[c], 0);
+        }
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    stats->commands = sums[COMMANDS];
+    stats->fifoWaitTime = sums[FIFO_WAIT_NS];
+    stats->launches = sums[LAUNCHES];
+    stats->bytesCopied = sums[BYTES_COPIED];
+    stats->allocationsCreated = sums[ALLOCATIONS_CREATED];
+    stats->allocationsLive = difference(sums[ALLOCATIONS_CREATED],
+                                        sums[ALLOCATIONS_DESTROYED]);
+    stats->allocationBytesLive = difference(sums[ALLOCATION_BYTES_ADDED],
+                                            sums[ALLOCATION_BYTES_REMOVED]);
+    stats->workerBusyTime = sums[WORKER_BUSY_NS];
+    stats->workerIdleTime = sums[WORKER_IDLE_NS];
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_RS_STATS_H
+#define ANDROID_RS_STATS_H
+
+#include "rsDefines.h"
+
+#include <stdint.h>
+
+// ---------------------------------------------------------------------------
+namespace android {
+namespace renderscript {
+
+/*
+ * The counters reported by rsContextGetStats.
+ *
+ * Every counter is split into stripes. A thread always adds to the stripe
+ * picked by its process-wide thread index, so the RS thread, each worker
+ * and the client threads write to separate cache lines and their updates
+ * do not contend. read() sums the stripes. It may run concurrently with
+ * updates, so the values it returns are only consistent with each other
+ * once the context is idle.
+ */
+class ContextStats {
+public:
+    enum Counter {
+        COMMANDS,
+        FIFO_WAIT_NS,
+        LAUNCHES,
+        BYTES_COPIED,
+        ALLOCATIONS_CREATED,
+        ALLOCATIONS_DESTROYED,
+        ALLOCATION_BYTES_ADDED,
+        ALLOCATION_BYTES_REMOVED,
+        WORKER_BUSY_NS,
+        WORKER_IDLE_NS,
+        _COUNTER_COUNT
+    };
+
+    ContextStats();
+
+    void add(Counter c, uint64_t value) const {
+        __sync_fetch_and_add(&mStripes[getStripe()].values[c], value);
+    }
+
+    void read(RsContextStats *stats) const;
+
+protected:
+    static const uint32_t kStripeCount = 16;
+
+    // Rounded up to 64 bytes so stripes do not share cache lines.
+    struct Stripe {
+        uint64_t values[(_COUNTER_COUNT + 7) & ~7];
+    };
+    mutable Stripe mStripes[kStripeCount];
+
+    static uint32_t getStripe();
+};
+
+}
+}
+
+#endif
@@ -33,13 +33,40 @@ ThreadIO::ThreadIO() {
     mRunning = true;
     mPureFifo = false;
     mMaxInlineSize = 1024;
+    mScheduler = NULL;
+    mFusion = NULL;
+
+    pthread_mutex_init(&mClientLock, NULL);
+    pthread_cond_init(&mClientReady, NULL);
+    pthread_cond_init(&mClientSpace, NULL);
+    mClientRing = NULL;
+    mClientWrite = 0;
+    mClientAcquired = 0;
+    mClientRead = 0;
+    mClientWaiting = 0;
+    mClientSpaceWaiting = 0;
+    mClientShutdown = false;
+    mClientHasPending = false;
 }
 
 ThreadIO::~ThreadIO() {
+    delete mFusion;
+    delete mScheduler;
+    if (mClientRing) {
+        // Drop anything the client never picked up.
+        mClientAcquired = mClientWrite;
+        releaseClientMessages();
+        free(mClientRing);
+    }
+    pthread_cond_destroy(&mClientSpace);
+    pthread_cond_destroy(&mClientReady);
+    pthread_mutex_destroy(&mClientLock);
 }
 
-void ThreadIO::init() {
-    mToClient.init();
+void ThreadIO::init(bool toClient) {
+    if (toClient) {
+        mClientRing = (uint8_t *)malloc(kClientRingSize);
+    }
     mToCore.init();
 }
 
@@ -64,7 +91,11 @@ void ThreadIO::coreCommit() {
 }
 
 void ThreadIO::clientShutdown() {
-    mToClient.shutdown();
+    pthread_mutex_lock(&mClientLock);
+    mClientShutdown = true;
+    pthread_cond_broadcast(&mClientReady);
+    pthread_cond_broadcast(&mClientSpace);
+    pthread_mutex_unlock(&mClientLock);
 }
 
 void ThreadIO::coreWrite(const void *data, size_t len) {
@@ -101,10 +132,61 @@ void ThreadIO::setTimeoutCallback(void (*cb)(void *), void *dat, uint64_t timeou
     //mToCore.setTimeoutCallback(cb, dat, timeout);
 }
 
+void ThreadIO::releaseFusionCache(Context *con) {
+    if (mFusion) {
+        mFusion->flush(con);
+    }
+    delete mFusion;
+    mFusion = NULL;
+}
+
+void ThreadIO::flushDeferred(Context *con) {
+    if (mFusion) {
+        mFusion->flush(con);
+    }
+    if (mScheduler) {
+        mScheduler->flush(con);
+    }
+}
+
+void ThreadIO::playLocal(Context *con, uint32_t cmdID, const void *data, size_t bytes) {
+    if (con->getAutoFusion() != (mFusion != NULL)) {
+        if (mFusion) {
+            releaseFusionCache(con);
+        } else {
+            mFusion = new FusionRecorder();
+        }
+    }
+
+    if (mFusion && mFusion->canCapture(cmdID, data, bytes)) {
+        if (mScheduler) {
+            mScheduler->flush(con);
+        }
+        mFusion->capture(con, data);
+        return;
+    }
+    if (mFusion) {
+        mFusion->flush(con);
+    }
+
+    if (mScheduler && mScheduler->defer(con, cmdID, data, bytes)) {
+        return;
+    }
+    if (mScheduler) {
+        mScheduler->flush(con);
+    }
+    gPlaybackFuncs[cmdID](con, data, bytes);
+}
+
 bool ThreadIO::playCoreCommands(Context *con, int waitFd) {
     bool ret = false;
     const bool isLocal = !isPureFifo();
 
+    if (!mScheduler && isLocal && (con->mHal.flags & RS_CONTEXT_OUT_OF_ORDER) &&
+        !con->mIsGraphicsContext) {
+        mScheduler = new CommandScheduler();
+    }
+
     uint8_t buf[2 * 1024];
     const CoreCmdHeader *cmd = (const CoreCmdHeader *)&buf[0];
     const void * data = (const void *)&buf[sizeof(CoreCmdHeader)];
@@ -127,7 +209,16 @@ bool ThreadIO::playCoreCommands(Context *con, int waitFd) {
 
     int waitTime = -1;
     while (mRunning) {
+        // Only blocking waits are timed.
+        const uint64_t waitStart = waitTime ? con->getTime() : 0;
         int pr = poll(p, pollCount, waitTime);
+        if (waitTime) {
+            const uint64_t waitEnd = con->getTime();
+            con->mStats.add(ContextStats::FIFO_WAIT_NS, waitEnd - waitStart);
+            if (Tracer::isEnabled()) {
+                Tracer::record(Tracer::CAT_FIFO, "fifo wait", waitStart, waitEnd);
+            }
+        }
         if (pr <= 0) {
             break;
         }
@@ -147,6 +238,7 @@ bool ThreadIO::playCoreCommands(Context *con, int waitFd) {
 
 
             ret = true;
+            con->mStats.add(ContextStats::COMMANDS, 1);
             if (con->props.mLogTimes) {
                 con->timerSet(Context::RS_TIMER_INTERNAL);
             }
@@ -157,10 +249,13 @@ bool ThreadIO::playCoreCommands(Context *con, int waitFd) {
                 ALOGE("playCoreCommands error con %p, cmd %i", con, cmd->cmdID);
             }
 
-            if (isLocal) {
-                gPlaybackFuncs[cmd->cmdID](con, data, cmd->bytes);
-            } else {
-                gPlaybackRemoteFuncs[cmd->cmdID](con, this);
+            {
+                TraceScope trace(Tracer::CAT_COMMAND, gPlaybackNames[cmd->cmdID], cmd->cmdID);
+                if (isLocal) {
+                    playLocal(con, cmd->cmdID, data, cmd->bytes);
+                } else {
+                    gPlaybackRemoteFuncs[cmd->cmdID](con, this);
+                }
             }
 
             if (con->props.mLogTimes) {
@@ -180,49 +275,188 @@ bool ThreadIO::playCoreCommands(Context *con, int waitFd) {
             break;
         }
     }
+
+    flushDeferred(con);
     return ret;
 }
 
+size_t ThreadIO::clientRecordSize(size_t dataLen) const {
+    return (sizeof(ClientCmdHeader) + dataLen + 15) & ~(size_t)15;
+}
+
+size_t ThreadIO::clientRecordSize(const ClientCmdHeader *hdr) const {
+    if ((hdr->cmdID != kClientRecordSkip) && (hdr->flags & kClientRecordHeap)) {
+        return clientRecordSize(sizeof(void *));
+    }
+    return clientRecordSize(hdr->bytes);
+}
+
+ThreadIO::ClientCmdHeader * ThreadIO::clientRecordAt(size_t pos) const {
+    return (ClientCmdHeader *)&mClientRing[pos & (kClientRingSize - 1)];
+}
+
+size_t ThreadIO::acquireClientMessages(RsMessageToClient *msgs, size_t maxCount) {
+    pthread_mutex_lock(&mClientLock);
+    while ((mClientAcquired == mClientWrite) && !mClientShutdown) {
+        mClientWaiting++;
+        pthread_cond_wait(&mClientReady, &mClientLock);
+        mClientWaiting--;
+    }
+    const size_t end = mClientWrite;
+    pthread_mutex_unlock(&mClientLock);
+
+    // Records in [mClientAcquired, end) are complete and will not be touched
+    // by the producer until they are released, so they can be walked unlocked.
+    size_t count = 0;
+    size_t pos = mClientAcquired;
+    while ((pos != end) && (count < maxCount)) {
+        const ClientCmdHeader *hdr = clientRecordAt(pos);
+        if (hdr->cmdID != kClientRecordSkip) {
+            RsMessageToClient &m = msgs[count++];
+            m.type = (RsMessageToClientType)hdr->cmdID;
+            m.usrID = hdr->userID;
+            m.dataLen = hdr->bytes;
+            m.data = &hdr[1];
+            if (hdr->flags & kClientRecordHeap) {
+                m.data = *(void * const *)&hdr[1];
+            }
+        }
+        pos += clientRecordSize(hdr);
+    }
+    // Trailing skip records are consumed along with the batch.
+    while ((pos != end) && (clientRecordAt(pos)->cmdID == kClientRecordSkip)) {
+        pos += clientRecordSize(clientRecordAt(pos));
+    }
+    mClientAcquired = pos;
+    return count;
+}
+
+void ThreadIO::releaseClientMessages() {
+    for (size_t pos = mClientRead; pos != mClientAcquired; ) {
+        const ClientCmdHeader *hdr = clientRecordAt(pos);
+        if ((hdr->cmdID != kClientRecordSkip) && (hdr->flags & kClientRecordHeap)) {
+            free(*(void * const *)&hdr[1]);
+        }
+        pos += clientRecordSize(hdr);
+    }
+
+    pthread_mutex_lock(&mClientLock);
+    mClientRead = mClientAcquired;
+    if (mClientSpaceWaiting) {
+        pthread_cond_broadcast(&mClientSpace);
+    }
+    pthread_mutex_unlock(&mClientLock);
+}
+
 RsMessageToClientType ThreadIO::getClientHeader(size_t *receiveLen, uint32_t *usrID) {
-    //ALOGE("getClientHeader");
-    mToClient.read(&mLastClientHeader, sizeof(mLastClientHeader));
+    // A peek without a matching get returns the same message again.
+    if (!mClientHasPending) {
+        if (!acquireClientMessages(&mClientPending, 1)) {
+            mClientPending.type = RS_MESSAGE_TO_CLIENT_NONE;
+            mClientPending.usrID = 0;
+            mClientPending.data = NULL;
+            mClientPending.dataLen = 0;
+            releaseClientMessages();
+        } else {
+            mClientHasPending = true;
+        }
+    }
 
-    receiveLen[0] = mLastClientHeader.bytes;
-    usrID[0] = mLastClientHeader.userID;
-    //ALOGE("getClientHeader %i %i %i", mLastClientHeader.cmdID, usrID[0], receiveLen[0]);
-    return (RsMessageToClientType)mLastClientHeader.cmdID;
+    receiveLen[0] = mClientPending.dataLen;
+    usrID[0] = mClientPending.usrID;
+    return mClientPending.type;
 }
 
 RsMessageToClientType ThreadIO::getClientPayload(void *data, size_t *receiveLen,
                                 uint32_t *usrID, size_t bufferLen) {
-    //ALOGE("getClientPayload");
-    receiveLen[0] = mLastClientHeader.bytes;
-    usrID[0] = mLastClientHeader.userID;
-    if (bufferLen < mLastClientHeader.bytes) {
+    if (!mClientHasPending) {
+        size_t len;
+        uint32_t id;
+        getClientHeader(&len, &id);
+    }
+
+    receiveLen[0] = mClientPending.dataLen;
+    usrID[0] = mClientPending.usrID;
+    if (bufferLen < mClientPending.dataLen) {
         return RS_MESSAGE_TO_CLIENT_RESIZE;
     }
-    if (receiveLen[0]) {
-        mToClient.read(data, receiveLen[0]);
+    if (mClientPending.dataLen) {
+        memcpy(data, mClientPending.data, mClientPending.dataLen);
+    }
+    if (mClientHasPending) {
+        mClientHasPending = false;
+        releaseClientMessages();
     }
-    //ALOGE("getClientPayload x");
-    return (RsMessageToClientType)mLastClientHeader.cmdID;
+    return mClientPending.type;
 }
 
 bool ThreadIO::sendToClient(RsMessageToClientType cmdID, uint32_t usrID, const void *data,
                             size_t dataLen, bool waitForSpace) {
 
-    //ALOGE("sendToClient %i %i %i", cmdID, usrID, (int)dataLen);
-    ClientCmdHeader hdr;
-    hdr.bytes = (uint32_t)dataLen;
-    hdr.cmdID = cmdID;
-    hdr.userID = usrID;
+    // Payloads that would take more than a quarter of the ring are copied to
+    // the heap so a single large message cannot stall the small ones.
+    void *heapCopy = NULL;
+    size_t recordLen = clientRecordSize(dataLen);
+    if (recordLen > (kClientRingSize / 4)) {
+        heapCopy = malloc(dataLen);
+        if (!heapCopy) {
+            ALOGE("sendToClient: unable to allocate %zu bytes", dataLen);
+            return false;
+        }
+        memcpy(heapCopy, data, dataLen);
+        recordLen = clientRecordSize(sizeof(void *));
+    }
 
-    mToClient.writeAsync(&hdr, sizeof(hdr));
-    if (dataLen) {
-        mToClient.writeAsync(data, dataLen);
+    pthread_mutex_lock(&mClientLock);
+    size_t tailRoom;
+    size_t needed;
+    while (true) {
+        tailRoom = kClientRingSize - (mClientWrite & (kClientRingSize - 1));
+        needed = recordLen + ((tailRoom < recordLen) ? tailRoom : 0);
+        if (mClientShutdown || (kClientRingSize - (mClientWrite - mClientRead)) >= needed) {
+            break;
+        }
+        if (!waitForSpace) {
+            break;
+        }
+        mClientSpaceWaiting++;
+        pthread_cond_wait(&mClientSpace, &mClientLock);
+        mClientSpaceWaiting--;
+    }
+    if (mClientShutdown || (kClientRingSize - (mClientWrite - mClientRead)) < needed) {
+        pthread_mutex_unlock(&mClientLock);
+        free(heapCopy);
+        return false;
     }
 
-    //ALOGE("sendToClient x");
+    if (tailRoom < recordLen) {
+        ClientCmdHeader *skip = clientRecordAt(mClientWrite);
+        skip->cmdID = kClientRecordSkip;
+        skip->bytes = tailRoom - sizeof(ClientCmdHeader);
+        skip->userID = 0;
+        skip->flags = 0;
+        mClientWrite += tailRoom;
+    }
+
+    ClientCmdHeader *hdr = clientRecordAt(mClientWrite);
+    hdr->cmdID = cmdID;
+    hdr->bytes = (uint32_t)dataLen;
+    hdr->userID = usrID;
+    if (heapCopy) {
+        hdr->flags = kClientRecordHeap;
+        memcpy(&hdr[1], &heapCopy, sizeof(heapCopy));
+    } else {
+        hdr->flags = 0;
+        if (dataLen) {
+            memcpy(&hdr[1], data, dataLen);
+        }
+    }
+    mClientWrite += recordLen;
+
+    // Only pay for the wake-up when the client is actually asleep.
+    if (mClientWaiting) {
+        pthread_cond_signal(&mClientReady);
+    }
+    pthread_mutex_unlock(&mClientLock);
     return true;
 }
-
@@ -19,6 +19,8 @@
 
 #include "rsUtils.h"
 #include "rsFifoSocket.h"
+#include "rsCommandScheduler.h"
+#include "rsFusionRecorder.h"
 
 // ---------------------------------------------------------------------------
 namespace android {
@@ -31,7 +33,9 @@ public:
     ThreadIO();
     ~ThreadIO();
 
-    void init();
+    // Queues other than the context's own never send to the client, which
+    // reads messages from the context's IO only, and need no client ring.
+    void init(bool toClient = true);
     void shutdown();
 
     size_t getMaxInlineSize() {
@@ -41,10 +45,15 @@ public:
         return mPureFifo;
     }
 
-    // Plays back commands from the client.
+    // Plays back commands from the client.  On out-of-order contexts,
+    // reorderable commands are batched and all run before this returns.
     // Returns true if any commands were processed.
     bool playCoreCommands(Context *con, int waitFd);
 
+    // Runs any launches the fusion recorder still holds, then releases its
+    // cache and the objects it references.
+    void releaseFusionCache(Context *con);
+
     void setTimeoutCallback(void (*)(void *), void *, uint64_t timeout);
 
     void * coreHeader(uint32_t, size_t dataLen);
@@ -66,6 +75,14 @@ public:
     bool sendToClient(RsMessageToClientType cmdID, uint32_t usrID, const void *data, size_t dataLen, bool waitForSpace);
     void clientShutdown();
 
+    // Batched to-client delivery.  acquireClientMessages blocks until at
+    // least one message is queued and then returns up to maxCount of them.
+    // The data pointers refer directly into the message ring and stay valid
+    // until releaseClientMessages is called.  Only one client thread may
+    // consume messages at a time.
+    size_t acquireClientMessages(RsMessageToClient *msgs, size_t maxCount);
+    void releaseClientMessages();
+
 
 protected:
     typedef struct CoreCmdHeaderRec {
@@ -76,14 +93,45 @@ protected:
         uint32_t cmdID;
         uint32_t bytes;
         uint32_t userID;
+        uint32_t flags;
     } ClientCmdHeader;
-    ClientCmdHeader mLastClientHeader;
+
+    // Records in the to-client ring are a ClientCmdHeader followed by the
+    // payload, padded so that every record starts 16 byte aligned and never
+    // wraps.  Payloads too large for the ring are stored out of line.
+    static const size_t kClientRingSize = 64 * 1024;
+    static const uint32_t kClientRecordSkip = 0xffffffff;
+    static const uint32_t kClientRecordHeap = 1;
+
+    size_t clientRecordSize(size_t dataLen) const;
+    size_t clientRecordSize(const ClientCmdHeader *hdr) const;
+    ClientCmdHeader * clientRecordAt(size_t pos) const;
+
+    pthread_mutex_t mClientLock;
+    pthread_cond_t mClientReady;
+    pthread_cond_t mClientSpace;
+    uint8_t *mClientRing;
+    size_t mClientWrite;     // Producer position.
+    size_t mClientAcquired;  // End of the records handed to the client.
+    size_t mClientRead;      // End of the records the client released.
+    uint32_t mClientWaiting;
+    uint32_t mClientSpaceWaiting;
+    bool mClientShutdown;
+
+    // Message being handed out through getClientHeader / getClientPayload.
+    RsMessageToClient mClientPending;
+    bool mClientHasPending;
 
     bool mRunning;
     bool mPureFifo;
     size_t mMaxInlineSize;
 
-    FifoSocket mToClient;
+    CommandScheduler *mScheduler;
+    FusionRecorder *mFusion;
+
+    void playLocal(Context *con, uint32_t cmdID, const void *data, size_t bytes);
+    void flushDeferred(Context *con);
+
     FifoSocket mToCore;
 
     intptr_t mToCoreRet;
@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "rsTrace.h"
+#include "rsUtils.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef RS_SERVER
+// Android exposes gettid(), standard Linux does not
+static pid_t gettid() {
+    return syscall(SYS_gettid);
+}
+#endif
+
+using namespace android;
+using namespace android::renderscript;
+
+volatile bool Tracer::gEnabled = false;
+
+namespace {
+
+struct TraceEvent {
+    uint64_t start;
+    uint64_t duration;
+    uint32_t tid;
+    uint32_t category;
+    uint32_t arg0;
+    uint32_t arg1;
+    char name[Tracer::kNameLength];
+};
+
+// Written only by the thread that owns it. head counts the events recorded
+// so far; event n is stored at n % kEventCount. Buffers are never freed.
+// When a thread exits its buffer is handed to the next thread that starts
+// recording, with the old events still in it.
+struct TraceBuffer {
+    TraceBuffer *next;
+    volatile int32_t inUse;
+    uint32_t tid;
+    volatile uint32_t head;
+    TraceEvent events[Tracer::kEventCount];
+};
+
+}
+
+static TraceBuffer * volatile gBuffers = NULL;
+static pthread_key_t gBufferKey;
+static pthread_once_t gBufferOnce = PTHREAD_ONCE_INIT;
+
+static const char * const gCategoryNames[Tracer::_CAT_COUNT] = {
+    "command", "fifo", "launch", "slice", "copy"
+};
+
+// Names of the two event arguments of each category, NULL when unused.
+static const char * const gArgNames[Tracer::_CAT_COUNT][2] = {
+    {"cmd", NULL},
+    {NULL, NULL},
+    {"dimX", "dimY"},
+    {"start", "end"},
+    {"bytes", NULL}
+};
+
+static void releaseBuffer(void *buffer) {
+    __sync_lock_release(&static_cast<TraceBuffer *>(buffer)->inUse);
+}
+
+static void initBufferKey() {
+    pthread_key_create(&gBufferKey, releaseBuffer);
+}
+
+static TraceBuffer * getBuffer() {
+    pthread_once(&gBufferOnce, initBufferKey);
+    TraceBuffer *b = static_cast<TraceBuffer *>(pthread_getspecific(gBufferKey));
+    if (b) {
+        return b;
+    }
+
+    for (b = gBuffers; b; b = b->next) {
+        if (__sync_bool_compare_and_swap(&b->inUse, 0, 1)) {
+            break;
+        }
+    }
+    if (!b) {
+        b = static_cast<TraceBuffer *>(calloc(1, sizeof(TraceBuffer)));
+        if (!b) {
+            return NULL;
+        }
+        b->inUse = 1;
+        do {
+            b->next = gBuffers;
+        } while (!__sync_bool_compare_and_swap(&gBuffers, b->next, b));
+    }
+    b->tid = gettid();
+    pthread_setspecific(gBufferKey, b);
+    return b;
+}
+
+void Tracer::setEnabled(bool enable) {
+    gEnabled = enable;
+}
+
+uint64_t Tracer::now() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_nsec + ((uint64_t)t.tv_sec * 1000 * 1000 * 1000);
+}
+
+void Tracer::record(Category cat, const char *name, uint64_t start,
+                    uint64_t end, uint32_t arg0, uint32_t arg1) {
+    TraceBuffer *b = getBuffer();
+    if (!b) {
+        return;
+    }
+
+    uint32_t head = b->head;
+    TraceEvent *e = &b->events[head & (kEventCount - 1)];
+    e->start = start;
+    e->duration = end - start;
+    e->tid = b->tid;
+    e->category = cat;
+    e->arg0 = arg0;
+    e->arg1 = arg1;
+    strncpy(e->name, name, kNameLength - 1);
+    e->name[kNameLength - 1] = 0;
+
+    // The event has to be complete before a reader can see the new head.
+    __sync_synchronize();
+    b->head = head + 1;
+}
+
+static void writeEscaped(FILE *f, const char *s) {
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            fprintf(f, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(f, "\\u%04x", c);
+        } else {
+            fputc(c, f);
+        }
+    }
+}
+
+static void writeEvent(FILE *f, const TraceEvent *e, pid_t pid, bool first) {
+    fprintf(f, "%s\n{\"name\":\"", first ? "" : ",");
+    writeEscaped(f, e->name);
+    fprintf(f, "\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+            "\"pid\":%d,\"tid\":%u",
+            gCategoryNames[e->category], e->start / 1000.0,
+            e->duration / 1000.0, (int)pid, e->tid);
+
+    const char * const *args = gArgNames[e->category];
+    if (args[0]) {
+        fprintf(f, ",\"args\":{\"%s\":%u", args[0], e->arg0);
+        if (args[1]) {
+            fprintf(f, ",\"%s\":%u", args[1], e->arg1);
+        }
+        fprintf(f, "}");
+    }
+    fprintf(f, "}");
+}
+
+bool Tracer::dump(const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        ALOGE("Unable to open trace file %s", path);
+        return false;
+    }
+
+    TraceEvent *events = static_cast<TraceEvent *>(malloc(sizeof(TraceEvent) * kEventCount));
+    if (!events) {
+        fclose(f);
+        return false;
+    }
+
+    const pid_t pid = getpid();
+    bool first = true;
+    fprintf(f, "{\"traceEvents\":[");
+    for (TraceBuffer *b = gBuffers; b; b = b->next) {
+        const uint32_t end = b->head;
+        __sync_synchronize();
+        const uint32_t count = rsMin(end, kEventCount);
+        const uint32_t begin = end - count;
+        for (uint32_t ct = 0; ct < count; ct++) {
+            events[ct] = b->events[(begin + ct) & (kEventCount - 1)];
+        }
+        __sync_synchronize();
+
+        // Events the owner has started to overwrite since head was read are
+        // dropped. Recording event n reuses the slot of n - kEventCount.
+        const uint32_t written = b->head - begin;
+        const uint32_t skip = written >= kEventCount ?
+                              rsMin(written - kEventCount + 1, count) : 0;
+        for (uint32_t ct = skip; ct < count; ct++) {
+            if (events[ct].category < _CAT_COUNT) {
+                writeEvent(f, &events[ct], pid, first);
+                first = false;
+            }
+        }
+    }
+    fprintf(f, "\n],\"displayTimeUnit\":\"ns\"}\n");
+
+    free(events);
+    bool ok = !ferror(f);
+    if (fclose(f) || !ok) {
+        ALOGE("Unable to write trace file %s", path);
+        return false;
+    }
+    return true;
+}
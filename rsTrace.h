@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_RS_TRACE_H
+#define ANDROID_RS_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// ---------------------------------------------------------------------------
+namespace android {
+namespace renderscript {
+
+/*
+ * Execution tracing.
+ *
+ * Each thread records complete events (a name, a start and a duration) into
+ * its own ring buffer, so recording takes no locks and never blocks. The
+ * newest kEventCount events of every thread are kept. dump() writes them as
+ * Chrome trace JSON, which chrome://tracing and Perfetto can load.
+ *
+ * Tracing is switched on for the whole process, either with the
+ * debug.rs.trace property or through rsContextSetTracing(). While it is off
+ * a trace point costs one load and branch.
+ */
+class Tracer {
+public:
+    enum Category {
+        CAT_COMMAND,    // A command played from the FIFO, args: command id.
+        CAT_FIFO,       // The RS thread waiting for commands.
+        CAT_LAUNCH,     // A forEach or ScriptGroup launch, args: dimX, dimY.
+        CAT_SLICE,      // A slice run by a worker, args: start, end.
+        CAT_COPY,       // An Allocation data copy, args: bytes.
+        _CAT_COUNT
+    };
+
+    static bool isEnabled() {
+        return gEnabled;
+    }
+    static void setEnabled(bool enable);
+
+    // Monotonic time in nanoseconds.
+    static uint64_t now();
+
+    // Records an event for the calling thread. The name is copied and may
+    // be truncated.
+    static void record(Category cat, const char *name, uint64_t start,
+                       uint64_t end, uint32_t arg0 = 0, uint32_t arg1 = 0);
+
+    // Writes the recorded events of all threads to path. Threads may keep
+    // recording while this runs; events overwritten during the dump are
+    // left out.
+    static bool dump(const char *path);
+
+    static const uint32_t kEventCount = 4096;
+    static const uint32_t kNameLength = 40;
+
+protected:
+    static volatile bool gEnabled;
+};
+
+// Records the lifetime of the object as one event. The name must stay
+// valid until the scope ends.
+class TraceScope {
+public:
+    TraceScope(Tracer::Category cat, const char *name,
+               uint32_t arg0 = 0, uint32_t arg1 = 0) {
+        mName = NULL;
+        if (Tracer::isEnabled()) {
+            mCat = cat;
+            mName = name;
+            mArg0 = arg0;
+            mArg1 = arg1;
+            mStart = Tracer::now();
+        }
+    }
+    ~TraceScope() {
+        if (mName) {
+            Tracer::record(mCat, mName, mStart, Tracer::now(), mArg0, mArg1);
+        }
+    }
+
+protected:
+    Tracer::Category mCat;
+    const char *mName;
+    uint32_t mArg0;
+    uint32_t mArg1;
+    uint64_t mStart;
+};
+
+}
+}
+
+#endif
@@ -159,6 +159,16 @@ typedef struct {
                                    size_t usrLen,
                                    const RsScriptCall *sc);
         void (*updateCachedObject)(const Context *rsc, const Script *, rs_script *obj);
+
+        bool (*clone)(const Context *rsc, ScriptC *dst, const ScriptC *src);
+
+        // Returns the object currently held by an exported global, or NULL
+        // if the global holds no object.  Returns false if the driver cannot
+        // tell, or if the script may keep objects anywhere other than
+        // single-handle exported globals (static globals, array elements).
+        // Scripts without exported globals are queried once with slot 0.
+        bool (*getGlobalObj)(const Context *rsc, const Script *s,
+                             uint32_t slot, ObjectBase **obj);
     } script;
 
     struct {
@@ -242,6 +252,11 @@ typedef struct {
         void (*generateMipmaps)(const Context *rsc, const Allocation *alloc);
 
         void (*updateCachedObject)(const Context *rsc, const Allocation *alloc, rs_allocation *obj);
+
+        void (*generateMipmapsFiltered)(const Context *rsc, const Allocation *alloc,
+                                        RsMipmapFilter filter);
+
+        void (*clone)(const Context *rsc, const Allocation *dst, const Allocation *src);
     } allocation;
 
     struct {
@@ -323,6 +338,15 @@ typedef struct {
     } element;
 
     void (*finish)(const Context *rsc);
+
+    // Bracket the replay loop of each extra command queue thread.
+    void (*attachQueueThread)(const Context *rsc);
+    void (*detachQueueThread)(const Context *rsc);
+
+    // Runs cbk once on the calling thread and once on each driver worker
+    // thread, with a distinct idx per call.  Each call sees its own copy of
+    // the caller's script TLS.
+    void (*launchWorkers)(const Context *rsc, void (*cbk)(void *usr, uint32_t idx), void *data);
 } RsdHalFunctions;
 
 
@@ -265,7 +265,7 @@ void printApiCpp(FILE *f) {
             }
             fprintf(f, "    }\n\n");
 
-            fprintf(f, "    ThreadIO *io = &((Context *)rsc)->mIO;\n");
+            fprintf(f, "    ThreadIO *io = ((Context *)rsc)->getIO();\n");
             fprintf(f, "    const size_t size = sizeof(RS_CMD_%s);\n", api->name);
             if (hasInlineDataPointers(api)) {
                 fprintf(f, "    size_t dataSize = 0;\n");
@@ -505,12 +505,12 @@ void printPlaybackCpp(FILE *f) {
             }
 
             fprintf(f, "    if ((totalSize != 0) && (cmdSizeBytes == sizeof(RS_CMD_%s))) {\n", api->name);
-            fprintf(f, "        con->mIO.coreSetReturn(NULL, 0);\n");
+            fprintf(f, "        con->getIO()->coreSetReturn(NULL, 0);\n");
             fprintf(f, "    }\n");
         } else if (api->ret.typeName[0]) {
-            fprintf(f, "    con->mIO.coreSetReturn(&ret, sizeof(ret));\n");
+            fprintf(f, "    con->getIO()->coreSetReturn(&ret, sizeof(ret));\n");
         } else if (api->sync || needFlush) {
-            fprintf(f, "    con->mIO.coreSetReturn(NULL, 0);\n");
+            fprintf(f, "    con->getIO()->coreSetReturn(NULL, 0);\n");
         }
 
         fprintf(f, "};\n\n");
@@ -636,6 +636,13 @@ void printPlaybackCpp(FILE *f) {
     }
     fprintf(f, "};\n");
 
+    fprintf(f, "const char * const gPlaybackNames[%i] = {\n", apiCount + 1);
+    fprintf(f, "    \"\",\n");
+    for (ct=0; ct < apiCount; ct++) {
+        fprintf(f, "    \"%s\",\n", apis[ct].name);
+    }
+    fprintf(f, "};\n");
+
     fprintf(f, "};\n");
     fprintf(f, "};\n");
 }
@@ -685,6 +692,7 @@ int main(int argc, char **argv) {
             fprintf(f, "typedef void (*RsPlaybackRemoteFunc)(Context *, ThreadIO *);\n");
             fprintf(f, "extern RsPlaybackLocalFunc gPlaybackFuncs[%i];\n", apiCount + 1);
             fprintf(f, "extern RsPlaybackRemoteFunc gPlaybackRemoteFuncs[%i];\n", apiCount + 1);
+            fprintf(f, "extern const char * const gPlaybackNames[%i];\n", apiCount + 1);
 
             fprintf(f, "}\n");
             fprintf(f, "}\n");
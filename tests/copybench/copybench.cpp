@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RenderScript.h"
+#include <sys/time.h>
+
+using namespace android;
+using namespace RSC;
+
+// Measures the bandwidth of the Allocation copy paths for a 4K RGBA frame and
+// a 256^3 byte volume: host to Allocation, Allocation to host, Allocation to
+// Allocation, each packed and as a sub-rectangle with strided rows.
+
+static double now() {
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return t.tv_sec + t.tv_usec * 1e-6;
+}
+
+static void report(const char *name, size_t bytes, int iters, double secs) {
+    printf("%-28s %8.2f GB/s  (%.3f ms/copy)\n", name,
+           (double)bytes * iters / secs / 1e9, secs * 1e3 / iters);
+}
+
+#define BENCH(name, bytes, stmt)                        \
+    do {                                                \
+        stmt;                                           \
+        rs->finish();                                   \
+        double t0 = now();                              \
+        for (int i = 0; i < iters; i++) {               \
+            stmt;                                       \
+        }                                               \
+        rs->finish();                                   \
+        report(name, bytes, iters, now() - t0);         \
+    } while (0)
+
+int main(int argc, char** argv)
+{
+    int iters = 20;
+    if (argc >= 2) {
+        iters = atoi(argv[1]);
+        if (iters <= 0) {
+            printf("iters must be positive\n");
+            return 1;
+        }
+    }
+
+    sp<RS> rs = new RS();
+    if (!rs->init("/system/bin")) {
+        printf("Could not initialize RenderScript\n");
+        return 1;
+    }
+
+    const uint32_t w = 3840, h = 2160;
+    const uint32_t sw = w - 64, sh = h - 64;
+    Type::Builder tb(rs, Element::RGBA_8888(rs));
+    tb.setX(w);
+    tb.setY(h);
+    sp<const Type> t2 = tb.create();
+    sp<Allocation> a = Allocation::createTyped(rs, t2);
+    sp<Allocation> b = Allocation::createTyped(rs, t2);
+
+    const size_t frame = (size_t)w * h * 4;
+    const size_t sub = (size_t)sw * sh * 4;
+    uint8_t *buf = new uint8_t[frame];
+    memset(buf, 0x5a, frame);
+
+    printf("2D %ux%u RGBA_8888, %d iterations\n", w, h, iters);
+    BENCH("copy2DRangeFrom", frame, a->copy2DRangeFrom(0, 0, w, h, buf));
+    BENCH("copy2DRangeTo", frame, a->copy2DRangeTo(0, 0, w, h, buf));
+    BENCH("copy2DRangeFrom(alloc)", frame, b->copy2DRangeFrom(0, 0, w, h, a, 0, 0));
+    BENCH("copy2DStridedFrom(sub)", sub,
+          a->copy2DStridedFrom(32, 32, sw, sh, buf, w * 4));
+    BENCH("copy2DStridedTo(sub)", sub,
+          a->copy2DStridedTo(32, 32, sw, sh, buf, w * 4));
+    BENCH("copy2DRangeFrom(alloc, sub)", sub,
+          b->copy2DRangeFrom(32, 32, sw, sh, a, 0, 0));
+
+    const uint32_t n = 256;
+    Type::Builder tb3(rs, Element::U8(rs));
+    tb3.setX(n);
+    tb3.setY(n);
+    tb3.setZ(n);
+    sp<const Type> t3 = tb3.create();
+    sp<Allocation> v = Allocation::createTyped(rs, t3);
+    sp<Allocation> u = Allocation::createTyped(rs, t3);
+
+    const size_t volume = (size_t)n * n * n;
+    const size_t subVolume = (size_t)(n - 16) * (n - 16) * (n - 16);
+
+    printf("3D %u^3 U8, %d iterations\n", n, iters);
+    BENCH("copy3DRangeFrom", volume, v->copy3DRangeFrom(0, 0, 0, n, n, n, buf));
+    BENCH("copy3DRangeFrom(alloc)", volume,
+          u->copy3DRangeFrom(0, 0, 0, n, n, n, v, 0, 0, 0));
+    BENCH("copy3DRangeFrom(alloc, sub)", subVolume,
+          u->copy3DRangeFrom(8, 8, 8, n - 16, n - 16, n - 16, v, 0, 0, 0));
+
+    delete [] buf;
+    return 0;
+}
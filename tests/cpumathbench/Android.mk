@@ -0,0 +1,28 @@
+LOCAL_PATH:= $(call my-dir)
+include $(CLEAR_VARS)
+
+# rs_core_math_bench.cpp is generated by frameworks/rs/api/gen_runtime -b.
+LOCAL_SRC_FILES:= \
+	rs_core_math_bench.cpp
+
+LOCAL_SHARED_LIBRARIES := \
+	libRS \
+	libRSCpuRef \
+	libcutils \
+	libutils \
+	liblog
+
+LOCAL_MODULE:= rstest-cpumathbench
+
+LOCAL_MODULE_TAGS := tests
+
+intermediates := $(call intermediates-dir-for,STATIC_LIBRARIES,libRS,TARGET,)
+
+LOCAL_C_INCLUDES += frameworks/compile/libbcc/include
+LOCAL_C_INCLUDES += frameworks/rs/cpu_ref
+LOCAL_C_INCLUDES += frameworks/rs
+LOCAL_C_INCLUDES += $(intermediates)
+
+LOCAL_CLANG := true
+
+include $(BUILD_EXECUTABLE)
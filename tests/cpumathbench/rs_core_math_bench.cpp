@@ -0,0 +1,495 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Don't edit this file!  It is auto-generated by frameworks/rs/api/gen_runtime.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "rsCpuCore.h"
+#include "rsCpuScript.h"
+
+using namespace android;
+using namespace android::renderscript;
+
+namespace {
+
+typedef float (*Fn1)(float);
+typedef float (*Fn2)(float, float);
+typedef float (*Fn3)(float, float, float);
+
+struct BenchEntry {
+    const char* name;       // e.g. pow(float4, float4)
+    const char* symbol;     // Mangled scalar name in the CPU runtime math table
+    int vectorSize;
+    int inputCount;
+    int isVector[3];        // 0 if the argument is a scalar broadcast to all lanes
+    float minValue[3];
+    float maxValue[3];
+    double (*reference)(const double* args);
+};
+
+double ref_acos_1(const double* a) {
+    return acos(a[0]);
+}
+
+double ref_acosh_1(const double* a) {
+    return acosh(a[0]);
+}
+
+double ref_asin_1(const double* a) {
+    return asin(a[0]);
+}
+
+double ref_asinh_1(const double* a) {
+    return asinh(a[0]);
+}
+
+double ref_atan_1(const double* a) {
+    return atan(a[0]);
+}
+
+double ref_atan2_2(const double* a) {
+    return atan2(a[0], a[1]);
+}
+
+double ref_atanh_1(const double* a) {
+    return atanh(a[0]);
+}
+
+double ref_cbrt_1(const double* a) {
+    return cbrt(a[0]);
+}
+
+double ref_ceil_1(const double* a) {
+    return ceil(a[0]);
+}
+
+double ref_copysign_2(const double* a) {
+    return copysign(a[0], a[1]);
+}
+
+double ref_cos_1(const double* a) {
+    return cos(a[0]);
+}
+
+double ref_cosh_1(const double* a) {
+    return cosh(a[0]);
+}
+
+double ref_erf_1(const double* a) {
+    return erf(a[0]);
+}
+
+double ref_erfc_1(const double* a) {
+    return erfc(a[0]);
+}
+
+double ref_exp_1(const double* a) {
+    return exp(a[0]);
+}
+
+double ref_exp2_1(const double* a) {
+    return exp2(a[0]);
+}
+
+double ref_expm1_1(const double* a) {
+    return expm1(a[0]);
+}
+
+double ref_fdim_2(const double* a) {
+    return fdim(a[0], a[1]);
+}
+
+double ref_floor_1(const double* a) {
+    return floor(a[0]);
+}
+
+double ref_fma_3(const double* a) {
+    return fma(a[0], a[1], a[2]);
+}
+
+double ref_fmax_2(const double* a) {
+    return fmax(a[0], a[1]);
+}
+
+double ref_fmin_2(const double* a) {
+    return fmin(a[0], a[1]);
+}
+
+double ref_fmod_2(const double* a) {
+    return fmod(a[0], a[1]);
+}
+
+double ref_hypot_2(const double* a) {
+    return hypot(a[0], a[1]);
+}
+
+double ref_lgamma_1(const double* a) {
+    return lgamma(a[0]);
+}
+
+double ref_log_1(const double* a) {
+    return log(a[0]);
+}
+
+double ref_log10_1(const double* a) {
+    return log10(a[0]);
+}
+
+double ref_log1p_1(const double* a) {
+    return log1p(a[0]);
+}
+
+double ref_logb_1(const double* a) {
+    return logb(a[0]);
+}
+
+double ref_nextafter_2(const double* a) {
+    return nextafter(a[0], a[1]);
+}
+
+double ref_pow_2(const double* a) {
+    return pow(a[0], a[1]);
+}
+
+double ref_remainder_2(const double* a) {
+    return remainder(a[0], a[1]);
+}
+
+double ref_rint_1(const double* a) {
+    return rint(a[0]);
+}
+
+double ref_round_1(const double* a) {
+    return round(a[0]);
+}
+
+double ref_sin_1(const double* a) {
+    return sin(a[0]);
+}
+
+double ref_sinh_1(const double* a) {
+    return sinh(a[0]);
+}
+
+double ref_sqrt_1(const double* a) {
+    return sqrt(a[0]);
+}
+
+double ref_tan_1(const double* a) {
+    return tan(a[0]);
+}
+
+double ref_tanh_1(const double* a) {
+    return tanh(a[0]);
+}
+
+double ref_tgamma_1(const double* a) {
+    return tgamma(a[0]);
+}
+
+double ref_trunc_1(const double* a) {
+    return trunc(a[0]);
+}
+
+
+const BenchEntry ENTRIES[] = {
+    {"acos(float)", "_Z4acosf", 1, 1, {0, 0, 0}, {-1, 0, 0}, {1, 0, 0}, &ref_acos_1},
+    {"acos(float2)", "_Z4acosf", 2, 1, {1, 0, 0}, {-1, 0, 0}, {1, 0, 0}, &ref_acos_1},
+    {"acos(float3)", "_Z4acosf", 3, 1, {1, 0, 0}, {-1, 0, 0}, {1, 0, 0}, &ref_acos_1},
+    {"acos(float4)", "_Z4acosf", 4, 1, {1, 0, 0}, {-1, 0, 0}, {1, 0, 0}, &ref_acos_1},
+    {"acosh(float)", "_Z5acoshf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_acosh_1},
+    {"acosh(float2)", "_Z5acoshf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_acosh_1},
+    {"acosh(float3)", "_Z5acoshf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_acosh_1},
+    {"acosh(float4)", "_Z5acoshf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_acosh_1},
+    {"asin(float)", "_Z4asinf", 1, 1, {0, 0, 0}, {-1, 0, 0}, {1, 0, 0}, &ref_asin_1},
+    {"asin(float2)", "_Z4asinf", 2, 1, {1, 0, 0}, {-1, 0, 0}, {1, 0, 0}, &ref_asin_1},
+    {"asin(float3)", "_Z4asinf", 3, 1, {1, 0, 0}, {-1, 0, 0}, {1, 0, 0}, &ref_asin_1},
+    {"asin(float4)", "_Z4asinf", 4, 1, {1, 0, 0}, {-1, 0, 0}, {1, 0, 0}, &ref_asin_1},
+    {"asinh(float)", "_Z5asinhf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_asinh_1},
+    {"asinh(float2)", "_Z5asinhf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_asinh_1},
+    {"asinh(float3)", "_Z5asinhf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_asinh_1},
+    {"asinh(float4)", "_Z5asinhf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_asinh_1},
+    {"atan(float)", "_Z4atanf", 1, 1, {0, 0, 0}, {-1, 0, 0}, {1, 0, 0}, &ref_atan_1},
+    {"atan(float2)", "_Z4atanf", 2, 1, {1, 0, 0}, {-1, 0, 0}, {1, 0, 0}, &ref_atan_1},
+    {"atan(float3)", "_Z4atanf", 3, 1, {1, 0, 0}, {-1, 0, 0}, {1, 0, 0}, &ref_atan_1},
+    {"atan(float4)", "_Z4atanf", 4, 1, {1, 0, 0}, {-1, 0, 0}, {1, 0, 0}, &ref_atan_1},
+    {"atan2(float, float)", "_Z5atan2ff", 1, 2, {0, 0, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_atan2_2},
+    {"atan2(float2, float2)", "_Z5atan2ff", 2, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_atan2_2},
+    {"atan2(float3, float3)", "_Z5atan2ff", 3, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_atan2_2},
+    {"atan2(float4, float4)", "_Z5atan2ff", 4, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_atan2_2},
+    {"atanh(float)", "_Z5atanhf", 1, 1, {0, 0, 0}, {-1, 0, 0}, {1, 0, 0}, &ref_atanh_1},
+    {"atanh(float2)", "_Z5atanhf", 2, 1, {1, 0, 0}, {-1, 0, 0}, {1, 0, 0}, &ref_atanh_1},
+    {"atanh(float3)", "_Z5atanhf", 3, 1, {1, 0, 0}, {-1, 0, 0}, {1, 0, 0}, &ref_atanh_1},
+    {"atanh(float4)", "_Z5atanhf", 4, 1, {1, 0, 0}, {-1, 0, 0}, {1, 0, 0}, &ref_atanh_1},
+    {"cbrt(float)", "_Z4cbrtf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_cbrt_1},
+    {"cbrt(float2)", "_Z4cbrtf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_cbrt_1},
+    {"cbrt(float3)", "_Z4cbrtf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_cbrt_1},
+    {"cbrt(float4)", "_Z4cbrtf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_cbrt_1},
+    {"ceil(float)", "_Z4ceilf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_ceil_1},
+    {"ceil(float2)", "_Z4ceilf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_ceil_1},
+    {"ceil(float3)", "_Z4ceilf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_ceil_1},
+    {"ceil(float4)", "_Z4ceilf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_ceil_1},
+    {"copysign(float, float)", "_Z8copysignff", 1, 2, {0, 0, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_copysign_2},
+    {"copysign(float2, float2)", "_Z8copysignff", 2, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_copysign_2},
+    {"copysign(float3, float3)", "_Z8copysignff", 3, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_copysign_2},
+    {"copysign(float4, float4)", "_Z8copysignff", 4, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_copysign_2},
+    {"cos(float)", "_Z3cosf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_cos_1},
+    {"cos(float2)", "_Z3cosf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_cos_1},
+    {"cos(float3)", "_Z3cosf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_cos_1},
+    {"cos(float4)", "_Z3cosf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_cos_1},
+    {"cosh(float)", "_Z4coshf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_cosh_1},
+    {"cosh(float2)", "_Z4coshf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_cosh_1},
+    {"cosh(float3)", "_Z4coshf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_cosh_1},
+    {"cosh(float4)", "_Z4coshf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_cosh_1},
+    {"erf(float)", "_Z3erff", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_erf_1},
+    {"erf(float2)", "_Z3erff", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_erf_1},
+    {"erf(float3)", "_Z3erff", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_erf_1},
+    {"erf(float4)", "_Z3erff", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_erf_1},
+    {"erfc(float)", "_Z4erfcf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_erfc_1},
+    {"erfc(float2)", "_Z4erfcf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_erfc_1},
+    {"erfc(float3)", "_Z4erfcf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_erfc_1},
+    {"erfc(float4)", "_Z4erfcf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_erfc_1},
+    {"exp(float)", "_Z3expf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_exp_1},
+    {"exp(float2)", "_Z3expf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_exp_1},
+    {"exp(float3)", "_Z3expf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_exp_1},
+    {"exp(float4)", "_Z3expf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_exp_1},
+    {"exp2(float)", "_Z4exp2f", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_exp2_1},
+    {"exp2(float2)", "_Z4exp2f", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_exp2_1},
+    {"exp2(float3)", "_Z4exp2f", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_exp2_1},
+    {"exp2(float4)", "_Z4exp2f", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_exp2_1},
+    {"expm1(float)", "_Z5expm1f", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_expm1_1},
+    {"expm1(float2)", "_Z5expm1f", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_expm1_1},
+    {"expm1(float3)", "_Z5expm1f", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_expm1_1},
+    {"expm1(float4)", "_Z5expm1f", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_expm1_1},
+    {"fdim(float, float)", "_Z4fdimff", 1, 2, {0, 0, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fdim_2},
+    {"fdim(float2, float2)", "_Z4fdimff", 2, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fdim_2},
+    {"fdim(float3, float3)", "_Z4fdimff", 3, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fdim_2},
+    {"fdim(float4, float4)", "_Z4fdimff", 4, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fdim_2},
+    {"floor(float)", "_Z5floorf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_floor_1},
+    {"floor(float2)", "_Z5floorf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_floor_1},
+    {"floor(float3)", "_Z5floorf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_floor_1},
+    {"floor(float4)", "_Z5floorf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_floor_1},
+    {"fma(float, float, float)", "_Z3fmafff", 1, 3, {0, 0, 0}, {-100, -100, -100}, {100, 100, 100}, &ref_fma_3},
+    {"fma(float2, float2, float2)", "_Z3fmafff", 2, 3, {1, 1, 1}, {-100, -100, -100}, {100, 100, 100}, &ref_fma_3},
+    {"fma(float3, float3, float3)", "_Z3fmafff", 3, 3, {1, 1, 1}, {-100, -100, -100}, {100, 100, 100}, &ref_fma_3},
+    {"fma(float4, float4, float4)", "_Z3fmafff", 4, 3, {1, 1, 1}, {-100, -100, -100}, {100, 100, 100}, &ref_fma_3},
+    {"fmax(float, float)", "_Z4fmaxff", 1, 2, {0, 0, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fmax_2},
+    {"fmax(float2, float2)", "_Z4fmaxff", 2, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fmax_2},
+    {"fmax(float3, float3)", "_Z4fmaxff", 3, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fmax_2},
+    {"fmax(float4, float4)", "_Z4fmaxff", 4, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fmax_2},
+    {"fmax(float2, float)", "_Z4fmaxff", 2, 2, {1, 0, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fmax_2},
+    {"fmax(float3, float)", "_Z4fmaxff", 3, 2, {1, 0, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fmax_2},
+    {"fmax(float4, float)", "_Z4fmaxff", 4, 2, {1, 0, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fmax_2},
+    {"fmin(float, float)", "_Z4fminff", 1, 2, {0, 0, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fmin_2},
+    {"fmin(float2, float2)", "_Z4fminff", 2, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fmin_2},
+    {"fmin(float3, float3)", "_Z4fminff", 3, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fmin_2},
+    {"fmin(float4, float4)", "_Z4fminff", 4, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fmin_2},
+    {"fmin(float2, float)", "_Z4fminff", 2, 2, {1, 0, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fmin_2},
+    {"fmin(float3, float)", "_Z4fminff", 3, 2, {1, 0, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fmin_2},
+    {"fmin(float4, float)", "_Z4fminff", 4, 2, {1, 0, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fmin_2},
+    {"fmod(float, float)", "_Z4fmodff", 1, 2, {0, 0, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fmod_2},
+    {"fmod(float2, float2)", "_Z4fmodff", 2, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fmod_2},
+    {"fmod(float3, float3)", "_Z4fmodff", 3, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fmod_2},
+    {"fmod(float4, float4)", "_Z4fmodff", 4, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_fmod_2},
+    {"hypot(float, float)", "_Z5hypotff", 1, 2, {0, 0, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_hypot_2},
+    {"hypot(float2, float2)", "_Z5hypotff", 2, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_hypot_2},
+    {"hypot(float3, float3)", "_Z5hypotff", 3, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_hypot_2},
+    {"hypot(float4, float4)", "_Z5hypotff", 4, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_hypot_2},
+    {"lgamma(float)", "_Z6lgammaf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_lgamma_1},
+    {"lgamma(float2)", "_Z6lgammaf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_lgamma_1},
+    {"lgamma(float3)", "_Z6lgammaf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_lgamma_1},
+    {"lgamma(float4)", "_Z6lgammaf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_lgamma_1},
+    {"log(float)", "_Z3logf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_log_1},
+    {"log(float2)", "_Z3logf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_log_1},
+    {"log(float3)", "_Z3logf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_log_1},
+    {"log(float4)", "_Z3logf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_log_1},
+    {"log10(float)", "_Z5log10f", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_log10_1},
+    {"log10(float2)", "_Z5log10f", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_log10_1},
+    {"log10(float3)", "_Z5log10f", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_log10_1},
+    {"log10(float4)", "_Z5log10f", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_log10_1},
+    {"log1p(float)", "_Z5log1pf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_log1p_1},
+    {"log1p(float2)", "_Z5log1pf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_log1p_1},
+    {"log1p(float3)", "_Z5log1pf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_log1p_1},
+    {"log1p(float4)", "_Z5log1pf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_log1p_1},
+    {"logb(float)", "_Z4logbf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_logb_1},
+    {"logb(float2)", "_Z4logbf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_logb_1},
+    {"logb(float3)", "_Z4logbf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_logb_1},
+    {"logb(float4)", "_Z4logbf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_logb_1},
+    {"nextafter(float, float)", "_Z9nextafterff", 1, 2, {0, 0, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_nextafter_2},
+    {"nextafter(float2, float2)", "_Z9nextafterff", 2, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_nextafter_2},
+    {"nextafter(float3, float3)", "_Z9nextafterff", 3, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_nextafter_2},
+    {"nextafter(float4, float4)", "_Z9nextafterff", 4, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_nextafter_2},
+    {"pow(float, float)", "_Z3powff", 1, 2, {0, 0, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_pow_2},
+    {"pow(float2, float2)", "_Z3powff", 2, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_pow_2},
+    {"pow(float3, float3)", "_Z3powff", 3, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_pow_2},
+    {"pow(float4, float4)", "_Z3powff", 4, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_pow_2},
+    {"remainder(float, float)", "_Z9remainderff", 1, 2, {0, 0, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_remainder_2},
+    {"remainder(float2, float2)", "_Z9remainderff", 2, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_remainder_2},
+    {"remainder(float3, float3)", "_Z9remainderff", 3, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_remainder_2},
+    {"remainder(float4, float4)", "_Z9remainderff", 4, 2, {1, 1, 0}, {-100, -100, 0}, {100, 100, 0}, &ref_remainder_2},
+    {"rint(float)", "_Z4rintf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_rint_1},
+    {"rint(float2)", "_Z4rintf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_rint_1},
+    {"rint(float3)", "_Z4rintf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_rint_1},
+    {"rint(float4)", "_Z4rintf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_rint_1},
+    {"round(float)", "_Z5roundf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_round_1},
+    {"round(float2)", "_Z5roundf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_round_1},
+    {"round(float3)", "_Z5roundf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_round_1},
+    {"round(float4)", "_Z5roundf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_round_1},
+    {"sin(float)", "_Z3sinf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_sin_1},
+    {"sin(float2)", "_Z3sinf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_sin_1},
+    {"sin(float3)", "_Z3sinf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_sin_1},
+    {"sin(float4)", "_Z3sinf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_sin_1},
+    {"sinh(float)", "_Z4sinhf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_sinh_1},
+    {"sinh(float2)", "_Z4sinhf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_sinh_1},
+    {"sinh(float3)", "_Z4sinhf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_sinh_1},
+    {"sinh(float4)", "_Z4sinhf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_sinh_1},
+    {"sqrt(float)", "_Z4sqrtf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_sqrt_1},
+    {"sqrt(float2)", "_Z4sqrtf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_sqrt_1},
+    {"sqrt(float3)", "_Z4sqrtf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_sqrt_1},
+    {"sqrt(float4)", "_Z4sqrtf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_sqrt_1},
+    {"tan(float)", "_Z3tanf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_tan_1},
+    {"tan(float2)", "_Z3tanf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_tan_1},
+    {"tan(float3)", "_Z3tanf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_tan_1},
+    {"tan(float4)", "_Z3tanf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_tan_1},
+    {"tanh(float)", "_Z4tanhf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_tanh_1},
+    {"tanh(float2)", "_Z4tanhf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_tanh_1},
+    {"tanh(float3)", "_Z4tanhf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_tanh_1},
+    {"tanh(float4)", "_Z4tanhf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_tanh_1},
+    {"tgamma(float)", "_Z6tgammaf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_tgamma_1},
+    {"tgamma(float2)", "_Z6tgammaf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_tgamma_1},
+    {"tgamma(float3)", "_Z6tgammaf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_tgamma_1},
+    {"tgamma(float4)", "_Z6tgammaf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_tgamma_1},
+    {"trunc(float)", "_Z5truncf", 1, 1, {0, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_trunc_1},
+    {"trunc(float2)", "_Z5truncf", 2, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_trunc_1},
+    {"trunc(float3)", "_Z5truncf", 3, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_trunc_1},
+    {"trunc(float4)", "_Z5truncf", 4, 1, {1, 0, 0}, {-100, 0, 0}, {100, 0, 0}, &ref_trunc_1},
+};
+
+const int NUM_ENTRIES = sizeof(ENTRIES) / sizeof(ENTRIES[0]);
+
+double ulpError(float actual, double expected) {
+    if (isnan(expected)) {
+        return isnan(actual) ? 0.0 : INFINITY;
+    }
+    if (isinf(expected) || fabs(expected) > 0x1.fffffep127) {
+        return (isinf(actual) && (actual > 0) == (expected > 0)) ? 0.0 : INFINITY;
+    }
+    int exponent;
+    frexp(expected, &exponent);
+    double ulp = ldexp(1.0, exponent - 24 < -149 ? -149 : exponent - 24);
+    return fabs((double)actual - expected) / ulp;
+}
+
+double nowNs() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+// Runs the entry over count vectors; returns the time per element in ns.
+double runEntry(const BenchEntry& e, void* fn, const float* in[3], float* out,
+                int count, int iterations) {
+    const int lanes = e.vectorSize;
+    double start = nowNs();
+    for (int it = 0; it < iterations; it++) {
+        for (int v = 0; v < count; v++) {
+            for (int l = 0; l < lanes; l++) {
+                int o = v * lanes + l;
+                float a = in[0][e.isVector[0] ? o : v];
+                switch (e.inputCount) {
+                case 1:
+                    out[o] = ((Fn1)fn)(a);
+                    break;
+                case 2:
+                    out[o] = ((Fn2)fn)(a, in[1][e.isVector[1] ? o : v]);
+                    break;
+                default:
+                    out[o] = ((Fn3)fn)(a, in[1][e.isVector[1] ? o : v],
+                                       in[2][e.isVector[2] ? o : v]);
+                    break;
+                }
+            }
+        }
+    }
+    return (nowNs() - start) / ((double)iterations * count * lanes);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 10;
+    int count = argc > 2 ? atoi(argv[2]) : 4096;
+    if (iterations <= 0 || count <= 0) {
+        printf("Usage: %s [iterations] [vectors]\n", argv[0]);
+        return 1;
+    }
+
+    float* in[3];
+    for (int i = 0; i < 3; i++) {
+        in[i] = new float[count * 4];
+    }
+    float* out = new float[count * 4];
+
+    printf("%-40s %12s %12s\n", "function", "max ulp", "ns/element");
+    int missing = 0;
+    for (int i = 0; i < NUM_ENTRIES; i++) {
+        const BenchEntry& e = ENTRIES[i];
+        const RsdCpuReference::CpuSymbol* sym =
+                RsdCpuScriptImpl::lookupSymbolMath(e.symbol);
+        if (!sym) {
+            printf("%-40s %12s\n", e.name, "(not in runtime)");
+            missing++;
+            continue;
+        }
+
+        srand(i);
+        for (int a = 0; a < e.inputCount; a++) {
+            for (int j = 0; j < count * 4; j++) {
+                float r = (float)rand() / RAND_MAX;
+                in[a][j] = e.minValue[a] + r * (e.maxValue[a] - e.minValue[a]);
+            }
+        }
+        const float* inputs[3] = {in[0], in[1], in[2]};
+        double ns = runEntry(e, sym->fnPtr, inputs, out, count, iterations);
+
+        double maxUlp = 0.0;
+        for (int v = 0; v < count; v++) {
+            for (int l = 0; l < e.vectorSize; l++) {
+                int o = v * e.vectorSize + l;
+                double args[3];
+                for (int a = 0; a < e.inputCount; a++) {
+                    args[a] = in[a][e.isVector[a] ? o : v];
+                }
+                double u = ulpError(out[o], e.reference(args));
+                if (u > maxUlp) {
+                    maxUlp = u;
+                }
+            }
+        }
+        printf("%-40s %12.2f %12.3f\n", e.name, maxUlp, ns);
+    }
+    printf("%d functions, %d not found in the CPU runtime.\n", NUM_ENTRIES, missing);
+
+    for (int i = 0; i < 3; i++) {
+        delete[] in[i];
+    }
+    delete[] out;
+    return 0;
+}
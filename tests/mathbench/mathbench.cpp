@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RenderScript.h"
+#include <float.h>
+#include <math.h>
+#include <sys/time.h>
+
+#include "ScriptC_mathbench.h"
+
+using namespace android;
+using namespace RSC;
+
+// Reports, for each math builtin, the worst error in ulps against a double
+// precision libm reference and the time per element of the float and float4
+// overloads over the same inputs.
+
+static float randRange(float lo, float hi) {
+    return lo + (hi - lo) * ((float)rand() / RAND_MAX);
+}
+
+static double ulpError(float got, double ref) {
+    if (isnan(ref)) {
+        return isnan(got) ? 0.0 : INFINITY;
+    }
+    if (isinf(ref) || fabs(ref) > FLT_MAX) {
+        return ((double)got == ref || isinf(got)) ? 0.0 : INFINITY;
+    }
+    int e;
+    frexp(ref, &e);
+    double ulp = ldexp(1.0, (e - 24) < -149 ? -149 : (e - 24));
+    return fabs((double)got - ref) / ulp;
+}
+
+static double maxUlp(const float *in, const float *y, const float *out, int count,
+                     double (*ref1)(double), double (*ref2)(double, double)) {
+    double worst = 0.0;
+    for (int i = 0; i < count; i++) {
+        double r = ref2 ? ref2(in[i], y[i]) : ref1(in[i]);
+        double u = ulpError(out[i], r);
+        if (u > worst) {
+            worst = u;
+        }
+    }
+    return worst;
+}
+
+static long long elapsedUs(const struct timeval &start, const struct timeval &stop) {
+    return (stop.tv_sec * 1000000) - (start.tv_sec * 1000000) + (stop.tv_usec - start.tv_usec);
+}
+
+static double ref_exp2(double v) { return pow(2.0, v); }
+static double ref_log2(double v) { return log(v) / log(2.0); }
+
+int main(int argc, char** argv)
+{
+    int iters = 20;
+    int numElems = 1 << 18;
+
+    if (argc >= 2) {
+        iters = atoi(argv[1]);
+        if (iters <= 0) {
+            printf("iters must be positive\n");
+            return 1;
+        }
+    }
+    if (argc >= 3) {
+        numElems = atoi(argv[2]) & ~3;
+        if (numElems <= 0) {
+            printf("numElems must be a positive multiple of 4\n");
+            return 1;
+        }
+    }
+
+    printf("iters = %d, numElems = %d\n", iters, numElems);
+
+    sp<RS> rs = new RS();
+    if (!rs->init("/system/bin")) {
+        printf("Could not initialize RenderScript\n");
+        return 1;
+    }
+
+    Type::Builder tb1(rs, Element::F32(rs));
+    tb1.setX(numElems);
+    sp<const Type> t1 = tb1.create();
+    Type::Builder tb4(rs, Element::F32_4(rs));
+    tb4.setX(numElems / 4);
+    sp<const Type> t4 = tb4.create();
+
+    sp<Allocation> in1 = Allocation::createTyped(rs, t1);
+    sp<Allocation> out1 = Allocation::createTyped(rs, t1);
+    sp<Allocation> in4 = Allocation::createTyped(rs, t4);
+    sp<Allocation> out4 = Allocation::createTyped(rs, t4);
+    sp<Allocation> ay = Allocation::createTyped(rs, t1);
+
+    float *in = new float[numElems];
+    float *y = new float[numElems];
+    float *out = new float[numElems];
+
+    sp<ScriptC_mathbench> sc = new ScriptC_mathbench(rs);
+    sc->set_gY(ay);
+
+    printf("%-12s %10s %10s %12s %12s\n", "function", "ulp(f1)", "ulp(f4)",
+           "ns/el(f1)", "ns/el(f4)");
+
+#define RUN_BENCH(fnc, lo, hi, ref1, ref2)                                  \
+    {                                                                       \
+        for (int i = 0; i < numElems; i++) {                                \
+            in[i] = randRange(lo, hi);                                      \
+            y[i] = randRange(-8.f, 8.f);                                    \
+        }                                                                   \
+        in1->copy1DFrom(in);                                                \
+        in4->copy1DFrom(in);                                                \
+        ay->copy1DFrom(y);                                                  \
+        struct timeval start, stop;                                         \
+                                                                            \
+        sc->forEach_##fnc##_f1(in1, out1);                                  \
+        rs->finish();                                                       \
+        gettimeofday(&start, NULL);                                         \
+        for (int i = 0; i < iters; i++) {                                   \
+            sc->forEach_##fnc##_f1(in1, out1);                              \
+        }                                                                   \
+        rs->finish();                                                       \
+        gettimeofday(&stop, NULL);                                          \
+        double ns1 = elapsedUs(start, stop) * 1000.0 / iters / numElems;    \
+        out1->copy1DTo(out);                                                \
+        double ulp1 = maxUlp(in, y, out, numElems, ref1, ref2);             \
+                                                                            \
+        sc->forEach_##fnc##_f4(in4, out4);                                  \
+        rs->finish();                                                       \
+        gettimeofday(&start, NULL);                                         \
+        for (int i = 0; i < iters; i++) {                                   \
+            sc->forEach_##fnc##_f4(in4, out4);                              \
+        }                                                                   \
+        rs->finish();                                                       \
+        gettimeofday(&stop, NULL);                                          \
+        double ns4 = elapsedUs(start, stop) * 1000.0 / iters / numElems;    \
+        out4->copy1DTo(out);                                                \
+        double ulp4 = maxUlp(in, y, out, numElems, ref1, ref2);             \
+                                                                            \
+        printf("%-12s %10.2f %10.2f %12.3f %12.3f\n", #fnc, ulp1, ulp4,     \
+               ns1, ns4);                                                   \
+    }
+
+    RUN_BENCH(exp, -87.f, 88.f, exp, NULL)
+    RUN_BENCH(exp2, -126.f, 127.f, ref_exp2, NULL)
+    RUN_BENCH(log, 1e-30f, 1e30f, log, NULL)
+    RUN_BENCH(sin, -100.f, 100.f, sin, NULL)
+    RUN_BENCH(cos, -100.f, 100.f, cos, NULL)
+    RUN_BENCH(pow, 1e-3f, 100.f, NULL, pow)
+    RUN_BENCH(native_exp, -80.f, 80.f, exp, NULL)
+    RUN_BENCH(native_log2, 1e-30f, 1e30f, ref_log2, NULL)
+
+#undef RUN_BENCH
+
+    delete [] in;
+    delete [] y;
+    delete [] out;
+
+    return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma version(1)
+#pragma rs java_package_name(com.android.rs.cpptests)
+
+// Second operand of pow, one float per lane.
+rs_allocation gY;
+
+#define MATH_KERNELS(fnc)                                       \
+float RS_KERNEL fnc##_f1(float in) {                            \
+    return fnc(in);                                             \
+}                                                               \
+float4 RS_KERNEL fnc##_f4(float4 in) {                          \
+    return fnc(in);                                             \
+}
+
+MATH_KERNELS(exp)
+MATH_KERNELS(exp2)
+MATH_KERNELS(log)
+MATH_KERNELS(sin)
+MATH_KERNELS(cos)
+MATH_KERNELS(native_exp)
+MATH_KERNELS(native_log2)
+
+float RS_KERNEL pow_f1(float in, uint32_t x) {
+    return pow(in, rsGetElementAt_float(gY, x));
+}
+
+float4 RS_KERNEL pow_f4(float4 in, uint32_t x) {
+    float4 y;
+    y.x = rsGetElementAt_float(gY, x * 4);
+    y.y = rsGetElementAt_float(gY, x * 4 + 1);
+    y.z = rsGetElementAt_float(gY, x * 4 + 2);
+    y.w = rsGetElementAt_float(gY, x * 4 + 3);
+    return pow(in, y);
+}
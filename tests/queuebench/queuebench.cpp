@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2014 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RenderScript.h"
+#include <pthread.h>
+#include <sys/time.h>
+
+using namespace android;
+using namespace RSC;
+
+// Measures aggregate throughput of many small kernel launches, first issued
+// from one thread through the default command queue and then split across
+// several client threads, each bound to its own CommandQueue.  A single
+// command stream only accepts calls from one thread at a time.
+
+static const uint32_t kDim = 64;
+
+static double now() {
+    struct timeval t;
+    gettimeofday(&t, NULL);
+    return t.tv_sec + t.tv_usec * 1e-6;
+}
+
+struct Worker {
+    sp<RS> rs;
+    sp<CommandQueue> queue;
+    sp<ScriptIntrinsicColorMatrix> cm;
+    sp<Allocation> in;
+    sp<Allocation> out;
+    int iters;
+    pthread_t thread;
+};
+
+static void * workerProc(void *v) {
+    Worker *w = (Worker *)v;
+    if (w->queue != NULL) {
+        w->queue->bind();
+    }
+    for (int i = 0; i < w->iters; i++) {
+        w->cm->forEach(w->in, w->out);
+    }
+    w->rs->finish();
+    if (w->queue != NULL) {
+        CommandQueue::unbind(w->rs);
+    }
+    return NULL;
+}
+
+static double run(sp<RS> rs, Worker *workers, int count) {
+    double t0 = now();
+    for (int i = 0; i < count; i++) {
+        pthread_create(&workers[i].thread, NULL, workerProc, &workers[i]);
+    }
+    for (int i = 0; i < count; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    rs->finish();
+    return now() - t0;
+}
+
+int main(int argc, char** argv)
+{
+    int threads = 4;
+    int iters = 2000;
+    if (argc >= 2) {
+        threads = atoi(argv[1]);
+    }
+    if (argc >= 3) {
+        iters = atoi(argv[2]);
+    }
+    if (threads <= 0 || iters <= 0) {
+        printf("usage: %s [threads] [iters]\n", argv[0]);
+        return 1;
+    }
+
+    sp<RS> rs = new RS();
+    if (!rs->init("/system/bin")) {
+        printf("Could not initialize RenderScript\n");
+        return 1;
+    }
+
+    Type::Builder tb(rs, Element::RGBA_8888(rs));
+    tb.setX(kDim);
+    tb.setY(kDim);
+    sp<const Type> t = tb.create();
+
+    Worker *workers = new Worker[threads];
+    for (int i = 0; i < threads; i++) {
+        // Each thread gets its own script so no state is shared across queues.
+        workers[i].rs = rs;
+        workers[i].cm = ScriptIntrinsicColorMatrix::create(rs);
+        workers[i].cm->setGreyscale();
+        workers[i].in = Allocation::createTyped(rs, t);
+        workers[i].out = Allocation::createTyped(rs, t);
+        workers[i].iters = iters;
+    }
+
+    const double launches = (double)threads * iters;
+    double t0 = now();
+    for (int j = 0; j < iters; j++) {
+        for (int i = 0; i < threads; i++) {
+            workers[i].cm->forEach(workers[i].in, workers[i].out);
+        }
+    }
+    rs->finish();
+    double secs = now() - t0;
+    printf("default queue   1 thread   %10.0f launches/s\n", launches / secs);
+
+    for (int i = 0; i < threads; i++) {
+        workers[i].queue = CommandQueue::create(rs);
+        if (workers[i].queue == NULL) {
+            printf("Could not create command queue\n");
+            return 1;
+        }
+    }
+    secs = run(rs, workers, threads);
+    printf("%2i queues      %2i threads  %10.0f launches/s\n", threads, threads, launches / secs);
+
+    delete [] workers;
+    return 0;
+}